@@ -0,0 +1,66 @@
+#include "alloc_counter.h"
+
+#include <errno.h>
+#include <stddef.h>
+
+#include <atomic>
+
+// glibc exports its allocator under these names as well, so the replacements
+// below can forward to it without dlsym(), which allocates itself.
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+}
+
+static std::atomic<uint64_t> allocations(0);
+
+static inline void Count() {
+	allocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t AllocCounter::Get() {
+	return allocations.load(std::memory_order_relaxed);
+}
+
+extern "C" {
+
+void* malloc(size_t size) {
+	Count();
+	return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+	Count();
+	return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+	// Shrinking or growing in place is not an allocation, but glibc doesn't
+	// tell, so every call counts.
+	Count();
+	return __libc_realloc(ptr, size);
+}
+
+void* memalign(size_t alignment, size_t size) {
+	Count();
+	return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+	Count();
+	return __libc_memalign(alignment, size);
+}
+
+// av_malloc() allocates with this one.
+int posix_memalign(void** ptr, size_t alignment, size_t size) {
+	Count();
+	void* result = __libc_memalign(alignment, size);
+	if (!result && size)
+		return ENOMEM;
+	*ptr = result;
+	return 0;
+}
+
+}  // extern "C"
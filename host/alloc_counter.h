@@ -0,0 +1,19 @@
+#ifndef HOST_ALLOC_COUNTER_H_
+#define HOST_ALLOC_COUNTER_H_
+
+#include <stdint.h>
+
+/// @file
+/// @brief Counts heap allocations of the whole process, FFmpeg included.
+///
+/// Linking alloc_counter.cc replaces the malloc family for the binary, the
+/// replacements count calls and forward to glibc.
+
+namespace AllocCounter {
+
+/// Returns the number of allocations made so far.
+uint64_t Get();
+
+}  // namespace AllocCounter
+
+#endif  // HOST_ALLOC_COUNTER_H_
@@ -0,0 +1,279 @@
+// Loads players through MessageReceiver and PlayerProvider, like the
+// messages of the application do, until the resource budget is used up, and
+// checks that the next player is rejected with kPlayerRejected and that
+// closing a player hands its decoder slot and buffered bytes to the next one.
+// The players play a file served by an in-process RTSPTestServer. Exits with
+// 1 if a check fails.
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "ppapi/cpp/instance.h"
+#include "ppapi/cpp/var_dictionary.h"
+
+#include "logger.h"
+#include "message_receiver.h"
+#include "message_sender.h"
+#include "messages.h"
+#include "player_provider.h"
+#include "resource_budget.h"
+#include "rtsp_player_controller.h"
+
+#include "packet_recorder.h"
+#include "rtsp_test_server.h"
+
+using Communication::ClipTypeEnum;
+using Communication::MessageFromPlayer;
+using Communication::MessageReceiver;
+using Communication::MessageToPlayer;
+
+namespace {
+
+const PP_Instance kBudgetInstance = 1;
+const int kDefaultDecoderSlots = 4;
+/// Players connect and fill their buffers before packets are counted.
+const int kWarmupS = 3;
+
+/// Remembers the players which were rejected. Log lines and messages go to
+/// stderr and stdout with -d only.
+class BudgetInstance : public pp::Instance {
+	public:
+		explicit BudgetInstance(bool verbose)
+			: pp::Instance(kBudgetInstance), verbose_(verbose) {}
+
+		bool WasRejected(int32_t player_id) {
+			std::lock_guard<std::mutex> lock(mutex_);
+			return rejected_.count(player_id) > 0;
+		}
+
+		void ClearRejected() {
+			std::lock_guard<std::mutex> lock(mutex_);
+			rejected_.clear();
+		}
+
+	protected:
+		void OnPostMessage(const pp::Var& message) override {
+			if (message.is_string()) {
+				if (verbose_)
+					pp::Instance::OnPostMessage(message);
+				return;
+			}
+			pp::VarDictionary dictionary(message);
+			int32_t type =
+			    dictionary.Get(Communication::kKeyMessageFromPlayer).AsInt();
+			if (type == MessageFromPlayer::kPlayerRejected) {
+				std::lock_guard<std::mutex> lock(mutex_);
+				rejected_.insert(dictionary.Get(Communication::kKeyPlayerId).AsInt());
+			}
+			if (verbose_)
+				printf("%s\n", message.DebugString().c_str());
+		}
+
+	private:
+		bool verbose_;
+		std::mutex mutex_;
+		std::set<int32_t> rejected_;
+};
+
+/// Hands messages to the receiver as the JS side of the application would
+/// send them.
+class Application {
+	public:
+		Application(MessageReceiver* receiver, const std::string& url,
+		            const std::string& transport)
+			: receiver_(receiver), url_(url), transport_(transport) {}
+
+		void Load(int32_t player_id) {
+			pp::VarDictionary message = Message(MessageToPlayer::kLoadMedia, player_id);
+			message.Set(Communication::kKeyType, static_cast<int32_t>(ClipTypeEnum::kRTSP));
+			message.Set(Communication::kKeyUrl, url_);
+			if (!transport_.empty())
+				message.Set(Communication::kKeyTransport, transport_);
+			Send(message);
+		}
+
+		void Play(int32_t player_id) {
+			Send(Message(MessageToPlayer::kPlay, player_id));
+		}
+
+		void Close(int32_t player_id) {
+			Send(Message(MessageToPlayer::kClosePlayer, player_id));
+		}
+
+	private:
+		static pp::VarDictionary Message(MessageToPlayer action, int32_t player_id) {
+			pp::VarDictionary message;
+			message.Set(Communication::kKeyMessageToPlayer, static_cast<int32_t>(action));
+			message.Set(Communication::kKeyPlayerId, player_id);
+			return message;
+		}
+
+		void Send(const pp::Var& message) {
+			receiver_->HandleMessage(pp::InstanceHandle(kBudgetInstance), message);
+		}
+
+		MessageReceiver* receiver_;
+		std::string url_;
+		std::string transport_;
+};
+
+void PrintUsage(const char* name) {
+	fprintf(stderr,
+	        "usage: %s [-d] [-t transport] [-n decoder_slots] <file>\n"
+	        "  -d  enable debug logs and print messages\n"
+	        "  -t  udp or tcp (default tcp)\n"
+	        "  -n  decoder slots of the budget, one more player is loaded "
+	        "(default %d)\n",
+	        name, kDefaultDecoderSlots);
+}
+
+void PrintBudget(const char* step, const ResourceBudget& budget) {
+	ResourceBudget::Usage usage = budget.GetUsage();
+	printf("%-24s  slots %u/%u  buffered bytes %" PRIu64 "/%" PRIu64 "\n", step,
+	       usage.decoder_slots, budget.GetLimits().decoder_slots,
+	       static_cast<uint64_t>(usage.buffered_bytes),
+	       static_cast<uint64_t>(budget.GetLimits().buffered_bytes));
+	fflush(stdout);
+}
+
+/// Runs the checks, returns what failed or NULL.
+const char* RunChecks(BudgetInstance* instance, Application* application,
+                      const ResourceBudget& budget) {
+	const int32_t slots = budget.GetLimits().decoder_slots;
+	std::vector<size_t> granted(slots);
+	for (int32_t id = 0; id < slots; ++id) {
+		ResourceBudget::Usage before = budget.GetUsage();
+		application->Load(id);
+		application->Play(id);
+		ResourceBudget::Usage after = budget.GetUsage();
+		PrintBudget("loaded player", budget);
+		if (instance->WasRejected(id))
+			return "a player within the budget was rejected";
+		if (after.decoder_slots != before.decoder_slots + 1)
+			return "a loaded player holds no decoder slot";
+		granted[id] = after.buffered_bytes - before.buffered_bytes;
+		if (!granted[id])
+			return "a loaded player got no buffered bytes";
+	}
+	ResourceBudget::Usage full = budget.GetUsage();
+
+	application->Load(slots);
+	PrintBudget("loaded one player more", budget);
+	if (!instance->WasRejected(slots))
+		return "a player over the budget wasn't rejected";
+	ResourceBudget::Usage usage = budget.GetUsage();
+	if (usage.decoder_slots != full.decoder_slots ||
+	    usage.buffered_bytes != full.buffered_bytes)
+		return "a rejected player holds resources";
+
+	// Player 0 was loaded first, so it got the largest share of the bytes.
+	application->Close(0);
+	PrintBudget("closed player 0", budget);
+	usage = budget.GetUsage();
+	if (usage.decoder_slots != full.decoder_slots - 1 ||
+	    usage.buffered_bytes != full.buffered_bytes - granted[0])
+		return "a closed player didn't release its resources";
+
+	instance->ClearRejected();
+	size_t released_bytes = usage.buffered_bytes;
+	application->Load(slots);
+	application->Play(slots);
+	PrintBudget("reloaded the rejected one", budget);
+	if (instance->WasRejected(slots))
+		return "the released decoder slot wasn't reused";
+	usage = budget.GetUsage();
+	if (usage.decoder_slots != full.decoder_slots)
+		return "the released decoder slot wasn't reused";
+	if (usage.buffered_bytes - released_bytes < granted[0])
+		return "the released buffered bytes weren't reused";
+
+	// The reloaded player plays on its own.
+	for (int32_t id = 1; id < slots; ++id)
+		application->Close(id);
+	PacketRecorder& recorder = PacketRecorder::Get();
+	uint64_t count = recorder.GetCount();
+	sleep(kWarmupS);
+	if (recorder.GetCount() == count)
+		return "the reloaded player got no packets";
+
+	application->Close(slots);
+	PrintBudget("closed all players", budget);
+	usage = budget.GetUsage();
+	if (usage.decoder_slots || usage.buffered_bytes)
+		return "closed players still hold resources";
+	return NULL;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+	bool verbose = false;
+	std::string transport;
+	int decoder_slots = kDefaultDecoderSlots;
+	int opt;
+	while ((opt = getopt(argc, argv, "dt:n:")) != -1) {
+		switch (opt) {
+			case 'd':
+				verbose = true;
+				Logger::EnableDebugLogs(true);
+				break;
+			case 't':
+				transport = optarg;
+				break;
+			case 'n':
+				decoder_slots = std::max(atoi(optarg), 2);
+				break;
+			default:
+				PrintUsage(argv[0]);
+				return 1;
+		}
+	}
+	if (optind >= argc) {
+		PrintUsage(argv[0]);
+		return 1;
+	}
+	std::string path = argv[optind];
+
+	RTSPTestServer server(path, RTSPTestServer::Impairments());
+	if (!server.Start(0))
+		return 1;
+	fprintf(stderr, "Serving %s at %s\n", path.c_str(), server.GetUrl().c_str());
+
+	BudgetInstance instance(verbose);
+	Logger::InitializeInstance(&instance);
+	PacketRecorder::Get().SetKeepRecords(false);
+
+	// Half of what the players ask for, so the last ones get less and the
+	// bytes a closed player releases matter.
+	ResourceBudget::Limits limits;
+	limits.decoder_slots = decoder_slots;
+	limits.buffered_bytes =
+	    decoder_slots * RTSPPlayerController::GetDefaultBufferedBytes() / 2;
+	auto provider = std::make_shared<PlayerProvider>(
+	    pp::InstanceHandle(&instance),
+	    std::make_shared<Communication::MessageSender>(&instance), limits);
+	const char* failure;
+	{
+		MessageReceiver receiver(provider);
+		Application application(&receiver, server.GetUrl(), transport);
+		failure = RunChecks(&instance, &application, *provider->GetResourceBudget());
+		// The receiver closes the players left when a check failed.
+	}
+	server.Stop();
+
+	if (failure) {
+		printf("FAILED: %s\n", failure);
+		return 1;
+	}
+	printf("PASSED\n");
+	return 0;
+}
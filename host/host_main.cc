@@ -0,0 +1,123 @@
+// Runs RTSPPlayerController natively against system FFmpeg, so the demuxing
+// and packet handling can be profiled with perf, valgrind or sanitizers
+// without a TV. Packets appended to the stub NaCl Player are recorded and
+// written out when the run ends. Sessions can be captured and replayed with
+// a "replay://<path>" URL, so runs of different builds get the same input.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+
+#include "ppapi/cpp/instance.h"
+
+#include "logger.h"
+#include "message_sender.h"
+#include "player_controller.h"
+#include "rtsp_player_controller.h"
+#include "stream_info_cache.h"
+#include "worker_pool.h"
+
+#include "packet_recorder.h"
+
+namespace {
+
+const PP_Instance kHostInstance = 1;
+const int kDefaultDurationS = 10;
+
+/// Writes messages meant for the JS side to stdout, log lines go to stderr.
+class HostInstance : public pp::Instance {
+	public:
+		HostInstance() : pp::Instance(kHostInstance) {}
+
+	protected:
+		void OnPostMessage(const pp::Var& message) override {
+			if (message.is_string()) {
+				pp::Instance::OnPostMessage(message);
+				return;
+			}
+			printf("%s\n", message.DebugString().c_str());
+		}
+};
+
+void PrintUsage(const char* name) {
+	fprintf(stderr,
+	        "usage: %s [-d] [-f] [-t transport] [-l target_latency] "
+	        "[-c capture] <url> [seconds] [packets.csv]\n"
+	        "  -d  enable debug logs\n"
+	        "  -f  replay a replay://<path> URL as fast as possible\n"
+	        "  -t  udp, tcp, udp_multicast or auto (default tcp)\n"
+	        "  -l  target latency in seconds, 0 disables dropping (default 0)\n"
+	        "  -c  capture the received packets to a file\n",
+	        name);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+	PlayerOptions options;
+	int opt;
+	while ((opt = getopt(argc, argv, "dft:l:c:")) != -1) {
+		switch (opt) {
+			case 'd':
+				Logger::EnableDebugLogs(true);
+				break;
+			case 'f':
+				options.replay_realtime = false;
+				break;
+			case 't':
+				options.transport = optarg;
+				break;
+			case 'l':
+				options.target_latency = atof(optarg);
+				break;
+			case 'c':
+				options.capture_path = optarg;
+				break;
+			default:
+				PrintUsage(argv[0]);
+				return 1;
+		}
+	}
+	if (optind >= argc) {
+		PrintUsage(argv[0]);
+		return 1;
+	}
+	std::string url = argv[optind];
+	int duration_s = optind + 1 < argc ? atoi(argv[optind + 1]) : kDefaultDurationS;
+	const char* csv_path = optind + 2 < argc ? argv[optind + 2] : NULL;
+
+	HostInstance instance;
+	Logger::InitializeInstance(&instance);
+
+	auto message_sender = std::make_shared<Communication::MessageSender>(&instance);
+	auto stream_info_cache = std::make_shared<StreamInfoCache>();
+	auto worker_pool = std::make_shared<WorkerPool>(
+	    pp::InstanceHandle(&instance), WorkerPool::kDefaultIoWorkers,
+	    WorkerPool::kDefaultProcessingWorkers);
+	{
+		auto controller = std::make_shared<RTSPPlayerController>(
+		    pp::InstanceHandle(&instance), message_sender, stream_info_cache,
+		    worker_pool);
+		controller->SetViewRect(Samsung::NaClPlayer::Rect(0, 0, 1920, 1080));
+		controller->InitPlayer(url, options);
+		controller->Play();
+		sleep(duration_s);
+		// The destructor stops the threads and closes the input.
+	}
+
+	PacketRecorder& recorder = PacketRecorder::Get();
+	if (csv_path) {
+		FILE* csv = fopen(csv_path, "w");
+		if (!csv) {
+			perror(csv_path);
+			return 1;
+		}
+		recorder.WriteCsv(csv);
+		fclose(csv);
+	}
+	recorder.WriteSummary(stdout);
+	return 0;
+}
@@ -0,0 +1,24 @@
+#ifndef HOST_NACL_PLAYER_BUFFERING_LISTENER_H_
+#define HOST_NACL_PLAYER_BUFFERING_LISTENER_H_
+
+#include <stdint.h>
+
+/// @file
+/// @brief Host build stand-in for the NaCl Player header of the same name.
+
+namespace Samsung {
+namespace NaClPlayer {
+
+class BufferingListener {
+	public:
+		virtual ~BufferingListener() {}
+
+		virtual void OnBufferingStart() {}
+		virtual void OnBufferingProgress(uint32_t /*percent*/) {}
+		virtual void OnBufferingComplete() {}
+};
+
+}  // namespace NaClPlayer
+}  // namespace Samsung
+
+#endif  // HOST_NACL_PLAYER_BUFFERING_LISTENER_H_
@@ -0,0 +1,57 @@
+#ifndef HOST_NACL_PLAYER_COMMON_H_
+#define HOST_NACL_PLAYER_COMMON_H_
+
+#include <stdint.h>
+
+/// @file
+/// @brief Host build stand-in for the NaCl Player header of the same name.
+
+namespace Samsung {
+namespace NaClPlayer {
+
+/// Time in seconds.
+typedef double TimeTicks;
+
+class Size {
+	public:
+		Size() : width_(0), height_(0) {}
+		Size(int32_t width, int32_t height) : width_(width), height_(height) {}
+
+		int32_t width() const { return width_; }
+		int32_t height() const { return height_; }
+
+	private:
+		int32_t width_;
+		int32_t height_;
+};
+
+class Rect {
+	public:
+		Rect() : x_(0), y_(0), width_(0), height_(0) {}
+		Rect(int32_t x, int32_t y, int32_t width, int32_t height)
+			: x_(x), y_(y), width_(width), height_(height) {}
+
+		int32_t x() const { return x_; }
+		int32_t y() const { return y_; }
+		int32_t width() const { return width_; }
+		int32_t height() const { return height_; }
+
+	private:
+		int32_t x_;
+		int32_t y_;
+		int32_t width_;
+		int32_t height_;
+};
+
+struct Rational {
+	Rational() : numerator(0), denominator(1) {}
+	Rational(int32_t num, int32_t den) : numerator(num), denominator(den) {}
+
+	int32_t numerator;
+	int32_t denominator;
+};
+
+}  // namespace NaClPlayer
+}  // namespace Samsung
+
+#endif  // HOST_NACL_PLAYER_COMMON_H_
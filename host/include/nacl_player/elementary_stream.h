@@ -0,0 +1,77 @@
+#ifndef HOST_NACL_PLAYER_ELEMENTARY_STREAM_H_
+#define HOST_NACL_PLAYER_ELEMENTARY_STREAM_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+
+#include "nacl_player/common.h"
+#include "nacl_player/elementary_stream_listener.h"
+#include "nacl_player/media_codecs.h"
+#include "nacl_player/media_common.h"
+
+/// @file
+/// @brief Host build stand-in for the NaCl Player header of the same name.
+
+namespace Samsung {
+namespace NaClPlayer {
+
+/// Records appended packets instead of decoding them, see
+/// <code>PacketRecorder</code>. Stream configuration is accepted and ignored.
+class ElementaryStream {
+	public:
+		virtual ~ElementaryStream() {}
+
+		int32_t SetCodecExtraData(uint32_t size, const void* data);
+		int32_t InitializeDone();
+		int32_t AppendPacket(const ESPacket& packet);
+		int32_t AppendEncryptedPacket(const ESPacket& packet,
+		                              const ESPacketEncryptionInfo& info);
+
+		/// Asks the listener for data, like the platform player does once
+		/// playback starts.
+		void RequestData();
+
+		/// Returns true for video streams.
+		virtual bool IsVideo() const = 0;
+
+	protected:
+		ElementaryStream() : initialized_(false) {}
+
+	private:
+		friend class ESDataSource;
+
+		std::weak_ptr<ElementaryStreamListener> listener_;
+		/// The highest PTS appended to any stream of the data source.
+		std::shared_ptr<std::atomic<TimeTicks> > appended_pts_;
+		bool initialized_;
+};
+
+class VideoElementaryStream : public ElementaryStream {
+	public:
+		void SetVideoCodecType(VideoCodec_Type) {}
+		void SetVideoCodecProfile(VideoCodec_Profile) {}
+		void SetVideoFrameFormat(VideoFrame_Format) {}
+		void SetVideoFrameSize(const Size&) {}
+		void SetFrameRate(const Rational&) {}
+
+		bool IsVideo() const override { return true; }
+};
+
+class AudioElementaryStream : public ElementaryStream {
+	public:
+		void SetAudioCodecType(AudioCodec_Type) {}
+		void SetAudioCodecProfile(AudioCodec_Profile) {}
+		void SetSampleFormat(SampleFormat) {}
+		void SetChannelLayout(ChannelLayout) {}
+		void SetBitsPerChannel(int32_t) {}
+		void SetSamplesPerSecond(int32_t) {}
+
+		bool IsVideo() const override { return false; }
+};
+
+}  // namespace NaClPlayer
+}  // namespace Samsung
+
+#endif  // HOST_NACL_PLAYER_ELEMENTARY_STREAM_H_
@@ -0,0 +1,26 @@
+#ifndef HOST_NACL_PLAYER_ELEMENTARY_STREAM_LISTENER_H_
+#define HOST_NACL_PLAYER_ELEMENTARY_STREAM_LISTENER_H_
+
+#include <stdint.h>
+
+#include "nacl_player/media_common.h"
+
+/// @file
+/// @brief Host build stand-in for the NaCl Player header of the same name.
+
+namespace Samsung {
+namespace NaClPlayer {
+
+class ElementaryStreamListener {
+	public:
+		virtual ~ElementaryStreamListener() {}
+
+		virtual void OnNeedData(int32_t /*bytes_max*/) {}
+		virtual void OnEnoughData() {}
+		virtual void OnSeekData(TimeTicks /*new_position*/) {}
+};
+
+}  // namespace NaClPlayer
+}  // namespace Samsung
+
+#endif  // HOST_NACL_PLAYER_ELEMENTARY_STREAM_LISTENER_H_
@@ -0,0 +1,21 @@
+#ifndef HOST_NACL_PLAYER_ERROR_CODES_H_
+#define HOST_NACL_PLAYER_ERROR_CODES_H_
+
+/// @file
+/// @brief Host build stand-in for the NaCl Player header of the same name.
+
+namespace Samsung {
+namespace NaClPlayer {
+
+enum ErrorCodes {
+	Success = 0,
+	CompletionPending = -1,
+	Failed = -2,
+	BadArgument = -4,
+	NoInterface = -6,
+};
+
+}  // namespace NaClPlayer
+}  // namespace Samsung
+
+#endif  // HOST_NACL_PLAYER_ERROR_CODES_H_
@@ -0,0 +1,46 @@
+#ifndef HOST_NACL_PLAYER_ES_DATA_SOURCE_H_
+#define HOST_NACL_PLAYER_ES_DATA_SOURCE_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "nacl_player/elementary_stream.h"
+#include "nacl_player/elementary_stream_listener.h"
+#include "nacl_player/media_data_source.h"
+
+/// @file
+/// @brief Host build stand-in for the NaCl Player header of the same name.
+
+namespace Samsung {
+namespace NaClPlayer {
+
+class ESDataSource : public MediaDataSource {
+	public:
+		ESDataSource();
+
+		int32_t AddStream(ElementaryStream& stream,
+		                  std::shared_ptr<ElementaryStreamListener> listener);
+
+		int32_t SetEndOfStream();
+
+		/// Calls <code>RequestData()</code> on all added streams.
+		void RequestData();
+
+		/// Returns the highest PTS appended so far, negative before the first
+		/// packet. It stays valid after the data source is destroyed.
+		std::shared_ptr<std::atomic<TimeTicks> > GetAppendedPts() const {
+			return appended_pts_;
+		}
+
+	private:
+		std::vector<ElementaryStream*> streams_;
+		std::shared_ptr<std::atomic<TimeTicks> > appended_pts_;
+};
+
+}  // namespace NaClPlayer
+}  // namespace Samsung
+
+#endif  // HOST_NACL_PLAYER_ES_DATA_SOURCE_H_
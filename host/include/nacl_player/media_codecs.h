@@ -0,0 +1,132 @@
+#ifndef HOST_NACL_PLAYER_MEDIA_CODECS_H_
+#define HOST_NACL_PLAYER_MEDIA_CODECS_H_
+
+/// @file
+/// @brief Host build stand-in for the NaCl Player header of the same name.
+/// Only the names matter on the host, the values are not the platform ones.
+
+namespace Samsung {
+namespace NaClPlayer {
+
+enum AudioCodec_Type {
+	AUDIOCODEC_TYPE_UNKNOWN,
+	AUDIOCODEC_TYPE_AAC,
+	AUDIOCODEC_TYPE_MP3,
+	AUDIOCODEC_TYPE_PCM,
+	AUDIOCODEC_TYPE_VORBIS,
+	AUDIOCODEC_TYPE_FLAC,
+	AUDIOCODEC_TYPE_AMR_NB,
+	AUDIOCODEC_TYPE_AMR_WB,
+	AUDIOCODEC_TYPE_PCM_MULAW,
+	AUDIOCODEC_TYPE_GSM_MS,
+	AUDIOCODEC_TYPE_PCM_S16BE,
+	AUDIOCODEC_TYPE_PCM_S24BE,
+	AUDIOCODEC_TYPE_OPUS,
+	AUDIOCODEC_TYPE_EAC3,
+	AUDIOCODEC_TYPE_MP2,
+	AUDIOCODEC_TYPE_DTS,
+	AUDIOCODEC_TYPE_AC3,
+	AUDIOCODEC_TYPE_WMAV1,
+	AUDIOCODEC_TYPE_WMAV2,
+};
+
+enum AudioCodec_Profile {
+	AUDIOCODEC_PROFILE_UNKNOWN,
+	AUDIOCODEC_PROFILE_AAC_MAIN,
+	AUDIOCODEC_PROFILE_AAC_LOW,
+	AUDIOCODEC_PROFILE_AAC_SSR,
+	AUDIOCODEC_PROFILE_AAC_LTP,
+	AUDIOCODEC_PROFILE_AAC_HE,
+	AUDIOCODEC_PROFILE_AAC_HE_V2,
+	AUDIOCODEC_PROFILE_AAC_LD,
+	AUDIOCODEC_PROFILE_AAC_ELD,
+};
+
+enum SampleFormat {
+	SAMPLEFORMAT_UNKNOWN,
+	SAMPLEFORMAT_U8,
+	SAMPLEFORMAT_S16,
+	SAMPLEFORMAT_S32,
+	SAMPLEFORMAT_F32,
+	SAMPLEFORMAT_PLANARS16,
+	SAMPLEFORMAT_PLANARF32,
+};
+
+enum ChannelLayout {
+	CHANNEL_LAYOUT_NONE,
+	CHANNEL_LAYOUT_UNSUPPORTED,
+	CHANNEL_LAYOUT_MONO,
+	CHANNEL_LAYOUT_STEREO,
+	CHANNEL_LAYOUT_2_1,
+	CHANNEL_LAYOUT_SURROUND,
+	CHANNEL_LAYOUT_4_0,
+	CHANNEL_LAYOUT_2_2,
+	CHANNEL_LAYOUT_QUAD,
+	CHANNEL_LAYOUT_5_0,
+	CHANNEL_LAYOUT_5_1,
+	CHANNEL_LAYOUT_5_0_BACK,
+	CHANNEL_LAYOUT_5_1_BACK,
+	CHANNEL_LAYOUT_7_0,
+	CHANNEL_LAYOUT_7_1,
+	CHANNEL_LAYOUT_7_1_WIDE,
+	CHANNEL_LAYOUT_STEREO_DOWNMIX,
+	CHANNEL_LAYOUT_2POINT1,
+	CHANNEL_LAYOUT_3_1,
+	CHANNEL_LAYOUT_4_1,
+	CHANNEL_LAYOUT_6_0,
+	CHANNEL_LAYOUT_6_0_FRONT,
+	CHANNEL_LAYOUT_HEXAGONAL,
+	CHANNEL_LAYOUT_6_1,
+	CHANNEL_LAYOUT_6_1_BACK,
+	CHANNEL_LAYOUT_6_1_FRONT,
+	CHANNEL_LAYOUT_7_0_FRONT,
+	CHANNEL_LAYOUT_7_1_WIDE_BACK,
+	CHANNEL_LAYOUT_OCTAGONAL,
+};
+
+enum VideoCodec_Type {
+	VIDEOCODEC_TYPE_UNKNOWN,
+	VIDEOCODEC_TYPE_H264,
+	VIDEOCODEC_TYPE_VC1,
+	VIDEOCODEC_TYPE_MPEG2,
+	VIDEOCODEC_TYPE_MPEG4,
+	VIDEOCODEC_TYPE_THEORA,
+	VIDEOCODEC_TYPE_VP8,
+	VIDEOCODEC_TYPE_VP9,
+	VIDEOCODEC_TYPE_H263,
+	VIDEOCODEC_TYPE_WMV1,
+	VIDEOCODEC_TYPE_WMV2,
+	VIDEOCODEC_TYPE_WMV3,
+	VIDEOCODEC_TYPE_INDEO3,
+};
+
+enum VideoCodec_Profile {
+	VIDEOCODEC_PROFILE_UNKNOWN,
+	VIDEOCODEC_PROFILE_H264_BASELINE,
+	VIDEOCODEC_PROFILE_H264_MAIN,
+	VIDEOCODEC_PROFILE_H264_EXTENDED,
+	VIDEOCODEC_PROFILE_H264_HIGH,
+	VIDEOCODEC_PROFILE_H264_HIGH10,
+	VIDEOCODEC_PROFILE_H264_HIGH422,
+	VIDEOCODEC_PROFILE_H264_HIGH444PREDICTIVE,
+	VIDEOCODEC_PROFILE_VP8_MAIN,
+	VIDEOCODEC_PROFILE_VP9_MAIN,
+	VIDEOCODEC_PROFILE_MPEG2_SIMPLE,
+	VIDEOCODEC_PROFILE_MPEG2_MAIN,
+	VIDEOCODEC_PROFILE_MPEG2_SNR_SCALABLE,
+	VIDEOCODEC_PROFILE_MPEG2_SS,
+	VIDEOCODEC_PROFILE_MPEG2_HIGH,
+	VIDEOCODEC_PROFILE_MPEG2_422,
+};
+
+enum VideoFrame_Format {
+	VIDEOFRAME_FORMAT_INVALID,
+	VIDEOFRAME_FORMAT_YV12,
+	VIDEOFRAME_FORMAT_YV16,
+	VIDEOFRAME_FORMAT_YV12A,
+};
+
+}  // namespace NaClPlayer
+}  // namespace Samsung
+
+#endif  // HOST_NACL_PLAYER_MEDIA_CODECS_H_
@@ -0,0 +1,66 @@
+#ifndef HOST_NACL_PLAYER_MEDIA_COMMON_H_
+#define HOST_NACL_PLAYER_MEDIA_COMMON_H_
+
+#include <stdint.h>
+
+#include <string>
+
+#include "nacl_player/common.h"
+
+/// @file
+/// @brief Host build stand-in for the NaCl Player header of the same name.
+
+namespace Samsung {
+namespace NaClPlayer {
+
+struct ESPacket {
+	ESPacket()
+		: buffer(NULL), size(0), pts(0), dts(0), duration(0), is_key_frame(false) {}
+
+	const void* buffer;
+	uint32_t size;
+	TimeTicks pts;
+	TimeTicks dts;
+	TimeTicks duration;
+	bool is_key_frame;
+};
+
+struct EncryptedSubsampleDescription {
+	uint32_t clear_bytes;
+	uint32_t cipher_bytes;
+};
+
+struct ESPacketEncryptionInfo {
+	ESPacketEncryptionInfo()
+		: key_id(NULL), key_id_size(0), iv(NULL), iv_size(0), subsamples(NULL),
+		  num_subsamples(0) {}
+
+	const void* key_id;
+	uint32_t key_id_size;
+	const void* iv;
+	uint32_t iv_size;
+	const EncryptedSubsampleDescription* subsamples;
+	uint32_t num_subsamples;
+};
+
+struct TextTrackInfo {
+	int32_t index;
+	std::string language;
+};
+
+enum MediaPlayerError {
+	MEDIAPLAYER_ERROR_NONE,
+	MEDIAPLAYER_ERROR_UNKNOWN,
+};
+
+enum MediaPlayerState {
+	MEDIAPLAYER_STATE_NONE,
+	MEDIAPLAYER_STATE_READY,
+	MEDIAPLAYER_STATE_PLAYING,
+	MEDIAPLAYER_STATE_PAUSED,
+};
+
+}  // namespace NaClPlayer
+}  // namespace Samsung
+
+#endif  // HOST_NACL_PLAYER_MEDIA_COMMON_H_
@@ -0,0 +1,18 @@
+#ifndef HOST_NACL_PLAYER_MEDIA_DATA_SOURCE_H_
+#define HOST_NACL_PLAYER_MEDIA_DATA_SOURCE_H_
+
+/// @file
+/// @brief Host build stand-in for the NaCl Player header of the same name.
+
+namespace Samsung {
+namespace NaClPlayer {
+
+class MediaDataSource {
+	public:
+		virtual ~MediaDataSource() {}
+};
+
+}  // namespace NaClPlayer
+}  // namespace Samsung
+
+#endif  // HOST_NACL_PLAYER_MEDIA_DATA_SOURCE_H_
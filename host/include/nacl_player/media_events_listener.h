@@ -0,0 +1,24 @@
+#ifndef HOST_NACL_PLAYER_MEDIA_EVENTS_LISTENER_H_
+#define HOST_NACL_PLAYER_MEDIA_EVENTS_LISTENER_H_
+
+#include "nacl_player/media_common.h"
+
+/// @file
+/// @brief Host build stand-in for the NaCl Player header of the same name.
+
+namespace Samsung {
+namespace NaClPlayer {
+
+class MediaEventsListener {
+	public:
+		virtual ~MediaEventsListener() {}
+
+		virtual void OnTimeUpdate(TimeTicks /*time*/) {}
+		virtual void OnEnded() {}
+		virtual void OnError(MediaPlayerError /*error*/) {}
+};
+
+}  // namespace NaClPlayer
+}  // namespace Samsung
+
+#endif  // HOST_NACL_PLAYER_MEDIA_EVENTS_LISTENER_H_
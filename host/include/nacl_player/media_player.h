@@ -0,0 +1,86 @@
+#ifndef HOST_NACL_PLAYER_MEDIA_PLAYER_H_
+#define HOST_NACL_PLAYER_MEDIA_PLAYER_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "nacl_player/buffering_listener.h"
+#include "nacl_player/common.h"
+#include "nacl_player/media_data_source.h"
+#include "nacl_player/media_events_listener.h"
+
+/// @file
+/// @brief Host build stand-in for the NaCl Player header of the same name.
+
+namespace Samsung {
+namespace NaClPlayer {
+
+class ESDataSource;
+
+/// Has no pipeline: attaching a data source completes buffering at once and
+/// once playing, the streams ask for data without a limit.
+///
+/// Playback is simulated by a clock which starts once packets are appended,
+/// advances in real time and stalls when it reaches the last appended PTS,
+/// like a player running out of data. It is reported through
+/// <code>MediaEventsListener::OnTimeUpdate()</code> from a thread of its own.
+class MediaPlayer {
+	public:
+		MediaPlayer() : data_source_(NULL), playing_(false) {}
+		~MediaPlayer();
+
+		MediaPlayer(const MediaPlayer&) = delete;
+		MediaPlayer& operator=(const MediaPlayer&) = delete;
+
+		void SetMediaEventsListener(std::shared_ptr<MediaEventsListener> listener) {
+			events_listener_ = listener;
+		}
+		void SetBufferingListener(std::shared_ptr<BufferingListener> listener) {
+			buffering_listener_ = listener;
+		}
+
+		int32_t SetDisplayRect(const Rect& view_rect);
+		int32_t SetDisplayRect(const Rect& view_rect,
+		                       const std::function<void(int32_t)>& callback);
+
+		int32_t AttachDataSource(MediaDataSource& data_source);
+
+		int32_t Play();
+		int32_t Stop();
+
+	private:
+		/// Shared with the clock thread, which may outlive the player.
+		struct ClockState {
+			ClockState() : running(true) {}
+
+			std::mutex mutex;
+			std::condition_variable stop;
+			bool running;
+		};
+
+		void StartClock();
+		void StopClock();
+		static void RunClock(std::shared_ptr<ClockState> state,
+		                     std::shared_ptr<std::atomic<TimeTicks> > appended_pts,
+		                     std::shared_ptr<MediaEventsListener> listener);
+
+		std::shared_ptr<MediaEventsListener> events_listener_;
+		std::shared_ptr<BufferingListener> buffering_listener_;
+		ESDataSource* data_source_;
+		std::shared_ptr<std::atomic<TimeTicks> > appended_pts_;
+		bool playing_;
+
+		std::shared_ptr<ClockState> clock_;
+		std::thread clock_thread_;
+};
+
+}  // namespace NaClPlayer
+}  // namespace Samsung
+
+#endif  // HOST_NACL_PLAYER_MEDIA_PLAYER_H_
@@ -0,0 +1,11 @@
+#ifndef HOST_PPAPI_C_PP_STDINT_H_
+#define HOST_PPAPI_C_PP_STDINT_H_
+
+/// @file
+/// @brief Host build stand-in for the PPAPI header of the same name.
+
+#include <stdint.h>
+
+typedef int32_t PP_Instance;
+
+#endif  // HOST_PPAPI_C_PP_STDINT_H_
@@ -0,0 +1,30 @@
+#ifndef HOST_PPAPI_CPP_COMPLETION_CALLBACK_H_
+#define HOST_PPAPI_CPP_COMPLETION_CALLBACK_H_
+
+#include <stdint.h>
+
+#include <functional>
+
+/// @file
+/// @brief Host build stand-in for <code>pp::CompletionCallback</code>.
+
+namespace pp {
+
+class CompletionCallback {
+	public:
+		CompletionCallback() {}
+		explicit CompletionCallback(std::function<void(int32_t)> function)
+			: function_(std::move(function)) {}
+
+		void Run(int32_t result) const {
+			if (function_)
+				function_(result);
+		}
+
+	private:
+		std::function<void(int32_t)> function_;
+};
+
+}  // namespace pp
+
+#endif  // HOST_PPAPI_CPP_COMPLETION_CALLBACK_H_
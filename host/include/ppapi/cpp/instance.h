@@ -0,0 +1,37 @@
+#ifndef HOST_PPAPI_CPP_INSTANCE_H_
+#define HOST_PPAPI_CPP_INSTANCE_H_
+
+#include "ppapi/c/pp_stdint.h"
+#include "ppapi/cpp/instance_handle.h"
+#include "ppapi/cpp/var.h"
+
+/// @file
+/// @brief Host build stand-in for <code>pp::Instance</code>.
+
+namespace pp {
+
+class Instance {
+	public:
+		explicit Instance(PP_Instance instance) : pp_instance_(instance) {}
+		virtual ~Instance() {}
+
+		PP_Instance pp_instance() const { return pp_instance_; }
+
+		virtual void HandleMessage(const Var& /*message*/) {}
+
+		/// Hands <code>message</code> to <code>OnPostMessage()</code>, there is
+		/// no JS side to deliver it to. May be called from any thread.
+		void PostMessage(const Var& message) { OnPostMessage(message); }
+
+	protected:
+		/// Receives messages posted by the module. Strings, which are log
+		/// lines, are written to stderr, the rest is ignored.
+		virtual void OnPostMessage(const Var& message);
+
+	private:
+		PP_Instance pp_instance_;
+};
+
+}  // namespace pp
+
+#endif  // HOST_PPAPI_CPP_INSTANCE_H_
@@ -0,0 +1,26 @@
+#ifndef HOST_PPAPI_CPP_INSTANCE_HANDLE_H_
+#define HOST_PPAPI_CPP_INSTANCE_HANDLE_H_
+
+#include "ppapi/c/pp_stdint.h"
+
+/// @file
+/// @brief Host build stand-in for <code>pp::InstanceHandle</code>.
+
+namespace pp {
+
+class Instance;
+
+class InstanceHandle {
+	public:
+		InstanceHandle(Instance* instance);
+		explicit InstanceHandle(PP_Instance pp_instance) : pp_instance_(pp_instance) {}
+
+		PP_Instance pp_instance() const { return pp_instance_; }
+
+	private:
+		PP_Instance pp_instance_;
+};
+
+}  // namespace pp
+
+#endif  // HOST_PPAPI_CPP_INSTANCE_HANDLE_H_
@@ -0,0 +1,25 @@
+#ifndef HOST_PPAPI_CPP_MESSAGE_HANDLER_H_
+#define HOST_PPAPI_CPP_MESSAGE_HANDLER_H_
+
+#include "ppapi/cpp/instance_handle.h"
+#include "ppapi/cpp/var.h"
+
+/// @file
+/// @brief Host build stand-in for <code>pp::MessageHandler</code>. Nothing
+/// registers it, host tools call <code>HandleMessage()</code> themselves.
+
+namespace pp {
+
+class MessageHandler {
+	public:
+		virtual ~MessageHandler() {}
+
+		virtual void HandleMessage(InstanceHandle instance, const Var& message_data) = 0;
+		virtual Var HandleBlockingMessage(InstanceHandle instance,
+		                                  const Var& message_data) = 0;
+		virtual void WasUnregistered(InstanceHandle instance) = 0;
+};
+
+}  // namespace pp
+
+#endif  // HOST_PPAPI_CPP_MESSAGE_HANDLER_H_
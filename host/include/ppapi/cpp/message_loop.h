@@ -0,0 +1,40 @@
+#ifndef HOST_PPAPI_CPP_MESSAGE_LOOP_H_
+#define HOST_PPAPI_CPP_MESSAGE_LOOP_H_
+
+#include <stdint.h>
+
+#include <memory>
+
+#include "ppapi/cpp/completion_callback.h"
+#include "ppapi/cpp/instance_handle.h"
+
+/// @file
+/// @brief Host build stand-in for <code>pp::MessageLoop</code>.
+
+namespace pp {
+
+/// A queue of callbacks run by the thread which called <code>Run()</code>.
+/// Copies refer to the same queue, like copies of a PPAPI resource.
+class MessageLoop {
+	public:
+		MessageLoop();
+		explicit MessageLoop(const InstanceHandle& instance);
+
+		/// Queues <code>callback</code> to be run with <code>PP_OK</code> after
+		/// <code>delay_ms</code>. Fails once the loop has been told to quit.
+		int32_t PostWork(const CompletionCallback& callback, int64_t delay_ms = 0);
+
+		/// Runs queued callbacks until <code>PostQuit()</code>. Work posted before
+		/// the quit is run first.
+		int32_t Run();
+
+		int32_t PostQuit(bool should_destroy);
+
+	private:
+		struct Queue;
+		std::shared_ptr<Queue> queue_;
+};
+
+}  // namespace pp
+
+#endif  // HOST_PPAPI_CPP_MESSAGE_LOOP_H_
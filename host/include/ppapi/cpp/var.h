@@ -0,0 +1,58 @@
+#ifndef HOST_PPAPI_CPP_VAR_H_
+#define HOST_PPAPI_CPP_VAR_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <string>
+
+/// @file
+/// @brief Host build stand-in for <code>pp::Var</code>. It supports the value
+/// types the player sends and receives.
+
+namespace pp {
+
+class Var {
+	public:
+		Var() : type_(kUndefined), bool_(false), int_(0), double_(0) {}
+		Var(bool value) : type_(kBool), bool_(value), int_(0), double_(0) {}
+		Var(int32_t value) : type_(kInt), bool_(false), int_(value), double_(value) {}
+		Var(double value) : type_(kDouble), bool_(false), int_(value), double_(value) {}
+		Var(const char* value)
+			: type_(kString), bool_(false), int_(0), double_(0), string_(value) {}
+		Var(const std::string& value)
+			: type_(kString), bool_(false), int_(0), double_(0), string_(value) {}
+		virtual ~Var() {}
+
+		bool is_undefined() const { return type_ == kUndefined; }
+		bool is_bool() const { return type_ == kBool; }
+		bool is_int() const { return type_ == kInt; }
+		bool is_double() const { return type_ == kDouble; }
+		bool is_number() const { return type_ == kInt || type_ == kDouble; }
+		bool is_string() const { return type_ == kString; }
+		bool is_dictionary() const { return type_ == kDictionary; }
+
+		bool AsBool() const { return bool_; }
+		int32_t AsInt() const { return int_; }
+		double AsDouble() const { return double_; }
+		std::string AsString() const { return string_; }
+
+		/// Returns the value as text, e.g. for logging.
+		std::string DebugString() const;
+
+	protected:
+		enum Type { kUndefined, kBool, kInt, kDouble, kString, kDictionary };
+
+		Type type_;
+		bool bool_;
+		int32_t int_;
+		double double_;
+		std::string string_;
+		/// Entries of a dictionary, shared by copies like a PPAPI reference.
+		std::shared_ptr<std::map<std::string, Var> > entries_;
+};
+
+}  // namespace pp
+
+#endif  // HOST_PPAPI_CPP_VAR_H_
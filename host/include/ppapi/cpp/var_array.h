@@ -0,0 +1,40 @@
+#ifndef HOST_PPAPI_CPP_VAR_ARRAY_H_
+#define HOST_PPAPI_CPP_VAR_ARRAY_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "ppapi/cpp/var.h"
+
+/// @file
+/// @brief Host build stand-in for <code>pp::VarArray</code>. Only the keys of
+/// a dictionary are returned as one, so the elements are not shared with
+/// copies converted to <code>Var</code>.
+
+namespace pp {
+
+class VarArray : public Var {
+	public:
+		VarArray() {}
+
+		Var Get(uint32_t index) const {
+			return index < elements_.size() ? elements_[index] : Var();
+		}
+
+		bool Set(uint32_t index, const Var& value) {
+			if (index >= elements_.size())
+				elements_.resize(index + 1);
+			elements_[index] = value;
+			return true;
+		}
+
+		uint32_t GetLength() const { return static_cast<uint32_t>(elements_.size()); }
+
+	private:
+		std::vector<Var> elements_;
+};
+
+}  // namespace pp
+
+#endif  // HOST_PPAPI_CPP_VAR_ARRAY_H_
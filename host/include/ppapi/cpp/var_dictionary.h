@@ -0,0 +1,50 @@
+#ifndef HOST_PPAPI_CPP_VAR_DICTIONARY_H_
+#define HOST_PPAPI_CPP_VAR_DICTIONARY_H_
+
+#include "ppapi/cpp/var.h"
+#include "ppapi/cpp/var_array.h"
+
+/// @file
+/// @brief Host build stand-in for <code>pp::VarDictionary</code>.
+
+namespace pp {
+
+class VarDictionary : public Var {
+	public:
+		VarDictionary() {
+			type_ = kDictionary;
+			entries_ = std::make_shared<std::map<std::string, Var> >();
+		}
+		explicit VarDictionary(const Var& var) : Var(var) {
+			if (!entries_) {
+				type_ = kDictionary;
+				entries_ = std::make_shared<std::map<std::string, Var> >();
+			}
+		}
+
+		Var Get(const Var& key) const {
+			auto it = entries_->find(key.AsString());
+			return it == entries_->end() ? Var() : it->second;
+		}
+
+		bool Set(const Var& key, const Var& value) {
+			(*entries_)[key.AsString()] = value;
+			return true;
+		}
+
+		bool HasKey(const Var& key) const {
+			return entries_->count(key.AsString()) > 0;
+		}
+
+		VarArray GetKeys() const {
+			VarArray keys;
+			uint32_t index = 0;
+			for (const auto& entry : *entries_)
+				keys.Set(index++, Var(entry.first));
+			return keys;
+		}
+};
+
+}  // namespace pp
+
+#endif  // HOST_PPAPI_CPP_VAR_DICTIONARY_H_
@@ -0,0 +1,61 @@
+#ifndef HOST_PPAPI_UTILITY_COMPLETION_CALLBACK_FACTORY_H_
+#define HOST_PPAPI_UTILITY_COMPLETION_CALLBACK_FACTORY_H_
+
+#include <stdint.h>
+
+#include <memory>
+
+#include "ppapi/cpp/completion_callback.h"
+
+/// @file
+/// @brief Host build stand-in for <code>pp::CompletionCallbackFactory</code>.
+
+namespace pp {
+
+/// Makes callbacks calling methods of <code>T</code>. Like the PPAPI one,
+/// callbacks which run after the factory is destroyed do nothing.
+template <typename T>
+class CompletionCallbackFactory {
+	public:
+		explicit CompletionCallbackFactory(T* object)
+			: object_(std::make_shared<T*>(object)) {}
+
+		~CompletionCallbackFactory() { *object_ = NULL; }
+
+		CompletionCallbackFactory(const CompletionCallbackFactory&) = delete;
+		CompletionCallbackFactory& operator=(const CompletionCallbackFactory&) = delete;
+
+		template <typename Method>
+		CompletionCallback NewCallback(Method method) {
+			std::shared_ptr<T*> object = object_;
+			return CompletionCallback([object, method](int32_t result) {
+				if (*object)
+					((*object)->*method)(result);
+			});
+		}
+
+		template <typename Method, typename A>
+		CompletionCallback NewCallback(Method method, const A& a) {
+			std::shared_ptr<T*> object = object_;
+			return CompletionCallback([object, method, a](int32_t result) {
+				if (*object)
+					((*object)->*method)(result, a);
+			});
+		}
+
+		template <typename Method, typename A, typename B>
+		CompletionCallback NewCallback(Method method, const A& a, const B& b) {
+			std::shared_ptr<T*> object = object_;
+			return CompletionCallback([object, method, a, b](int32_t result) {
+				if (*object)
+					((*object)->*method)(result, a, b);
+			});
+		}
+
+	private:
+		std::shared_ptr<T*> object_;
+};
+
+}  // namespace pp
+
+#endif  // HOST_PPAPI_UTILITY_COMPLETION_CALLBACK_FACTORY_H_
@@ -0,0 +1,40 @@
+#ifndef HOST_PPAPI_UTILITY_THREADING_LOCK_H_
+#define HOST_PPAPI_UTILITY_THREADING_LOCK_H_
+
+#include <mutex>
+
+/// @file
+/// @brief Host build stand-in for <code>pp::Lock</code> and
+/// <code>pp::AutoLock</code>.
+
+namespace pp {
+
+class Lock {
+	public:
+		Lock() {}
+
+		Lock(const Lock&) = delete;
+		Lock& operator=(const Lock&) = delete;
+
+		void Acquire() { mutex_.lock(); }
+		void Release() { mutex_.unlock(); }
+
+	private:
+		std::mutex mutex_;
+};
+
+class AutoLock {
+	public:
+		explicit AutoLock(Lock& lock) : lock_(lock) { lock_.Acquire(); }
+		~AutoLock() { lock_.Release(); }
+
+		AutoLock(const AutoLock&) = delete;
+		AutoLock& operator=(const AutoLock&) = delete;
+
+	private:
+		Lock& lock_;
+};
+
+}  // namespace pp
+
+#endif  // HOST_PPAPI_UTILITY_THREADING_LOCK_H_
@@ -0,0 +1,39 @@
+#ifndef HOST_PPAPI_UTILITY_THREADING_SIMPLE_THREAD_H_
+#define HOST_PPAPI_UTILITY_THREADING_SIMPLE_THREAD_H_
+
+#include <thread>
+
+#include "ppapi/cpp/instance_handle.h"
+#include "ppapi/cpp/message_loop.h"
+
+/// @file
+/// @brief Host build stand-in for <code>pp::SimpleThread</code>.
+
+namespace pp {
+
+/// A thread running a <code>MessageLoop</code>. Like the PPAPI one, the
+/// destructor joins it.
+class SimpleThread {
+	public:
+		explicit SimpleThread(const InstanceHandle& instance);
+		~SimpleThread();
+
+		SimpleThread(const SimpleThread&) = delete;
+		SimpleThread& operator=(const SimpleThread&) = delete;
+
+		bool Start();
+
+		/// Makes the message loop quit once the work posted so far is done and
+		/// waits for the thread.
+		bool Join();
+
+		MessageLoop& message_loop() { return message_loop_; }
+
+	private:
+		MessageLoop message_loop_;
+		std::thread thread_;
+};
+
+}  // namespace pp
+
+#endif  // HOST_PPAPI_UTILITY_THREADING_SIMPLE_THREAD_H_
@@ -0,0 +1,229 @@
+// Plays a file through RTSPPlayerController from an in-process RTSPTestServer
+// which stalls periodically and then sends the packets it held back at once,
+// like a camera behind a congested link. Each burst leaves seconds of media
+// buffered, and the check is that the latency controller brings the latency
+// back to the target within a bound. Exits with 1 if the latency stays above
+// the target for longer than that, or never rose at all.
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "ppapi/cpp/instance.h"
+#include "ppapi/cpp/var_dictionary.h"
+
+#include "logger.h"
+#include "message_sender.h"
+#include "messages.h"
+#include "player_controller.h"
+#include "rtsp_player_controller.h"
+#include "stream_info_cache.h"
+#include "worker_pool.h"
+
+#include "packet_recorder.h"
+#include "rtsp_test_server.h"
+
+using Communication::MessageFromPlayer;
+
+namespace {
+
+const PP_Instance kLatencyInstance = 1;
+const int kDefaultDurationS = 60;
+const double kDefaultTargetLatencyS = 0.5;
+const int kDefaultStallIntervalS = 15;
+const int kDefaultStallMs = 3000;
+const int kDefaultMaxConvergeS = 5;
+/// The latency counts as back at the target below target plus this, which
+/// leaves room for the tolerance of the controller and a frame or two.
+const double kSettledMarginS = 0.5;
+/// The player connects and starts playing before the latency is checked.
+const int kWarmupS = 5;
+
+/// Picks the latency and reconnection failures out of the messages meant for
+/// the JS side. Log lines and messages go to stderr and stdout with -d only.
+class LatencyInstance : public pp::Instance {
+	public:
+		explicit LatencyInstance(bool verbose)
+			: pp::Instance(kLatencyInstance),
+			  verbose_(verbose),
+			  latency_ms_(0),
+			  dropped_frames_(0),
+			  reconnect_failed_(false) {}
+
+		int32_t GetLatencyMs() const { return latency_ms_; }
+		int32_t GetDroppedFrames() const { return dropped_frames_; }
+		bool ReconnectFailed() const { return reconnect_failed_; }
+
+	protected:
+		void OnPostMessage(const pp::Var& message) override {
+			if (message.is_string()) {
+				if (verbose_)
+					pp::Instance::OnPostMessage(message);
+				return;
+			}
+			pp::VarDictionary dictionary(message);
+			int32_t type =
+			    dictionary.Get(Communication::kKeyMessageFromPlayer).AsInt();
+			if (type == MessageFromPlayer::kSendPipelineStats) {
+				latency_ms_ = dictionary.Get(Communication::kKeyLatencyMs).AsInt();
+				dropped_frames_ =
+				    dictionary.Get(Communication::kKeyLatencyDroppedFrames).AsInt();
+			} else if (type == MessageFromPlayer::kReconnectFailed) {
+				reconnect_failed_ = true;
+			}
+			if (verbose_)
+				printf("%s\n", message.DebugString().c_str());
+		}
+
+	private:
+		bool verbose_;
+		std::atomic<int32_t> latency_ms_;
+		std::atomic<int32_t> dropped_frames_;
+		std::atomic<bool> reconnect_failed_;
+};
+
+void PrintUsage(const char* name) {
+	fprintf(stderr,
+	        "usage: %s [-d] [-t transport] [-l target_latency] [-S stall_interval_s] "
+	        "[-P stall_ms] [-c max_converge_s] <file> [seconds]\n"
+	        "  -d  enable debug logs and print messages\n"
+	        "  -t  udp or tcp (default tcp)\n"
+	        "  -l  target latency in seconds (default %g)\n"
+	        "  -S  stall after streaming this long, and again each interval "
+	        "(default %d)\n"
+	        "  -P  length of a stall in milliseconds, below the read timeout "
+	        "(default %d)\n"
+	        "  -c  seconds the latency may stay above the target after a burst "
+	        "(default %d)\n"
+	        "  seconds defaults to %d\n",
+	        name, kDefaultTargetLatencyS, kDefaultStallIntervalS, kDefaultStallMs,
+	        kDefaultMaxConvergeS, kDefaultDurationS);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+	PlayerOptions options;
+	options.target_latency = kDefaultTargetLatencyS;
+	RTSPTestServer::Impairments impairments;
+	impairments.stall_interval_s = kDefaultStallIntervalS;
+	impairments.stall_ms = kDefaultStallMs;
+	bool verbose = false;
+	int max_converge_s = kDefaultMaxConvergeS;
+	int opt;
+	while ((opt = getopt(argc, argv, "dt:l:S:P:c:")) != -1) {
+		switch (opt) {
+			case 'd':
+				verbose = true;
+				Logger::EnableDebugLogs(true);
+				break;
+			case 't':
+				options.transport = optarg;
+				break;
+			case 'l':
+				options.target_latency = atof(optarg);
+				break;
+			case 'S':
+				impairments.stall_interval_s = std::max(atoi(optarg), 1);
+				break;
+			case 'P':
+				impairments.stall_ms = std::max(atoi(optarg), 1);
+				break;
+			case 'c':
+				max_converge_s = std::max(atoi(optarg), 1);
+				break;
+			default:
+				PrintUsage(argv[0]);
+				return 1;
+		}
+	}
+	if (optind >= argc || options.target_latency <= 0) {
+		PrintUsage(argv[0]);
+		return 1;
+	}
+	std::string path = argv[optind];
+	int duration_s = optind + 1 < argc ? atoi(argv[optind + 1]) : kDefaultDurationS;
+
+	RTSPTestServer server(path, impairments);
+	if (!server.Start(0))
+		return 1;
+	fprintf(stderr, "Serving %s at %s\n", path.c_str(), server.GetUrl().c_str());
+
+	LatencyInstance instance(verbose);
+	Logger::InitializeInstance(&instance);
+	PacketRecorder& recorder = PacketRecorder::Get();
+	recorder.SetKeepRecords(false);
+
+	auto message_sender = std::make_shared<Communication::MessageSender>(&instance);
+	auto stream_info_cache = std::make_shared<StreamInfoCache>();
+	auto worker_pool = std::make_shared<WorkerPool>(
+	    pp::InstanceHandle(&instance), WorkerPool::kDefaultIoWorkers,
+	    WorkerPool::kDefaultProcessingWorkers);
+	const int32_t settled_ms = (options.target_latency + kSettledMarginS) * 1000;
+	uint32_t bursts = 0;
+	int max_above_s = 0;
+	const char* failure = NULL;
+	{
+		auto controller = std::make_shared<RTSPPlayerController>(
+		    pp::InstanceHandle(&instance), message_sender, stream_info_cache,
+		    worker_pool);
+		controller->SetViewRect(Samsung::NaClPlayer::Rect(0, 0, 1920, 1080));
+		controller->InitPlayer(server.GetUrl(), options);
+		controller->Play();
+
+		printf("target latency %d ms, settled below %d ms\n",
+		       static_cast<int32_t>(options.target_latency * 1000), settled_ms);
+		uint64_t last_count = 0;
+		int above_s = 0;
+		for (int s = 1; s <= duration_s && !failure; ++s) {
+			sleep(1);
+			uint64_t count = recorder.GetCount();
+			bool stalled = count == last_count;
+			last_count = count;
+			// Latency only counts while packets flow, it is stale otherwise.
+			if (s <= kWarmupS || stalled)
+				continue;
+
+			int32_t latency_ms = instance.GetLatencyMs();
+			if (latency_ms > settled_ms) {
+				if (!above_s++) {
+					++bursts;
+					printf("%6d s  burst, latency %d ms\n", s, latency_ms);
+				}
+			} else if (above_s) {
+				printf("%6d s  back at the target after %d s, latency %d ms\n", s,
+				       above_s, latency_ms);
+				above_s = 0;
+			}
+			max_above_s = std::max(max_above_s, above_s);
+			fflush(stdout);
+
+			if (instance.ReconnectFailed())
+				failure = "reconnecting failed";
+			else if (above_s > max_converge_s)
+				failure = "latency didn't come back to the target";
+		}
+		if (!failure && !bursts)
+			failure = "latency never rose above the target, the stalls had no effect";
+		// The destructor stops the threads and closes the input.
+	}
+	server.Stop();
+
+	RTSPTestServer::Stats stats = server.GetStats();
+	printf("sessions %" PRIu64 "  stalls %" PRIu64 "  appended packets %" PRIu64
+	       "\n", stats.sessions, stats.stalls, recorder.GetCount());
+	printf("bursts %u  longest above the target %d s  dropped frames %d\n",
+	       bursts, max_above_s, instance.GetDroppedFrames());
+	if (failure) {
+		printf("FAILED: %s\n", failure);
+		return 1;
+	}
+	printf("PASSED\n");
+	return 0;
+}
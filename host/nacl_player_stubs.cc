@@ -0,0 +1,181 @@
+// Host build implementation of the NaCl Player classes used by the player.
+// Nothing is decoded, appended packets go to the PacketRecorder.
+
+#include <algorithm>
+#include <chrono>
+
+#include "nacl_player/error_codes.h"
+#include "nacl_player/es_data_source.h"
+#include "nacl_player/media_player.h"
+
+#include "packet_recorder.h"
+
+namespace Samsung {
+namespace NaClPlayer {
+
+/// The platform player asks for data without a size limit with 0.
+static const int32_t kUnlimitedData = 0;
+/// How often the playback position is reported, the platform player reports
+/// it a few times a second too.
+static const int64_t kTimeUpdatePeriodMs = 250;
+
+int32_t ElementaryStream::SetCodecExtraData(uint32_t /*size*/,
+                                            const void* /*data*/) {
+	return ErrorCodes::Success;
+}
+
+int32_t ElementaryStream::InitializeDone() {
+	initialized_ = true;
+	return ErrorCodes::Success;
+}
+
+int32_t ElementaryStream::AppendPacket(const ESPacket& packet) {
+	if (!initialized_)
+		return ErrorCodes::Failed;
+	PacketRecorder::Get().Add(IsVideo(), packet);
+	if (appended_pts_) {
+		TimeTicks appended = appended_pts_->load();
+		while (packet.pts > appended &&
+		       !appended_pts_->compare_exchange_weak(appended, packet.pts)) {}
+	}
+	return ErrorCodes::Success;
+}
+
+int32_t ElementaryStream::AppendEncryptedPacket(
+    const ESPacket& packet, const ESPacketEncryptionInfo& /*info*/) {
+	return AppendPacket(packet);
+}
+
+void ElementaryStream::RequestData() {
+	std::shared_ptr<ElementaryStreamListener> listener = listener_.lock();
+	if (listener)
+		listener->OnNeedData(kUnlimitedData);
+}
+
+ESDataSource::ESDataSource()
+	: appended_pts_(std::make_shared<std::atomic<TimeTicks> >(-1)) {}
+
+int32_t ESDataSource::AddStream(
+    ElementaryStream& stream,
+    std::shared_ptr<ElementaryStreamListener> listener) {
+	stream.listener_ = listener;
+	stream.appended_pts_ = appended_pts_;
+	streams_.push_back(&stream);
+	return ErrorCodes::Success;
+}
+
+int32_t ESDataSource::SetEndOfStream() {
+	return ErrorCodes::Success;
+}
+
+void ESDataSource::RequestData() {
+	for (ElementaryStream* stream : streams_)
+		stream->RequestData();
+}
+
+int32_t MediaPlayer::SetDisplayRect(const Rect& /*view_rect*/) {
+	return ErrorCodes::Success;
+}
+
+int32_t MediaPlayer::SetDisplayRect(
+    const Rect& /*view_rect*/, const std::function<void(int32_t)>& callback) {
+	if (callback)
+		callback(ErrorCodes::Success);
+	return ErrorCodes::Success;
+}
+
+MediaPlayer::~MediaPlayer() {
+	StopClock();
+}
+
+int32_t MediaPlayer::AttachDataSource(MediaDataSource& data_source) {
+	data_source_ = dynamic_cast<ESDataSource*>(&data_source);
+	if (!data_source_)
+		return ErrorCodes::BadArgument;
+	appended_pts_ = data_source_->GetAppendedPts();
+	if (buffering_listener_) {
+		buffering_listener_->OnBufferingStart();
+		buffering_listener_->OnBufferingComplete();
+	}
+	if (playing_) {
+		StartClock();
+		data_source_->RequestData();
+	}
+	return ErrorCodes::Success;
+}
+
+int32_t MediaPlayer::Play() {
+	// The data source is usually attached after Play(), once the streams have
+	// been probed. Data is requested by whichever comes last.
+	playing_ = true;
+	if (data_source_) {
+		StartClock();
+		data_source_->RequestData();
+	}
+	return ErrorCodes::Success;
+}
+
+int32_t MediaPlayer::Stop() {
+	playing_ = false;
+	StopClock();
+	return ErrorCodes::Success;
+}
+
+void MediaPlayer::StartClock() {
+	if (clock_thread_.joinable())
+		return;
+	clock_ = std::make_shared<ClockState>();
+	clock_thread_ = std::thread(&MediaPlayer::RunClock, clock_, appended_pts_,
+	                            events_listener_);
+}
+
+void MediaPlayer::StopClock() {
+	if (!clock_thread_.joinable())
+		return;
+	{
+		std::lock_guard<std::mutex> lock(clock_->mutex);
+		clock_->running = false;
+	}
+	clock_->stop.notify_one();
+	// The last reference to the player may be dropped by the listener called
+	// from the clock thread itself.
+	if (clock_thread_.get_id() == std::this_thread::get_id())
+		clock_thread_.detach();
+	else
+		clock_thread_.join();
+}
+
+void MediaPlayer::RunClock(std::shared_ptr<ClockState> state,
+                           std::shared_ptr<std::atomic<TimeTicks> > appended_pts,
+                           std::shared_ptr<MediaEventsListener> listener) {
+	typedef std::chrono::steady_clock Clock;
+	TimeTicks position = -1;
+	Clock::time_point last_tick = Clock::now();
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	while (state->running) {
+		state->stop.wait_for(lock, std::chrono::milliseconds(kTimeUpdatePeriodMs));
+		if (!state->running)
+			break;
+		Clock::time_point now = Clock::now();
+		TimeTicks elapsed = std::chrono::duration<TimeTicks>(now - last_tick).count();
+		last_tick = now;
+
+		TimeTicks appended = appended_pts->load();
+		if (appended < 0)
+			continue;
+		if (position < 0)
+			position = appended;
+		else
+			position = std::min(position + elapsed, appended);
+
+		if (listener) {
+			lock.unlock();
+			listener->OnTimeUpdate(position);
+			lock.lock();
+		}
+	}
+}
+
+}  // namespace NaClPlayer
+}  // namespace Samsung
@@ -0,0 +1,95 @@
+#include "packet_recorder.h"
+
+#include <inttypes.h>
+#include <time.h>
+
+#include <algorithm>
+
+PacketRecorder& PacketRecorder::Get() {
+	static PacketRecorder recorder;
+	return recorder;
+}
+
+int64_t PacketRecorder::NowUs() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+void PacketRecorder::Add(bool is_video,
+                         const Samsung::NaClPlayer::ESPacket& packet) {
+	++count_;
+	if (!keep_records_)
+		return;
+
+	Record record;
+	record.is_video = is_video;
+	record.pts = packet.pts;
+	record.dts = packet.dts;
+	record.size = packet.size;
+	record.is_key_frame = packet.is_key_frame;
+	record.wall_clock_us = NowUs();
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	records_.push_back(record);
+}
+
+std::vector<PacketRecorder::Record> PacketRecorder::GetRecords() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return records_;
+}
+
+void PacketRecorder::WriteCsv(FILE* file) const {
+	std::vector<Record> records = GetRecords();
+	fprintf(file, "stream,pts,dts,size,key_frame,wall_clock_us\n");
+	for (const Record& record : records) {
+		fprintf(file, "%s,%.6f,%.6f,%u,%d,%" PRId64 "\n",
+		        record.is_video ? "video" : "audio", record.pts, record.dts,
+		        record.size, record.is_key_frame ? 1 : 0, record.wall_clock_us);
+	}
+}
+
+void PacketRecorder::WriteSummary(FILE* file) const {
+	std::vector<Record> records = GetRecords();
+	for (int video = 1; video >= 0; --video) {
+		std::vector<int64_t> intervals;
+		uint64_t bytes = 0;
+		uint32_t packets = 0;
+		uint32_t key_frames = 0;
+		int64_t first_us = 0;
+		int64_t last_us = 0;
+		for (const Record& record : records) {
+			if (record.is_video != (video != 0))
+				continue;
+			if (packets)
+				intervals.push_back(record.wall_clock_us - last_us);
+			else
+				first_us = record.wall_clock_us;
+			last_us = record.wall_clock_us;
+			bytes += record.size;
+			key_frames += record.is_key_frame;
+			++packets;
+		}
+
+		const char* name = video ? "video" : "audio";
+		if (!packets) {
+			fprintf(file, "%s: no packets\n", name);
+			continue;
+		}
+		double seconds = (last_us - first_us) / 1e6;
+		fprintf(file, "%s: %u packets (%u key), %" PRIu64 " bytes",
+		        name, packets, key_frames, bytes);
+		if (seconds > 0) {
+			fprintf(file, ", %.1f packets/s, %.1f kbit/s",
+			        (packets - 1) / seconds, bytes * 8 / seconds / 1000);
+		}
+		if (!intervals.empty()) {
+			std::sort(intervals.begin(), intervals.end());
+			fprintf(file, ", append interval us p50 %" PRId64 " p99 %" PRId64
+			        " max %" PRId64,
+			        intervals[intervals.size() / 2],
+			        intervals[intervals.size() * 99 / 100], intervals.back());
+		}
+		fprintf(file, "\n");
+	}
+}
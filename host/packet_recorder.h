@@ -0,0 +1,69 @@
+#ifndef HOST_PACKET_RECORDER_H_
+#define HOST_PACKET_RECORDER_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "nacl_player/media_common.h"
+
+/// @file
+/// @brief This file defines the <code>PacketRecorder</code> class.
+
+/// @class PacketRecorder
+/// @brief Collects packets appended to the stub elementary streams.
+///
+/// Each record carries the wall clock time of the append, so the output shows
+/// how regularly the controller feeds the platform player and how far the
+/// appended timestamps run ahead of real time.
+class PacketRecorder {
+	public:
+		struct Record {
+			bool is_video;
+			Samsung::NaClPlayer::TimeTicks pts;
+			Samsung::NaClPlayer::TimeTicks dts;
+			uint32_t size;
+			bool is_key_frame;
+			/// Monotonic wall clock time of the append in microseconds.
+			int64_t wall_clock_us;
+		};
+
+		static PacketRecorder& Get();
+
+		PacketRecorder(const PacketRecorder&) = delete;
+		PacketRecorder& operator=(const PacketRecorder&) = delete;
+
+		/// Records <code>packet</code>. May be called from any thread.
+		void Add(bool is_video, const Samsung::NaClPlayer::ESPacket& packet);
+
+		/// Makes <code>Add()</code> only count packets, which long runs need to
+		/// keep their memory bounded. Records are kept by default.
+		void SetKeepRecords(bool keep) { keep_records_ = keep; }
+
+		/// Returns the number of packets added so far.
+		uint64_t GetCount() const { return count_.load(); }
+
+		/// Returns a copy of the records collected so far.
+		std::vector<Record> GetRecords() const;
+
+		/// Writes all records as CSV with a header line.
+		void WriteCsv(FILE* file) const;
+
+		/// Writes packet counts, rates and the spread of append intervals.
+		void WriteSummary(FILE* file) const;
+
+		static int64_t NowUs();
+
+	private:
+		PacketRecorder() : keep_records_(true), count_(0) {}
+
+		std::atomic<bool> keep_records_;
+		std::atomic<uint64_t> count_;
+		mutable std::mutex mutex_;
+		std::vector<Record> records_;
+};
+
+#endif  // HOST_PACKET_RECORDER_H_
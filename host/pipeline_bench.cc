@@ -0,0 +1,496 @@
+// Feeds the packets of a capture or a local media file through the ES packet
+// conversion of RTSPPlayerController as fast as possible and reports the
+// throughput, the per packet latency, allocations, CPU time per packet and
+// the media time buffered before the first output packet of each path:
+// video, audio passthrough, audio decode (level metering), audio decoded to
+// PCM, audio transcode and muted audio. The audio level meter is compared
+// with the scalar loop it replaced on the decoded frames.
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ppapi/cpp/instance.h"
+
+#include "audio_level_meter.h"
+#include "capture_file.h"
+#include "logger.h"
+#include "message_sender.h"
+#include "rtsp_player_controller.h"
+#include "stream_info_cache.h"
+#include "worker_pool.h"
+#include "transcode_utils.h"
+
+#include "alloc_counter.h"
+
+namespace {
+
+const PP_Instance kBenchInstance = 1;
+const int kDefaultIterations = 5;
+const char kReplayScheme[] = "replay://";
+
+int64_t NowNs(clockid_t clock) {
+	struct timespec ts;
+	clock_gettime(clock, &ts);
+	return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+/// Log lines are only wanted with -d, they would dominate the timings.
+class BenchInstance : public pp::Instance {
+	public:
+		explicit BenchInstance(bool verbose)
+			: pp::Instance(kBenchInstance), verbose_(verbose) {}
+
+	protected:
+		void OnPostMessage(const pp::Var& message) override {
+			if (verbose_)
+				pp::Instance::OnPostMessage(message);
+		}
+
+	private:
+		bool verbose_;
+};
+
+}  // namespace
+
+/// Measurements of one conversion path.
+struct BenchResult {
+	BenchResult()
+		: bytes(0), allocations(0), cpu_ns(0), wall_ns(0), delay_ms(-1) {}
+
+	std::string name;
+	/// Time spent in each call in nanoseconds.
+	std::vector<int64_t> latencies_ns;
+	uint64_t bytes;
+	uint64_t allocations;
+	int64_t cpu_ns;
+	int64_t wall_ns;
+	/// Media time read before the first packet came out, which is what the
+	/// path adds to the latency. Negative if nothing came out.
+	double delay_ms;
+};
+
+/// Has access to the conversion methods of <code>RTSPPlayerController</code>,
+/// which are private.
+class PipelineBench {
+	public:
+		enum Path {
+			kVideo,
+			kAudioPassthrough,
+			kAudioDecode,
+			kAudioPcm,
+			kAudioTranscode,
+			kAudioMuted,
+		};
+
+		PipelineBench(RTSPPlayerController* controller, int iterations)
+			: controller_(controller),
+			  iterations_(iterations),
+			  audio_output_mode_(kAudioTranscode) {}
+
+		~PipelineBench() {
+			for (AVPacket* packet : packets_)
+				av_packet_free(&packet);
+			avformat_close_input(&controller_->format_context_);
+		}
+
+		/// Opens <code>url</code> and reads up to <code>max_packets</code>
+		/// packets (all if 0) into memory, so I/O isn't measured.
+		bool Load(const std::string& url, uint32_t max_packets);
+
+		bool HasVideo() const { return controller_->video_stream_idx_ >= 0; }
+		bool HasAudio() const { return controller_->audio_stream_idx_ >= 0; }
+
+		BenchResult Run(Path path);
+
+		/// Decodes the audio packets and times metering of the frames with
+		/// the current meter and with the loop it replaced.
+		void RunMeter();
+
+	private:
+		std::unique_ptr<ElementaryStreamPacket> Convert(Path path, AVPacket* pkt);
+		void Release(Path path, std::unique_ptr<ElementaryStreamPacket> es_pkt);
+		bool OpenAudioCodecs(Path path);
+		void CloseAudioCodecs();
+
+		RTSPPlayerController* controller_;
+		int iterations_;
+		std::vector<AVPacket*> packets_;
+
+		AudioOutputMode audio_output_mode_;
+};
+
+bool PipelineBench::Load(const std::string& url, uint32_t max_packets) {
+	av_register_all();
+	avformat_network_init();
+
+	// Captures are read like the controller replays them.
+	bool is_replay = url.compare(0, strlen(kReplayScheme), kReplayScheme) == 0;
+	CaptureReader reader;
+	AVFormatContext* format_context = NULL;
+	int ret;
+	if (is_replay) {
+		ret = reader.Open(url.substr(strlen(kReplayScheme))) ?
+		      reader.CreateFormatContext(&format_context) : AVERROR(ENOENT);
+	} else {
+		ret = avformat_open_input(&format_context, url.c_str(), NULL, NULL);
+	}
+	if (ret < 0) {
+		char error[AV_ERROR_MAX_STRING_SIZE];
+		fprintf(stderr, "Cannot open %s: %s\n", url.c_str(),
+		        av_make_error_string(error, sizeof(error), ret));
+		return false;
+	}
+	controller_->format_context_ = format_context;
+	if (!is_replay) {
+		ret = avformat_find_stream_info(format_context, NULL);
+		if (ret < 0) {
+			char error[AV_ERROR_MAX_STRING_SIZE];
+			fprintf(stderr, "Cannot find stream info: %s\n",
+			        av_make_error_string(error, sizeof(error), ret));
+			return false;
+		}
+	}
+	controller_->video_stream_idx_ =
+	    av_find_best_stream(format_context, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+	controller_->audio_stream_idx_ =
+	    av_find_best_stream(format_context, AVMEDIA_TYPE_AUDIO, -1, -1, NULL, 0);
+
+	AVPacket* packet = av_packet_alloc();
+	while (!max_packets || packets_.size() < max_packets) {
+		int64_t arrival_us;
+		ret = is_replay ? reader.Read(packet, &arrival_us) :
+		      av_read_frame(format_context, packet);
+		if (ret < 0)
+			break;
+		if (packet->stream_index != controller_->video_stream_idx_ &&
+		    packet->stream_index != controller_->audio_stream_idx_) {
+			av_packet_unref(packet);
+			continue;
+		}
+		packets_.push_back(packet);
+		packet = av_packet_alloc();
+	}
+	av_packet_free(&packet);
+	fprintf(stderr, "Loaded %zu packets from %s\n", packets_.size(), url.c_str());
+	return !packets_.empty();
+}
+
+bool PipelineBench::OpenAudioCodecs(Path path) {
+	if (path == kVideo)
+		return true;
+	AVStream* s =
+	    controller_->format_context_->streams[controller_->audio_stream_idx_];
+	// Like UpdateAudioConfig(), the codec decides how audio is played.
+	audio_output_mode_ = GetAudioOutputMode(s->codecpar);
+	if (path == kAudioDecode && audio_output_mode_ != kAudioPassthrough) {
+		// The player only meters audio which it passes through this way.
+		return false;
+	}
+	// The PCM and transcode paths are timed for any codec, muting in the
+	// mode the player would pick.
+	if (path == kAudioPcm)
+		audio_output_mode_ = kAudioPcm;
+	else if (path == kAudioTranscode)
+		audio_output_mode_ = kAudioTranscode;
+	// The codecs, buffers and metering state are set up like in
+	// StartParsing(), so only the steady state is timed. The conversion runs
+	// on this thread instead of the audio strand.
+	controller_->audio_output_mode_ = audio_output_mode_;
+	bool opened = controller_->OpenAudioCodecs();
+	// Muted passed through audio is replaced by silence encoded up front.
+	controller_->is_mute_ = path == kAudioMuted;
+	// Passed through packets are timed with the audio stream parameters only.
+	return opened || path == kAudioPassthrough;
+}
+
+void PipelineBench::CloseAudioCodecs() {
+	controller_->CloseAudioCodecs();
+	controller_->is_mute_ = false;
+}
+
+std::unique_ptr<ElementaryStreamPacket> PipelineBench::Convert(
+    Path path, AVPacket* pkt) {
+	switch (path) {
+		case kVideo:
+		case kAudioPassthrough:
+			return controller_->MakeESPacketFromAVPacket(pkt);
+		case kAudioDecode:
+		case kAudioPcm:
+		case kAudioTranscode:
+		case kAudioMuted:
+			return controller_->ConvertAudioPacket(pkt);
+	}
+	return NULL;
+}
+
+void PipelineBench::Release(Path path,
+                            std::unique_ptr<ElementaryStreamPacket> es_pkt) {
+	if (!es_pkt)
+		return;
+	// The pools are picked like in MakeESPacketFromAVPacket().
+	if (path == kVideo)
+		controller_->video_packet_pool_.Release(std::move(es_pkt));
+	else
+		controller_->audio_packet_pool_.Release(std::move(es_pkt));
+}
+
+BenchResult PipelineBench::Run(Path path) {
+	static const char* const kNames[] = {
+		"video", "audio passthrough", "audio decode", "audio pcm",
+		"audio transcode", "audio muted",
+	};
+	BenchResult result;
+	result.name = kNames[path];
+	if (!OpenAudioCodecs(path)) {
+		CloseAudioCodecs();
+		return result;
+	}
+
+	int stream_index = path == kVideo ? controller_->video_stream_idx_ :
+	                   controller_->audio_stream_idx_;
+	AVRational time_base =
+	    controller_->format_context_->streams[stream_index]->time_base;
+	int64_t first_pts = AV_NOPTS_VALUE;
+	AVPacket* work = av_packet_alloc();
+	for (int i = 0; i < iterations_; ++i) {
+		for (const AVPacket* packet : packets_) {
+			if (packet->stream_index != stream_index)
+				continue;
+			if (first_pts == AV_NOPTS_VALUE)
+				first_pts = packet->pts;
+			// The conversion takes over or unreferences the payload, so each call
+			// gets its own reference. Making it isn't measured.
+			av_packet_ref(work, packet);
+
+			uint64_t allocations = AllocCounter::Get();
+			int64_t cpu = NowNs(CLOCK_THREAD_CPUTIME_ID);
+			int64_t wall = NowNs(CLOCK_MONOTONIC);
+			std::unique_ptr<ElementaryStreamPacket> es_pkt = Convert(path, work);
+			// A transcoded packet may yield more than one frame.
+			if (path != kVideo && path != kAudioPassthrough) {
+				while (std::unique_ptr<ElementaryStreamPacket> more =
+				           controller_->NextConvertedAudioPacket())
+					Release(path, std::move(more));
+			}
+			wall = NowNs(CLOCK_MONOTONIC) - wall;
+			cpu = NowNs(CLOCK_THREAD_CPUTIME_ID) - cpu;
+			result.allocations += AllocCounter::Get() - allocations;
+
+			result.latencies_ns.push_back(wall);
+			result.wall_ns += wall;
+			result.cpu_ns += cpu;
+			result.bytes += packet->size;
+			if (es_pkt && result.delay_ms < 0 && first_pts != AV_NOPTS_VALUE &&
+			    packet->pts != AV_NOPTS_VALUE) {
+				result.delay_ms = av_q2d(time_base) * 1000 *
+				                  (packet->pts + packet->duration - first_pts);
+			}
+			Release(path, std::move(es_pkt));
+			av_packet_unref(work);
+		}
+	}
+	av_packet_free(&work);
+	CloseAudioCodecs();
+	return result;
+}
+
+/// The level loop calculateAudioLevel() used before the meter was vectorized,
+/// it sums absolute values of the first plane and misreads float samples.
+static float LegacyAudioLevelSum(const AVFrame* frame, AVSampleFormat format) {
+	const uint8_t* buff16 = frame->extended_data[0];
+	float sum = 0, sample;
+	switch (format) {
+		case AV_SAMPLE_FMT_U8:
+		case AV_SAMPLE_FMT_U8P:
+			for (int i = 0; i < frame->nb_samples; i++) {
+				sample = (char)buff16[i];
+				sum += fabs(sample);
+			}
+			break;
+		case AV_SAMPLE_FMT_S16:
+		case AV_SAMPLE_FMT_S16P:
+			for (int i = 0; i < frame->nb_samples; i++) {
+				sample = (short)(((short)buff16[(i*2) + 1] << 8) | (short)buff16[i*2]);
+				sum += fabs(sample);
+			}
+			break;
+		case AV_SAMPLE_FMT_FLTP:
+			for (int i = 0; i < frame->nb_samples; i++) {
+				sample = (float)(((int)buff16[(i*4) + 3] << 24) | ((int)buff16[(i*4) + 2] << 16) |
+				                 ((int)buff16[(i*4) + 1] << 8) | (int)buff16[i*4]);
+				sum += fabs(sample);
+			}
+			break;
+		default:
+			break;
+	}
+	return sum;
+}
+
+void PipelineBench::RunMeter() {
+	AVStream* s =
+	    controller_->format_context_->streams[controller_->audio_stream_idx_];
+	AVCodec* codec = avcodec_find_decoder(s->codecpar->codec_id);
+	AVCodecContext* codec_ctx = avcodec_alloc_context3(codec);
+	if (!codec || avcodec_parameters_to_context(codec_ctx, s->codecpar) < 0 ||
+	    avcodec_open2(codec_ctx, codec, NULL) < 0) {
+		avcodec_free_context(&codec_ctx);
+		return;
+	}
+
+	std::vector<AVFrame*> frames;
+	uint64_t samples = 0;
+	AVPacket* work = av_packet_alloc();
+	for (const AVPacket* packet : packets_) {
+		if (packet->stream_index != controller_->audio_stream_idx_)
+			continue;
+		av_packet_ref(work, packet);
+		AVFrame* frame = av_frame_alloc();
+		int data_present = 0;
+		if (decode(codec_ctx, frame, &data_present, work) >= 0 && data_present) {
+			samples += frame->nb_samples * frame->channels;
+			frames.push_back(frame);
+		} else {
+			av_frame_free(&frame);
+		}
+		av_packet_unref(work);
+	}
+	av_packet_free(&work);
+	AVSampleFormat format = codec_ctx->sample_fmt;
+	avcodec_free_context(&codec_ctx);
+	if (frames.empty())
+		return;
+
+	// The results are summed up, so the loops aren't optimized away.
+	double total = 0;
+	int64_t legacy_ns = NowNs(CLOCK_MONOTONIC);
+	for (int i = 0; i < iterations_; ++i) {
+		for (const AVFrame* frame : frames)
+			total += LegacyAudioLevelSum(frame, format);
+	}
+	legacy_ns = NowNs(CLOCK_MONOTONIC) - legacy_ns;
+
+	int64_t meter_ns = NowNs(CLOCK_MONOTONIC);
+	for (int i = 0; i < iterations_; ++i) {
+		for (const AVFrame* frame : frames) {
+			AudioLevel level;
+			MeasureAudioLevel(frame, format, &level);
+			total += level.rms + level.peak;
+		}
+	}
+	meter_ns = NowNs(CLOCK_MONOTONIC) - meter_ns;
+
+	size_t count = frames.size() * iterations_;
+	printf("\nmeter on %zu frames of %s (%.0f)\n", frames.size(),
+	       av_get_sample_fmt_name(format), total);
+	printf("%-18s %10s %12s\n", "meter", "ns/frame", "Msamples/s");
+	printf("%-18s %10.0f %12.1f\n", "legacy scalar",
+	       static_cast<double>(legacy_ns) / count,
+	       static_cast<double>(samples) * iterations_ / legacy_ns * 1e3);
+	printf("%-18s %10.0f %12.1f\n", "vectorized",
+	       static_cast<double>(meter_ns) / count,
+	       static_cast<double>(samples) * iterations_ / meter_ns * 1e3);
+
+	for (AVFrame* frame : frames)
+		av_frame_free(&frame);
+}
+
+static void PrintResult(BenchResult* result) {
+	size_t packets = result->latencies_ns.size();
+	if (!packets) {
+		printf("%-18s n/a\n", result->name.c_str());
+		return;
+	}
+	std::sort(result->latencies_ns.begin(), result->latencies_ns.end());
+	double seconds = result->wall_ns / 1e9;
+	printf("%-18s %10.0f %10.2f %9.2f %9.2f %9.2f %9.2f %9.1f\n",
+	       result->name.c_str(), packets / seconds,
+	       result->bytes / seconds / 1e6,
+	       result->latencies_ns[packets / 2] / 1e3,
+	       result->latencies_ns[packets * 99 / 100] / 1e3,
+	       static_cast<double>(result->allocations) / packets,
+	       result->cpu_ns / 1e3 / packets, result->delay_ms);
+}
+
+static void PrintUsage(const char* name) {
+	fprintf(stderr,
+	        "usage: %s [-d] [-i iterations] [-a audio_level_frequency] "
+	        "<file, url or replay://capture> [max_packets]\n"
+	        "  -d  show logs\n"
+	        "  -i  passes over the loaded packets (default %d)\n"
+	        "  -a  audio level reporting period in seconds, 0 disables metering "
+	        "(default 0)\n",
+	        name, kDefaultIterations);
+}
+
+int main(int argc, char** argv) {
+	bool verbose = false;
+	int iterations = kDefaultIterations;
+	double audio_level_frequency = 0;
+	int opt;
+	while ((opt = getopt(argc, argv, "di:a:")) != -1) {
+		switch (opt) {
+			case 'd':
+				verbose = true;
+				break;
+			case 'i':
+				iterations = atoi(optarg);
+				break;
+			case 'a':
+				audio_level_frequency = atof(optarg);
+				break;
+			default:
+				PrintUsage(argv[0]);
+				return 1;
+		}
+	}
+	if (optind >= argc || iterations <= 0) {
+		PrintUsage(argv[0]);
+		return 1;
+	}
+	std::string url = argv[optind];
+	uint32_t max_packets = optind + 1 < argc ? atoi(argv[optind + 1]) : 0;
+
+	BenchInstance instance(verbose);
+	Logger::InitializeInstance(&instance);
+	// The conversion paths are driven directly, the workers stay idle.
+	auto controller = std::make_shared<RTSPPlayerController>(
+	    pp::InstanceHandle(&instance),
+	    std::make_shared<Communication::MessageSender>(&instance),
+	    std::make_shared<StreamInfoCache>(),
+	    std::make_shared<WorkerPool>(pp::InstanceHandle(&instance), 1, 2));
+	controller->audio_level_cb_frequency_ = audio_level_frequency;
+
+	PipelineBench bench(controller.get(), iterations);
+	if (!bench.Load(url, max_packets))
+		return 1;
+
+	printf("%-18s %10s %10s %9s %9s %9s %9s %9s\n", "path", "packets/s", "MB/s",
+	       "p50 us", "p99 us", "allocs", "cpu us", "delay ms");
+	if (bench.HasVideo()) {
+		BenchResult result = bench.Run(PipelineBench::kVideo);
+		PrintResult(&result);
+	}
+	if (bench.HasAudio()) {
+		for (PipelineBench::Path path : {PipelineBench::kAudioPassthrough,
+		                                 PipelineBench::kAudioDecode,
+		                                 PipelineBench::kAudioPcm,
+		                                 PipelineBench::kAudioTranscode,
+		                                 PipelineBench::kAudioMuted}) {
+			BenchResult result = bench.Run(path);
+			PrintResult(&result);
+		}
+		bench.RunMeter();
+	}
+	return 0;
+}
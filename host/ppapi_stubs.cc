@@ -0,0 +1,150 @@
+// Host build implementation of the PPAPI classes used by the player.
+
+#include <stdio.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+#include "ppapi/c/pp_stdint.h"
+#include "ppapi/cpp/instance.h"
+#include "ppapi/cpp/instance_handle.h"
+#include "ppapi/cpp/message_loop.h"
+#include "ppapi/cpp/var.h"
+#include "ppapi/utility/threading/simple_thread.h"
+
+namespace pp {
+
+namespace {
+
+const int32_t PP_OK = 0;
+const int32_t PP_ERROR_FAILED = -2;
+
+}  // namespace
+
+std::string Var::DebugString() const {
+	std::ostringstream out;
+	switch (type_) {
+		case kUndefined:
+			out << "undefined";
+			break;
+		case kBool:
+			out << (bool_ ? "true" : "false");
+			break;
+		case kInt:
+			out << int_;
+			break;
+		case kDouble:
+			out << double_;
+			break;
+		case kString:
+			out << '"' << string_ << '"';
+			break;
+		case kDictionary: {
+			const char* separator = "";
+			out << '{';
+			for (const auto& entry : *entries_) {
+				out << separator << entry.first << ": " << entry.second.DebugString();
+				separator = ", ";
+			}
+			out << '}';
+			break;
+		}
+	}
+	return out.str();
+}
+
+InstanceHandle::InstanceHandle(Instance* instance)
+	: pp_instance_(instance ? instance->pp_instance() : 0) {}
+
+void Instance::OnPostMessage(const Var& message) {
+	if (message.is_string())
+		fputs(message.AsString().c_str(), stderr);
+}
+
+struct MessageLoop::Queue {
+	typedef std::chrono::steady_clock Clock;
+
+	Queue() : quit(false) {}
+
+	std::mutex mutex;
+	std::condition_variable changed;
+	/// Callbacks ordered by the time they are due, equal times keep the order
+	/// they were posted in.
+	std::multimap<Clock::time_point, CompletionCallback> work;
+	bool quit;
+};
+
+MessageLoop::MessageLoop() : queue_(std::make_shared<Queue>()) {}
+
+MessageLoop::MessageLoop(const InstanceHandle& /*instance*/)
+	: queue_(std::make_shared<Queue>()) {}
+
+int32_t MessageLoop::PostWork(const CompletionCallback& callback,
+                              int64_t delay_ms) {
+	std::lock_guard<std::mutex> lock(queue_->mutex);
+	if (queue_->quit)
+		return PP_ERROR_FAILED;
+	Queue::Clock::time_point due =
+	    Queue::Clock::now() + std::chrono::milliseconds(delay_ms);
+	queue_->work.insert(std::make_pair(due, callback));
+	queue_->changed.notify_one();
+	return PP_OK;
+}
+
+int32_t MessageLoop::Run() {
+	std::unique_lock<std::mutex> lock(queue_->mutex);
+	for (;;) {
+		if (queue_->work.empty()) {
+			if (queue_->quit)
+				break;
+			queue_->changed.wait(lock);
+			continue;
+		}
+		auto first = queue_->work.begin();
+		if (!queue_->quit && first->first > Queue::Clock::now()) {
+			queue_->changed.wait_until(lock, first->first);
+			continue;
+		}
+		CompletionCallback callback = first->second;
+		queue_->work.erase(first);
+		lock.unlock();
+		callback.Run(PP_OK);
+		lock.lock();
+	}
+	return PP_OK;
+}
+
+int32_t MessageLoop::PostQuit(bool /*should_destroy*/) {
+	std::lock_guard<std::mutex> lock(queue_->mutex);
+	queue_->quit = true;
+	queue_->changed.notify_one();
+	return PP_OK;
+}
+
+SimpleThread::SimpleThread(const InstanceHandle& instance)
+	: message_loop_(instance) {}
+
+SimpleThread::~SimpleThread() {
+	Join();
+}
+
+bool SimpleThread::Start() {
+	if (thread_.joinable())
+		return false;
+	MessageLoop loop = message_loop_;
+	thread_ = std::thread([loop]() mutable { loop.Run(); });
+	return true;
+}
+
+bool SimpleThread::Join() {
+	if (!thread_.joinable())
+		return false;
+	message_loop_.PostQuit(false);
+	thread_.join();
+	return true;
+}
+
+}  // namespace pp
@@ -0,0 +1,650 @@
+#include "rtsp_test_server.h"
+
+#include <arpa/inet.h>
+#include <ctype.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <sstream>
+#include <vector>
+
+extern "C" {
+#include "libavformat/avformat.h"
+#include "libavutil/opt.h"
+}
+
+/// Fits an RTP packet into an Ethernet frame.
+static const int kMaxRtpPacketSize = 1400;
+static const int kFirstPayloadType = 96;
+static const uint32_t kSleepSliceMs = 50;
+static const char kStreamPath[] = "/live";
+static const char kSessionId[] = "5354415650";
+
+static int64_t NowNs() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+/// Sleeps until <code>deadline_ns</code> unless <code>running</code> is
+/// cleared in the meantime.
+static bool SleepUntil(int64_t deadline_ns, const std::atomic<bool>& running) {
+	while (running) {
+		int64_t left_ns = deadline_ns - NowNs();
+		if (left_ns <= 0)
+			return true;
+		usleep(std::min<int64_t>(left_ns / 1000, kSleepSliceMs * 1000));
+	}
+	return false;
+}
+
+/// Serves one RTSP connection.
+class RTSPTestServer::Session {
+	public:
+		Session(RTSPTestServer* server, int fd);
+		~Session();
+
+		void Start() { thread_ = std::thread(&Session::Run, this); }
+
+		/// Makes the connection fail, the session thread finishes shortly after.
+		void Close() { shutdown(fd_, SHUT_RDWR); }
+
+		bool IsFinished() const { return finished_; }
+
+	private:
+		struct Request {
+			std::string method;
+			std::string uri;
+			int cseq;
+			std::map<std::string, std::string> headers;
+		};
+
+		/// An RTP muxer for one stream of the file.
+		struct Output {
+			Session* session;
+			int input_index;
+			AVFormatContext* muxer;
+			bool header_written;
+			bool set_up;
+			bool interleaved;
+			int channel;
+			struct sockaddr_in rtp_address;
+			struct sockaddr_in rtcp_address;
+		};
+
+		void Run();
+		bool ReadRequest(Request* request);
+		void Handle(const Request& request);
+		void Respond(const Request& request, const std::string& headers,
+		             const std::string& body = std::string(),
+		             const char* status = "200 OK");
+
+		bool OpenMedia();
+		void CloseMedia();
+		std::string MakeSdp();
+		bool SetUp(const Request& request, std::string* transport);
+
+		void StartStreaming();
+		void StopStreaming();
+		void Stream();
+		static int WriteRtp(void* opaque, uint8_t* data, int size);
+		void OnRtpPacket(Output* output, const uint8_t* data, int size);
+		void SendRtp(Output* output, const uint8_t* data, int size);
+		bool Send(const void* data, size_t size);
+
+		RTSPTestServer* server_;
+		int fd_;
+		int udp_fd_;
+		std::string input_buffer_;
+		std::mutex write_mutex_;
+		std::thread thread_;
+		std::thread stream_thread_;
+		std::atomic<bool> streaming_;
+		std::atomic<bool> finished_;
+
+		AVFormatContext* input_;
+		std::vector<Output> outputs_;
+
+		std::minstd_rand rng_;
+		/// A packet held back to be sent after the next one.
+		std::vector<uint8_t> held_packet_;
+		Output* held_output_;
+		int64_t next_send_ns_;
+};
+
+RTSPTestServer::Session::Session(RTSPTestServer* server, int fd)
+	: server_(server),
+	  fd_(fd),
+	  udp_fd_(-1),
+	  streaming_(false),
+	  finished_(false),
+	  input_(NULL),
+	  rng_(static_cast<uint32_t>(NowNs())),
+	  held_output_(NULL),
+	  next_send_ns_(0) {}
+
+RTSPTestServer::Session::~Session() {
+	Close();
+	if (thread_.joinable())
+		thread_.join();
+	close(fd_);
+}
+
+void RTSPTestServer::Session::Run() {
+	Request request;
+	while (ReadRequest(&request)) {
+		Handle(request);
+		if (request.method == "TEARDOWN")
+			break;
+	}
+	StopStreaming();
+	CloseMedia();
+	if (udp_fd_ >= 0)
+		close(udp_fd_);
+	finished_ = true;
+}
+
+bool RTSPTestServer::Session::ReadRequest(Request* request) {
+	for (;;) {
+		// RTCP receiver reports interleaved with the requests are skipped.
+		if (!input_buffer_.empty() && input_buffer_[0] == '$') {
+			if (input_buffer_.size() >= 4) {
+				size_t length = (static_cast<uint8_t>(input_buffer_[2]) << 8) |
+				                static_cast<uint8_t>(input_buffer_[3]);
+				if (input_buffer_.size() >= 4 + length) {
+					input_buffer_.erase(0, 4 + length);
+					continue;
+				}
+			}
+		} else {
+			size_t end = input_buffer_.find("\r\n\r\n");
+			if (end != std::string::npos) {
+				std::istringstream lines(input_buffer_.substr(0, end));
+				std::string line;
+				std::getline(lines, line);
+				std::istringstream request_line(line);
+				request_line >> request->method >> request->uri;
+				request->headers.clear();
+				while (std::getline(lines, line)) {
+					size_t colon = line.find(':');
+					if (colon == std::string::npos)
+						continue;
+					std::string name = line.substr(0, colon);
+					std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+					size_t value = line.find_first_not_of(' ', colon + 1);
+					std::string text = value == std::string::npos ? "" : line.substr(value);
+					if (!text.empty() && text[text.size() - 1] == '\r')
+						text.erase(text.size() - 1);
+					request->headers[name] = text;
+				}
+				request->cseq = atoi(request->headers["cseq"].c_str());
+				size_t length = end + 4 + atoi(request->headers["content-length"].c_str());
+				if (input_buffer_.size() >= length) {
+					input_buffer_.erase(0, length);
+					return true;
+				}
+			}
+		}
+
+		char buffer[4096];
+		ssize_t received = recv(fd_, buffer, sizeof(buffer), 0);
+		if (received <= 0)
+			return false;
+		input_buffer_.append(buffer, received);
+	}
+}
+
+void RTSPTestServer::Session::Respond(const Request& request,
+                                      const std::string& headers,
+                                      const std::string& body,
+                                      const char* status) {
+	std::ostringstream response;
+	response << "RTSP/1.0 " << status << "\r\n"
+	         << "CSeq: " << request.cseq << "\r\n"
+	         << headers;
+	if (!body.empty())
+		response << "Content-Length: " << body.size() << "\r\n";
+	response << "\r\n" << body;
+	std::string text = response.str();
+	Send(text.data(), text.size());
+}
+
+void RTSPTestServer::Session::Handle(const Request& request) {
+	const std::string session = std::string("Session: ") + kSessionId +
+	                            ";timeout=60\r\n";
+	if (request.method == "OPTIONS") {
+		Respond(request, "Public: OPTIONS, DESCRIBE, SETUP, PLAY, TEARDOWN, "
+		                 "GET_PARAMETER\r\n");
+	} else if (request.method == "DESCRIBE") {
+		if (!input_ && !OpenMedia()) {
+			CloseMedia();
+			Respond(request, "", "", "404 Not Found");
+			return;
+		}
+		std::string base = request.uri;
+		if (base.empty() || base[base.size() - 1] != '/')
+			base += '/';
+		Respond(request, "Content-Type: application/sdp\r\nContent-Base: " +
+		        base + "\r\n", MakeSdp());
+	} else if (request.method == "SETUP") {
+		std::string transport;
+		if (!SetUp(request, &transport)) {
+			Respond(request, "", "", "461 Unsupported Transport");
+			return;
+		}
+		Respond(request, session + "Transport: " + transport + "\r\n");
+	} else if (request.method == "PLAY") {
+		Respond(request, session + "Range: npt=0.000-\r\n");
+		StartStreaming();
+	} else if (request.method == "TEARDOWN") {
+		StopStreaming();
+		Respond(request, session);
+	} else {
+		// GET_PARAMETER keep-alives and anything else.
+		Respond(request, session);
+	}
+}
+
+bool RTSPTestServer::Session::OpenMedia() {
+	if (avformat_open_input(&input_, server_->path_.c_str(), NULL, NULL) < 0) {
+		fprintf(stderr, "RTSPTestServer: cannot open %s\n", server_->path_.c_str());
+		return false;
+	}
+	if (avformat_find_stream_info(input_, NULL) < 0)
+		return false;
+
+	for (unsigned i = 0; i < input_->nb_streams; ++i) {
+		AVStream* in_stream = input_->streams[i];
+		AVMediaType type = in_stream->codecpar->codec_type;
+		if (type != AVMEDIA_TYPE_VIDEO && type != AVMEDIA_TYPE_AUDIO)
+			continue;
+
+		Output output;
+		memset(&output, 0, sizeof(output));
+		output.session = this;
+		output.input_index = i;
+		if (avformat_alloc_output_context2(&output.muxer, NULL, "rtp", NULL) < 0)
+			return false;
+		outputs_.push_back(output);
+	}
+
+	// The muxers keep a pointer to their Output, so they are set up once the
+	// vector doesn't grow anymore.
+	for (size_t i = 0; i < outputs_.size(); ++i) {
+		Output* output = &outputs_[i];
+		AVStream* in_stream = input_->streams[output->input_index];
+		AVStream* stream = avformat_new_stream(output->muxer, NULL);
+		avcodec_parameters_copy(stream->codecpar, in_stream->codecpar);
+		stream->codecpar->codec_tag = 0;
+		stream->time_base = in_stream->time_base;
+		av_opt_set_int(output->muxer->priv_data, "payload_type",
+		               kFirstPayloadType + i, 0);
+
+		uint8_t* buffer = static_cast<uint8_t*>(av_malloc(kMaxRtpPacketSize));
+		output->muxer->pb = avio_alloc_context(buffer, kMaxRtpPacketSize, 1,
+		                                       output, NULL, &Session::WriteRtp,
+		                                       NULL);
+		output->muxer->pb->max_packet_size = kMaxRtpPacketSize;
+		if (avformat_write_header(output->muxer, NULL) < 0) {
+			fprintf(stderr, "RTSPTestServer: cannot packetize stream %d\n",
+			        output->input_index);
+			return false;
+		}
+		output->header_written = true;
+	}
+	return !outputs_.empty();
+}
+
+void RTSPTestServer::Session::CloseMedia() {
+	for (Output& output : outputs_) {
+		if (output.header_written)
+			av_write_trailer(output.muxer);
+		if (output.muxer->pb) {
+			av_freep(&output.muxer->pb->buffer);
+			av_freep(&output.muxer->pb);
+		}
+		avformat_free_context(output.muxer);
+	}
+	outputs_.clear();
+	avformat_close_input(&input_);
+}
+
+std::string RTSPTestServer::Session::MakeSdp() {
+	std::vector<AVFormatContext*> muxers;
+	for (Output& output : outputs_)
+		muxers.push_back(output.muxer);
+	// Without a destination address each media gets a=control:streamid=N.
+	char sdp[16384];
+	if (av_sdp_create(&muxers.front(), muxers.size(), sdp, sizeof(sdp)) < 0)
+		return std::string();
+	return sdp;
+}
+
+bool RTSPTestServer::Session::SetUp(const Request& request,
+                                    std::string* transport) {
+	size_t id = request.uri.rfind("streamid=");
+	if (id == std::string::npos)
+		return false;
+	size_t index = atoi(request.uri.c_str() + id + strlen("streamid="));
+	if (index >= outputs_.size())
+		return false;
+	Output* output = &outputs_[index];
+
+	auto it = request.headers.find("transport");
+	if (it == request.headers.end())
+		return false;
+	const std::string& client = it->second;
+
+	int first, second;
+	size_t interleaved = client.find("interleaved=");
+	size_t client_port = client.find("client_port=");
+	if (interleaved != std::string::npos &&
+	    sscanf(client.c_str() + interleaved, "interleaved=%d-%d", &first,
+	           &second) == 2) {
+		output->interleaved = true;
+		output->channel = first;
+		*transport = "RTP/AVP/TCP;unicast;interleaved=" + std::to_string(first) +
+		             "-" + std::to_string(second);
+	} else if (client_port != std::string::npos &&
+	           sscanf(client.c_str() + client_port, "client_port=%d-%d", &first,
+	                  &second) == 2) {
+		struct sockaddr_in address;
+		socklen_t length = sizeof(address);
+		if (udp_fd_ < 0) {
+			udp_fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+			memset(&address, 0, sizeof(address));
+			address.sin_family = AF_INET;
+			address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			if (bind(udp_fd_, reinterpret_cast<struct sockaddr*>(&address),
+			         sizeof(address)) < 0)
+				return false;
+		}
+		getsockname(udp_fd_, reinterpret_cast<struct sockaddr*>(&address), &length);
+		int server_port = ntohs(address.sin_port);
+
+		length = sizeof(address);
+		getpeername(fd_, reinterpret_cast<struct sockaddr*>(&address), &length);
+		output->interleaved = false;
+		output->rtp_address = address;
+		output->rtp_address.sin_port = htons(first);
+		output->rtcp_address = address;
+		output->rtcp_address.sin_port = htons(second);
+		*transport = "RTP/AVP;unicast;client_port=" + std::to_string(first) + "-" +
+		             std::to_string(second) + ";server_port=" +
+		             std::to_string(server_port) + "-" +
+		             std::to_string(server_port);
+	} else {
+		return false;
+	}
+	output->set_up = true;
+	return true;
+}
+
+void RTSPTestServer::Session::StartStreaming() {
+	if (streaming_.exchange(true))
+		return;
+	stream_thread_ = std::thread(&Session::Stream, this);
+}
+
+void RTSPTestServer::Session::StopStreaming() {
+	streaming_ = false;
+	if (stream_thread_.joinable())
+		stream_thread_.join();
+}
+
+void RTSPTestServer::Session::Stream() {
+	const Impairments& impairments = server_->impairments_;
+	std::uniform_int_distribution<int64_t> jitter(
+	    0, static_cast<int64_t>(impairments.jitter_ms) * 1000000);
+	const int64_t start_ns = NowNs();
+	next_send_ns_ = start_ns;
+	const int64_t stall_interval_ns = impairments.stall_interval_s * 1000000000LL;
+	int64_t next_stall_ns = start_ns + stall_interval_ns;
+	// Added to the timestamps of each pass over the file, so they keep
+	// increasing like a live stream's.
+	int64_t loop_offset_us = 0;
+	int64_t end_us = 0;
+	bool pass_sent_packets = false;
+
+	AVPacket pkt;
+	av_init_packet(&pkt);
+	pkt.data = NULL;
+	pkt.size = 0;
+	while (streaming_) {
+		if (impairments.disconnect_interval_s &&
+		    NowNs() - start_ns >= impairments.disconnect_interval_s * 1000000000LL) {
+			++server_->disconnects_;
+			Close();
+			break;
+		}
+		if (impairments.stall_ms && NowNs() >= next_stall_ns) {
+			++server_->stalls_;
+			if (!SleepUntil(NowNs() + impairments.stall_ms * 1000000LL, streaming_))
+				break;
+			// Pacing keeps its schedule, so the packets held back go out at once.
+			next_stall_ns = NowNs() + stall_interval_ns;
+		}
+
+		int ret = av_read_frame(input_, &pkt);
+		if (ret == AVERROR_EOF) {
+			if (!pass_sent_packets)
+				break;
+			pass_sent_packets = false;
+			loop_offset_us = end_us;
+			av_seek_frame(input_, -1, 0, AVSEEK_FLAG_BACKWARD);
+			continue;
+		}
+		if (ret < 0)
+			break;
+
+		Output* output = NULL;
+		for (Output& candidate : outputs_) {
+			if (candidate.input_index == pkt.stream_index && candidate.set_up)
+				output = &candidate;
+		}
+		int64_t ts = pkt.dts != AV_NOPTS_VALUE ? pkt.dts : pkt.pts;
+		if (!output || ts == AV_NOPTS_VALUE) {
+			av_packet_unref(&pkt);
+			continue;
+		}
+
+		AVStream* in_stream = input_->streams[pkt.stream_index];
+		int64_t start_time = in_stream->start_time != AV_NOPTS_VALUE ?
+		                     in_stream->start_time : 0;
+		int64_t media_us = av_rescale_q(ts - start_time, in_stream->time_base,
+		                                AV_TIME_BASE_Q) + loop_offset_us;
+		end_us = std::max(end_us, media_us +
+		                  av_rescale_q(std::max<int64_t>(pkt.duration, 1),
+		                               in_stream->time_base, AV_TIME_BASE_Q));
+		int64_t due_ns = start_ns + media_us * 1000;
+		if (impairments.jitter_ms)
+			due_ns += jitter(rng_);
+		if (!SleepUntil(due_ns, streaming_)) {
+			av_packet_unref(&pkt);
+			break;
+		}
+
+		int64_t offset = av_rescale_q(loop_offset_us, AV_TIME_BASE_Q,
+		                              in_stream->time_base);
+		if (pkt.pts != AV_NOPTS_VALUE)
+			pkt.pts += offset;
+		if (pkt.dts != AV_NOPTS_VALUE)
+			pkt.dts += offset;
+		av_packet_rescale_ts(&pkt, in_stream->time_base,
+		                     output->muxer->streams[0]->time_base);
+		pkt.stream_index = 0;
+		// Fails for the rare packet with a non increasing timestamp, which is
+		// skipped like a lost one.
+		av_write_frame(output->muxer, &pkt);
+		av_packet_unref(&pkt);
+		pass_sent_packets = true;
+	}
+	av_packet_unref(&pkt);
+
+	if (held_output_) {
+		SendRtp(held_output_, held_packet_.data(), held_packet_.size());
+		held_output_ = NULL;
+	}
+}
+
+int RTSPTestServer::Session::WriteRtp(void* opaque, uint8_t* data, int size) {
+	Output* output = static_cast<Output*>(opaque);
+	output->session->OnRtpPacket(output, data, size);
+	return size;
+}
+
+void RTSPTestServer::Session::OnRtpPacket(Output* output, const uint8_t* data,
+                                          int size) {
+	const Impairments& impairments = server_->impairments_;
+	std::uniform_real_distribution<double> chance(0, 1);
+	++server_->rtp_packets_;
+	if (impairments.loss > 0 && chance(rng_) < impairments.loss) {
+		++server_->lost_packets_;
+		return;
+	}
+	if (!held_output_ && impairments.reorder > 0 &&
+	    chance(rng_) < impairments.reorder) {
+		++server_->reordered_packets_;
+		held_packet_.assign(data, data + size);
+		held_output_ = output;
+		return;
+	}
+	SendRtp(output, data, size);
+	if (held_output_) {
+		SendRtp(held_output_, held_packet_.data(), held_packet_.size());
+		held_output_ = NULL;
+	}
+}
+
+void RTSPTestServer::Session::SendRtp(Output* output, const uint8_t* data,
+                                      int size) {
+	const uint32_t bandwidth_kbps = server_->impairments_.bandwidth_kbps;
+	if (bandwidth_kbps) {
+		// Each packet takes its share of the capped rate before the next one.
+		next_send_ns_ = std::max(next_send_ns_, NowNs());
+		if (!SleepUntil(next_send_ns_, streaming_))
+			return;
+		next_send_ns_ += static_cast<int64_t>(size) * 8 * 1000000 / bandwidth_kbps;
+	}
+
+	// RTCP sender reports come through the same muxer, their packet types are
+	// 200 to 204 where RTP has the marker bit and the payload type.
+	bool is_rtcp = size > 1 && data[1] >= 200 && data[1] <= 204;
+	if (output->interleaved) {
+		uint8_t header[4] = {
+			'$', static_cast<uint8_t>(output->channel + (is_rtcp ? 1 : 0)),
+			static_cast<uint8_t>(size >> 8), static_cast<uint8_t>(size & 0xff),
+		};
+		std::lock_guard<std::mutex> lock(write_mutex_);
+		if (send(fd_, header, sizeof(header), MSG_NOSIGNAL) == sizeof(header))
+			send(fd_, data, size, MSG_NOSIGNAL);
+	} else {
+		const struct sockaddr_in* address = is_rtcp ? &output->rtcp_address :
+		                                    &output->rtp_address;
+		sendto(udp_fd_, data, size, 0,
+		       reinterpret_cast<const struct sockaddr*>(address), sizeof(*address));
+	}
+}
+
+bool RTSPTestServer::Session::Send(const void* data, size_t size) {
+	std::lock_guard<std::mutex> lock(write_mutex_);
+	return send(fd_, data, size, MSG_NOSIGNAL) == static_cast<ssize_t>(size);
+}
+
+RTSPTestServer::RTSPTestServer(const std::string& path,
+                               const Impairments& impairments)
+	: path_(path),
+	  impairments_(impairments),
+	  listen_fd_(-1),
+	  port_(0),
+	  sessions_count_(0),
+	  rtp_packets_(0),
+	  lost_packets_(0),
+	  reordered_packets_(0),
+	  disconnects_(0),
+	  stalls_(0) {}
+
+RTSPTestServer::~RTSPTestServer() {
+	Stop();
+}
+
+bool RTSPTestServer::Start(uint16_t port) {
+	av_register_all();
+	listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+	int reuse = 1;
+	setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+	struct sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = htons(port);
+	socklen_t length = sizeof(address);
+	if (bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&address),
+	         sizeof(address)) < 0 ||
+	    listen(listen_fd_, 4) < 0 ||
+	    getsockname(listen_fd_, reinterpret_cast<struct sockaddr*>(&address),
+	                &length) < 0) {
+		perror("RTSPTestServer");
+		close(listen_fd_);
+		listen_fd_ = -1;
+		return false;
+	}
+	port_ = ntohs(address.sin_port);
+	accept_thread_ = std::thread(&RTSPTestServer::Accept, this);
+	return true;
+}
+
+void RTSPTestServer::Stop() {
+	if (listen_fd_ < 0)
+		return;
+	// Wakes up accept().
+	shutdown(listen_fd_, SHUT_RDWR);
+	accept_thread_.join();
+	close(listen_fd_);
+	listen_fd_ = -1;
+
+	std::lock_guard<std::mutex> lock(sessions_mutex_);
+	sessions_.clear();
+}
+
+std::string RTSPTestServer::GetUrl() const {
+	return "rtsp://127.0.0.1:" + std::to_string(port_) + kStreamPath;
+}
+
+RTSPTestServer::Stats RTSPTestServer::GetStats() const {
+	Stats stats;
+	stats.sessions = sessions_count_;
+	stats.rtp_packets = rtp_packets_;
+	stats.lost_packets = lost_packets_;
+	stats.reordered_packets = reordered_packets_;
+	stats.disconnects = disconnects_;
+	stats.stalls = stalls_;
+	return stats;
+}
+
+void RTSPTestServer::Accept() {
+	for (;;) {
+		int fd = accept(listen_fd_, NULL, NULL);
+		if (fd < 0)
+			return;
+
+		std::lock_guard<std::mutex> lock(sessions_mutex_);
+		// Sessions of closed connections are reaped here, so a long soak run
+		// doesn't pile them up.
+		sessions_.remove_if([](const std::unique_ptr<Session>& session) {
+			return session->IsFinished();
+		});
+		++sessions_count_;
+		sessions_.push_back(std::unique_ptr<Session>(new Session(this, fd)));
+		sessions_.back()->Start();
+	}
+}
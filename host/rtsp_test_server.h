@@ -0,0 +1,114 @@
+#ifndef HOST_RTSP_TEST_SERVER_H_
+#define HOST_RTSP_TEST_SERVER_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/// @file
+/// @brief This file defines the <code>RTSPTestServer</code> class.
+
+/// @class RTSPTestServer
+/// @brief A loopback RTSP server for soak runs of the host build.
+///
+/// It serves a prerecorded file (e.g. H.264 with AAC or G.711) in a loop as
+/// a live stream, over interleaved TCP or UDP, paced in real time. The RTP
+/// packets can be impaired to reproduce bad networks: some are lost or
+/// reordered, frames are delayed by a random jitter, the sending rate is
+/// capped, connections are dropped mid-stream and sending stalls for a while
+/// before the held back packets go out at once.
+///
+/// Each connection is served by a thread of its own, so a client reconnecting
+/// while the old connection is still open is served too. Only the requests the
+/// FFmpeg RTSP demuxer makes are supported.
+class RTSPTestServer {
+	public:
+		struct Impairments {
+			Impairments()
+				: loss(0),
+				  reorder(0),
+				  jitter_ms(0),
+				  bandwidth_kbps(0),
+				  disconnect_interval_s(0),
+				  stall_interval_s(0),
+				  stall_ms(0) {}
+
+			/// A share of RTP packets which are not sent, from 0 to 1.
+			double loss;
+			/// A share of RTP packets which are sent after the next one, from 0
+			/// to 1.
+			double reorder;
+			/// A maximum random delay of each frame in milliseconds.
+			uint32_t jitter_ms;
+			/// A cap of the sending rate of each connection, 0 for none.
+			uint32_t bandwidth_kbps;
+			/// Connections are closed after streaming this long, 0 for never.
+			uint32_t disconnect_interval_s;
+			/// Connections send nothing for <code>stall_ms</code> after
+			/// streaming <code>stall_interval_s</code>, and again each interval
+			/// after that. The packets due meanwhile are sent at once
+			/// afterwards. A stall_ms of 0 never stalls.
+			uint32_t stall_interval_s;
+			uint32_t stall_ms;
+		};
+
+		struct Stats {
+			uint64_t sessions;
+			uint64_t rtp_packets;
+			uint64_t lost_packets;
+			uint64_t reordered_packets;
+			uint64_t disconnects;
+			uint64_t stalls;
+		};
+
+		/// @param[in] path A media file FFmpeg can demux.
+		/// @param[in] impairments Impairments applied to all connections.
+		RTSPTestServer(const std::string& path, const Impairments& impairments);
+		~RTSPTestServer();
+
+		RTSPTestServer(const RTSPTestServer&) = delete;
+		RTSPTestServer& operator=(const RTSPTestServer&) = delete;
+
+		/// Starts listening on the loopback interface.
+		///
+		/// @param[in] port A TCP port, 0 picks a free one.
+		/// @return False if the port couldn't be bound.
+		bool Start(uint16_t port);
+
+		/// Closes all connections and waits for their threads.
+		void Stop();
+
+		/// Returns the URL of the stream, valid after <code>Start()</code>.
+		std::string GetUrl() const;
+
+		Stats GetStats() const;
+
+	private:
+		class Session;
+		friend class Session;
+
+		void Accept();
+
+		const std::string path_;
+		const Impairments impairments_;
+		int listen_fd_;
+		uint16_t port_;
+		std::thread accept_thread_;
+
+		std::mutex sessions_mutex_;
+		std::list<std::unique_ptr<Session> > sessions_;
+
+		std::atomic<uint64_t> sessions_count_;
+		std::atomic<uint64_t> rtp_packets_;
+		std::atomic<uint64_t> lost_packets_;
+		std::atomic<uint64_t> reordered_packets_;
+		std::atomic<uint64_t> disconnects_;
+		std::atomic<uint64_t> stalls_;
+};
+
+#endif  // HOST_RTSP_TEST_SERVER_H_
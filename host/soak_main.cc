@@ -0,0 +1,264 @@
+// Plays a prerecorded file through RTSPPlayerController for hours, streamed
+// by an in-process RTSPTestServer which impairs the RTP packets, and checks
+// that memory use and latency stay bounded and that playback keeps going
+// across disconnects. Exits with 1 if any bound was exceeded.
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "ppapi/cpp/instance.h"
+#include "ppapi/cpp/var_dictionary.h"
+
+#include "logger.h"
+#include "message_sender.h"
+#include "messages.h"
+#include "player_controller.h"
+#include "rtsp_player_controller.h"
+#include "stream_info_cache.h"
+#include "worker_pool.h"
+
+#include "packet_recorder.h"
+#include "rtsp_test_server.h"
+
+using Communication::MessageFromPlayer;
+
+namespace {
+
+const PP_Instance kSoakInstance = 1;
+const int kDefaultDurationS = 3600;
+const int kDefaultMaxRssGrowthMb = 64;
+const double kDefaultMaxLatencyS = 5;
+/// Memory is allowed to settle for this long before the baseline is taken.
+const int kWarmupS = 30;
+/// Longer than the reconnect backoff of the controller, so a stall is only
+/// reported once reconnecting has clearly failed.
+const int kMaxStallS = 60;
+const int kStatusPeriodS = 60;
+
+/// Returns the resident set size in kilobytes.
+long ReadRssKb() {
+	FILE* statm = fopen("/proc/self/statm", "r");
+	if (!statm)
+		return 0;
+	long size = 0, resident = 0;
+	if (fscanf(statm, "%ld %ld", &size, &resident) != 2)
+		resident = 0;
+	fclose(statm);
+	return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+/// Picks the pipeline statistics and reconnection events out of the messages
+/// meant for the JS side. Log lines go to stderr with -d only.
+class SoakInstance : public pp::Instance {
+	public:
+		explicit SoakInstance(bool verbose)
+			: pp::Instance(kSoakInstance),
+			  verbose_(verbose),
+			  latency_ms_(0),
+			  max_latency_ms_(0),
+			  reconnects_(0),
+			  reconnect_failed_(false) {}
+
+		int32_t GetLatencyMs() const { return latency_ms_; }
+		int32_t GetMaxLatencyMs() const { return max_latency_ms_; }
+		uint32_t GetReconnects() const { return reconnects_; }
+		bool ReconnectFailed() const { return reconnect_failed_; }
+
+	protected:
+		void OnPostMessage(const pp::Var& message) override {
+			if (message.is_string()) {
+				if (verbose_)
+					pp::Instance::OnPostMessage(message);
+				return;
+			}
+			pp::VarDictionary dictionary(message);
+			int32_t type =
+			    dictionary.Get(Communication::kKeyMessageFromPlayer).AsInt();
+			switch (type) {
+				case MessageFromPlayer::kSendPipelineStats: {
+					int32_t latency_ms =
+					    dictionary.Get(Communication::kKeyLatencyMs).AsInt();
+					latency_ms_ = latency_ms;
+					if (latency_ms > max_latency_ms_)
+						max_latency_ms_ = latency_ms;
+					break;
+				}
+				case MessageFromPlayer::kReconnected:
+					++reconnects_;
+					break;
+				case MessageFromPlayer::kReconnectFailed:
+					reconnect_failed_ = true;
+					break;
+			}
+			if (verbose_)
+				printf("%s\n", message.DebugString().c_str());
+		}
+
+	private:
+		bool verbose_;
+		std::atomic<int32_t> latency_ms_;
+		std::atomic<int32_t> max_latency_ms_;
+		std::atomic<uint32_t> reconnects_;
+		std::atomic<bool> reconnect_failed_;
+};
+
+void PrintUsage(const char* name) {
+	fprintf(stderr,
+	        "usage: %s [-d] [-t transport] [-l target_latency] [-L loss] "
+	        "[-R reorder] [-J jitter_ms] [-B kbps] [-D disconnect_s] "
+	        "[-m max_rss_growth_mb] [-x max_latency] <file> [seconds]\n"
+	        "  -d  enable debug logs and print messages\n"
+	        "  -t  udp or tcp (default tcp)\n"
+	        "  -l  target latency in seconds, 0 disables dropping (default 0)\n"
+	        "  -L  share of RTP packets lost, 0 to 1 (default 0)\n"
+	        "  -R  share of RTP packets reordered, 0 to 1 (default 0)\n"
+	        "  -J  maximum jitter of each frame in milliseconds (default 0)\n"
+	        "  -B  bandwidth cap in kbit/s, 0 for none (default 0)\n"
+	        "  -D  disconnect after streaming this long, 0 for never "
+	        "(default 0)\n"
+	        "  -m  allowed growth of the RSS after warmup in MB (default %d)\n"
+	        "  -x  allowed latency in seconds (default %g)\n"
+	        "  seconds defaults to %d\n",
+	        name, kDefaultMaxRssGrowthMb, kDefaultMaxLatencyS, kDefaultDurationS);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+	PlayerOptions options;
+	RTSPTestServer::Impairments impairments;
+	bool verbose = false;
+	long max_rss_growth_kb = kDefaultMaxRssGrowthMb * 1024;
+	int32_t max_latency_ms = kDefaultMaxLatencyS * 1000;
+	int opt;
+	while ((opt = getopt(argc, argv, "dt:l:L:R:J:B:D:m:x:")) != -1) {
+		switch (opt) {
+			case 'd':
+				verbose = true;
+				Logger::EnableDebugLogs(true);
+				break;
+			case 't':
+				options.transport = optarg;
+				break;
+			case 'l':
+				options.target_latency = atof(optarg);
+				break;
+			case 'L':
+				impairments.loss = atof(optarg);
+				break;
+			case 'R':
+				impairments.reorder = atof(optarg);
+				break;
+			case 'J':
+				impairments.jitter_ms = atoi(optarg);
+				break;
+			case 'B':
+				impairments.bandwidth_kbps = atoi(optarg);
+				break;
+			case 'D':
+				impairments.disconnect_interval_s = atoi(optarg);
+				break;
+			case 'm':
+				max_rss_growth_kb = atol(optarg) * 1024;
+				break;
+			case 'x':
+				max_latency_ms = atof(optarg) * 1000;
+				break;
+			default:
+				PrintUsage(argv[0]);
+				return 1;
+		}
+	}
+	if (optind >= argc) {
+		PrintUsage(argv[0]);
+		return 1;
+	}
+	std::string path = argv[optind];
+	int duration_s = optind + 1 < argc ? atoi(argv[optind + 1]) : kDefaultDurationS;
+
+	RTSPTestServer server(path, impairments);
+	if (!server.Start(0))
+		return 1;
+	fprintf(stderr, "Serving %s at %s\n", path.c_str(), server.GetUrl().c_str());
+
+	SoakInstance instance(verbose);
+	Logger::InitializeInstance(&instance);
+	PacketRecorder& recorder = PacketRecorder::Get();
+	recorder.SetKeepRecords(false);
+
+	auto message_sender = std::make_shared<Communication::MessageSender>(&instance);
+	auto stream_info_cache = std::make_shared<StreamInfoCache>();
+	auto worker_pool = std::make_shared<WorkerPool>(
+	    pp::InstanceHandle(&instance), WorkerPool::kDefaultIoWorkers,
+	    WorkerPool::kDefaultProcessingWorkers);
+	long baseline_rss_kb = 0;
+	long max_rss_kb = 0;
+	const char* failure = NULL;
+	{
+		auto controller = std::make_shared<RTSPPlayerController>(
+		    pp::InstanceHandle(&instance), message_sender, stream_info_cache,
+		    worker_pool);
+		controller->SetViewRect(Samsung::NaClPlayer::Rect(0, 0, 1920, 1080));
+		controller->InitPlayer(server.GetUrl(), options);
+		controller->Play();
+
+		uint64_t last_count = 0;
+		int stalled_s = 0;
+		for (int s = 1; s <= duration_s && !failure; ++s) {
+			sleep(1);
+			long rss_kb = ReadRssKb();
+			if (s == kWarmupS)
+				baseline_rss_kb = rss_kb;
+			if (rss_kb > max_rss_kb)
+				max_rss_kb = rss_kb;
+
+			uint64_t count = recorder.GetCount();
+			stalled_s = count == last_count ? stalled_s + 1 : 0;
+			last_count = count;
+
+			if (instance.ReconnectFailed())
+				failure = "reconnecting failed";
+			else if (stalled_s >= kMaxStallS)
+				failure = "no packets appended";
+			else if (baseline_rss_kb && rss_kb - baseline_rss_kb > max_rss_growth_kb)
+				failure = "memory grew above the bound";
+			// Latency only counts while packets flow, it is stale otherwise.
+			else if (!stalled_s && s > kWarmupS &&
+			         instance.GetLatencyMs() > max_latency_ms)
+				failure = "latency above the bound";
+
+			if (s % kStatusPeriodS == 0 || failure) {
+				printf("%6d s  rss %ld kB  latency %d ms  packets %" PRIu64
+				       "  reconnects %u\n",
+				       s, rss_kb, instance.GetLatencyMs(), count,
+				       instance.GetReconnects());
+				fflush(stdout);
+			}
+		}
+		// The destructor stops the threads and closes the input.
+	}
+	server.Stop();
+
+	RTSPTestServer::Stats stats = server.GetStats();
+	printf("sessions %" PRIu64 "  rtp packets %" PRIu64 "  lost %" PRIu64
+	       "  reordered %" PRIu64 "  disconnects %" PRIu64 "\n",
+	       stats.sessions, stats.rtp_packets, stats.lost_packets,
+	       stats.reordered_packets, stats.disconnects);
+	printf("appended packets %" PRIu64 "  reconnects %u  max latency %d ms  "
+	       "rss baseline %ld kB  max %ld kB\n",
+	       recorder.GetCount(), instance.GetReconnects(),
+	       instance.GetMaxLatencyMs(), baseline_rss_kb, max_rss_kb);
+	if (failure) {
+		printf("FAILED: %s\n", failure);
+		return 1;
+	}
+	printf("PASSED\n");
+	return 0;
+}
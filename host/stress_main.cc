@@ -0,0 +1,353 @@
+// Plays the same stream with a growing number of RTSPPlayerController
+// instances sharing one worker pool, like a grid of cameras, and checks that
+// every player still gets its packets through. The stream is served in real
+// time by an in-process RTSPTestServer, so the packets appended per player
+// and second only stay flat if playback scales linearly. Unreachable and
+// stalled cameras can be played alongside, which block connecting and reading
+// until they time out, and the playback of every healthy player has to keep
+// up with real time regardless. Exits with 1 if a step falls below the given share of the
+// single player rate or a healthy player lags behind.
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ppapi/cpp/instance.h"
+#include "ppapi/cpp/var_dictionary.h"
+
+#include "logger.h"
+#include "message_sender.h"
+#include "messages.h"
+#include "player_controller.h"
+#include "rtsp_player_controller.h"
+#include "stream_info_cache.h"
+#include "worker_pool.h"
+
+#include "packet_recorder.h"
+#include "rtsp_test_server.h"
+
+using Communication::MessageFromPlayer;
+
+namespace {
+
+const PP_Instance kStressInstance = 1;
+const int kDefaultMaxPlayers = 16;
+const int kDefaultStepS = 10;
+const double kDefaultMinEfficiency = 0.9;
+const double kDefaultMaxLagS = 1;
+/// Players connect and fill their buffers before a step is measured.
+const int kWarmupS = 3;
+/// Players of unreachable and stalled cameras get ids from here on, the
+/// healthy ones count from 0.
+const int32_t kImpairedPlayerIds = 1000;
+/// Stalled cameras answer RTSP requests but send no media during a run, so
+/// they append no packets to the count.
+const uint32_t kStalledMs = 24 * 3600 * 1000;
+
+int64_t ProcessCpuUs() {
+	struct timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+/// A camera which accepts connections but never answers, so connecting to it
+/// blocks until the controller times out.
+class UnreachableCamera {
+	public:
+		UnreachableCamera() : fd_(-1), port_(0) {}
+		~UnreachableCamera() {
+			if (fd_ >= 0)
+				close(fd_);
+		}
+
+		UnreachableCamera(const UnreachableCamera&) = delete;
+		UnreachableCamera& operator=(const UnreachableCamera&) = delete;
+
+		bool Start() {
+			fd_ = socket(AF_INET, SOCK_STREAM, 0);
+			struct sockaddr_in address;
+			memset(&address, 0, sizeof(address));
+			address.sin_family = AF_INET;
+			address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			socklen_t length = sizeof(address);
+			// Connections wait in the backlog, which is never accepted from.
+			if (bind(fd_, reinterpret_cast<struct sockaddr*>(&address),
+			         sizeof(address)) < 0 ||
+			    listen(fd_, SOMAXCONN) < 0 ||
+			    getsockname(fd_, reinterpret_cast<struct sockaddr*>(&address),
+			                &length) < 0) {
+				perror("UnreachableCamera");
+				return false;
+			}
+			port_ = ntohs(address.sin_port);
+			return true;
+		}
+
+		std::string GetUrl() const {
+			return "rtsp://127.0.0.1:" + std::to_string(port_) + "/unreachable";
+		}
+
+	private:
+		int fd_;
+		uint16_t port_;
+};
+
+/// Counts failed reconnects of the healthy players and keeps the latest
+/// playback position of each player. Log lines and messages go to stderr and
+/// stdout with -d only.
+class StressInstance : public pp::Instance {
+	public:
+		explicit StressInstance(bool verbose)
+			: pp::Instance(kStressInstance),
+			  verbose_(verbose),
+			  reconnect_failures_(0) {}
+
+		uint32_t GetReconnectFailures() const { return reconnect_failures_; }
+
+		std::map<int32_t, double> GetPositions() {
+			std::lock_guard<std::mutex> lock(mutex_);
+			return positions_;
+		}
+
+	protected:
+		void OnPostMessage(const pp::Var& message) override {
+			if (message.is_string()) {
+				if (verbose_)
+					pp::Instance::OnPostMessage(message);
+				return;
+			}
+			pp::VarDictionary dictionary(message);
+			int32_t type =
+			    dictionary.Get(Communication::kKeyMessageFromPlayer).AsInt();
+			int32_t player_id = dictionary.Get(Communication::kKeyPlayerId).AsInt();
+			if (type == MessageFromPlayer::kReconnectFailed &&
+			    player_id < kImpairedPlayerIds) {
+				++reconnect_failures_;
+			} else if (type == MessageFromPlayer::kTimeUpdate) {
+				std::lock_guard<std::mutex> lock(mutex_);
+				positions_[player_id] = dictionary.Get(Communication::kKeyTime).AsDouble();
+			}
+			if (verbose_)
+				printf("%s\n", message.DebugString().c_str());
+		}
+
+	private:
+		bool verbose_;
+		std::atomic<uint32_t> reconnect_failures_;
+		std::mutex mutex_;
+		std::map<int32_t, double> positions_;
+};
+
+/// Returns by how much the playback of the slowest of the first
+/// <code>players</code> fell behind real time between the two positions.
+double GetMaxLagS(const std::map<int32_t, double>& started,
+                  const std::map<int32_t, double>& finished, int players,
+                  double elapsed_s) {
+	double max_lag_s = 0;
+	for (int32_t id = 0; id < players; ++id) {
+		auto start = started.find(id);
+		auto end = finished.find(id);
+		double played_s = start != started.end() && end != finished.end() ?
+		                   end->second - start->second : 0;
+		max_lag_s = std::max(max_lag_s, elapsed_s - played_s);
+	}
+	return max_lag_s;
+}
+
+void PrintUsage(const char* name) {
+	fprintf(stderr,
+	        "usage: %s [-d] [-t transport] [-n max_players] [-s step_seconds] "
+	        "[-e min_efficiency] [-u unreachable] [-S stalled] [-l max_lag] "
+	        "<file>\n"
+	        "  -d  enable debug logs and print messages\n"
+	        "  -t  udp or tcp (default tcp)\n"
+	        "  -n  players of the last step, the count doubles from 1 "
+	        "(default %d)\n"
+	        "  -s  time each step is measured for (default %d)\n"
+	        "  -e  share of the single player packet rate each player has to "
+	        "keep, 0 to 1 (default %g)\n"
+	        "  -u  cameras played alongside which never answer (default 0)\n"
+	        "  -S  cameras played alongside which never send media (default 0)\n"
+	        "  -l  seconds the playback of a player may fall behind in a step "
+	        "(default %g)\n",
+	        name, kDefaultMaxPlayers, kDefaultStepS, kDefaultMinEfficiency,
+	        kDefaultMaxLagS);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+	PlayerOptions options;
+	bool verbose = false;
+	int max_players = kDefaultMaxPlayers;
+	int step_s = kDefaultStepS;
+	double min_efficiency = kDefaultMinEfficiency;
+	int unreachable_cameras = 0;
+	int stalled_cameras = 0;
+	double max_lag_s = kDefaultMaxLagS;
+	int opt;
+	while ((opt = getopt(argc, argv, "dt:n:s:e:u:S:l:")) != -1) {
+		switch (opt) {
+			case 'd':
+				verbose = true;
+				Logger::EnableDebugLogs(true);
+				break;
+			case 't':
+				options.transport = optarg;
+				break;
+			case 'n':
+				max_players = std::max(atoi(optarg), 1);
+				break;
+			case 's':
+				step_s = std::max(atoi(optarg), 1);
+				break;
+			case 'e':
+				min_efficiency = atof(optarg);
+				break;
+			case 'u':
+				unreachable_cameras = std::max(atoi(optarg), 0);
+				break;
+			case 'S':
+				stalled_cameras = std::max(atoi(optarg), 0);
+				break;
+			case 'l':
+				max_lag_s = atof(optarg);
+				break;
+			default:
+				PrintUsage(argv[0]);
+				return 1;
+		}
+	}
+	if (optind >= argc) {
+		PrintUsage(argv[0]);
+		return 1;
+	}
+	std::string path = argv[optind];
+
+	RTSPTestServer server(path, RTSPTestServer::Impairments());
+	if (!server.Start(0))
+		return 1;
+	fprintf(stderr, "Serving %s at %s\n", path.c_str(), server.GetUrl().c_str());
+
+	RTSPTestServer::Impairments stall;
+	stall.stall_ms = kStalledMs;
+	RTSPTestServer stalled_server(path, stall);
+	UnreachableCamera unreachable;
+	if ((stalled_cameras && !stalled_server.Start(0)) ||
+	    (unreachable_cameras && !unreachable.Start()))
+		return 1;
+
+	StressInstance instance(verbose);
+	Logger::InitializeInstance(&instance);
+	PacketRecorder& recorder = PacketRecorder::Get();
+	recorder.SetKeepRecords(false);
+
+	auto message_sender = std::make_shared<Communication::MessageSender>(&instance);
+	auto stream_info_cache = std::make_shared<StreamInfoCache>();
+	auto worker_pool = std::make_shared<WorkerPool>(
+	    pp::InstanceHandle(&instance), WorkerPool::kDefaultIoWorkers,
+	    WorkerPool::kDefaultProcessingWorkers);
+	const char* failure = NULL;
+	{
+		auto create_player = [&](int32_t player_id, const std::string& url) {
+			auto controller = std::make_shared<RTSPPlayerController>(
+			    pp::InstanceHandle(&instance), message_sender->ForPlayer(player_id),
+			    stream_info_cache, worker_pool);
+			controller->SetViewRect(Samsung::NaClPlayer::Rect(0, 0, 480, 270));
+			controller->InitPlayer(url, options);
+			controller->Play();
+			return controller;
+		};
+
+		// Impaired cameras are loaded again each step, since a player whose
+		// first connect fails isn't retried.
+		std::vector<std::shared_ptr<RTSPPlayerController> > impaired;
+		std::vector<std::shared_ptr<RTSPPlayerController> > controllers;
+		double single_rate = 0;
+		printf("players  packets/s  per player  efficiency  cpu %%  cpu us/packet"
+		       "  max io %%  max cpu %%  io workers  max lag s\n");
+		for (int players = 1; !failure; players = std::min(players * 2, max_players)) {
+			impaired.clear();
+			for (int i = 0; i < unreachable_cameras; ++i)
+				impaired.push_back(create_player(kImpairedPlayerIds + i, unreachable.GetUrl()));
+			for (int i = 0; i < stalled_cameras; ++i) {
+				impaired.push_back(create_player(
+				    kImpairedPlayerIds + unreachable_cameras + i, stalled_server.GetUrl()));
+			}
+			while (static_cast<int>(controllers.size()) < players) {
+				controllers.push_back(create_player(controllers.size(),
+				                                    server.GetUrl()));
+			}
+			sleep(kWarmupS);
+
+			uint64_t count = recorder.GetCount();
+			int64_t cpu_us = ProcessCpuUs();
+			int64_t started_us = PacketRecorder::NowUs();
+			std::map<int32_t, double> started_positions = instance.GetPositions();
+			sleep(step_s);
+			double elapsed_s = (PacketRecorder::NowUs() - started_us) / 1e6;
+			uint64_t packets = recorder.GetCount() - count;
+			cpu_us = ProcessCpuUs() - cpu_us;
+			double lag_s = GetMaxLagS(started_positions, instance.GetPositions(),
+			                          players, elapsed_s);
+
+			uint32_t max_utilization[2] = {0, 0};
+			for (const WorkerPool::WorkerStats& stats : worker_pool->GetWorkerStats()) {
+				uint32_t& max = max_utilization[stats.group];
+				max = std::max(max, stats.utilization);
+			}
+
+			double rate = packets / elapsed_s;
+			double per_player = rate / players;
+			if (players == 1)
+				single_rate = rate;
+			double efficiency = single_rate > 0 ? per_player / single_rate : 0;
+			printf("%7d  %9.1f  %10.1f  %10.2f  %5.1f  %13.1f  %8u  %9u  %10u  %9.2f\n",
+			       players, rate, per_player, efficiency,
+			       cpu_us / 1e4 / elapsed_s,
+			       packets ? static_cast<double>(cpu_us) / packets : 0.0,
+			       max_utilization[WorkerPool::kIo],
+			       max_utilization[WorkerPool::kProcessing],
+			       worker_pool->GetWorkerCount(WorkerPool::kIo), lag_s);
+			fflush(stdout);
+
+			if (!packets)
+				failure = "no packets appended";
+			else if (instance.GetReconnectFailures())
+				failure = "reconnecting failed";
+			else if (efficiency < min_efficiency)
+				failure = "packet rate per player dropped below the bound";
+			else if (lag_s > max_lag_s)
+				failure = "playback of a player fell behind above the bound";
+			if (players == max_players)
+				break;
+		}
+		// The destructors stop the players, the pool outlives them.
+	}
+	server.Stop();
+	stalled_server.Stop();
+
+	RTSPTestServer::Stats stats = server.GetStats();
+	printf("sessions %" PRIu64 "  rtp packets %" PRIu64 "  appended packets %" PRIu64
+	       "\n", stats.sessions, stats.rtp_packets, recorder.GetCount());
+	if (failure) {
+		printf("FAILED: %s\n", failure);
+		return 1;
+	}
+	printf("PASSED\n");
+	return 0;
+}
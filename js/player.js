@@ -3,13 +3,18 @@
 var STAVPlayer = {
     module: null,
     handleBufferingComplete: null,
-    playReady: false,
+    // Keyed by player id, see the player_id option of play().
+    playReady: {},
+    loadArgs: {},
+    transport: null,
     MessageTo: {
         kClosePlayer: 0,
         kLoadMedia: 1,
         kPlay: 2,
         kStop: 3,
+        kChangeViewRect: 4,
         kMute: 5,
+        kSetPriority: 6,
     },
     MessageFrom: {
         kTimeUpdate: 100,
@@ -17,6 +22,15 @@ var STAVPlayer = {
         kStreamEnded: 103,
         kSetAudioLevel: 104,
         kSendStats: 105,
+        kSendPipelineStats: 106,
+        kStreamConfigChanged: 107,
+        kTransportSelected: 108,
+        kTeardownCompleted: 109,
+        kReconnecting: 110,
+        kReconnected: 111,
+        kReconnectFailed: 112,
+        kSendWorkerStats: 113,
+        kPlayerRejected: 114,
     },
 };
 
@@ -29,12 +43,14 @@ STAVPlayer.moduleDidCrash = function(e) {
 }
 
 STAVPlayer.handleMessage = function(e) {
+    var playerId = e.data.player_id || 0;
     switch (e.data.messageFromPlayer) {
     case STAVPlayer.MessageFrom.kBufferingCompleted:
         console.log('buffering complete');
-        STAVPlayer.playReady = true;
+        STAVPlayer.playReady[playerId] = true;
         STAVPlayer.handleBufferingCompleted(e);
-        STAVPlayer.module.postMessage({'messageToPlayer': STAVPlayer.MessageTo.kPlay});
+        STAVPlayer.module.postMessage({'messageToPlayer': STAVPlayer.MessageTo.kPlay,
+                                       'player_id': playerId});
         break;
     case STAVPlayer.MessageFrom.kStreamEnded:
         console.log('stream ended');
@@ -53,29 +69,144 @@ STAVPlayer.handleMessage = function(e) {
         msg    += ' bitrate=' + e.data.stats_bitrate + ' kb/s';
         console.log(msg);
         break;
+    case STAVPlayer.MessageFrom.kSendPipelineStats:
+        var msg = 'ring occupancy=' + e.data.ring_occupancy;
+        msg    += ' high_watermark=' + e.data.ring_high_watermark;
+        msg    += ' overruns=' + e.data.ring_overruns;
+        msg    += ' dropped_gops=' + e.data.ring_dropped_gops;
+        msg    += ' video buffered=' + e.data.video_buffered_bytes + 'B';
+        msg    += ' dropped_gops=' + e.data.video_dropped_gops;
+        msg    += ' audio buffered=' + e.data.audio_buffered_bytes + 'B';
+        msg    += ' dropped=' + e.data.audio_dropped_packets;
+        msg    += ' es_packets=' + e.data.es_packets;
+        msg    += ' allocations=' + e.data.es_packet_allocations;
+        msg    += ' latency=' + e.data.latency_ms + 'ms';
+        msg    += ' latency_dropped=' + e.data.latency_dropped_frames;
+        msg    += ' audio queue=' + e.data.audio_queue_occupancy;
+        msg    += ' overruns=' + e.data.audio_queue_overruns;
+        msg    += ' wait=' + e.data.audio_queue_wait_us + '/' + e.data.audio_queue_wait_max_us + 'us';
+        msg    += ' convert=' + e.data.audio_convert_us + '/' + e.data.audio_convert_max_us + 'us';
+        msg    += ' handoff=' + e.data.audio_handoff_us + '/' + e.data.audio_handoff_max_us + 'us';
+        console.log(msg);
+        break;
+    case STAVPlayer.MessageFrom.kStreamConfigChanged:
+        // The cached configuration is dropped already, loading again probes
+        // the stream.
+        console.log('stream configuration changed, reloading');
+        STAVPlayer.close(playerId);
+        STAVPlayer.play.apply(STAVPlayer, STAVPlayer.loadArgs[playerId]);
+        break;
+    case STAVPlayer.MessageFrom.kTransportSelected:
+        console.log('RTSP transport: ' + e.data.transport);
+        STAVPlayer.transport = e.data.transport;
+        break;
+    case STAVPlayer.MessageFrom.kTeardownCompleted:
+        console.log('stream stopped in ' + e.data.teardown_ms + ' ms');
+        break;
+    case STAVPlayer.MessageFrom.kReconnecting:
+        console.log('connection lost, reconnect attempt ' + e.data.attempt +
+                    ' in ' + e.data.delay_ms + ' ms');
+        break;
+    case STAVPlayer.MessageFrom.kReconnected:
+        console.log('reconnected after ' + e.data.attempt + ' attempt(s)');
+        break;
+    case STAVPlayer.MessageFrom.kReconnectFailed:
+        console.log('reconnecting failed, playback stopped');
+        STAVPlayer.playReady[playerId] = false;
+        break;
+    case STAVPlayer.MessageFrom.kSendWorkerStats:
+        var msg = 'workers';
+        for (var name in e.data.workers) {
+            var worker = e.data.workers[name];
+            msg += ' ' + name + '=' + worker.utilization + '%';
+            msg += '/' + worker.tasks + '/' + worker.max_task_us + 'us';
+        }
+        console.log(msg);
+        break;
+    case STAVPlayer.MessageFrom.kPlayerRejected:
+        // Closing another player frees its decoder slot.
+        console.log('player ' + playerId + ' rejected, all decoder slots are taken');
+        STAVPlayer.playReady[playerId] = false;
+        break;
     default:
         console.log(e.data); // a log message from C code
     }    
 }
 
-STAVPlayer.play = function(url, audio_level_cb_frequency, crt_path) {
+// options (optional):
+//   transport - 'udp', 'tcp' (default), 'udp_multicast' or 'auto', which tries
+//               UDP and falls back to TCP
+//   fast_start - configure streams from the SDP instead of probing them
+//   persist_stream_info - keep cached stream parameters across restarts
+//   ffmpeg_options - FFmpeg/RTSP tuning, e.g. {'max_delay': 0,
+//                    'fflags': 'nobuffer', 'reorder_queue_size': 16}
+//   max_reconnect_attempts - how many times a lost connection is reopened
+//                            (10 by default, 0 disables reconnecting)
+//   target_latency - live latency in seconds kept by dropping video when
+//                    playback falls behind, e.g. 0.5 (disabled by default)
+//   priority - scheduling priority on the threads shared by all players, a
+//              higher one goes first (0 by default), see setPriority()
+//   player_id - plays several streams at once, e.g. the tiles of a grid, each
+//               shown where setViewRect() puts it (0 by default)
+STAVPlayer.play = function(url, audio_level_cb_frequency, crt_path, options) {
+	options = options || {};
+	var playerId = options.player_id || 0;
+	this.loadArgs[playerId] = [url, audio_level_cb_frequency, crt_path, options];
 	audio_level_cb_frequency = audio_level_cb_frequency || 0;
-    if (this.playReady) {
-        this.module.postMessage({'messageToPlayer': this.MessageTo.kPlay});
+    if (this.playReady[playerId]) {
+        this.module.postMessage({'messageToPlayer': this.MessageTo.kPlay,
+                                 'player_id': playerId});
     } else {
         this.module.postMessage({'messageToPlayer': this.MessageTo.kLoadMedia,
+                                 'player_id': playerId,
                                  'type' : 1, 'url': url,
                                  'audio_level_cb_frequency':audio_level_cb_frequency,
-                                 'crt_path': crt_path});
+                                 'crt_path': crt_path,
+                                 'transport': options.transport || 'tcp',
+                                 'fast_start': !!options.fast_start,
+                                 'persist_stream_info': !!options.persist_stream_info,
+                                 'ffmpeg_options': options.ffmpeg_options || {},
+                                 'max_reconnect_attempts': options.max_reconnect_attempts,
+                                 'target_latency': options.target_latency || 0,
+                                 'priority': options.priority || 0});
     }
 }
 
-STAVPlayer.stop = function() {
-    this.module.postMessage({'messageToPlayer': this.MessageTo.kStop});
+STAVPlayer.stop = function(player_id) {
+    // The connection is closed, so the next play() has to load the media.
+    this.playReady[player_id || 0] = false;
+    this.module.postMessage({'messageToPlayer': this.MessageTo.kStop,
+                             'player_id': player_id || 0});
+}
+
+// Closes the player and gives its decoder slot and buffers back to the
+// others.
+STAVPlayer.close = function(player_id) {
+    this.playReady[player_id || 0] = false;
+    this.module.postMessage({'messageToPlayer': this.MessageTo.kClosePlayer,
+                             'player_id': player_id || 0});
+}
+
+STAVPlayer.mute = function(player_id) {
+    this.module.postMessage({'messageToPlayer': this.MessageTo.kMute,
+                             'player_id': player_id || 0});
+}
+
+// Gives the player's work precedence on the threads shared by all players,
+// e.g. when its tile gets the focus.
+STAVPlayer.setPriority = function(priority, player_id) {
+    this.module.postMessage({'messageToPlayer': this.MessageTo.kSetPriority,
+                             'player_id': player_id || 0,
+                             'priority': priority});
 }
 
-STAVPlayer.mute = function() {
-    this.module.postMessage({'messageToPlayer': this.MessageTo.kMute});
+// Moves the player, e.g. to its tile of a grid. It can be called before
+// play(), tiles are switched without loading the streams again.
+STAVPlayer.setViewRect = function(x, y, width, height, player_id) {
+    this.module.postMessage({'messageToPlayer': this.MessageTo.kChangeViewRect,
+                             'player_id': player_id || 0,
+                             'x_coordinate': x, 'y_coordinate': y,
+                             'width': width, 'height': height});
 }
 STAVPlayer.addListeners = function(listenerElem) {
     listenerElem.addEventListener('load', this.moduleDidLoad, true);
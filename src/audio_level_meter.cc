@@ -0,0 +1,184 @@
+#include "audio_level_meter.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+
+// GCC and Clang generic vectors, PNaCl lowers them to SSE2 or NEON. Only
+// 128-bit vectors are used, narrow samples are widened within the lanes of a
+// full vector and doubles are narrowed lane by lane.
+typedef float Float4 __attribute__((vector_size(16)));
+typedef int32_t Int32x4 __attribute__((vector_size(16)));
+typedef uint32_t Uint32x4 __attribute__((vector_size(16)));
+typedef double Double2 __attribute__((vector_size(16)));
+
+static const int kBlockBytes = 2 * sizeof(Float4);
+static const double kSixteenBitFullScale = 32768.0;
+
+/// How blocks of two vectors of samples are converted to
+/// <code>kVectors</code> vectors of floats scaled to -1..1, in any order.
+template <typename T> struct SampleTraits;
+
+template <> struct SampleTraits<uint8_t> {
+	typedef Int32x4 Vector;
+	static const int kVectors = 8;
+	static void ToFloat(const Vector* v, Float4* f) {
+		// Each byte of a lane is shifted down and masked, a zero extension.
+		for (int i = 0; i < 2; ++i) {
+			for (int byte = 0; byte < 4; ++byte) {
+				Int32x4 s = (v[i] >> (8 * byte)) & 0xff;
+				f[4 * i + byte] =
+					(__builtin_convertvector(s, Float4) - 128.0f) * (1.0f / 128);
+			}
+		}
+	}
+	static float ToFloat(uint8_t s) { return (s - 128.0f) * (1.0f / 128); }
+};
+
+template <> struct SampleTraits<int16_t> {
+	typedef Int32x4 Vector;
+	static const int kVectors = 4;
+	static void ToFloat(const Vector* v, Float4* f) {
+		// The low sample of a lane is shifted up first, the arithmetic shift
+		// down extends the sign of both.
+		for (int i = 0; i < 2; ++i) {
+			Int32x4 low = (Int32x4)((Uint32x4)v[i] << 16) >> 16;
+			Int32x4 high = v[i] >> 16;
+			f[2 * i] = __builtin_convertvector(low, Float4) * (1.0f / 32768);
+			f[2 * i + 1] = __builtin_convertvector(high, Float4) * (1.0f / 32768);
+		}
+	}
+	static float ToFloat(int16_t s) { return s * (1.0f / 32768); }
+};
+
+template <> struct SampleTraits<int32_t> {
+	typedef Int32x4 Vector;
+	static const int kVectors = 2;
+	static void ToFloat(const Vector* v, Float4* f) {
+		for (int i = 0; i < 2; ++i)
+			f[i] = __builtin_convertvector(v[i], Float4) * (1.0f / 2147483648.0f);
+	}
+	static float ToFloat(int32_t s) { return s * (1.0f / 2147483648.0f); }
+};
+
+template <> struct SampleTraits<float> {
+	typedef Float4 Vector;
+	static const int kVectors = 2;
+	static void ToFloat(const Vector* v, Float4* f) {
+		f[0] = v[0];
+		f[1] = v[1];
+	}
+	static float ToFloat(float s) { return s; }
+};
+
+template <> struct SampleTraits<double> {
+	typedef Double2 Vector;
+	static const int kVectors = 1;
+	static void ToFloat(const Vector* v, Float4* f) {
+		Float4 narrowed = {static_cast<float>(v[0][0]), static_cast<float>(v[0][1]),
+		                   static_cast<float>(v[1][0]), static_cast<float>(v[1][1])};
+		f[0] = narrowed;
+	}
+	static float ToFloat(double s) { return static_cast<float>(s); }
+};
+
+/// Generic vectors have no min/max, so it is a compare and a bitwise select.
+static inline Float4 Max(Float4 a, Float4 b) {
+	Int32x4 mask = a > b;
+	return (Float4)(((Int32x4)a & mask) | ((Int32x4)b & ~mask));
+}
+
+/// Adds the squares of <code>count</code> samples to <code>*sum</code> and
+/// raises <code>*peak</code> to the largest square.
+template <typename T>
+static void Accumulate(const uint8_t* data, int count, double* sum,
+                       float* peak) {
+	typedef SampleTraits<T> Traits;
+	typedef typename Traits::Vector Vector;
+	const int block_samples = kBlockBytes / sizeof(T);
+	const T* samples = reinterpret_cast<const T*>(data);
+
+	// Two accumulators hide the latency of the additions.
+	Float4 sums[2] = {{0, 0, 0, 0}, {0, 0, 0, 0}};
+	Float4 maxs[2] = {{0, 0, 0, 0}, {0, 0, 0, 0}};
+	int i = 0;
+	for (; i + block_samples <= count; i += block_samples) {
+		Vector v[2];
+		// Planes are aligned, but packed channels may start anywhere.
+		memcpy(v, samples + i, sizeof(v));
+		Float4 f[Traits::kVectors];
+		Traits::ToFloat(v, f);
+		for (int j = 0; j < Traits::kVectors; ++j) {
+			f[j] *= f[j];
+			sums[j & 1] += f[j];
+			maxs[j & 1] = Max(maxs[j & 1], f[j]);
+		}
+	}
+	Float4 sum0 = sums[0] + sums[1];
+	Float4 max0 = Max(maxs[0], maxs[1]);
+
+	float tail_sum = 0;
+	float tail_max = 0;
+	for (; i < count; ++i) {
+		float f = Traits::ToFloat(samples[i]);
+		f *= f;
+		tail_sum += f;
+		tail_max = std::max(tail_max, f);
+	}
+
+	*sum += static_cast<double>(sum0[0]) + sum0[1] + sum0[2] + sum0[3] + tail_sum;
+	*peak = std::max(*peak, std::max(std::max(max0[0], max0[1]),
+	                                 std::max(max0[2], std::max(max0[3], tail_max))));
+}
+
+bool MeasureAudioLevel(const uint8_t* const* planes, int plane_count,
+                       int samples_per_plane, AVSampleFormat format,
+                       AudioLevel* level) {
+	typedef void (*AccumulateFunction)(const uint8_t*, int, double*, float*);
+	AccumulateFunction accumulate;
+	switch (av_get_packed_sample_fmt(format)) {
+		case AV_SAMPLE_FMT_U8:
+			accumulate = Accumulate<uint8_t>;
+			break;
+		case AV_SAMPLE_FMT_S16:
+			accumulate = Accumulate<int16_t>;
+			break;
+		case AV_SAMPLE_FMT_S32:
+			accumulate = Accumulate<int32_t>;
+			break;
+		case AV_SAMPLE_FMT_FLT:
+			accumulate = Accumulate<float>;
+			break;
+		case AV_SAMPLE_FMT_DBL:
+			accumulate = Accumulate<double>;
+			break;
+		default:
+			return false;
+	}
+
+	double sum = 0;
+	float peak = 0;
+	for (int i = 0; i < plane_count; ++i)
+		accumulate(planes[i], samples_per_plane, &sum, &peak);
+
+	int64_t count = static_cast<int64_t>(plane_count) * samples_per_plane;
+	level->rms = count > 0 ? sqrt(sum / count) : 0;
+	level->peak = sqrt(peak);
+	return true;
+}
+
+bool MeasureAudioLevel(const AVFrame* frame, AVSampleFormat format,
+                       AudioLevel* level) {
+	int channels = frame->channels;
+	if (av_sample_fmt_is_planar(format))
+		return MeasureAudioLevel(frame->extended_data, channels, frame->nb_samples,
+		                         format, level);
+	return MeasureAudioLevel(frame->extended_data, 1,
+	                         frame->nb_samples * channels, format, level);
+}
+
+double AudioLevelToDecibels(double level) {
+	double decibels = 20 * log10(level * kSixteenBitFullScale);
+	return decibels > 0 ? decibels : 0;
+}
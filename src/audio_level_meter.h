@@ -0,0 +1,55 @@
+#ifndef AUDIO_LEVEL_METER_H_
+#define AUDIO_LEVEL_METER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+extern "C" {
+#include "libavutil/frame.h"
+#include "libavutil/samplefmt.h"
+}
+
+/// @file
+/// @brief This file defines functions measuring the level of decoded audio.
+
+/// @struct AudioLevel
+/// @brief A level of a block of samples, relative to the full scale of the
+/// sample format.
+struct AudioLevel {
+	AudioLevel() : rms(0), peak(0) {}
+
+	/// The root mean square of all samples of all channels, 0 to 1.
+	double rms;
+
+	/// The largest absolute sample value, 0 to 1.
+	double peak;
+};
+
+/// Measures samples of one or more planes.
+///
+/// The samples are converted to floats and processed four at a time with
+/// generic vectors, which map to SSE2 or NEON registers.
+///
+/// @param[in] planes Pointers to the sample planes, a single one for packed
+///   formats.
+/// @param[in] plane_count A number of <code>planes</code>.
+/// @param[in] samples_per_plane A number of samples in each plane, which is
+///   the number of samples times the number of channels for packed formats.
+/// @param[in] format Any packed or planar U8, S16, S32, FLT or DBL format.
+/// @param[out] level The measured level.
+/// @return False if <code>format</code> is not supported.
+bool MeasureAudioLevel(const uint8_t* const* planes, int plane_count,
+                       int samples_per_plane, AVSampleFormat format,
+                       AudioLevel* level);
+
+/// Measures all channels of a decoded frame.
+///
+/// @see MeasureAudioLevel()
+bool MeasureAudioLevel(const AVFrame* frame, AVSampleFormat format,
+                       AudioLevel* level);
+
+/// Converts a level to decibels over one step of 16-bit audio, the scale audio
+/// levels are reported in: 0 for silence up to 90.31 for a full scale level.
+double AudioLevelToDecibels(double level);
+
+#endif  // AUDIO_LEVEL_METER_H_
@@ -0,0 +1,177 @@
+#include "audio_transcoder.h"
+
+extern "C" {
+#include "libavutil/channel_layout.h"
+#include "libavutil/mem.h"
+#include "libavutil/samplefmt.h"
+}
+
+#include "common.h"
+#include "transcode_utils.h"
+
+/// Samples per channel expected in a decoded frame if the decoder doesn't
+/// tell, more than an RTP packet of the transcoded codecs holds. Larger frames
+/// still work, the buffers grow once.
+static const int kMaxInputFrameSamples = 4096;
+
+AudioTranscoder::AudioTranscoder()
+	: in_codec_ctx_(NULL),
+	  out_codec_ctx_(NULL),
+	  resample_context_(NULL),
+	  fifo_(NULL),
+	  input_frame_(NULL),
+	  output_frame_(NULL),
+	  converted_samples_(NULL),
+	  converted_capacity_(0),
+	  fifo_pts_(AV_NOPTS_VALUE) {
+	time_base_.num = 1;
+	time_base_.den = 1;
+}
+
+int AudioTranscoder::Init(const AVCodecParameters* codecpar,
+                          AVRational time_base) {
+	Reset();
+	time_base_ = time_base;
+	int ret = init_transcoder(codecpar, &in_codec_ctx_, &out_codec_ctx_,
+	                          &resample_context_, kAudioTranscode);
+	if (ret >= 0 && (!out_codec_ctx_ || !resample_context_))
+		ret = AVERROR(EINVAL);
+	if (ret < 0) {
+		Reset();
+		return ret;
+	}
+
+	const int channels = out_codec_ctx_->channels;
+	const int frame_size = out_codec_ctx_->frame_size;
+	const int max_input_samples = in_codec_ctx_->frame_size > 0 ?
+	                              in_codec_ctx_->frame_size : kMaxInputFrameSamples;
+	input_frame_ = av_frame_alloc();
+	output_frame_ = av_frame_alloc();
+	converted_samples_ = static_cast<uint8_t**>(
+	                         av_calloc(channels, sizeof(*converted_samples_)));
+	// Every full frame is encoded before the next packet is decoded, so the
+	// FIFO never holds more than a frame and the largest input frame.
+	fifo_ = av_audio_fifo_alloc(out_codec_ctx_->sample_fmt, channels,
+	                            frame_size + max_input_samples);
+	if (!input_frame_ || !output_frame_ || !converted_samples_ || !fifo_) {
+		LOG_ERROR("Could not allocate transcoder buffers");
+		Reset();
+		return AVERROR(ENOMEM);
+	}
+
+	output_frame_->nb_samples = frame_size;
+	output_frame_->channels = channels;
+	output_frame_->channel_layout = out_codec_ctx_->channel_layout;
+	output_frame_->format = out_codec_ctx_->sample_fmt;
+	output_frame_->sample_rate = out_codec_ctx_->sample_rate;
+	if ((ret = av_frame_get_buffer(output_frame_, 0)) < 0 ||
+	    (ret = Reserve(max_input_samples)) < 0) {
+		char error[AV_ERROR_MAX_STRING_SIZE];
+		LOG_ERROR("Could not allocate transcoder samples (error '%s')",
+		          av_make_error_string(error, sizeof(error), ret));
+		Reset();
+		return ret;
+	}
+	return 0;
+}
+
+void AudioTranscoder::Reset() {
+	if (converted_samples_) {
+		av_freep(&converted_samples_[0]);
+		av_freep(&converted_samples_);
+	}
+	converted_capacity_ = 0;
+	if (fifo_) {
+		av_audio_fifo_free(fifo_);
+		fifo_ = NULL;
+	}
+	av_frame_free(&input_frame_);
+	av_frame_free(&output_frame_);
+	swr_free(&resample_context_);
+	avcodec_free_context(&in_codec_ctx_);
+	avcodec_free_context(&out_codec_ctx_);
+	fifo_pts_ = AV_NOPTS_VALUE;
+}
+
+int AudioTranscoder::Reserve(int samples) {
+	int ret;
+	if (samples > converted_capacity_) {
+		av_freep(&converted_samples_[0]);
+		converted_capacity_ = 0;
+		if ((ret = av_samples_alloc(converted_samples_, NULL,
+		                            out_codec_ctx_->channels, samples,
+		                            out_codec_ctx_->sample_fmt, 0)) < 0)
+			return ret;
+		converted_capacity_ = samples;
+	}
+	int needed = av_audio_fifo_size(fifo_) + samples;
+	if (needed > av_audio_fifo_size(fifo_) + av_audio_fifo_space(fifo_)) {
+		LOG_INFO("Transcoder FIFO grows to %d samples", needed);
+		return av_audio_fifo_realloc(fifo_, needed);
+	}
+	return 0;
+}
+
+int AudioTranscoder::Decode(AVPacket* pkt, bool is_mute, AVFrame** frame) {
+	*frame = NULL;
+	int data_present = 0;
+	int ret = decode(in_codec_ctx_, input_frame_, &data_present, pkt);
+	if (ret < 0 || !data_present)
+		return ret;
+
+	int samples = input_frame_->nb_samples;
+	if ((ret = Reserve(samples)) < 0)
+		return ret;
+	if (is_mute) {
+		av_samples_set_silence(converted_samples_, 0, samples,
+		                       out_codec_ctx_->channels, out_codec_ctx_->sample_fmt);
+	} else {
+		// The sample rate doesn't change, so all samples come out at once.
+		ret = swr_convert(resample_context_, converted_samples_, samples,
+		                  (const uint8_t**)input_frame_->extended_data, samples);
+		if (ret < 0)
+			return ret;
+		samples = ret;
+	}
+
+	// The encoder counts time in samples, the FIFO follows the decoded frames
+	// so gaps in the stream are kept.
+	if (input_frame_->best_effort_timestamp != AV_NOPTS_VALUE) {
+		AVRational sample_time = {1, out_codec_ctx_->sample_rate};
+		fifo_pts_ = av_rescale_q(input_frame_->best_effort_timestamp, time_base_,
+		                         sample_time) - av_audio_fifo_size(fifo_);
+	}
+	if (av_audio_fifo_write(fifo_, (void**)converted_samples_, samples) < samples)
+		return AVERROR_EXIT;
+	*frame = input_frame_;
+	return 0;
+}
+
+int AudioTranscoder::Encode(AVPacket* pkt) {
+	const int frame_size = out_codec_ctx_->frame_size;
+	// The encoder holds the first frames back, so a frame may go in without a
+	// packet coming out.
+	while (av_audio_fifo_size(fifo_) >= frame_size) {
+		// Only copies if the encoder still references the previous samples.
+		int ret = av_frame_make_writable(output_frame_);
+		if (ret < 0)
+			return ret;
+		if (av_audio_fifo_read(fifo_, (void**)output_frame_->extended_data,
+		                       frame_size) < frame_size)
+			return AVERROR_EXIT;
+		output_frame_->pts = fifo_pts_;
+		if (fifo_pts_ != AV_NOPTS_VALUE)
+			fifo_pts_ += frame_size;
+
+		int got_packet = 0;
+		ret = encode(out_codec_ctx_, pkt, &got_packet, output_frame_);
+		if (ret < 0)
+			return ret;
+		if (got_packet) {
+			AVRational sample_time = {1, out_codec_ctx_->sample_rate};
+			av_packet_rescale_ts(pkt, sample_time, time_base_);
+			return 1;
+		}
+	}
+	return 0;
+}
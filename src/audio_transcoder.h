@@ -0,0 +1,89 @@
+#ifndef AUDIO_TRANSCODER_H_
+#define AUDIO_TRANSCODER_H_
+
+#include <stdint.h>
+
+extern "C" {
+#include "libavcodec/avcodec.h"
+#include "libavutil/audio_fifo.h"
+#include "libavutil/frame.h"
+#include "libswresample/swresample.h"
+}
+
+/// @file
+/// @brief This file defines the <code>AudioTranscoder</code> class.
+
+/// @class AudioTranscoder
+/// @brief Transcodes an audio stream the player can't decode to mono AAC.
+///
+/// The decoder, the encoder, the resampler, their frames, the converted
+/// samples and the FIFO between them are set up once for the lifetime of the
+/// stream. The FIFO and the sample buffer are sized for the largest frame
+/// expected up front, so transcoding a packet allocates nothing but what the
+/// codecs allocate themselves.
+class AudioTranscoder {
+	public:
+		AudioTranscoder();
+		~AudioTranscoder() { Reset(); }
+
+		AudioTranscoder(const AudioTranscoder&) = delete;
+		AudioTranscoder& operator=(const AudioTranscoder&) = delete;
+
+		/// Opens the decoder for <code>codecpar</code> and the AAC encoder and
+		/// allocates the buffers.
+		///
+		/// @param[in] codecpar Parameters of the input stream.
+		/// @param[in] time_base A time base of the input stream, timestamps
+		///   of the encoded packets are in it as well.
+		/// @return A negative FFmpeg error code on failure.
+		int Init(const AVCodecParameters* codecpar, AVRational time_base);
+
+		/// Frees the codecs, the FIFO and the buffers. Samples still buffered in
+		/// them are dropped, not drained, since it is only called when the
+		/// stream stops or changes and nothing would append them.
+		void Reset();
+
+		bool IsOpen() const { return out_codec_ctx_ != NULL; }
+
+		/// Decodes <code>pkt</code> and adds its samples to the FIFO, silent
+		/// ones if <code>is_mute</code> is set. Every full frame should be
+		/// encoded before the next call.
+		///
+		/// @param[out] frame The decoded frame, valid until the next call, or
+		///   NULL if the decoder returned none.
+		/// @return A negative FFmpeg error code on failure.
+		int Decode(AVPacket* pkt, bool is_mute, AVFrame** frame);
+
+		/// Encodes frames from the FIFO until a packet comes out or less than
+		/// a frame is left. Called until it returns 0 to encode every full
+		/// frame.
+		///
+		/// @param[out] pkt An encoded packet with timestamps in the time base
+		///   of the input stream, if one came out.
+		/// @return 1 if a packet came out, 0 if not, or a negative FFmpeg error
+		///   code on failure.
+		int Encode(AVPacket* pkt);
+
+	private:
+		/// Makes <code>converted_samples_</code> and the FIFO hold at least
+		/// <code>samples</code> more samples. Only allocates if a frame is larger
+		/// than any before.
+		int Reserve(int samples);
+
+		AVCodecContext* in_codec_ctx_;
+		AVCodecContext* out_codec_ctx_;
+		SwrContext* resample_context_;
+		AVAudioFifo* fifo_;
+		AVFrame* input_frame_;
+		AVFrame* output_frame_;
+		/// Samples of the latest input frame in the encoder's format.
+		uint8_t** converted_samples_;
+		/// Samples per channel <code>converted_samples_</code> holds.
+		int converted_capacity_;
+		AVRational time_base_;
+		/// The timestamp of the first sample in the FIFO, AV_NOPTS_VALUE until
+		/// a frame with a timestamp was decoded.
+		int64_t fifo_pts_;
+};
+
+#endif  // AUDIO_TRANSCODER_H_
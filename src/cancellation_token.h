@@ -0,0 +1,98 @@
+#ifndef CANCELLATION_TOKEN_H_
+#define CANCELLATION_TOKEN_H_
+
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+
+extern "C" {
+#include "libavformat/avformat.h"
+}
+
+/// @file
+/// @brief This file defines the <code>CancellationToken</code> class.
+
+/// @class CancellationToken
+/// @brief Aborts blocking FFmpeg I/O on request or when a deadline passes.
+///
+/// The token is installed as the <code>AVIOInterruptCB</code> of a format
+/// context, FFmpeg polls it while it waits for the network. Each blocking
+/// operation (connect, probe, read) sets its own deadline before it starts.
+/// <code>Cancel()</code> may be called from any thread and makes the pending
+/// and all further operations fail with <code>AVERROR_EXIT</code> until
+/// <code>Reset()</code> is called.
+class CancellationToken {
+	public:
+		CancellationToken() : cancelled_(false), deadline_ms_(0) {}
+
+		CancellationToken(const CancellationToken&) = delete;
+		CancellationToken& operator=(const CancellationToken&) = delete;
+
+		/// Makes <code>format_context</code> poll this token.
+		void Install(AVFormatContext* format_context) {
+			format_context->interrupt_callback.callback = &CancellationToken::Callback;
+			format_context->interrupt_callback.opaque = this;
+		}
+
+		/// Aborts the pending operation and all further ones.
+		void Cancel() { cancelled_.store(true); }
+
+		/// Clears the cancellation and the deadline.
+		void Reset() {
+			cancelled_.store(false);
+			deadline_ms_.store(0);
+		}
+
+		bool IsCancelled() const { return cancelled_.load(); }
+
+		/// Limits the duration of the next blocking operation.
+		///
+		/// @param[in] timeout_ms A time limit counted from now, 0 removes the
+		///   limit.
+		void SetDeadline(uint32_t timeout_ms) {
+			deadline_ms_.store(timeout_ms ? NowMs() + timeout_ms : 0);
+		}
+
+		/// Returns true if the current deadline has passed.
+		bool IsDeadlineExceeded() const {
+			uint64_t deadline = deadline_ms_.load();
+			return deadline && NowMs() > deadline;
+		}
+
+		/// Sleeps for <code>timeout_ms</code> unless cancelled in the meantime.
+		///
+		/// @return False if the token was cancelled.
+		bool SleepFor(uint32_t timeout_ms) const {
+			const uint64_t until = NowMs() + timeout_ms;
+			while (!IsCancelled()) {
+				uint64_t now = NowMs();
+				if (now >= until)
+					return true;
+				usleep(std::min<uint64_t>(until - now, kSleepSliceMs) * 1000);
+			}
+			return false;
+		}
+
+		/// Returns a monotonic time in milliseconds.
+		static uint64_t NowMs() {
+			struct timespec ts;
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			return static_cast<uint64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+		}
+
+	private:
+		static const uint32_t kSleepSliceMs = 50;
+
+		static int Callback(void* opaque) {
+			const CancellationToken* token = static_cast<const CancellationToken*>(opaque);
+			return token->IsCancelled() || token->IsDeadlineExceeded();
+		}
+
+		std::atomic<bool> cancelled_;
+		std::atomic<uint64_t> deadline_ms_;
+};
+
+#endif  // CANCELLATION_TOKEN_H_
@@ -0,0 +1,314 @@
+#include "capture_file.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "stream_info_cache.h"
+
+/// "STAVCAP" and a format version.
+static const char kCaptureMagic[8] = {'S', 'T', 'A', 'V', 'C', 'A', 'P', '1'};
+static const size_t kCaptureAlignment = 8;
+static const uint8_t kPadding[kCaptureAlignment] = {0};
+static const size_t kMaxDescriptionSize = 16384;
+
+// Fields are written as they are in memory.
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+              "Capture files are little-endian");
+static_assert(sizeof(CaptureFileHeader) == 16 &&
+              sizeof(CaptureStreamHeader) == 72 &&
+              sizeof(CapturePacketHeader) == 40,
+              "Capture file headers have a fixed layout");
+
+static size_t Align(size_t size) {
+	return (size + kCaptureAlignment - 1) & ~(kCaptureAlignment - 1);
+}
+
+static uint64_t NowUs() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+CaptureWriter::CaptureWriter() : file_(NULL), start_us_(0), packets_(0) {}
+
+CaptureWriter::~CaptureWriter() {
+	Close();
+}
+
+bool CaptureWriter::Open(const std::string& path,
+                         AVFormatContext* format_context) {
+	Close();
+	file_ = fopen(path.c_str(), "wb");
+	if (!file_) {
+		LOG_ERROR("Cannot create capture file %s", path.c_str());
+		return false;
+	}
+
+	// FFmpeg doesn't keep the SDP the server sent, an SDP is generated from
+	// the streams for reference instead.
+	char description[kMaxDescriptionSize];
+	if (av_sdp_create(&format_context, 1, description, sizeof(description)) < 0)
+		description[0] = '\0';
+
+	CaptureFileHeader header;
+	memcpy(header.magic, kCaptureMagic, sizeof(header.magic));
+	header.stream_count = format_context->nb_streams;
+	header.description_size = strlen(description);
+	bool ok = WriteAligned(&header, sizeof(header)) &&
+	          WriteAligned(description, header.description_size);
+
+	CachedStreamInfo info;
+	StreamInfoCache::Capture(format_context, std::string(), &info);
+	for (unsigned i = 0; i < info.streams.size() && ok; ++i) {
+		const CachedStreamParameters& params = info.streams[i];
+		const AVStream* s = format_context->streams[i];
+		CaptureStreamHeader stream;
+		memset(&stream, 0, sizeof(stream));
+		stream.codec_type = params.codec_type;
+		stream.codec_id = params.codec_id;
+		stream.codec_tag = params.codec_tag;
+		stream.profile = params.profile;
+		stream.level = params.level;
+		stream.format = params.format;
+		stream.width = params.width;
+		stream.height = params.height;
+		stream.sample_rate = params.sample_rate;
+		stream.channels = params.channels;
+		stream.channel_layout = params.channel_layout;
+		stream.bits_per_raw_sample = params.bits_per_raw_sample;
+		stream.frame_rate_num = params.frame_rate_num;
+		stream.frame_rate_den = params.frame_rate_den;
+		stream.time_base_num = s->time_base.num;
+		stream.time_base_den = s->time_base.den;
+		stream.extradata_size = params.extradata.size();
+		ok = WriteAligned(&stream, sizeof(stream)) &&
+		     WriteAligned(params.extradata.data(), params.extradata.size());
+	}
+
+	if (!ok) {
+		LOG_ERROR("Cannot write capture file %s", path.c_str());
+		Close();
+		return false;
+	}
+	start_us_ = NowUs();
+	packets_ = 0;
+	LOG_INFO("Capturing packets to %s", path.c_str());
+	return true;
+}
+
+void CaptureWriter::Write(const AVPacket* pkt) {
+	if (!file_)
+		return;
+
+	CapturePacketHeader header;
+	memset(&header, 0, sizeof(header));
+	header.arrival_us = NowUs() - start_us_;
+	header.pts = pkt->pts;
+	header.dts = pkt->dts;
+	header.duration = pkt->duration;
+	header.size = pkt->size;
+	header.stream_index = pkt->stream_index;
+	header.flags = pkt->flags;
+	if (!WriteAligned(&header, sizeof(header)) ||
+	    !WriteAligned(pkt->data, pkt->size)) {
+		LOG_ERROR("Cannot write capture file, capturing stopped");
+		Close();
+		return;
+	}
+	++packets_;
+}
+
+void CaptureWriter::Close() {
+	if (!file_)
+		return;
+	if (fclose(file_) != 0)
+		LOG_ERROR("Capture file not closed cleanly");
+	else
+		LOG_INFO("Captured %llu packets", static_cast<unsigned long long>(packets_));
+	file_ = NULL;
+}
+
+bool CaptureWriter::WriteAligned(const void* data, size_t size) {
+	if (size && fwrite(data, 1, size, file_) != size)
+		return false;
+	size_t padding = Align(size) - size;
+	return !padding || fwrite(kPadding, 1, padding, file_) == padding;
+}
+
+CaptureReader::CaptureReader()
+	: data_(NULL), size_(0), mapped_(false), offset_(0) {}
+
+CaptureReader::~CaptureReader() {
+	Close();
+}
+
+bool CaptureReader::Open(const std::string& path) {
+	Close();
+	int fd = open(path.c_str(), O_RDONLY);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) < 0) {
+		LOG_ERROR("Cannot open capture file %s", path.c_str());
+		if (fd >= 0)
+			close(fd);
+		return false;
+	}
+	size_ = st.st_size;
+
+	void* mapping = size_ ? mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0) :
+	                MAP_FAILED;
+	if (mapping != MAP_FAILED) {
+		data_ = static_cast<const uint8_t*>(mapping);
+		mapped_ = true;
+	} else {
+		// Not every file system of NaCl supports mapping files.
+		buffer_.resize(size_);
+		size_t done = 0;
+		while (done < size_) {
+			ssize_t ret = read(fd, buffer_.data() + done, size_ - done);
+			if (ret <= 0)
+				break;
+			done += ret;
+		}
+		size_ = done;
+		data_ = buffer_.data();
+	}
+	close(fd);
+
+	CaptureFileHeader header;
+	if (size_ < sizeof(header)) {
+		LOG_ERROR("Capture file %s is truncated", path.c_str());
+		Close();
+		return false;
+	}
+	memcpy(&header, data_, sizeof(header));
+	if (memcmp(header.magic, kCaptureMagic, sizeof(header.magic))) {
+		LOG_ERROR("%s is not a capture file", path.c_str());
+		Close();
+		return false;
+	}
+
+	size_t offset = Align(sizeof(header));
+	if (offset + header.description_size > size_) {
+		LOG_ERROR("Capture file %s is truncated", path.c_str());
+		Close();
+		return false;
+	}
+	description_.assign(reinterpret_cast<const char*>(data_ + offset),
+	                    header.description_size);
+	offset += Align(header.description_size);
+
+	for (uint32_t i = 0; i < header.stream_count; ++i) {
+		CaptureStreamHeader stream;
+		if (offset + sizeof(stream) > size_) {
+			LOG_ERROR("Capture file %s is truncated", path.c_str());
+			Close();
+			return false;
+		}
+		memcpy(&stream, data_ + offset, sizeof(stream));
+		offset += Align(sizeof(stream));
+		if (offset + stream.extradata_size > size_ || stream.time_base_num <= 0 ||
+		    stream.time_base_den <= 0) {
+			LOG_ERROR("Capture file %s has a corrupt stream %u", path.c_str(), i);
+			Close();
+			return false;
+		}
+		streams_.push_back(stream);
+		extradata_.push_back(data_ + offset);
+		offset += Align(stream.extradata_size);
+	}
+	offset_ = offset;
+	LOG_INFO("Replaying %s, %u streams, %s", path.c_str(), header.stream_count,
+	         mapped_ ? "mapped" : "read into memory");
+	return true;
+}
+
+int CaptureReader::CreateFormatContext(AVFormatContext** format_context) const {
+	AVFormatContext* context = avformat_alloc_context();
+	if (!context)
+		return AVERROR(ENOMEM);
+
+	CachedStreamInfo info;
+	for (size_t i = 0; i < streams_.size(); ++i) {
+		const CaptureStreamHeader& stream = streams_[i];
+		AVStream* s = avformat_new_stream(context, NULL);
+		if (!s) {
+			avformat_free_context(context);
+			return AVERROR(ENOMEM);
+		}
+		s->time_base.num = stream.time_base_num;
+		s->time_base.den = stream.time_base_den;
+		s->codecpar->codec_type = static_cast<AVMediaType>(stream.codec_type);
+		s->codecpar->codec_id = static_cast<AVCodecID>(stream.codec_id);
+
+		CachedStreamParameters params;
+		params.codec_type = stream.codec_type;
+		params.codec_id = stream.codec_id;
+		params.codec_tag = stream.codec_tag;
+		params.profile = stream.profile;
+		params.level = stream.level;
+		params.format = stream.format;
+		params.width = stream.width;
+		params.height = stream.height;
+		params.sample_rate = stream.sample_rate;
+		params.channels = stream.channels;
+		params.channel_layout = stream.channel_layout;
+		params.bits_per_raw_sample = stream.bits_per_raw_sample;
+		params.frame_rate_num = stream.frame_rate_num;
+		params.frame_rate_den = stream.frame_rate_den;
+		params.extradata.assign(extradata_[i], extradata_[i] + stream.extradata_size);
+		info.streams.push_back(params);
+	}
+
+	// The streams are set up like the cache sets up a probed session.
+	if (!StreamInfoCache::Apply(info, context)) {
+		avformat_free_context(context);
+		return AVERROR_INVALIDDATA;
+	}
+	*format_context = context;
+	return 0;
+}
+
+int CaptureReader::Read(AVPacket* pkt, int64_t* arrival_us) {
+	CapturePacketHeader header;
+	if (offset_ + sizeof(header) > size_)
+		return AVERROR_EOF;
+	memcpy(&header, data_ + offset_, sizeof(header));
+	size_t payload = offset_ + Align(sizeof(header));
+	if (payload + header.size > size_ || header.stream_index >= streams_.size()) {
+		LOG_ERROR("Capture file is corrupt after %u bytes",
+		          static_cast<unsigned>(offset_));
+		offset_ = size_;
+		return AVERROR_EOF;
+	}
+
+	int ret = av_new_packet(pkt, header.size);
+	if (ret < 0)
+		return ret;
+	memcpy(pkt->data, data_ + payload, header.size);
+	pkt->pts = header.pts;
+	pkt->dts = header.dts;
+	pkt->duration = header.duration;
+	pkt->stream_index = header.stream_index;
+	pkt->flags = header.flags;
+	*arrival_us = header.arrival_us;
+	offset_ = payload + Align(header.size);
+	return 0;
+}
+
+void CaptureReader::Close() {
+	if (mapped_)
+		munmap(const_cast<uint8_t*>(data_), size_);
+	mapped_ = false;
+	data_ = NULL;
+	size_ = 0;
+	buffer_.clear();
+	description_.clear();
+	streams_.clear();
+	extradata_.clear();
+	offset_ = 0;
+}
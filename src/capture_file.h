@@ -0,0 +1,156 @@
+#ifndef CAPTURE_FILE_H_
+#define CAPTURE_FILE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "libavformat/avformat.h"
+}
+
+/// @file
+/// @brief This file defines the <code>CaptureWriter</code> and
+/// <code>CaptureReader</code> classes.
+///
+/// A capture file holds the packets of an RTSP session as the demuxer
+/// returned them, so the session can be replayed through the player with the
+/// same input. All fields are little-endian, which is checked at build time,
+/// and 8-byte aligned, so the file can be memory-mapped and read in place:
+///
+/// - a <code>CaptureFileHeader</code>,
+/// - a description of the streams, padded. It is an SDP generated from the
+///   demuxed streams for reference, not the one the server sent,
+/// - one <code>CaptureStreamHeader</code> per stream followed by its
+///   extradata, padded,
+/// - one <code>CapturePacketHeader</code> per packet followed by its payload,
+///   padded, until the end of the file.
+
+struct CaptureFileHeader {
+	char magic[8];
+	uint32_t stream_count;
+	uint32_t description_size;
+};
+
+struct CaptureStreamHeader {
+	int32_t codec_type;
+	int32_t codec_id;
+	uint32_t codec_tag;
+	int32_t profile;
+	int32_t level;
+	int32_t format;
+	int32_t width;
+	int32_t height;
+	int32_t sample_rate;
+	int32_t channels;
+	uint64_t channel_layout;
+	int32_t bits_per_raw_sample;
+	int32_t frame_rate_num;
+	int32_t frame_rate_den;
+	int32_t time_base_num;
+	int32_t time_base_den;
+	uint32_t extradata_size;
+};
+
+struct CapturePacketHeader {
+	/// Microseconds since the capture started.
+	int64_t arrival_us;
+	int64_t pts;
+	int64_t dts;
+	int64_t duration;
+	uint32_t size;
+	uint16_t stream_index;
+	/// <code>AV_PKT_FLAG_*</code> values.
+	uint16_t flags;
+};
+
+/// @class CaptureWriter
+/// @brief Writes packets read from an input into a capture file. Used on the
+/// parser thread only.
+class CaptureWriter {
+	public:
+		CaptureWriter();
+		~CaptureWriter();
+
+		CaptureWriter(const CaptureWriter&) = delete;
+		CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+		/// Creates <code>path</code> and writes a description and the parameters
+		/// of all streams of <code>format_context</code>. Arrival times are counted
+		/// from now.
+		///
+		/// @return False if the file couldn't be written.
+		bool Open(const std::string& path, AVFormatContext* format_context);
+
+		/// Appends a packet. Writing stops at the first I/O error.
+		void Write(const AVPacket* pkt);
+
+		/// Flushes and closes the file.
+		void Close();
+
+		bool IsOpen() const { return file_ != NULL; }
+
+	private:
+		bool WriteAligned(const void* data, size_t size);
+
+		FILE* file_;
+		uint64_t start_us_;
+		uint64_t packets_;
+};
+
+/// @class CaptureReader
+/// @brief Reads a capture file written by <code>CaptureWriter</code>.
+///
+/// The file is memory-mapped if the file system supports it and read into
+/// memory otherwise. Payloads are copied into packets of their own, like the
+/// RTP depacketizer makes them, so a replay costs the pipeline what a live
+/// session does.
+class CaptureReader {
+	public:
+		CaptureReader();
+		~CaptureReader();
+
+		CaptureReader(const CaptureReader&) = delete;
+		CaptureReader& operator=(const CaptureReader&) = delete;
+
+		/// Maps <code>path</code> and checks its header and stream parameters.
+		bool Open(const std::string& path);
+
+		/// Returns the SDP generated from the captured streams when capturing
+		/// started, for reference only.
+		const std::string& GetStreamDescription() const { return description_; }
+
+		/// Makes a format context with the captured streams, configured as they
+		/// were when capturing started, so nothing has to be probed. It has no
+		/// demuxer and is freed with <code>avformat_close_input()</code>.
+		///
+		/// @return A negative FFmpeg error code on failure.
+		int CreateFormatContext(AVFormatContext** format_context) const;
+
+		/// Reads the next packet.
+		///
+		/// @param[out] pkt A packet with its own copy of the payload.
+		/// @param[out] arrival_us When the packet arrived, in microseconds since
+		///   capturing started.
+		/// @return 0 on success, <code>AVERROR_EOF</code> at the end of the file
+		///   or if the rest of it is corrupt.
+		int Read(AVPacket* pkt, int64_t* arrival_us);
+
+	private:
+		void Close();
+
+		const uint8_t* data_;
+		size_t size_;
+		bool mapped_;
+		std::vector<uint8_t> buffer_;
+
+		std::string description_;
+		std::vector<CaptureStreamHeader> streams_;
+		std::vector<const uint8_t*> extradata_;
+		size_t offset_;
+};
+
+#endif  // CAPTURE_FILE_H_
@@ -0,0 +1,555 @@
+#include "codec_config_parser.h"
+
+#include <string.h>
+
+#include <vector>
+
+namespace {
+
+const int kH264NalSPS = 7;
+const int kH265NalSPS = 33;
+const int kMaxShortTermRefPicSets = 64;
+
+const int kAACSampleRates[] = {
+	96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000,
+	11025, 8000, 7350
+};
+const int kAACChannels[] = { 0, 1, 2, 3, 4, 5, 6, 8 };
+const int kAACObjectTypeSBR = 5;
+const int kAACObjectTypePS = 29;
+
+// Reads bits from a NAL unit payload with emulation prevention bytes already
+// removed. Reading past the end sets the error flag and yields zeros, so the
+// parsers check it once at the end instead of after every field.
+class BitReader {
+	public:
+		BitReader(const uint8_t* data, size_t size)
+			: data_(data), size_(size), pos_(0), error_(false) {}
+
+		uint32_t ReadBits(int count) {
+			uint32_t value = 0;
+			for (int i = 0; i < count; ++i)
+				value = (value << 1) | ReadBit();
+			return value;
+		}
+
+		uint32_t ReadBit() {
+			if (pos_ >= size_ * 8) {
+				error_ = true;
+				return 0;
+			}
+			uint32_t bit = (data_[pos_ / 8] >> (7 - pos_ % 8)) & 1;
+			++pos_;
+			return bit;
+		}
+
+		void SkipBits(size_t count) {
+			pos_ += count;
+			if (pos_ > size_ * 8)
+				error_ = true;
+		}
+
+		// Exp-Golomb ue(v).
+		uint32_t ReadUE() {
+			int leading_zeros = 0;
+			while (!ReadBit()) {
+				if (error_ || ++leading_zeros > 31) {
+					error_ = true;
+					return 0;
+				}
+			}
+			return ((1u << leading_zeros) - 1) + ReadBits(leading_zeros);
+		}
+
+		// Exp-Golomb se(v).
+		int32_t ReadSE() {
+			uint32_t value = ReadUE();
+			return (value & 1) ? static_cast<int32_t>((value + 1) / 2) :
+			       -static_cast<int32_t>(value / 2);
+		}
+
+		void SetError() { error_ = true; }
+		bool HasError() const { return error_; }
+
+	private:
+		const uint8_t* data_;
+		size_t size_;
+		size_t pos_;
+		bool error_;
+};
+
+// Strips the NAL unit header and 0x000003 emulation prevention bytes.
+std::vector<uint8_t> UnescapeRBSP(const uint8_t* nal, size_t size,
+                                  size_t header_size) {
+	std::vector<uint8_t> rbsp;
+	if (size <= header_size)
+		return rbsp;
+	rbsp.reserve(size - header_size);
+	int zeros = 0;
+	for (size_t i = header_size; i < size; ++i) {
+		if (zeros >= 2 && nal[i] == 0x03) {
+			zeros = 0;
+			continue;
+		}
+		zeros = nal[i] == 0 ? zeros + 1 : 0;
+		rbsp.push_back(nal[i]);
+	}
+	return rbsp;
+}
+
+int GetNALType(const uint8_t* nal, bool is_hevc) {
+	return is_hevc ? (nal[0] >> 1) & 0x3F : nal[0] & 0x1F;
+}
+
+// Returns the offset of the payload following the next 00 00 01 start code at
+// or after pos, or size if there is none.
+size_t FindStartCode(const uint8_t* data, size_t size, size_t pos) {
+	for (; pos + 3 <= size; ++pos) {
+		if (data[pos] == 0 && data[pos + 1] == 0 && data[pos + 2] == 1)
+			return pos + 3;
+	}
+	return size;
+}
+
+const uint8_t* FindNALUnitInAnnexB(const uint8_t* data, size_t size,
+                                   bool is_hevc, int nal_type,
+                                   size_t* nal_size) {
+	size_t start = FindStartCode(data, size, 0);
+	while (start < size) {
+		size_t next = FindStartCode(data, size, start);
+		size_t end = next < size ? next - 3 : size;
+		// A four byte start code leaves a trailing zero behind.
+		while (end > start && data[end - 1] == 0)
+			--end;
+		if (end > start && GetNALType(data + start, is_hevc) == nal_type) {
+			*nal_size = end - start;
+			return data + start;
+		}
+		start = next;
+	}
+	return NULL;
+}
+
+const uint8_t* FindNALUnitInAvcC(const uint8_t* data, size_t size,
+                                 int nal_type, size_t* nal_size) {
+	// configurationVersion, profile, compatibility, level, lengthSizeMinusOne,
+	// numOfSequenceParameterSets, then length prefixed SPSs, numOfPPS, PPSs.
+	size_t pos = 5;
+	for (int set = 0; set < 2 && pos < size; ++set) {
+		int count = set == 0 ? data[pos] & 0x1F : data[pos];
+		++pos;
+		for (int i = 0; i < count; ++i) {
+			if (pos + 2 > size)
+				return NULL;
+			size_t length = (data[pos] << 8) | data[pos + 1];
+			pos += 2;
+			if (length == 0 || pos + length > size)
+				return NULL;
+			if (GetNALType(data + pos, false) == nal_type) {
+				*nal_size = length;
+				return data + pos;
+			}
+			pos += length;
+		}
+	}
+	return NULL;
+}
+
+void SkipH264ScalingList(BitReader* reader, int size) {
+	int last_scale = 8;
+	int next_scale = 8;
+	for (int i = 0; i < size; ++i) {
+		if (next_scale != 0)
+			next_scale = (last_scale + reader->ReadSE() + 256) % 256;
+		if (next_scale != 0)
+			last_scale = next_scale;
+	}
+}
+
+bool IsH264HighProfile(int profile) {
+	switch (profile) {
+		case 100: case 110: case 122: case 244: case 44: case 83: case 86:
+		case 118: case 128: case 138: case 139: case 134: case 135:
+			return true;
+		default:
+			return false;
+	}
+}
+
+void GetChromaSubsampling(int chroma_format_idc, bool separate_planes,
+                          int* sub_width, int* sub_height) {
+	*sub_width = 1;
+	*sub_height = 1;
+	if (separate_planes)
+		return;
+	if (chroma_format_idc == 1 || chroma_format_idc == 2)
+		*sub_width = 2;
+	if (chroma_format_idc == 1)
+		*sub_height = 2;
+}
+
+// Skips the VUI up to the timing info and reads it. The H.264 and H.265
+// syntax is the same up to there except for the H.265 specific fields.
+void ReadVUITiming(BitReader* reader, bool is_hevc,
+                   VideoParameterSetInfo* info) {
+	if (reader->ReadBit()) {  // aspect_ratio_info_present_flag
+		const uint32_t kExtendedSAR = 255;
+		if (reader->ReadBits(8) == kExtendedSAR)
+			reader->SkipBits(32);
+	}
+	if (reader->ReadBit())  // overscan_info_present_flag
+		reader->SkipBits(1);
+	if (reader->ReadBit()) {  // video_signal_type_present_flag
+		reader->SkipBits(4);
+		if (reader->ReadBit())  // colour_description_present_flag
+			reader->SkipBits(24);
+	}
+	if (reader->ReadBit()) {  // chroma_loc_info_present_flag
+		reader->ReadUE();
+		reader->ReadUE();
+	}
+	if (is_hevc) {
+		// neutral_chroma_indication_flag, field_seq_flag,
+		// frame_field_info_present_flag
+		reader->SkipBits(3);
+		if (reader->ReadBit()) {  // default_display_window_flag
+			for (int i = 0; i < 4; ++i)
+				reader->ReadUE();
+		}
+	}
+	if (!reader->ReadBit())  // timing_info_present_flag
+		return;
+
+	uint32_t num_units_in_tick = reader->ReadBits(32);
+	uint32_t time_scale = reader->ReadBits(32);
+	if (reader->HasError() || num_units_in_tick == 0 || time_scale == 0)
+		return;
+
+	// H.264 ticks are fields, so a frame lasts two of them.
+	info->frame_rate_num = static_cast<int>(time_scale);
+	info->frame_rate_den = static_cast<int>(num_units_in_tick * (is_hevc ? 1 : 2));
+}
+
+void ReadH265ProfileTierLevel(BitReader* reader, int max_sub_layers_minus1,
+                              VideoParameterSetInfo* info) {
+	reader->SkipBits(3);  // general_profile_space, general_tier_flag
+	info->profile = reader->ReadBits(5);
+	// general_profile_compatibility_flags, source and constraint flags.
+	reader->SkipBits(32 + 48);
+	info->level = reader->ReadBits(8);
+
+	bool profile_present[8];
+	bool level_present[8];
+	for (int i = 0; i < max_sub_layers_minus1; ++i) {
+		profile_present[i] = reader->ReadBit();
+		level_present[i] = reader->ReadBit();
+	}
+	if (max_sub_layers_minus1 > 0) {
+		for (int i = max_sub_layers_minus1; i < 8; ++i)
+			reader->SkipBits(2);
+	}
+	for (int i = 0; i < max_sub_layers_minus1; ++i) {
+		if (profile_present[i])
+			reader->SkipBits(88);
+		if (level_present[i])
+			reader->SkipBits(8);
+	}
+}
+
+void SkipH265ScalingListData(BitReader* reader) {
+	for (int size_id = 0; size_id < 4; ++size_id) {
+		for (int matrix_id = 0; matrix_id < 6;
+		     matrix_id += (size_id == 3) ? 3 : 1) {
+			if (!reader->ReadBit()) {  // scaling_list_pred_mode_flag
+				reader->ReadUE();
+				continue;
+			}
+			int coef_num = 1 << (4 + (size_id << 1));
+			if (coef_num > 64)
+				coef_num = 64;
+			if (size_id > 1)
+				reader->ReadSE();
+			for (int i = 0; i < coef_num; ++i)
+				reader->ReadSE();
+		}
+	}
+}
+
+// Skips st_ref_pic_set(idx) and returns its NumDeltaPocs.
+int SkipH265ShortTermRefPicSet(BitReader* reader, int idx,
+                               const int* num_delta_pocs) {
+	if (idx != 0 && reader->ReadBit()) {  // inter_ref_pic_set_prediction_flag
+		reader->SkipBits(1);  // delta_rps_sign
+		reader->ReadUE();  // abs_delta_rps_minus1
+		int count = 0;
+		for (int j = 0; j <= num_delta_pocs[idx - 1]; ++j) {
+			bool used_by_curr_pic = reader->ReadBit();
+			if (used_by_curr_pic || reader->ReadBit())  // use_delta_flag
+				++count;
+		}
+		return count;
+	}
+
+	uint32_t num_negative_pics = reader->ReadUE();
+	uint32_t num_positive_pics = reader->ReadUE();
+	if (num_negative_pics > 16 || num_positive_pics > 16) {
+		reader->SetError();
+		return 0;
+	}
+	for (uint32_t i = 0; i < num_negative_pics + num_positive_pics; ++i) {
+		reader->ReadUE();  // delta_poc_minus1
+		reader->SkipBits(1);  // used_by_curr_pic_flag
+	}
+	return static_cast<int>(num_negative_pics + num_positive_pics);
+}
+
+int ReadAACObjectType(BitReader* reader) {
+	int type = reader->ReadBits(5);
+	return type == 31 ? 32 + static_cast<int>(reader->ReadBits(6)) : type;
+}
+
+int ReadAACSampleRate(BitReader* reader) {
+	const uint32_t kExplicitRate = 0x0F;
+	uint32_t index = reader->ReadBits(4);
+	if (index == kExplicitRate)
+		return reader->ReadBits(24);
+	return index < sizeof(kAACSampleRates) / sizeof(kAACSampleRates[0]) ?
+	       kAACSampleRates[index] : 0;
+}
+
+}  // namespace
+
+const uint8_t* FindNALUnit(const uint8_t* data, size_t size, bool is_hevc,
+                           int nal_type, size_t* nal_size) {
+	if (!data || size < 4)
+		return NULL;
+	if (!is_hevc && data[0] == 1)
+		return FindNALUnitInAvcC(data, size, nal_type, nal_size);
+	return FindNALUnitInAnnexB(data, size, is_hevc, nal_type, nal_size);
+}
+
+bool ParseH264SPS(const uint8_t* nal, size_t size,
+                  VideoParameterSetInfo* info) {
+	if (size < 4 || GetNALType(nal, false) != kH264NalSPS)
+		return false;
+
+	std::vector<uint8_t> rbsp = UnescapeRBSP(nal, size, 1);
+	BitReader reader(rbsp.data(), rbsp.size());
+	memset(info, 0, sizeof(*info));
+
+	info->profile = reader.ReadBits(8);
+	reader.SkipBits(8);  // constraint_set flags
+	info->level = reader.ReadBits(8);
+	reader.ReadUE();  // seq_parameter_set_id
+
+	info->chroma_format_idc = 1;
+	info->bit_depth = 8;
+	bool separate_planes = false;
+	if (IsH264HighProfile(info->profile)) {
+		info->chroma_format_idc = reader.ReadUE();
+		if (info->chroma_format_idc == 3)
+			separate_planes = reader.ReadBit();
+		info->bit_depth = reader.ReadUE() + 8;
+		reader.ReadUE();  // bit_depth_chroma_minus8
+		reader.SkipBits(1);  // qpprime_y_zero_transform_bypass_flag
+		if (reader.ReadBit()) {  // seq_scaling_matrix_present_flag
+			int lists = info->chroma_format_idc != 3 ? 8 : 12;
+			for (int i = 0; i < lists; ++i) {
+				if (reader.ReadBit())
+					SkipH264ScalingList(&reader, i < 6 ? 16 : 64);
+			}
+		}
+	}
+
+	reader.ReadUE();  // log2_max_frame_num_minus4
+	uint32_t pic_order_cnt_type = reader.ReadUE();
+	if (pic_order_cnt_type == 0) {
+		reader.ReadUE();  // log2_max_pic_order_cnt_lsb_minus4
+	} else if (pic_order_cnt_type == 1) {
+		reader.SkipBits(1);  // delta_pic_order_always_zero_flag
+		reader.ReadSE();  // offset_for_non_ref_pic
+		reader.ReadSE();  // offset_for_top_to_bottom_field
+		uint32_t cycle = reader.ReadUE();
+		if (cycle > 255)
+			return false;
+		for (uint32_t i = 0; i < cycle; ++i)
+			reader.ReadSE();
+	}
+	reader.ReadUE();  // max_num_ref_frames
+	reader.SkipBits(1);  // gaps_in_frame_num_value_allowed_flag
+
+	uint32_t width_in_mbs = reader.ReadUE() + 1;
+	uint32_t height_in_map_units = reader.ReadUE() + 1;
+	bool frame_mbs_only = reader.ReadBit();
+	if (!frame_mbs_only)
+		reader.SkipBits(1);  // mb_adaptive_frame_field_flag
+	reader.SkipBits(1);  // direct_8x8_inference_flag
+
+	uint32_t crop[4] = {0, 0, 0, 0};
+	if (reader.ReadBit()) {  // frame_cropping_flag
+		for (int i = 0; i < 4; ++i)
+			crop[i] = reader.ReadUE();
+	}
+
+	int sub_width, sub_height;
+	GetChromaSubsampling(info->chroma_format_idc,
+	                     separate_planes || info->chroma_format_idc == 0,
+	                     &sub_width, &sub_height);
+	int crop_unit_x = sub_width;
+	int crop_unit_y = sub_height * (frame_mbs_only ? 1 : 2);
+	info->width = width_in_mbs * 16 - crop_unit_x * (crop[0] + crop[1]);
+	info->height = height_in_map_units * 16 * (frame_mbs_only ? 1 : 2) -
+	               crop_unit_y * (crop[2] + crop[3]);
+
+	if (reader.ReadBit())  // vui_parameters_present_flag
+		ReadVUITiming(&reader, false, info);
+
+	return !reader.HasError() && info->width > 0 && info->height > 0;
+}
+
+bool ParseH265SPS(const uint8_t* nal, size_t size,
+                  VideoParameterSetInfo* info) {
+	if (size < 5 || GetNALType(nal, true) != kH265NalSPS)
+		return false;
+
+	std::vector<uint8_t> rbsp = UnescapeRBSP(nal, size, 2);
+	BitReader reader(rbsp.data(), rbsp.size());
+	memset(info, 0, sizeof(*info));
+
+	reader.SkipBits(4);  // sps_video_parameter_set_id
+	int max_sub_layers_minus1 = reader.ReadBits(3);
+	reader.SkipBits(1);  // sps_temporal_id_nesting_flag
+	ReadH265ProfileTierLevel(&reader, max_sub_layers_minus1, info);
+	reader.ReadUE();  // sps_seq_parameter_set_id
+
+	info->chroma_format_idc = reader.ReadUE();
+	bool separate_planes = false;
+	if (info->chroma_format_idc == 3)
+		separate_planes = reader.ReadBit();
+	uint32_t width = reader.ReadUE();
+	uint32_t height = reader.ReadUE();
+
+	uint32_t window[4] = {0, 0, 0, 0};
+	if (reader.ReadBit()) {  // conformance_window_flag
+		for (int i = 0; i < 4; ++i)
+			window[i] = reader.ReadUE();
+	}
+	int sub_width, sub_height;
+	GetChromaSubsampling(info->chroma_format_idc,
+	                     separate_planes || info->chroma_format_idc == 0,
+	                     &sub_width, &sub_height);
+	info->width = width - sub_width * (window[0] + window[1]);
+	info->height = height - sub_height * (window[2] + window[3]);
+
+	info->bit_depth = reader.ReadUE() + 8;
+	reader.ReadUE();  // bit_depth_chroma_minus8
+	uint32_t log2_max_poc_lsb = reader.ReadUE() + 4;
+	bool sub_layer_ordering_info = reader.ReadBit();
+	for (int i = sub_layer_ordering_info ? 0 : max_sub_layers_minus1;
+	     i <= max_sub_layers_minus1; ++i) {
+		reader.ReadUE();  // sps_max_dec_pic_buffering_minus1
+		reader.ReadUE();  // sps_max_num_reorder_pics
+		reader.ReadUE();  // sps_max_latency_increase_plus1
+	}
+	// Coding block and transform sizes and hierarchy depths.
+	for (int i = 0; i < 6; ++i)
+		reader.ReadUE();
+
+	if (reader.ReadBit() && reader.ReadBit())  // scaling_list_enabled_flag,
+		SkipH265ScalingListData(&reader);  // sps_scaling_list_data_present_flag
+	reader.SkipBits(2);  // amp_enabled_flag, sample_adaptive_offset_enabled_flag
+	if (reader.ReadBit()) {  // pcm_enabled_flag
+		reader.SkipBits(8);
+		reader.ReadUE();
+		reader.ReadUE();
+		reader.SkipBits(1);
+	}
+
+	uint32_t num_short_term_ref_pic_sets = reader.ReadUE();
+	if (num_short_term_ref_pic_sets > kMaxShortTermRefPicSets)
+		return false;
+	int num_delta_pocs[kMaxShortTermRefPicSets];
+	for (uint32_t i = 0; i < num_short_term_ref_pic_sets; ++i) {
+		num_delta_pocs[i] = SkipH265ShortTermRefPicSet(&reader, i, num_delta_pocs);
+		if (reader.HasError())
+			return false;
+	}
+
+	if (reader.ReadBit()) {  // long_term_ref_pics_present_flag
+		uint32_t num_long_term_ref_pics = reader.ReadUE();
+		if (num_long_term_ref_pics > 32)
+			return false;
+		for (uint32_t i = 0; i < num_long_term_ref_pics; ++i)
+			reader.SkipBits(log2_max_poc_lsb + 1);
+	}
+	// sps_temporal_mvp_enabled_flag, strong_intra_smoothing_enabled_flag
+	reader.SkipBits(2);
+
+	if (reader.ReadBit())  // vui_parameters_present_flag
+		ReadVUITiming(&reader, true, info);
+
+	return !reader.HasError() && info->width > 0 && info->height > 0;
+}
+
+bool FindAndParseSPS(const uint8_t* data, size_t size, bool is_hevc,
+                     VideoParameterSetInfo* info) {
+	size_t sps_size = 0;
+	const uint8_t* sps = FindNALUnit(data, size, is_hevc,
+	                                 is_hevc ? kH265NalSPS : kH264NalSPS,
+	                                 &sps_size);
+	if (!sps)
+		return false;
+	return is_hevc ? ParseH265SPS(sps, sps_size, info) :
+	       ParseH264SPS(sps, sps_size, info);
+}
+
+bool IsNonReferencePicture(const uint8_t* data, size_t size, bool is_hevc) {
+	if (!data)
+		return false;
+	for (size_t start = FindStartCode(data, size, 0); start < size;
+	     start = FindStartCode(data, size, start)) {
+		int nal_type = GetNALType(data + start, is_hevc);
+		if (is_hevc) {
+			// VCL NAL unit types are 0 - 31, the even ones up to 14 are sub-layer
+			// non-reference pictures.
+			if (nal_type < 32)
+				return nal_type <= 14 && nal_type % 2 == 0;
+		} else if (nal_type >= 1 && nal_type <= 5) {
+			return (data[start] & 0x60) == 0;
+		}
+	}
+	return false;
+}
+
+bool ParseAACAudioSpecificConfig(const uint8_t* data, size_t size,
+                                 AACConfigInfo* info) {
+	if (!data || size < 2)
+		return false;
+
+	BitReader reader(data, size);
+	memset(info, 0, sizeof(*info));
+
+	info->object_type = ReadAACObjectType(&reader);
+	info->sample_rate = ReadAACSampleRate(&reader);
+	uint32_t channel_config = reader.ReadBits(4);
+	if (channel_config < sizeof(kAACChannels) / sizeof(kAACChannels[0]))
+		info->channels = kAACChannels[channel_config];
+	info->core_object_type = info->object_type;
+	info->core_sample_rate = info->sample_rate;
+	info->core_channels = info->channels;
+
+	if (info->object_type == kAACObjectTypeSBR ||
+	    info->object_type == kAACObjectTypePS) {
+		// Explicit hierarchical signalling, the extension sample rate is the
+		// output one. Parametric stereo makes mono streams stereo.
+		if (info->object_type == kAACObjectTypePS && info->channels == 1)
+			info->channels = 2;
+		int extension_rate = ReadAACSampleRate(&reader);
+		if (extension_rate > 0)
+			info->sample_rate = extension_rate;
+		info->core_object_type = ReadAACObjectType(&reader);
+	}
+
+	return !reader.HasError() && info->object_type > 0 &&
+	       info->sample_rate > 0 && info->channels > 0;
+}
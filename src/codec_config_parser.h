@@ -0,0 +1,93 @@
+#ifndef CODEC_CONFIG_PARSER_H_
+#define CODEC_CONFIG_PARSER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// @file
+/// @brief Lightweight parsers of codec configuration found in RTSP SDPs and
+/// in-band parameter sets. They only extract what is needed to configure
+/// NaCl Player elementary streams without probing.
+
+/// @struct VideoParameterSetInfo
+/// @brief Information read from an H.264 or H.265 sequence parameter set.
+struct VideoParameterSetInfo {
+	/// profile_idc (H.264) or general_profile_idc (H.265).
+	int profile;
+
+	/// level_idc (H.264) or general_level_idc (H.265).
+	int level;
+
+	/// Cropped picture size in pixels.
+	int width;
+	int height;
+
+	/// 0 - monochrome, 1 - 4:2:0, 2 - 4:2:2, 3 - 4:4:4.
+	int chroma_format_idc;
+	int bit_depth;
+
+	/// Frame rate from the VUI timing info, both 0 if it is not present.
+	int frame_rate_num;
+	int frame_rate_den;
+};
+
+/// @struct AACConfigInfo
+/// @brief Information read from an MPEG-4 AudioSpecificConfig.
+struct AACConfigInfo {
+	/// MPEG-4 audio object type, e.g. 2 for AAC LC or 5 for HE-AAC.
+	int object_type;
+
+	/// Output sample rate, with SBR taken into account.
+	int sample_rate;
+	int channels;
+
+	/// The object type, sample rate and channels of the core the SBR and
+	/// parametric stereo extensions are added to, the same as the output ones
+	/// without them. SBR doubles the core rate, parametric stereo makes a
+	/// mono core stereo.
+	int core_object_type;
+	int core_sample_rate;
+	int core_channels;
+};
+
+/// Finds a NAL unit of the given type in codec extradata, which can be either
+/// in Annex B format or an H.264 avcC record.
+///
+/// @param[in] data Codec extradata.
+/// @param[in] size A size of <code>data</code> in bytes.
+/// @param[in] is_hevc True for H.265 NAL unit headers, false for H.264.
+/// @param[in] nal_type A NAL unit type to look for, e.g. 7 for H.264 SPS or
+///   33 for H.265 SPS.
+/// @param[out] nal_size A size of the found NAL unit.
+/// @return A pointer to the first byte of the NAL unit header or NULL.
+const uint8_t* FindNALUnit(const uint8_t* data, size_t size, bool is_hevc,
+                           int nal_type, size_t* nal_size);
+
+/// Parses an H.264 sequence parameter set NAL unit, including its header.
+/// @return True on success.
+bool ParseH264SPS(const uint8_t* nal, size_t size, VideoParameterSetInfo* info);
+
+/// Parses an H.265 sequence parameter set NAL unit, including its header.
+/// @return True on success.
+bool ParseH265SPS(const uint8_t* nal, size_t size, VideoParameterSetInfo* info);
+
+/// Finds a sequence parameter set in codec extradata or in an Annex B access
+/// unit and parses it.
+/// @return True if the SPS was found and parsed.
+bool FindAndParseSPS(const uint8_t* data, size_t size, bool is_hevc,
+                     VideoParameterSetInfo* info);
+
+/// Checks whether an Annex B access unit holds a picture no other picture
+/// refers to, so it can be dropped without corrupting the decoding. That is
+/// nal_ref_idc equal to 0 for H.264 and a sub-layer non-reference picture for
+/// H.265.
+/// @return False if the picture is a reference one or no slice was found.
+bool IsNonReferencePicture(const uint8_t* data, size_t size, bool is_hevc);
+
+/// Parses an MPEG-4 AudioSpecificConfig as carried by the SDP
+/// <code>config=</code> parameter of mpeg4-generic streams.
+/// @return True on success.
+bool ParseAACAudioSpecificConfig(const uint8_t* data, size_t size,
+                                 AACConfigInfo* info);
+
+#endif  // CODEC_CONFIG_PARSER_H_
@@ -1,6 +1,74 @@
 #include "convert_codecs.h"
 #include "common.h"
 
+namespace {
+
+struct AudioCapability {
+  AVCodecID codec;
+  AudioOutputMode mode;
+  /// Passthrough needs the codec configuration, which comes with the SDP.
+  bool needs_extradata;
+};
+
+const AudioCapability kAudioCapabilities[] = {
+  // Decoded by NaCl Player, see ConvertAudioCodec().
+  {AV_CODEC_ID_AAC, kAudioPassthrough, false},
+  {AV_CODEC_ID_AC3, kAudioPassthrough, false},
+  {AV_CODEC_ID_EAC3, kAudioPassthrough, false},
+  {AV_CODEC_ID_DTS, kAudioPassthrough, false},
+  {AV_CODEC_ID_MP2, kAudioPassthrough, false},
+  {AV_CODEC_ID_MP3, kAudioPassthrough, false},
+  {AV_CODEC_ID_OPUS, kAudioPassthrough, false},
+  {AV_CODEC_ID_AMR_NB, kAudioPassthrough, false},
+  {AV_CODEC_ID_AMR_WB, kAudioPassthrough, false},
+  {AV_CODEC_ID_GSM_MS, kAudioPassthrough, false},
+  {AV_CODEC_ID_VORBIS, kAudioPassthrough, true},
+  {AV_CODEC_ID_FLAC, kAudioPassthrough, true},
+  {AV_CODEC_ID_WMAV1, kAudioPassthrough, true},
+  {AV_CODEC_ID_WMAV2, kAudioPassthrough, true},
+  {AV_CODEC_ID_PCM_U8, kAudioPassthrough, false},
+  {AV_CODEC_ID_PCM_MULAW, kAudioPassthrough, false},
+  {AV_CODEC_ID_PCM_S16BE, kAudioPassthrough, false},
+  {AV_CODEC_ID_PCM_S24BE, kAudioPassthrough, false},
+  // Not taken by NaCl Player, but cheap to decode to PCM.
+  {AV_CODEC_ID_PCM_ALAW, kAudioPcm, false},
+  {AV_CODEC_ID_PCM_S8, kAudioPcm, false},
+  {AV_CODEC_ID_PCM_S16LE, kAudioPcm, false},
+  {AV_CODEC_ID_PCM_U16BE, kAudioPcm, false},
+  {AV_CODEC_ID_PCM_U16LE, kAudioPcm, false},
+  {AV_CODEC_ID_PCM_S24LE, kAudioPcm, false},
+  {AV_CODEC_ID_PCM_S32BE, kAudioPcm, false},
+  {AV_CODEC_ID_PCM_S32LE, kAudioPcm, false},
+  {AV_CODEC_ID_PCM_F32BE, kAudioPcm, false},
+  {AV_CODEC_ID_PCM_F32LE, kAudioPcm, false},
+  {AV_CODEC_ID_ADPCM_G722, kAudioPcm, false},
+  {AV_CODEC_ID_ADPCM_G726, kAudioPcm, false},
+  {AV_CODEC_ID_ADPCM_G726LE, kAudioPcm, false},
+  {AV_CODEC_ID_ADPCM_IMA_WAV, kAudioPcm, false},
+  {AV_CODEC_ID_GSM, kAudioPcm, false},
+};
+
+}  // namespace
+
+AudioOutputMode GetAudioOutputMode(const AVCodecParameters* codecpar) {
+  // NaCl Player takes up to 7.1 and the layout can't be guessed otherwise.
+  if (codecpar->channels < 1 || codecpar->channels > 8 ||
+      codecpar->sample_rate <= 0)
+    return kAudioTranscode;
+
+  for (const AudioCapability& capability : kAudioCapabilities) {
+    if (capability.codec != codecpar->codec_id)
+      continue;
+    if (capability.needs_extradata && codecpar->extradata_size <= 0) {
+      LOG_INFO("codec %d has no configuration, transcoding it",
+               codecpar->codec_id);
+      return kAudioTranscode;
+    }
+    return capability.mode;
+  }
+  return kAudioTranscode;
+}
+
 Samsung::NaClPlayer::AudioCodec_Type ConvertAudioCodec(AVCodecID codec) {
   switch (codec) {
     case AV_CODEC_ID_AAC:
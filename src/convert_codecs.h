@@ -17,6 +17,21 @@ extern "C" {
 #include "common.h"
 #include "stream_demuxer.h"
 
+/// How an audio stream is handed to NaCl Player.
+enum AudioOutputMode {
+  /// Demuxed packets are appended as they are.
+  kAudioPassthrough,
+  /// Packets are decoded and appended as interleaved 16-bit PCM.
+  kAudioPcm,
+  /// Packets are decoded, resampled and encoded to mono AAC.
+  kAudioTranscode,
+};
+
+/// Picks the cheapest way of playing a stream NaCl Player can take: codecs
+/// it decodes itself are passed through, codecs which are cheap to decode
+/// become PCM and the rest is transcoded to AAC.
+AudioOutputMode GetAudioOutputMode(const AVCodecParameters* codecpar);
+
 Samsung::NaClPlayer::AudioCodec_Type ConvertAudioCodec(AVCodecID codec);
 Samsung::NaClPlayer::SampleFormat ConvertSampleFormat(AVSampleFormat format);
 Samsung::NaClPlayer::ChannelLayout ChannelLayoutFromChannelCount(int channels);
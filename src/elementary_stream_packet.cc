@@ -13,12 +13,48 @@ using Samsung::NaClPlayer::ESPacket;
 using Samsung::NaClPlayer::ESPacketEncryptionInfo;
 using Samsung::NaClPlayer::TimeTicks;
 
+namespace {
+
+const ESPacketEncryptionInfo kNoEncryptionInfo = {};
+
+}  // namespace
+
+ElementaryStreamPacket::ElementaryStreamPacket() : es_packet_() {
+  FixDataInvariant();
+}
+
 ElementaryStreamPacket::ElementaryStreamPacket(uint8_t* data, uint32_t size)
-    : data_(data, data + size) {
+    : data_(data, data + size), es_packet_() {
   FixDataInvariant();
-  FixKeyIdInvariant();
-  FixIvInvariant();
-  FixSubsamplesInvariant();
+}
+
+ElementaryStreamPacket::ElementaryStreamPacket(AVBufferRef* buffer_ref,
+                                               uint8_t* data, uint32_t size)
+    : buffer_ref_(buffer_ref), es_packet_() {
+  es_packet_.buffer = data;
+  es_packet_.size = size;
+}
+
+void ElementaryStreamPacket::Assign(const uint8_t* data, uint32_t size) {
+  buffer_ref_.reset();
+  data_.assign(data, data + size);
+  FixDataInvariant();
+}
+
+void ElementaryStreamPacket::Assign(AVBufferRef* buffer_ref, uint8_t* data,
+                                    uint32_t size) {
+  buffer_ref_.reset(buffer_ref);
+  data_.clear();
+  es_packet_.buffer = data;
+  es_packet_.size = size;
+}
+
+void ElementaryStreamPacket::Reset() {
+  buffer_ref_.reset();
+  data_.clear();
+  es_packet_ = ESPacket();
+  FixDataInvariant();
+  encryption_.reset();
 }
 
 const ESPacket& ElementaryStreamPacket::GetESPacket() const {
@@ -27,41 +63,43 @@ const ESPacket& ElementaryStreamPacket::GetESPacket() const {
 
 const ESPacketEncryptionInfo& ElementaryStreamPacket::GetEncryptionInfo()
     const {
-  return encryption_info_;
+  return encryption_ ? encryption_->info : kNoEncryptionInfo;
 }
 
 bool ElementaryStreamPacket::IsEncrypted() const {
   // There might be 0 subsamples in encrypted packet.
-  return !key_id_.empty() || !iv_.empty();
+  return encryption_ &&
+         (!encryption_->key_id.empty() || !encryption_->iv.empty());
 }
 
 void ElementaryStreamPacket::SetKeyId(uint8_t* key_id, uint32_t key_id_size) {
   if (key_id && key_id_size)
-    key_id_.assign(key_id, key_id + key_id_size);
-  else
-    key_id_.clear();
+    GetOrCreateEncryptionData()->key_id.assign(key_id, key_id + key_id_size);
+  else if (encryption_)
+    encryption_->key_id.clear();
 
   FixKeyIdInvariant();
 }
 
 void ElementaryStreamPacket::SetIv(uint8_t* iv, uint32_t iv_size) {
   if (iv && iv_size)
-    iv_.assign(iv, iv + iv_size);
-  else
-    iv_.clear();
+    GetOrCreateEncryptionData()->iv.assign(iv, iv + iv_size);
+  else if (encryption_)
+    encryption_->iv.clear();
 
   FixIvInvariant();
 }
 
 void ElementaryStreamPacket::ClearSubsamples() {
-  subsamples_.clear();
+  if (encryption_)
+    encryption_->subsamples.clear();
   FixSubsamplesInvariant();
 }
 
 void ElementaryStreamPacket::AddSubsample(uint32_t clear_bytes,
                                           uint32_t cipher_bytes) {
   EncryptedSubsampleDescription subsample = {clear_bytes, cipher_bytes};
-  subsamples_.push_back(subsample);
+  GetOrCreateEncryptionData()->subsamples.push_back(subsample);
   FixSubsamplesInvariant();
 }
 
@@ -72,16 +110,30 @@ void ElementaryStreamPacket::FixDataInvariant() {
 }
 
 void ElementaryStreamPacket::FixKeyIdInvariant() {
-  encryption_info_.key_id = key_id_.data();
-  encryption_info_.key_id_size = key_id_.size();
+  if (!encryption_) return;
+  encryption_->info.key_id = encryption_->key_id.data();
+  encryption_->info.key_id_size = encryption_->key_id.size();
 }
 
 void ElementaryStreamPacket::FixIvInvariant() {
-  encryption_info_.iv = iv_.data();
-  encryption_info_.iv_size = iv_.size();
+  if (!encryption_) return;
+  encryption_->info.iv = encryption_->iv.data();
+  encryption_->info.iv_size = encryption_->iv.size();
 }
 
 void ElementaryStreamPacket::FixSubsamplesInvariant() {
-  encryption_info_.subsamples = subsamples_.data();
-  encryption_info_.num_subsamples = subsamples_.size();
+  if (!encryption_) return;
+  encryption_->info.subsamples = encryption_->subsamples.data();
+  encryption_->info.num_subsamples = encryption_->subsamples.size();
+}
+
+ElementaryStreamPacket::EncryptionData*
+ElementaryStreamPacket::GetOrCreateEncryptionData() {
+  if (!encryption_) {
+    encryption_.reset(new EncryptionData());
+    FixKeyIdInvariant();
+    FixIvInvariant();
+    FixSubsamplesInvariant();
+  }
+  return encryption_.get();
 }
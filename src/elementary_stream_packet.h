@@ -9,10 +9,15 @@
 #ifndef SRC_PLAYER_ES_DASH_PLAYER_DEMUXER_ELEMENTARY_STREAM_PACKET_H_
 #define SRC_PLAYER_ES_DASH_PLAYER_DEMUXER_ELEMENTARY_STREAM_PACKET_H_
 
+#include <memory>
 #include <vector>
 
 #include "nacl_player/media_common.h"
 
+extern "C" {
+#include "libavutil/buffer.h"
+}
+
 /// @file
 /// @brief This file defines the <code>ElementaryStreamPacket</code>.
 
@@ -27,6 +32,10 @@
 /// @see Samsung::NaClPlayer::ESPacketEncryptionInfo
 class ElementaryStreamPacket {
  public:
+  /// Constructs an empty <code>ElementaryStreamPacket</code>, which can be
+  /// filled with <code>Assign()</code>.
+  ElementaryStreamPacket();
+
   /// Constructs <code>ElementaryStreamPacket</code> and
   /// initialize Samsung::NaClPlayer::ESPacket with given data.
   ///
@@ -36,6 +45,18 @@ class ElementaryStreamPacket {
   /// @see Samsung::NaClPlayer::ESPacket
   ElementaryStreamPacket(uint8_t* data, uint32_t size);
 
+  /// Constructs <code>ElementaryStreamPacket</code> which points into an
+  /// FFmpeg buffer instead of copying the data.
+  ///
+  /// @param[in] buffer_ref A reference to the buffer which holds the data.
+  ///   The packet takes over this reference and releases it when destroyed.
+  /// @param[in] data A pointer to the packet data inside
+  ///   <code>buffer_ref</code>.
+  /// @param[in] size A size of data array in bytes.
+  /// @see Samsung::NaClPlayer::ESPacket
+  ElementaryStreamPacket(AVBufferRef* buffer_ref, uint8_t* data,
+                         uint32_t size);
+
   ElementaryStreamPacket(const ElementaryStreamPacket&) = delete;
 
   /// Move-constructs a <code>ElementaryStreamPacket</code> object,
@@ -52,6 +73,36 @@ class ElementaryStreamPacket {
   /// <code>ElementaryStreamPacket</code> object.
   ElementaryStreamPacket& operator=(ElementaryStreamPacket&& other) = default;
 
+  /// Replaces the packet data with a copy of <code>data</code>. The internal
+  /// byte array is reused, so no memory is allocated if its capacity is big
+  /// enough. Timing information is kept.
+  ///
+  /// @param[in] data A byte array which helds data of elementary stream
+  ///   packet.
+  /// @param[in] size A size of data array in bytes.
+  void Assign(const uint8_t* data, uint32_t size);
+
+  /// Replaces the packet data with data held by an FFmpeg buffer. Timing
+  /// information is kept.
+  ///
+  /// @param[in] buffer_ref A reference to the buffer which holds the data.
+  ///   The packet takes over this reference.
+  /// @param[in] data A pointer to the packet data inside
+  ///   <code>buffer_ref</code>.
+  /// @param[in] size A size of data array in bytes.
+  void Assign(AVBufferRef* buffer_ref, uint8_t* data, uint32_t size);
+
+  /// Releases the data and clears encryption and timing information, so the
+  /// packet can be reused. Capacity of the internal byte array is kept.
+  void Reset();
+
+  /// Returns the number of bytes the internal byte array can hold without
+  /// reallocating.
+  uint32_t GetCapacity() const { return data_.capacity(); }
+
+  /// Reserves the internal byte array for at least <code>size</code> bytes.
+  void Reserve(uint32_t size) { data_.reserve(size); }
+
   /// Returns Elementary Stream Packet.
   const Samsung::NaClPlayer::ESPacket& GetESPacket() const;
 
@@ -66,7 +117,7 @@ class ElementaryStreamPacket {
   bool IsKeyFrame() const { return es_packet_.is_key_frame; }
 
   /// Returns size of packet's data.
-  uint32_t GetDataSize() const { return data_.size(); }
+  uint32_t GetDataSize() const { return es_packet_.size; }
 
   /// Returns the presentation timestamp.
   /// @see Samsung::NaClPlayer::ESPacket::pts
@@ -129,30 +180,46 @@ class ElementaryStreamPacket {
   // assumption: Address returned by vector::data() method is invariant under
   //             move operations
 
+  // Encryption information is allocated on first use, clear packets do not
+  // carry it.
+  struct EncryptionData {
+    std::vector<uint8_t> key_id;
+    std::vector<uint8_t> iv;
+    std::vector<Samsung::NaClPlayer::EncryptedSubsampleDescription> subsamples;
+    Samsung::NaClPlayer::ESPacketEncryptionInfo info;
+  };
+
   // invariants:
 
   // es_packet.data == data_.data() && es_packet.size == data.size()
+  // unless the data is held by buffer_ref_
   void FixDataInvariant();
 
-  // encryption_info.key_id == key_id_.data()
-  // encryption_info.key_id_size == key_id_.size()
+  // encryption_->info.key_id == encryption_->key_id.data()
+  // encryption_->info.key_id_size == encryption_->key_id.size()
   void FixKeyIdInvariant();
 
-  // encryption_info.iv == key_id_.data()
-  // encryption_info.iv_size == key_id_.size()
+  // encryption_->info.iv == encryption_->iv.data()
+  // encryption_->info.iv_size == encryption_->iv.size()
   void FixIvInvariant();
 
-  // encryption_info.subsamples == subsamples_.data()
-  // encryption_info.num_subsamples == subsamples_.size()
+  // encryption_->info.subsamples == encryption_->subsamples.data()
+  // encryption_->info.num_subsamples == encryption_->subsamples.size()
   void FixSubsamplesInvariant();
 
+  EncryptionData* GetOrCreateEncryptionData();
+
+  struct AVBufferRefDeleter {
+    void operator()(AVBufferRef* buffer_ref) const {
+      av_buffer_unref(&buffer_ref);
+    }
+  };
+
   std::vector<uint8_t> data_;
+  std::unique_ptr<AVBufferRef, AVBufferRefDeleter> buffer_ref_;
   Samsung::NaClPlayer::ESPacket es_packet_;
 
-  std::vector<uint8_t> key_id_;
-  std::vector<uint8_t> iv_;
-  std::vector<Samsung::NaClPlayer::EncryptedSubsampleDescription> subsamples_;
-  Samsung::NaClPlayer::ESPacketEncryptionInfo encryption_info_;
+  std::unique_ptr<EncryptionData> encryption_;
 };
 
 #endif  // SRC_PLAYER_ES_DASH_PLAYER_DEMUXER_ELEMENTARY_STREAM_PACKET_H_
@@ -0,0 +1,62 @@
+#include "es_packet_buffer.h"
+
+#include "common.h"
+
+ESPacketBuffer::ESPacketBuffer(size_t max_bytes, bool drop_whole_gops)
+	: max_bytes_(max_bytes),
+	  drop_whole_gops_(drop_whole_gops),
+	  bytes_(0),
+	  wait_for_key_frame_(false),
+	  dropped_packets_(0),
+	  dropped_gops_(0) {}
+
+void ESPacketBuffer::Push(std::unique_ptr<ElementaryStreamPacket> packet) {
+	if (wait_for_key_frame_) {
+		if (!packet->IsKeyFrame()) {
+			++dropped_packets_;
+			return;
+		}
+		wait_for_key_frame_ = false;
+	}
+
+	bytes_ += packet->GetDataSize();
+	packets_.push_back(std::move(packet));
+
+	while (bytes_ > max_bytes_)
+		DropOldest();
+}
+
+std::unique_ptr<ElementaryStreamPacket> ESPacketBuffer::Pop() {
+	std::unique_ptr<ElementaryStreamPacket> packet = std::move(packets_.front());
+	packets_.pop_front();
+	bytes_ -= packet->GetDataSize();
+	return packet;
+}
+
+void ESPacketBuffer::Clear() {
+	packets_.clear();
+	bytes_ = 0;
+	wait_for_key_frame_ = drop_whole_gops_;
+}
+
+void ESPacketBuffer::DropOldest() {
+	DropFront();
+	if (!drop_whole_gops_)
+		return;
+
+	++dropped_gops_;
+	while (!packets_.empty() && !packets_.front()->IsKeyFrame())
+		DropFront();
+
+	// The rest of the current GOP is still to come and can't be decoded.
+	if (packets_.empty())
+		wait_for_key_frame_ = true;
+
+	LOG_DEBUG("Dropped a GOP, %u packets dropped in total", dropped_packets_);
+}
+
+void ESPacketBuffer::DropFront() {
+	bytes_ -= packets_.front()->GetDataSize();
+	packets_.pop_front();
+	++dropped_packets_;
+}
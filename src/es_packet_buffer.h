@@ -0,0 +1,80 @@
+#ifndef ES_PACKET_BUFFER_H_
+#define ES_PACKET_BUFFER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <deque>
+#include <memory>
+
+#include "elementary_stream_packet.h"
+
+/// @file
+/// @brief This file defines the <code>ESPacketBuffer</code> class.
+
+/// @class ESPacketBuffer
+/// @brief A bounded FIFO of elementary stream packets of one stream.
+///
+/// Packets are kept here while NaCl Player does not want more data. When the
+/// buffer grows over its byte limit the oldest packets are dropped. For video
+/// whole GOPs are dropped, so the decoder never gets a frame whose reference
+/// frames were thrown away; if no complete GOP is left, incoming packets are
+/// discarded until the next key frame.
+///
+/// This class is not thread safe.
+class ESPacketBuffer {
+	public:
+		/// Creates an empty <code>ESPacketBuffer</code>.
+		///
+		/// @param[in] max_bytes A limit of buffered payload bytes.
+		/// @param[in] drop_whole_gops If true, packets are dropped from a key
+		///   frame up to the next key frame. Otherwise each packet is dropped on
+		///   its own, which is suitable for audio.
+		ESPacketBuffer(size_t max_bytes, bool drop_whole_gops);
+
+		ESPacketBuffer(const ESPacketBuffer&) = delete;
+		ESPacketBuffer& operator=(const ESPacketBuffer&) = delete;
+
+		/// Appends a packet at the end of the buffer, dropping the oldest
+		/// packets if the byte limit is exceeded.
+		void Push(std::unique_ptr<ElementaryStreamPacket> packet);
+
+		/// Returns the oldest packet. The buffer must not be empty.
+		const ElementaryStreamPacket& Front() const { return *packets_.front(); }
+
+		/// Removes and returns the oldest packet. The buffer must not be empty.
+		std::unique_ptr<ElementaryStreamPacket> Pop();
+
+		/// Drops all buffered packets without counting them as dropped. Video
+		/// buffers then wait for the next key frame.
+		void Clear();
+
+		/// Changes the byte limit, packets over it are dropped on the next
+		/// <code>Push()</code>.
+		void SetMaxBytes(size_t max_bytes) { max_bytes_ = max_bytes; }
+
+		bool Empty() const { return packets_.empty(); }
+		size_t GetBufferedBytes() const { return bytes_; }
+		size_t GetBufferedPackets() const { return packets_.size(); }
+
+		/// Returns a number of packets dropped since creation.
+		uint32_t GetDroppedPackets() const { return dropped_packets_; }
+
+		/// Returns a number of GOPs dropped since creation, always 0 unless
+		/// whole GOPs are dropped.
+		uint32_t GetDroppedGops() const { return dropped_gops_; }
+
+	private:
+		void DropOldest();
+		void DropFront();
+
+		size_t max_bytes_;
+		const bool drop_whole_gops_;
+		std::deque<std::unique_ptr<ElementaryStreamPacket>> packets_;
+		size_t bytes_;
+		bool wait_for_key_frame_;
+		uint32_t dropped_packets_;
+		uint32_t dropped_gops_;
+};
+
+#endif  // ES_PACKET_BUFFER_H_
@@ -0,0 +1,41 @@
+#include "es_packet_pool.h"
+
+ESPacketPool::ESPacketPool(uint32_t payload_capacity)
+	: payload_capacity_(payload_capacity),
+	  acquired_(0),
+	  allocations_(0) {}
+
+std::unique_ptr<ElementaryStreamPacket> ESPacketPool::AcquireCopy(
+    const uint8_t* data, uint32_t size) {
+	std::unique_ptr<ElementaryStreamPacket> packet = Acquire();
+	if (packet->GetCapacity() < size)
+		allocations_.fetch_add(1, std::memory_order_relaxed);
+	packet->Assign(data, size);
+	return packet;
+}
+
+std::unique_ptr<ElementaryStreamPacket> ESPacketPool::AcquireRef(
+    AVBufferRef* buffer_ref, uint8_t* data, uint32_t size) {
+	std::unique_ptr<ElementaryStreamPacket> packet = Acquire();
+	packet->Assign(buffer_ref, data, size);
+	return packet;
+}
+
+void ESPacketPool::Release(std::unique_ptr<ElementaryStreamPacket> packet) {
+	packet->Reset();
+	// On failure the packet is left in place and destroyed here.
+	free_packets_.TryPush(std::move(packet));
+}
+
+std::unique_ptr<ElementaryStreamPacket> ESPacketPool::Acquire() {
+	acquired_.fetch_add(1, std::memory_order_relaxed);
+
+	std::unique_ptr<ElementaryStreamPacket> packet;
+	if (free_packets_.TryPop(&packet))
+		return packet;
+
+	allocations_.fetch_add(1, std::memory_order_relaxed);
+	packet.reset(new ElementaryStreamPacket());
+	packet->Reserve(payload_capacity_);
+	return packet;
+}
@@ -0,0 +1,73 @@
+#ifndef ES_PACKET_POOL_H_
+#define ES_PACKET_POOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+
+#include "elementary_stream_packet.h"
+#include "packet_ring.h"
+
+/// @file
+/// @brief This file defines the <code>ESPacketPool</code> class.
+
+/// @class ESPacketPool
+/// @brief A pool of reusable <code>ElementaryStreamPacket</code> objects of
+/// one stream.
+///
+/// Packets are acquired on the thread which demuxes the stream and released
+/// on the thread which appends them to NaCl Player. Released packets keep
+/// their payload capacity, so once the pool is warmed up the copy path stops
+/// allocating too. The free list is a <code>PacketRing</code>, so acquiring
+/// and releasing is lock-free.
+class ESPacketPool {
+	public:
+		/// Creates an empty <code>ESPacketPool</code>.
+		///
+		/// @param[in] payload_capacity A number of bytes reserved in every new
+		///   packet, should fit a typical packet of the stream.
+		explicit ESPacketPool(uint32_t payload_capacity);
+
+		ESPacketPool(const ESPacketPool&) = delete;
+		ESPacketPool& operator=(const ESPacketPool&) = delete;
+
+		/// Returns a packet holding a copy of <code>data</code>. Producer side
+		/// only.
+		std::unique_ptr<ElementaryStreamPacket> AcquireCopy(const uint8_t* data,
+		        uint32_t size);
+
+		/// Returns a packet which takes over <code>buffer_ref</code>. Producer
+		/// side only.
+		std::unique_ptr<ElementaryStreamPacket> AcquireRef(AVBufferRef* buffer_ref,
+		        uint8_t* data, uint32_t size);
+
+		/// Gives a packet back to the pool, releasing its data. If the pool is
+		/// full the packet is destroyed. Consumer side only.
+		void Release(std::unique_ptr<ElementaryStreamPacket> packet);
+
+		/// Returns a number of packets handed out since creation.
+		uint32_t GetAcquired() const {
+			return acquired_.load(std::memory_order_relaxed);
+		}
+
+		/// Returns a number of heap allocations made by the pool: new packets
+		/// and growth of packet payload arrays.
+		uint32_t GetAllocations() const {
+			return allocations_.load(std::memory_order_relaxed);
+		}
+
+	private:
+		/// Enough to cover packets in flight in the ring and in the buffers.
+		static const size_t kPoolSize = 512;
+
+		std::unique_ptr<ElementaryStreamPacket> Acquire();
+
+		const uint32_t payload_capacity_;
+		PacketRing<std::unique_ptr<ElementaryStreamPacket>, kPoolSize> free_packets_;
+		std::atomic<uint32_t> acquired_;
+		std::atomic<uint32_t> allocations_;
+};
+
+#endif  // ES_PACKET_POOL_H_
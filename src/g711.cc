@@ -0,0 +1,48 @@
+#include "g711.h"
+
+namespace {
+
+/// Both tables are built once, before any parser thread starts.
+struct G711Tables {
+	G711Tables() {
+		for (int i = 0; i < 256; ++i) {
+			mu_law[i] = MuLawToLinear(i);
+			a_law[i] = ALawToLinear(i);
+		}
+	}
+
+	static int16_t MuLawToLinear(uint8_t value) {
+		value = ~value;
+		int t = (((value & 0x0f) << 3) + 0x84) << ((value & 0x70) >> 4);
+		return (value & 0x80) ? (0x84 - t) : (t - 0x84);
+	}
+
+	static int16_t ALawToLinear(uint8_t value) {
+		value ^= 0x55;
+		int t = value & 0x0f;
+		int segment = (value & 0x70) >> 4;
+		if (segment)
+			t = (t + t + 1 + 32) << (segment + 2);
+		else
+			t = (t + t + 1) << 3;
+		return (value & 0x80) ? t : -t;
+	}
+
+	int16_t mu_law[256];
+	int16_t a_law[256];
+};
+
+const G711Tables kG711Tables;
+
+}  // namespace
+
+bool IsG711Codec(AVCodecID codec) {
+	return codec == AV_CODEC_ID_PCM_MULAW || codec == AV_CODEC_ID_PCM_ALAW;
+}
+
+void DecodeG711(AVCodecID codec, const uint8_t* in, size_t count, int16_t* out) {
+	const int16_t* table = codec == AV_CODEC_ID_PCM_MULAW ? kG711Tables.mu_law :
+	                       kG711Tables.a_law;
+	for (size_t i = 0; i < count; ++i)
+		out[i] = table[in[i]];
+}
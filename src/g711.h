@@ -0,0 +1,29 @@
+#ifndef G711_H_
+#define G711_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+extern "C" {
+#include "libavcodec/avcodec.h"
+}
+
+/// @file
+/// @brief This file defines functions expanding G.711 audio to linear PCM.
+///
+/// Every G.711 byte is one sample, so expanding it is a lookup in a table of
+/// 256 16-bit values. The values are the ones of the FFmpeg decoders.
+
+/// Returns true for G.711 mu-law and A-law.
+bool IsG711Codec(AVCodecID codec);
+
+/// Expands G.711 samples to 16-bit linear PCM.
+///
+/// @param[in] codec <code>AV_CODEC_ID_PCM_MULAW</code> or
+///   <code>AV_CODEC_ID_PCM_ALAW</code>.
+/// @param[in] in <code>count</code> G.711 samples.
+/// @param[in] count A number of samples of all channels.
+/// @param[out] out Room for <code>count</code> samples.
+void DecodeG711(AVCodecID codec, const uint8_t* in, size_t count, int16_t* out);
+
+#endif  // G711_H_
@@ -0,0 +1,68 @@
+#include "latency_controller.h"
+
+#include "codec_config_parser.h"
+
+using Samsung::NaClPlayer::TimeTicks;
+
+// Latency above the target which is tolerated, so dropping doesn't toggle on
+// every jitter of the network.
+static const TimeTicks kLatencyTolerance = 0.1;
+// Latency above the target from which the rest of the GOP is skipped even
+// without audio, dropping single pictures would take too long to catch up.
+static const TimeTicks kSkipToKeyFrameThreshold = 1.0;
+static const TimeTicks kUnknownTime = -1;
+
+LatencyController::LatencyController()
+	: target_(0),
+	  playback_time_(kUnknownTime),
+	  appended_pts_(kUnknownTime),
+	  dropped_frames_(0),
+	  has_audio_(false),
+	  skipping_to_key_frame_(false) {}
+
+void LatencyController::Reset(TimeTicks target) {
+	target_ = target;
+	playback_time_ = kUnknownTime;
+	appended_pts_ = kUnknownTime;
+	dropped_frames_ = 0;
+	has_audio_ = false;
+	skipping_to_key_frame_ = false;
+}
+
+void LatencyController::OnTimeUpdate(TimeTicks time) {
+	playback_time_ = time;
+}
+
+void LatencyController::OnPacketAppended(TimeTicks pts) {
+	if (pts > appended_pts_.load())
+		appended_pts_ = pts;
+}
+
+TimeTicks LatencyController::GetLatency() const {
+	TimeTicks playback_time = playback_time_.load();
+	TimeTicks appended_pts = appended_pts_.load();
+	if (playback_time < 0 || appended_pts < playback_time)
+		return 0;
+	return appended_pts - playback_time;
+}
+
+bool LatencyController::ShouldDropVideo(const uint8_t* data, size_t size,
+                                        bool is_key_frame, bool is_hevc) {
+	if (target_ <= 0)
+		return false;
+
+	if (is_key_frame) {
+		skipping_to_key_frame_ = false;
+		return false;
+	}
+
+	TimeTicks latency = GetLatency();
+	if (latency > target_ + (has_audio_ ? kLatencyTolerance : kSkipToKeyFrameThreshold))
+		skipping_to_key_frame_ = true;
+	bool drop = skipping_to_key_frame_ ||
+	            (latency > target_ + kLatencyTolerance &&
+	             IsNonReferencePicture(data, size, is_hevc));
+	if (drop)
+		++dropped_frames_;
+	return drop;
+}
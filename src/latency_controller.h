@@ -0,0 +1,79 @@
+#ifndef LATENCY_CONTROLLER_H_
+#define LATENCY_CONTROLLER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+#include "nacl_player/media_common.h"
+
+/// @file
+/// @brief This file defines the <code>LatencyController</code> class.
+
+/// @class LatencyController
+/// @brief Keeps live playback close to a target latency by dropping video.
+///
+/// The latency is the duration buffered by NaCl Player, that is the PTS of
+/// the last appended packet minus the playback position. Above the target,
+/// non-reference pictures are dropped. Far above the target, everything up to
+/// the next keyframe is skipped, audio included, so rebasing timestamps after
+/// the gap shortens the buffered duration of both streams.
+///
+/// The gap of a single dropped picture can only be closed if there is no
+/// audio, which would fall behind the video otherwise. Dropping single
+/// pictures doesn't shorten the buffered duration then, so with audio the
+/// rest of the GOP is skipped as soon as the latency is above the target.
+///
+/// <code>OnTimeUpdate()</code> and <code>OnPacketAppended()</code> may be
+/// called from any thread, the decision methods from the parser thread only.
+class LatencyController {
+	public:
+		LatencyController();
+
+		LatencyController(const LatencyController&) = delete;
+		LatencyController& operator=(const LatencyController&) = delete;
+
+		/// Sets the latency to keep, 0 disables dropping. Clears all state,
+		/// the stream is taken to have no audio.
+		void Reset(Samsung::NaClPlayer::TimeTicks target);
+
+		/// Tells whether the stream has audio, see the class description.
+		void SetHasAudio(bool has_audio) { has_audio_ = has_audio; }
+
+		/// Updates the playback position reported by NaCl Player.
+		void OnTimeUpdate(Samsung::NaClPlayer::TimeTicks time);
+
+		/// Updates the PTS of the last packet appended to NaCl Player.
+		void OnPacketAppended(Samsung::NaClPlayer::TimeTicks pts);
+
+		/// Returns the buffered duration, 0 until playback starts.
+		Samsung::NaClPlayer::TimeTicks GetLatency() const;
+
+		/// Decides whether a video access unit should be dropped.
+		///
+		/// @param[in] data An Annex B access unit.
+		/// @param[in] size A size of <code>data</code> in bytes.
+		/// @param[in] is_key_frame True if the access unit starts a GOP.
+		/// @param[in] is_hevc True for H.265, false for H.264.
+		/// @return True if the access unit should be dropped.
+		bool ShouldDropVideo(const uint8_t* data, size_t size, bool is_key_frame,
+		                     bool is_hevc);
+
+		/// Returns true if audio should be dropped, which is the case while
+		/// skipping to the next keyframe.
+		bool ShouldDropAudio() const { return skipping_to_key_frame_; }
+
+		/// Returns a number of video access units dropped since the last reset.
+		uint32_t GetDroppedFrames() const { return dropped_frames_.load(); }
+
+	private:
+		Samsung::NaClPlayer::TimeTicks target_;
+		std::atomic<Samsung::NaClPlayer::TimeTicks> playback_time_;
+		std::atomic<Samsung::NaClPlayer::TimeTicks> appended_pts_;
+		std::atomic<uint32_t> dropped_frames_;
+		bool has_audio_;
+		bool skipping_to_key_frame_;
+};
+
+#endif  // LATENCY_CONTROLLER_H_
@@ -9,13 +9,16 @@
 
 #include "message_receiver.h"
 
+#include <sstream>
 #include <string>
 
+#include "ppapi/cpp/var_array.h"
 #include "ppapi/cpp/var_dictionary.h"
 
 #include "messages.h"
 
 using pp::Var;
+using pp::VarArray;
 using pp::VarDictionary;
 
 namespace Communication {
@@ -36,35 +39,51 @@ void MessageReceiver::HandleMessage(pp::InstanceHandle /*instance*/,
     LOG_ERROR("Invalid message - 'action' should be an integer!");
     return;
   }
-  LOG_INFO("Action type: %d", action_var.AsInt());
+  Var player_id_var = msg.Get(kKeyPlayerId);
+  int32_t player_id = player_id_var.is_int() ? player_id_var.AsInt() : 0;
+  LOG_INFO("Action type: %d, player: %d", action_var.AsInt(), player_id);
   auto action = static_cast<MessageToPlayer>(action_var.AsInt());
 
   switch (action) {
     case MessageToPlayer::kClosePlayer:
-      ClosePlayer();
+      ClosePlayer(player_id);
       break;
     case MessageToPlayer::kLoadMedia:
-      LoadMedia(msg.Get(kKeyType),
+      LoadMedia(player_id,
+                msg.Get(kKeyType),
                 msg.Get(kKeyUrl),
                 msg.Get(kKeyUpdateFrequency),
-                msg.Get(kKeyArloCrtPath)
+                msg.Get(kKeyArloCrtPath),
+                msg.Get(kKeyTransport),
+                msg.Get(kKeyFastStart),
+                msg.Get(kKeyPersistStreamInfo),
+                msg.Get(kKeyFfmpegOptions),
+                msg.Get(kKeyMaxReconnectAttempts),
+                msg.Get(kKeyTargetLatency),
+                msg.Get(kKeyCapturePath),
+                msg.Get(kKeyReplayRealtime),
+                msg.Get(kKeyPriority)
                 );
       break;
     case MessageToPlayer::kPlay:
-      Play();
+      Play(player_id);
       break;
     case MessageToPlayer::kStop:
-      Stop();
+      Stop(player_id);
       break;
     case MessageToPlayer::kChangeViewRect:
-      ChangeViewRect(msg.Get(kKeyXCoordination),
+      ChangeViewRect(player_id,
+                     msg.Get(kKeyXCoordination),
                      msg.Get(kKeyYCoordination),
                      msg.Get(kKeyWidth),
                      msg.Get(kKeyHeight));
       break;
     case MessageToPlayer::kMute:
-          Mute();
+          Mute(player_id);
           break;
+    case MessageToPlayer::kSetPriority:
+      SetPriority(player_id, msg.Get(kKeyPriority));
+      break;
     default:
       LOG_ERROR("Not supported action code!");
   }
@@ -75,11 +94,29 @@ Var MessageReceiver::HandleBlockingMessage(
   return Var();
 }
 
-void MessageReceiver::ClosePlayer() { player_controller_.reset(); }
+PlayerController* MessageReceiver::GetController(int32_t player_id) {
+  auto it = players_.find(player_id);
+  return it == players_.end() ? NULL : it->second.controller.get();
+}
 
-void MessageReceiver::LoadMedia(const Var& type, const Var& url,
+void MessageReceiver::ClosePlayer(int32_t player_id) {
+  auto it = players_.find(player_id);
+  if (it != players_.end()) it->second.controller.reset();
+}
+
+void MessageReceiver::LoadMedia(int32_t player_id, const Var& type,
+                                const Var& url,
                                 const Var& audio_level_cb_frequency,
-                                const Var& crt_path) {
+                                const Var& crt_path,
+                                const Var& transport,
+                                const Var& fast_start,
+                                const Var& persist_stream_info,
+                                const Var& ffmpeg_options,
+                                const Var& max_reconnect_attempts,
+                                const Var& target_latency,
+                                const Var& capture_path,
+                                const Var& replay_realtime,
+                                const Var& priority) {
   if (!type.is_int() || !url.is_string()) {
     LOG_ERROR("Invalid message - 'url' should be a string");
     return;
@@ -94,35 +131,92 @@ void MessageReceiver::LoadMedia(const Var& type, const Var& url,
       return;
   }
 
+  PlayerOptions options;
+  if (audio_level_cb_frequency.is_number())
+    options.audio_level_cb_frequency = audio_level_cb_frequency.AsDouble();
+  if (crt_path.is_string())
+    options.crt_path = crt_path.AsString();
+  if (transport.is_string())
+    options.transport = transport.AsString();
+  if (fast_start.is_bool())
+    options.fast_start = fast_start.AsBool();
+  if (persist_stream_info.is_bool())
+    options.persist_stream_info = persist_stream_info.AsBool();
+  if (ffmpeg_options.is_dictionary()) {
+    VarDictionary dict(ffmpeg_options);
+    VarArray keys = dict.GetKeys();
+    for (uint32_t i = 0; i < keys.GetLength(); ++i) {
+      std::string name = keys.Get(i).AsString();
+      Var value = dict.Get(keys.Get(i));
+      std::ostringstream value_str;
+      if (value.is_string()) {
+        value_str << value.AsString();
+      } else if (value.is_int()) {
+        value_str << value.AsInt();
+      } else if (value.is_double()) {
+        value_str << value.AsDouble();
+      } else {
+        LOG_ERROR("Invalid value of FFmpeg option '%s'", name.c_str());
+        continue;
+      }
+      options.ffmpeg_options[name] = value_str.str();
+    }
+  }
 
-  player_controller_ =
-      player_provider_->CreatePlayer(player_type, view_rect_, url.AsString(),
-                                     audio_level_cb_frequency.AsDouble(),
-                                     crt_path.AsString());
+  if (max_reconnect_attempts.is_int())
+    options.max_reconnect_attempts = max_reconnect_attempts.AsInt();
+  if (target_latency.is_number())
+    options.target_latency = target_latency.AsDouble();
+  if (capture_path.is_string())
+    options.capture_path = capture_path.AsString();
+  if (replay_realtime.is_bool())
+    options.replay_realtime = replay_realtime.AsBool();
+  if (priority.is_int())
+    options.priority = priority.AsInt();
+
+  // The previous player of this id gives its resources back first.
+  Player& player = players_[player_id];
+  player.controller.reset();
+  player.controller =
+      player_provider_->CreatePlayer(player_type, player_id, player.view_rect,
+                                     url.AsString(), options);
 }
 
-void MessageReceiver::Play() {
-  if (player_controller_) player_controller_->Play();
+void MessageReceiver::Play(int32_t player_id) {
+  PlayerController* controller = GetController(player_id);
+  if (controller) controller->Play();
 }
 
-void MessageReceiver::Stop() {
-  if (player_controller_) player_controller_->Stop();
+void MessageReceiver::Stop(int32_t player_id) {
+  PlayerController* controller = GetController(player_id);
+  if (controller) controller->Stop();
 }
 
-void MessageReceiver::Mute() {
-  if (player_controller_) player_controller_->Mute();
+void MessageReceiver::Mute(int32_t player_id) {
+  PlayerController* controller = GetController(player_id);
+  if (controller) controller->Mute();
+}
+
+void MessageReceiver::SetPriority(int32_t player_id, const Var& priority) {
+  if (!priority.is_int()) {
+    LOG_ERROR("Invalid message - 'priority' should be an int");
+    return;
+  }
+  PlayerController* controller = GetController(player_id);
+  if (controller) controller->SetPriority(priority.AsInt());
 }
-void MessageReceiver::ChangeViewRect(const Var& x_position,
+void MessageReceiver::ChangeViewRect(int32_t player_id, const Var& x_position,
     const Var& y_position, const Var& width, const Var& height) {
   if (!x_position.is_int() || !y_position.is_int() || !width.is_int() ||
       !height.is_int()) {
     LOG_ERROR("Invalid message - some params are not an int type");
     return;
   }
-  view_rect_ = Samsung::NaClPlayer::Rect(
+  Player& player = players_[player_id];
+  player.view_rect = Samsung::NaClPlayer::Rect(
       x_position.AsInt(), y_position.AsInt(), width.AsInt(), height.AsInt());
-  if (player_controller_) {
-    player_controller_->SetViewRect(view_rect_);
+  if (player.controller) {
+    player.controller->SetViewRect(player.view_rect);
   }
 }
 
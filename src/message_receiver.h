@@ -10,6 +10,8 @@
 #ifndef NATIVE_PLAYER_INC_COMMUNICATOR_MESSAGE_RECEIVER_H_
 #define NATIVE_PLAYER_INC_COMMUNICATOR_MESSAGE_RECEIVER_H_
 
+#include <map>
+
 #include "ppapi/cpp/var.h"
 #include "ppapi/cpp/instance_handle.h"
 #include "ppapi/cpp/message_handler.h"
@@ -33,6 +35,10 @@ namespace Communication {
 /// <code>enum MessageToPlayer</code>. Basing on this value
 /// <code>MessageReceiver</code> performs a proper action on the player.
 ///
+/// Several players can play at once, e.g. the tiles of a camera grid. Each
+/// message addresses the player given by <code>kKeyPlayerId</code>, player 0
+/// if it is missing, and every player keeps its own view rect.
+///
 /// @see Communication Description of the <code>Communication</code> namespace
 ///   provides a brief of the communication mechanism.
 /// @see kKeyMessageToPlayer
@@ -102,44 +108,95 @@ class MessageReceiver : public pp::MessageHandler {
   /// @see StreamType
   void ChangeRepresentation(const pp::Var& type, const pp::Var& id);
 
+  /// @struct Player
+  /// A player addressed by an id and where it is shown.
+  struct Player {
+    std::shared_ptr<PlayerController> controller;
+    Samsung::NaClPlayer::Rect view_rect;
+  };
+
+  /// Returns the controller of a player, NULL if it is not loaded.
+  PlayerController* GetController(int32_t player_id);
+
   /// @public
   /// Handles a <code>kClosePlayer</code> message, closes the player
-  /// and frees resources.
+  /// and frees resources. Its view rect is kept for the next load.
   ///
+  /// @param[in] player_id An id of the player.
   /// @see kClosePlayer
-  void ClosePlayer();
+  void ClosePlayer(int32_t player_id);
 
   /// @public
   /// Validates a <code>kLoadMedia</code> message, decodes provided
   /// parameters and creates a player that can handle a given type of the
-  /// multimedia content.
+  /// multimedia content. A player loaded with the same id before is closed
+  /// first, so its resources can be reused.
   ///
+  /// @param[in] player_id An id of the player.
   /// @param[in] type A type of a content which needs to be loaded. This
   ///   <code>Var</code> is casted to <code>ClipTypeEnum</code> and it has to
   ///   be an integer value.
   /// @param[in] url An URL to a content container, it could point to
   ///   different types of files depending on the player type. This
   ///   <code>Var</code> has to be a <code>string</code> type value.
-  /// @param[in] subtitle An URL to the file with external subtitles. It is an
-  ///   optional parameter, but if provided it has to be a <code>string</code>
-  ///   type value.
-  /// @param[in] encoding A subtitle encoding code. It is an optional
-  ///   parameter, which has to be a <code>string</code> type value.
+  /// @param[in] audio_level_cb_frequency A period of audio level
+  ///   notifications in seconds. It is an optional <code>double</code>.
+  /// @param[in] crt_path A CA certificate path for RTSPS streams. It is an
+  ///   optional <code>string</code>.
+  /// @param[in] transport An RTSP transport. It is an optional
+  ///   <code>string</code>, "tcp" by default.
+  /// @param[in] fast_start Enables configuring streams without probing. It is
+  ///   an optional <code>bool</code>, false by default.
+  /// @param[in] persist_stream_info Enables storing the stream info cache in
+  ///   the persistent file system. It is an optional <code>bool</code>.
+  /// @param[in] ffmpeg_options FFmpeg options. It is an optional
+  ///   <code>dictionary</code> of <code>string</code> or number values.
+  /// @param[in] max_reconnect_attempts A limit of reconnect attempts after a
+  ///   network error. It is an optional <code>int</code>, 10 by default.
+  /// @param[in] target_latency A live latency in seconds to catch up to. It is
+  ///   an optional <code>double</code>, 0 (disabled) by default.
+  /// @param[in] capture_path A file received packets are captured to. It is
+  ///   an optional <code>string</code>.
+  /// @param[in] replay_realtime Replays captures with the original timing. It
+  ///   is an optional <code>bool</code>, true by default.
+  /// @param[in] priority A scheduling priority of the player. It is an
+  ///   optional <code>int</code>, 0 by default.
   /// @see kLoadMedia
   /// @see ClipTypeEnum
-  void LoadMedia(const pp::Var& type, const pp::Var& url, const pp::Var& audio_level_cb_frequency,
-                 const pp::Var& crt_path);
+  void LoadMedia(int32_t player_id, const pp::Var& type, const pp::Var& url, const pp::Var& audio_level_cb_frequency,
+                 const pp::Var& crt_path, const pp::Var& transport,
+                 const pp::Var& fast_start,
+                 const pp::Var& persist_stream_info,
+                 const pp::Var& ffmpeg_options,
+                 const pp::Var& max_reconnect_attempts,
+                 const pp::Var& target_latency,
+                 const pp::Var& capture_path,
+                 const pp::Var& replay_realtime,
+                 const pp::Var& priority);
 
-  void Stop();
+  void Stop(int32_t player_id);
 
   /// @public
   /// Handles a <code>kPlay</code> message, and requests the player to
   /// start play. The request will be ignored if the content is not loaded.
   ///
+  /// @param[in] player_id An id of the player.
   /// @see kPlay
-  void Play();
+  void Play(int32_t player_id);
+
+  void Mute(int32_t player_id);
+
+  /// @public
+  /// Handles a <code>kSetPriority</code> message and changes the scheduling
+  /// priority of the player. The request will be ignored if the content is
+  /// not loaded.
+  ///
+  /// @param[in] player_id An id of the player.
+  /// @param[in] priority A new priority; should be expressed by an integer
+  ///   value.
+  /// @see kSetPriority
+  void SetPriority(int32_t player_id, const pp::Var& priority);
 
-  void Mute();
   /// @public
   /// Handles a <code>kSeek</code> message, validates a provided
   /// parameter and requests the player to change current playback time to the
@@ -158,6 +215,7 @@ class MessageReceiver : public pp::MessageHandler {
   /// resolution of plugin window. If the player is not initialized then
   /// parameters will be provided during initialization.
   ///
+  /// @param[in] player_id An id of the player.
   /// @param[in] x_position An x position of the plugin left upper corner;
   ///   should be expressed by an integer value.
   /// @param[in] y_position A y position of the plugin left upper corner;
@@ -167,8 +225,9 @@ class MessageReceiver : public pp::MessageHandler {
   /// @param[in] height A height of the plugin window; should be expressed
   ///   by an integer value.
   /// @see kChangeViewRect
-  void ChangeViewRect(const pp::Var& x_position, const pp::Var& y_position,
-                        const pp::Var& width, const pp::Var& height);
+  void ChangeViewRect(int32_t player_id, const pp::Var& x_position,
+                      const pp::Var& y_position, const pp::Var& width,
+                      const pp::Var& height);
 
   /// @public
   /// Handles a <code>kChangeSubtitlesRepresentation</code> message,
@@ -189,9 +248,8 @@ class MessageReceiver : public pp::MessageHandler {
   /// @see kChangeSubtitlesVisibility
   void ChangeSubtitlesVisibility();
 
-  std::shared_ptr<PlayerController> player_controller_;
+  std::map<int32_t, Player> players_;
   std::shared_ptr<PlayerProvider> player_provider_;
-  Samsung::NaClPlayer::Rect view_rect_;
 };
 
 }  // namespace Communication
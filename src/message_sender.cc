@@ -9,6 +9,7 @@
 
 #include "message_sender.h"
 
+#include <sstream>
 #include <string>
 
 #include "ppapi/cpp/var_dictionary.h"
@@ -22,6 +23,13 @@ using Samsung::NaClPlayer::TextTrackInfo;
 
 namespace Communication {
 
+std::shared_ptr<MessageSender> MessageSender::ForPlayer(int32_t player_id) const {
+  std::shared_ptr<MessageSender> sender =
+      std::make_shared<MessageSender>(instance_);
+  sender->player_id_ = player_id;
+  return sender;
+}
+
 void MessageSender::SetMediaDuration(TimeTicks duration) {
   VarDictionary message;
   message.Set(kKeyMessageFromPlayer, MessageFromPlayer::kSetDuration);
@@ -42,10 +50,11 @@ void MessageSender::BufferingCompleted() {
   PostMessage(message);
 }
 
-void MessageSender::SetAudioLevel(TimeTicks audio_level) { 
+void MessageSender::SetAudioLevel(double level, double peak) {
   VarDictionary message;
   message.Set(kKeyMessageFromPlayer, MessageFromPlayer::kSetAudioLevel);
-  message.Set(kKeyAudioLevel,audio_level);//key value pair
+  message.Set(kKeyAudioLevel, level);
+  message.Set(kKeyAudioPeak, peak);
   PostMessage(message);
 }
 
@@ -58,6 +67,117 @@ void MessageSender::SendStats(int lost, int jitter, int bitrate) {
 	PostMessage(message);
 }
 
+void MessageSender::SendPipelineStats(const PipelineStats& stats) {
+  VarDictionary message;
+  message.Set(kKeyMessageFromPlayer, MessageFromPlayer::kSendPipelineStats);
+  message.Set(kKeyRingOccupancy, static_cast<int32_t>(stats.ring_occupancy));
+  message.Set(kKeyRingHighWatermark,
+              static_cast<int32_t>(stats.ring_high_watermark));
+  message.Set(kKeyRingOverruns, static_cast<int32_t>(stats.ring_overruns));
+  message.Set(kKeyRingDroppedGops, static_cast<int32_t>(stats.ring_dropped_gops));
+  message.Set(kKeyVideoBufferedBytes,
+              static_cast<int32_t>(stats.video_buffered_bytes));
+  message.Set(kKeyVideoBufferedPackets,
+              static_cast<int32_t>(stats.video_buffered_packets));
+  message.Set(kKeyVideoDroppedPackets,
+              static_cast<int32_t>(stats.video_dropped_packets));
+  message.Set(kKeyVideoDroppedGops,
+              static_cast<int32_t>(stats.video_dropped_gops));
+  message.Set(kKeyAudioBufferedBytes,
+              static_cast<int32_t>(stats.audio_buffered_bytes));
+  message.Set(kKeyAudioBufferedPackets,
+              static_cast<int32_t>(stats.audio_buffered_packets));
+  message.Set(kKeyAudioDroppedPackets,
+              static_cast<int32_t>(stats.audio_dropped_packets));
+  message.Set(kKeyEsPackets, static_cast<int32_t>(stats.es_packets));
+  message.Set(kKeyEsPacketAllocations,
+              static_cast<int32_t>(stats.es_packet_allocations));
+  message.Set(kKeyLatencyMs, static_cast<int32_t>(stats.latency_ms));
+  message.Set(kKeyLatencyDroppedFrames,
+              static_cast<int32_t>(stats.latency_dropped_frames));
+  message.Set(kKeyAudioQueueOccupancy,
+              static_cast<int32_t>(stats.audio_queue_occupancy));
+  message.Set(kKeyAudioQueueOverruns,
+              static_cast<int32_t>(stats.audio_queue_overruns));
+  message.Set(kKeyAudioQueueWaitUs,
+              static_cast<int32_t>(stats.audio_queue_wait_us));
+  message.Set(kKeyAudioQueueWaitMaxUs,
+              static_cast<int32_t>(stats.audio_queue_wait_max_us));
+  message.Set(kKeyAudioConvertUs, static_cast<int32_t>(stats.audio_convert_us));
+  message.Set(kKeyAudioConvertMaxUs,
+              static_cast<int32_t>(stats.audio_convert_max_us));
+  message.Set(kKeyAudioHandoffUs, static_cast<int32_t>(stats.audio_handoff_us));
+  message.Set(kKeyAudioHandoffMaxUs,
+              static_cast<int32_t>(stats.audio_handoff_max_us));
+  PostMessage(message);
+}
+
+void MessageSender::StreamConfigChanged() {
+  VarDictionary message;
+  message.Set(kKeyMessageFromPlayer, MessageFromPlayer::kStreamConfigChanged);
+  PostMessage(message);
+}
+
+void MessageSender::TransportSelected(const std::string& transport) {
+  VarDictionary message;
+  message.Set(kKeyMessageFromPlayer, MessageFromPlayer::kTransportSelected);
+  message.Set(kKeyTransport, transport);
+  PostMessage(message);
+}
+
+void MessageSender::TeardownCompleted(int teardown_ms) {
+  VarDictionary message;
+  message.Set(kKeyMessageFromPlayer, MessageFromPlayer::kTeardownCompleted);
+  message.Set(kKeyTeardownMs, teardown_ms);
+  PostMessage(message);
+}
+
+void MessageSender::Reconnecting(int attempt, int delay_ms) {
+  VarDictionary message;
+  message.Set(kKeyMessageFromPlayer, MessageFromPlayer::kReconnecting);
+  message.Set(kKeyAttempt, attempt);
+  message.Set(kKeyDelayMs, delay_ms);
+  PostMessage(message);
+}
+
+void MessageSender::Reconnected(int attempt) {
+  VarDictionary message;
+  message.Set(kKeyMessageFromPlayer, MessageFromPlayer::kReconnected);
+  message.Set(kKeyAttempt, attempt);
+  PostMessage(message);
+}
+
+void MessageSender::ReconnectFailed() {
+  VarDictionary message;
+  message.Set(kKeyMessageFromPlayer, MessageFromPlayer::kReconnectFailed);
+  PostMessage(message);
+}
+
+void MessageSender::SendWorkerStats(
+    const std::vector<WorkerPool::WorkerStats>& stats) {
+  VarDictionary workers;
+  for (const WorkerPool::WorkerStats& worker : stats) {
+    VarDictionary entry;
+    entry.Set(kKeyUtilization, static_cast<int32_t>(worker.utilization));
+    entry.Set(kKeyTasks, static_cast<int32_t>(worker.tasks));
+    entry.Set(kKeyMaxTaskUs, static_cast<int32_t>(worker.max_task_us));
+    std::ostringstream name;
+    name << (worker.group == WorkerPool::kIo ? "io" : "cpu") << worker.index;
+    workers.Set(name.str(), entry);
+  }
+
+  VarDictionary message;
+  message.Set(kKeyMessageFromPlayer, MessageFromPlayer::kSendWorkerStats);
+  message.Set(kKeyWorkers, workers);
+  PostMessage(message);
+}
+
+void MessageSender::PlayerRejected() {
+  VarDictionary message;
+  message.Set(kKeyMessageFromPlayer, MessageFromPlayer::kPlayerRejected);
+  PostMessage(message);
+}
+
 void MessageSender::StreamEnded() {
   VarDictionary message;
   message.Set(kKeyMessageFromPlayer, MessageFromPlayer::kStreamEnded);
@@ -65,6 +185,11 @@ void MessageSender::StreamEnded() {
 }
 
 void MessageSender::PostMessage(const Var& message) {
+  // Dictionaries are references, the id is added to the message itself.
+  if (player_id_ != kNoPlayerId) {
+    VarDictionary dictionary(message);
+    dictionary.Set(kKeyPlayerId, player_id_);
+  }
   instance_->PostMessage(message);
 }
 
@@ -10,12 +10,16 @@
 #ifndef NATIVE_PLAYER_INC_COMMUNICATOR_MESSAGE_SENDER_H_
 #define NATIVE_PLAYER_INC_COMMUNICATOR_MESSAGE_SENDER_H_
 
+#include <memory>
 #include <vector>
 
 #include "common.h"
 #include "nacl_player/common.h"
 #include "nacl_player/media_common.h"
 
+#include "pipeline_stats.h"
+#include "worker_pool.h"
+
 /// @file
 /// @brief This file defines a MessageSender class.
 
@@ -36,11 +40,20 @@ class MessageSender {
   ///
   /// @param[in] instance A pointer to a module which will be used for sending
   ///   messages.
-  explicit MessageSender(pp::Instance* instance) : instance_(instance) {}
+  explicit MessageSender(pp::Instance* instance)
+      : instance_(instance), player_id_(kNoPlayerId) {}
 
   /// Destroys the <code>MessageSender</code> object.
   ~MessageSender() {}
 
+  /// Creates a <code>MessageSender</code> whose messages carry a player id,
+  /// so the application can tell which player sent them. Messages of this
+  /// one, e.g. worker statistics, are about all players and carry none.
+  ///
+  /// @param[in] player_id An id given by the application in
+  ///   <code>kKeyPlayerId</code>.
+  std::shared_ptr<MessageSender> ForPlayer(int32_t player_id) const;
+
   /// Prepares and posts a message with the duration of the content.
   ///
   /// @param[in] duration A total length in seconds of the loaded media
@@ -66,8 +79,72 @@ class MessageSender {
   /// @see kStreamEnded Main key value in the prepared message.
   void StreamEnded();
 
-  void SetAudioLevel(Samsung::NaClPlayer::TimeTicks duration);
+  /// Prepares and posts a message with the audio level.
+  ///
+  /// @param[in] level The RMS level in dB over one step of 16-bit audio.
+  /// @param[in] peak The peak since the previous message on the same scale.
+  /// @see kSetAudioLevel Main key value in the prepared message.
+  void SetAudioLevel(double level, double peak);
   void SendStats(int lost, int jitter, int bitrate);
+
+  /// Prepares and posts a message with packet pipeline counters.
+  ///
+  /// @param[in] stats A snapshot of the pipeline counters.
+  /// @see kSendPipelineStats Main key value in the prepared message.
+  void SendPipelineStats(const PipelineStats& stats);
+
+  /// Prepares and posts a message with the information that the stream no
+  /// longer matches its cached configuration used to start playback.
+  ///
+  /// @see kStreamConfigChanged Main key value in the prepared message.
+  void StreamConfigChanged();
+
+  /// Prepares and posts a message with the RTSP transport in use.
+  ///
+  /// @param[in] transport A name of the transport.
+  /// @see kTransportSelected Main key value in the prepared message.
+  void TransportSelected(const std::string& transport);
+
+  /// Prepares and posts a message with the time stopping the stream took.
+  ///
+  /// @param[in] teardown_ms A time in milliseconds.
+  /// @see kTeardownCompleted Main key value in the prepared message.
+  void TeardownCompleted(int teardown_ms);
+
+  /// Prepares and posts a message with the information that the connection
+  /// was lost and is going to be reopened.
+  ///
+  /// @param[in] attempt A number of the attempt, starting from 1.
+  /// @param[in] delay_ms A time in milliseconds before the attempt.
+  /// @see kReconnecting Main key value in the prepared message.
+  void Reconnecting(int attempt, int delay_ms);
+
+  /// Prepares and posts a message with the information that the connection
+  /// was reopened.
+  ///
+  /// @param[in] attempt A number of the successful attempt.
+  /// @see kReconnected Main key value in the prepared message.
+  void Reconnected(int attempt);
+
+  /// Prepares and posts a message with the information that reconnecting
+  /// failed and playback stopped.
+  ///
+  /// @see kReconnectFailed Main key value in the prepared message.
+  void ReconnectFailed();
+
+  /// Prepares and posts a message with the utilization of the threads shared
+  /// by all players.
+  ///
+  /// @param[in] stats Statistics of all workers.
+  /// @see kSendWorkerStats Main key value in the prepared message.
+  void SendWorkerStats(const std::vector<WorkerPool::WorkerStats>& stats);
+
+  /// Prepares and posts a message with the information that the player was
+  /// not loaded, since other players use all of the resources.
+  ///
+  /// @see kPlayerRejected Main key value in the prepared message.
+  void PlayerRejected();
+
  private:
   /// Send a provided message by the communication channel.
   ///
@@ -75,7 +152,11 @@ class MessageSender {
   /// @see pp::Instance
   inline void PostMessage(const pp::Var& message);
 
+  /// Set by <code>ForPlayer()</code>, messages carry no player id otherwise.
+  static const int32_t kNoPlayerId = -1;
+
   pp::Instance* instance_;
+  int32_t player_id_;
 };
 
 }  // namespace Communication
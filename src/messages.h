@@ -33,13 +33,18 @@ namespace Communication {
 /// also included in the same<code>VarDictionary</code> object.
 /// Parameters can be found in the values description, each one's
 /// type key identifier and description is provided.
+/// Every message may also carry (int)kKeyPlayerId to address one of several
+/// players, e.g. the tiles of a camera grid; player 0 is used without it.
 /// @see kKeyMessageToPlayer
 enum MessageToPlayer {
-  /// A request to close the player; no additional parameters.
+  /// A request to close the player and release its resources; no
+  /// additional parameters.
   kClosePlayer = 0,
 
   /// A request to load content specified in additional fields and
-  /// prepare the player to play it.
+  /// prepare the player to play it. A player loaded with the same id before
+  /// is closed first. If other players use up the resource budget,
+  /// <code>kPlayerRejected</code> is sent instead.
   /// @param (int)kKeyType A specification of what kind of content have
   ///   to be loaded. The only values accepted for  this parameter are
   ///   the ones defined by <code>ClipEnumType</code>
@@ -51,6 +56,27 @@ enum MessageToPlayer {
   ///   content with external subtitles this field must be filled.
   /// @param (string)kKeyEncoding [optional] A subtitles encoding code.
   ///   If this parameter is not specified then UTF-8 will be used .
+  /// @param (double)kKeyUpdateFrequency [optional] A period of audio level
+  ///   notifications in seconds.
+  /// @param (string)kKeyArloCrtPath [optional] A CA certificate for RTSPS.
+  /// @param (string)kKeyTransport [optional] An RTSP transport: "udp",
+  ///   "tcp", "udp_multicast" or "auto". TCP is used by default.
+  /// @param (bool)kKeyFastStart [optional] If true, streams are configured
+  ///   from the SDP without probing, probing is still used as a fallback.
+  /// @param (bool)kKeyPersistStreamInfo [optional] If true, cached stream
+  ///   parameters of cameras are stored in the persistent file system.
+  /// @param (dictionary)kKeyFfmpegOptions [optional] FFmpeg options, names
+  ///   map to string or number values.
+  /// @param (int)kKeyMaxReconnectAttempts [optional] How many times the
+  ///   stream is reopened after a network error, 10 by default.
+  /// @param (double)kKeyTargetLatency [optional] A live latency in seconds
+  ///   the player catches up to by dropping video, disabled by default.
+  /// @param (string)kKeyCapturePath [optional] A file received packets are
+  ///   captured to. A capture is played with a "replay://<path>" URL.
+  /// @param (bool)kKeyReplayRealtime [optional] If false, a capture is
+  ///   replayed as fast as possible instead of with the original timing.
+  /// @param (int)kKeyPriority [optional] A scheduling priority of the
+  ///   player, 0 by default.
   /// @see Communication::ClipTypeEnum
   kLoadMedia = 1,
 
@@ -68,6 +94,11 @@ enum MessageToPlayer {
   /// @param (int)kKeyHeight A height of the players window.
   kChangeViewRect = 4,
   kMute          =5,
+
+  /// A request to change the scheduling priority of the player, e.g. when
+  /// its tile gets the focus.
+  /// @param (int)kKeyPriority A higher priority goes first, 0 by default.
+  kSetPriority = 6,
 };
 
 /// @enum MessageFromPlayer
@@ -78,6 +109,8 @@ enum MessageToPlayer {
 /// also included in the same<code>VarDictionary</code> object.
 /// Parameters can be found in the values description, each one's
 /// type key identifier and description is provided.
+/// Messages of a player carry its (int)kKeyPlayerId, messages about all
+/// players, e.g. <code>kSendWorkerStats</code>, carry none.
 /// @note Information about all tracks, representations and content duration is
 ///   send right after content loading is finished. Other messages are send
 ///   when accurate event occurs, or related operation have been completed.
@@ -101,8 +134,85 @@ enum MessageFromPlayer {
   /// An information from the player that stream has finished;
   /// no additional parameters.
   kStreamEnded   = 103,
+
+  /// Periodic audio level of all channels, in dB over one step of 16-bit
+  /// audio: 0 for silence up to 90.31 for a full scale signal.
+  /// @param (double)kKeyAudioLevel The RMS level, averaged.
+  /// @param (double)kKeyAudioPeak The peak since the previous message.
   kSetAudioLevel = 104,
   kSendStats     = 105,
+
+  /// Periodic counters of the packet pipeline inside the player.
+  /// @param (int)kKeyRingOccupancy Packets waiting for the player thread.
+  /// @param (int)kKeyRingHighWatermark The highest ring occupancy so far.
+  /// @param (int)kKeyRingOverruns Packets dropped because the ring was full.
+  /// @param (int)kKeyRingDroppedGops Video GOPs cut short by a full ring.
+  /// @param (int)kKeyVideoBufferedBytes Video bytes held back by the player.
+  /// @param (int)kKeyVideoBufferedPackets Video packets held back by the player.
+  /// @param (int)kKeyVideoDroppedPackets Video packets dropped on overflow.
+  /// @param (int)kKeyVideoDroppedGops Video GOPs dropped on overflow.
+  /// @param (int)kKeyAudioBufferedBytes Audio bytes held back by the player.
+  /// @param (int)kKeyAudioBufferedPackets Audio packets held back by the player.
+  /// @param (int)kKeyAudioDroppedPackets Audio packets dropped on overflow.
+  /// @param (int)kKeyEsPackets ES packets created since playback start.
+  /// @param (int)kKeyEsPacketAllocations Heap allocations made for them.
+  /// @param (int)kKeyLatencyMs Duration buffered by the player.
+  /// @param (int)kKeyLatencyDroppedFrames Video frames dropped to keep the
+  ///   target latency.
+  /// @param (int)kKeyAudioQueueOccupancy Packets waiting for the audio thread.
+  /// @param (int)kKeyAudioQueueOverruns Audio packets dropped because the
+  ///   audio thread fell behind.
+  /// @param (int)kKeyAudioQueueWaitUs Average and
+  ///   (int)kKeyAudioQueueWaitMaxUs maximum microseconds audio packets waited
+  ///   for the audio thread since the previous message.
+  /// @param (int)kKeyAudioConvertUs Average and (int)kKeyAudioConvertMaxUs
+  ///   maximum microseconds spent converting an audio packet.
+  /// @param (int)kKeyAudioHandoffUs Average and (int)kKeyAudioHandoffMaxUs
+  ///   maximum microseconds converted audio waited for the player thread.
+  kSendPipelineStats = 106,
+
+  /// An information from the player that the stream configuration differs
+  /// from the cached one playback was started with. The cache entry is
+  /// dropped, so loading the media again probes the stream; no additional
+  /// parameters.
+  kStreamConfigChanged = 107,
+
+  /// An information from the player which RTSP transport is used.
+  /// @param (string)kKeyTransport "udp", "tcp" or "udp_multicast".
+  kTransportSelected = 108,
+
+  /// An information from the player that streaming was stopped and the
+  /// connection to the camera closed.
+  /// @param (int)kKeyTeardownMs Time it took in milliseconds.
+  kTeardownCompleted = 109,
+
+  /// An information from the player that the connection to the camera was
+  /// lost and it will be reopened.
+  /// @param (int)kKeyAttempt A number of the attempt, starting from 1.
+  /// @param (int)kKeyDelayMs Time in milliseconds before the attempt.
+  kReconnecting = 110,
+
+  /// An information from the player that the connection was reopened and
+  /// playback continues with the same streams.
+  /// @param (int)kKeyAttempt A number of the successful attempt.
+  kReconnected = 111,
+
+  /// An information from the player that the connection could not be
+  /// reopened and playback stopped; no additional parameters.
+  kReconnectFailed = 112,
+
+  /// Periodic utilization of the threads shared by all players.
+  /// @param (dictionary)kKeyWorkers Maps worker names, "io0", "io1", ...
+  ///   for I/O workers and "cpu0", ... for processing ones, to dictionaries
+  ///   with (int)kKeyUtilization, the percentage of the last second spent
+  ///   running work, (int)kKeyTasks, the number of callbacks run, and
+  ///   (int)kKeyMaxTaskUs, the longest of them in microseconds.
+  kSendWorkerStats = 113,
+
+  /// An information from the player that it was not loaded, since all
+  /// decoder slots of the resource budget are taken by other players; no
+  /// additional parameters. Closing another player frees one.
+  kPlayerRejected = 114,
 };
 
 /// @enum ClipTypeEnum
@@ -131,6 +241,11 @@ const std::string kKeyMessageToPlayer = "messageToPlayer";
 /// @see Communication::MessageFromPlayer
 const std::string kKeyMessageFromPlayer = "messageFromPlayer";
 
+/// A string value used in messages as a <code>VarDictionary</code> key.
+/// This key maps to an <code>int</code> type value, an id of the player the
+/// message is addressed to or sent by, chosen by the application.
+const std::string kKeyPlayerId = "player_id";
+
 /// A string value used in messages as a <code>VarDictionary</code> key.
 /// This key maps to an <code>int</code> type value.
 const std::string kKeyBitrate = "bitrate";
@@ -167,6 +282,55 @@ const std::string kKeyUrl = "url";
 const std::string kKeyUpdateFrequency = "audio_level_cb_frequency";
 
 const std::string kKeyArloCrtPath = "crt_path";
+
+/// A string value used in messages as a <code>VarDictionary</code> key.
+/// This key maps to a <code>bool</code> type value.
+const std::string kKeyFastStart = "fast_start";
+
+/// A string value used in messages as a <code>VarDictionary</code> key.
+/// This key maps to a <code>bool</code> type value.
+const std::string kKeyPersistStreamInfo = "persist_stream_info";
+
+/// A string value used in messages as a <code>VarDictionary</code> key.
+/// This key maps to a <code>string</code> type value.
+const std::string kKeyTransport = "transport";
+
+/// A string value used in messages as a <code>VarDictionary</code> key.
+/// This key maps to an <code>int</code> type value.
+const std::string kKeyTeardownMs = "teardown_ms";
+
+/// A string value used in messages as a <code>VarDictionary</code> key.
+/// This key maps to an <code>int</code> type value.
+const std::string kKeyMaxReconnectAttempts = "max_reconnect_attempts";
+
+/// A string value used in messages as a <code>VarDictionary</code> key.
+/// This key maps to an <code>int</code> type value.
+const std::string kKeyAttempt = "attempt";
+
+/// A string value used in messages as a <code>VarDictionary</code> key.
+/// This key maps to an <code>int</code> type value.
+const std::string kKeyDelayMs = "delay_ms";
+
+/// A string value used in messages as a <code>VarDictionary</code> key.
+/// This key maps to a <code>double</code> type value.
+const std::string kKeyTargetLatency = "target_latency";
+
+/// A string value used in messages as a <code>VarDictionary</code> key.
+/// This key maps to a <code>dictionary</code> type value.
+const std::string kKeyFfmpegOptions = "ffmpeg_options";
+
+/// A string value used in messages as a <code>VarDictionary</code> key.
+/// This key maps to a <code>string</code> type value.
+const std::string kKeyCapturePath = "capture_path";
+
+/// A string value used in messages as a <code>VarDictionary</code> key.
+/// This key maps to a <code>bool</code> type value.
+const std::string kKeyReplayRealtime = "replay_realtime";
+
+/// A string value used in messages as a <code>VarDictionary</code> key.
+/// This key maps to an <code>int</code> type value.
+const std::string kKeyPriority = "priority";
+
 /// This key maps to an <code>int</code> type value.
 const std::string kKeyWidth = "width";
 
@@ -183,9 +347,39 @@ const std::string kKeyXCoordination = "x_coordinate";
 const std::string kKeyYCoordination = "y_coordinate";
 
 const std::string kKeyAudioLevel   = "audio_level";
+const std::string kKeyAudioPeak    = "audio_peak";
 const std::string kKeyStatsLost    = "stats_lost";
 const std::string kKeyStatsJitter  = "stats_jitter";
 const std::string kKeyStatsBitrate = "stats_bitrate";
+
+const std::string kKeyRingOccupancy     = "ring_occupancy";
+const std::string kKeyRingHighWatermark = "ring_high_watermark";
+const std::string kKeyRingOverruns      = "ring_overruns";
+const std::string kKeyRingDroppedGops   = "ring_dropped_gops";
+const std::string kKeyVideoBufferedBytes   = "video_buffered_bytes";
+const std::string kKeyVideoBufferedPackets = "video_buffered_packets";
+const std::string kKeyVideoDroppedPackets  = "video_dropped_packets";
+const std::string kKeyVideoDroppedGops     = "video_dropped_gops";
+const std::string kKeyAudioBufferedBytes   = "audio_buffered_bytes";
+const std::string kKeyAudioBufferedPackets = "audio_buffered_packets";
+const std::string kKeyAudioDroppedPackets  = "audio_dropped_packets";
+const std::string kKeyEsPackets            = "es_packets";
+const std::string kKeyEsPacketAllocations  = "es_packet_allocations";
+const std::string kKeyLatencyMs            = "latency_ms";
+const std::string kKeyLatencyDroppedFrames = "latency_dropped_frames";
+const std::string kKeyAudioQueueOccupancy  = "audio_queue_occupancy";
+const std::string kKeyAudioQueueOverruns   = "audio_queue_overruns";
+const std::string kKeyAudioQueueWaitUs     = "audio_queue_wait_us";
+const std::string kKeyAudioQueueWaitMaxUs  = "audio_queue_wait_max_us";
+const std::string kKeyAudioConvertUs       = "audio_convert_us";
+const std::string kKeyAudioConvertMaxUs    = "audio_convert_max_us";
+const std::string kKeyAudioHandoffUs       = "audio_handoff_us";
+const std::string kKeyAudioHandoffMaxUs    = "audio_handoff_max_us";
+
+const std::string kKeyWorkers     = "workers";
+const std::string kKeyUtilization = "utilization";
+const std::string kKeyTasks       = "tasks";
+const std::string kKeyMaxTaskUs   = "max_task_us";
 }  // namespace Communication
 
 #endif  // NATIVE_PLAYER_INC_COMMUNICATOR_MESSAGES_H_
@@ -0,0 +1,117 @@
+#ifndef PACKET_RING_H_
+#define PACKET_RING_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <utility>
+
+/// @file
+/// @brief This file defines the <code>PacketRing</code> class.
+
+/// @class PacketRing
+/// @brief A bounded, lock-free single-producer/single-consumer ring.
+///
+/// All slots are allocated together with the ring, so pushing and popping
+/// never touch the heap. <code>TryPush()</code> may be called from one
+/// (producer) thread only and <code>TryPop()</code> from one (consumer) thread
+/// only. Statistics can be read from any thread.
+///
+/// @tparam T A default constructible and move assignable slot type.
+/// @tparam Capacity A number of slots, it has to be a power of two.
+template <typename T, size_t Capacity>
+class PacketRing {
+	static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+	              "PacketRing capacity has to be a power of two");
+
+	public:
+		PacketRing() : head_(0), tail_(0), high_watermark_(0), overruns_(0) {}
+
+		PacketRing(const PacketRing&) = delete;
+		PacketRing& operator=(const PacketRing&) = delete;
+
+		/// Moves <code>item</code> into the next free slot. Producer side only.
+		///
+		/// @param[in] item An item to be queued. It is left untouched if the ring
+		///   is full.
+		/// @return True if the item was queued.\n False if the ring was full, in
+		///   which case the overrun counter is incremented.
+		bool TryPush(T&& item) {
+			const size_t tail = tail_.load(std::memory_order_relaxed);
+			const size_t head = head_.load(std::memory_order_acquire);
+			if (tail - head == Capacity) {
+				overruns_.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+
+			slots_[tail & kMask] = std::move(item);
+			tail_.store(tail + 1, std::memory_order_release);
+
+			const size_t occupancy = tail + 1 - head;
+			if (occupancy > high_watermark_.load(std::memory_order_relaxed))
+				high_watermark_.store(occupancy, std::memory_order_relaxed);
+			return true;
+		}
+
+		/// Moves the oldest queued item out of the ring. Consumer side only.
+		///
+		/// @param[out] item A destination for the dequeued item.
+		/// @return True if an item was dequeued.\n False if the ring was empty.
+		bool TryPop(T* item) {
+			const size_t head = head_.load(std::memory_order_relaxed);
+			const size_t tail = tail_.load(std::memory_order_acquire);
+			if (head == tail)
+				return false;
+
+			*item = std::move(slots_[head & kMask]);
+			head_.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+		/// Returns the oldest queued item without dequeuing it. Consumer side
+		/// only.
+		///
+		/// @return NULL if the ring is empty.
+		const T* Peek() const {
+			const size_t head = head_.load(std::memory_order_relaxed);
+			const size_t tail = tail_.load(std::memory_order_acquire);
+			return head == tail ? NULL : &slots_[head & kMask];
+		}
+
+		/// Returns true if there is nothing to pop at the moment.
+		bool Empty() const { return Size() == 0; }
+
+		/// Returns the number of currently queued items.
+		size_t Size() const {
+			return tail_.load(std::memory_order_acquire) -
+			       head_.load(std::memory_order_acquire);
+		}
+
+		/// Returns the number of slots.
+		static constexpr size_t GetCapacity() { return Capacity; }
+
+		/// Returns the highest occupancy the ring has reached so far.
+		size_t HighWatermark() const {
+			return high_watermark_.load(std::memory_order_relaxed);
+		}
+
+		/// Returns the number of items rejected because the ring was full.
+		uint32_t Overruns() const {
+			return overruns_.load(std::memory_order_relaxed);
+		}
+
+	private:
+		static const size_t kMask = Capacity - 1;
+
+		T slots_[Capacity];
+
+		// head_ is written by the consumer and tail_ by the producer only. Both
+		// grow monotonically, slot indices are taken modulo Capacity.
+		std::atomic<size_t> head_;
+		std::atomic<size_t> tail_;
+		std::atomic<size_t> high_watermark_;
+		std::atomic<uint32_t> overruns_;
+};
+
+#endif  // PACKET_RING_H_
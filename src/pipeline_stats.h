@@ -0,0 +1,101 @@
+#ifndef PIPELINE_STATS_H_
+#define PIPELINE_STATS_H_
+
+#include <stdint.h>
+
+/// @file
+/// @brief This file defines the <code>PipelineStats</code> structure.
+
+/// @struct PipelineStats
+/// @brief A snapshot of counters describing the path of elementary stream
+/// packets from the demuxer to NaCl Player.
+///
+/// It is filled by the player controller and sent periodically through the
+/// communication channel.
+/// @see Communication::MessageSender::SendPipelineStats()
+struct PipelineStats {
+  PipelineStats()
+      : ring_occupancy(0),
+        ring_high_watermark(0),
+        ring_overruns(0),
+        ring_dropped_gops(0),
+        video_buffered_bytes(0),
+        video_buffered_packets(0),
+        video_dropped_packets(0),
+        video_dropped_gops(0),
+        audio_buffered_bytes(0),
+        audio_buffered_packets(0),
+        audio_dropped_packets(0),
+        es_packets(0),
+        es_packet_allocations(0),
+        latency_ms(0),
+        latency_dropped_frames(0),
+        audio_queue_occupancy(0),
+        audio_queue_overruns(0),
+        audio_queue_wait_us(0),
+        audio_queue_wait_max_us(0),
+        audio_convert_us(0),
+        audio_convert_max_us(0),
+        audio_handoff_us(0),
+        audio_handoff_max_us(0) {}
+
+  /// A number of packets waiting in the parser to player ring.
+  uint32_t ring_occupancy;
+
+  /// The highest number of packets the ring has held since playback start.
+  uint32_t ring_high_watermark;
+
+  /// A number of packets dropped because the ring was full.
+  uint32_t ring_overruns;
+
+  /// Video GOPs cut short by a full ring, the pictures up to the next
+  /// keyframe are dropped with the one which didn't fit.
+  uint32_t ring_dropped_gops;
+
+  /// Bytes and packets of video held back while the player has enough data.
+  uint32_t video_buffered_bytes;
+  uint32_t video_buffered_packets;
+
+  /// Video packets dropped because the buffer overflowed, and the number of
+  /// GOPs they made up.
+  uint32_t video_dropped_packets;
+  uint32_t video_dropped_gops;
+
+  /// Bytes and packets of audio held back while the player has enough data.
+  uint32_t audio_buffered_bytes;
+  uint32_t audio_buffered_packets;
+
+  /// Audio packets dropped because the buffer overflowed.
+  uint32_t audio_dropped_packets;
+
+  /// A number of ES packets created since playback start.
+  uint32_t es_packets;
+
+  /// Heap allocations made for ES packets since playback start. It stops
+  /// growing once the packet pools are warmed up.
+  uint32_t es_packet_allocations;
+
+  /// A duration buffered by NaCl Player, i.e. the PTS of the last appended
+  /// packet minus the playback position.
+  uint32_t latency_ms;
+
+  /// Video frames dropped to keep the target latency since playback start.
+  uint32_t latency_dropped_frames;
+
+  /// Audio packets waiting for the audio thread, and the number dropped
+  /// because it fell behind.
+  uint32_t audio_queue_occupancy;
+  uint32_t audio_queue_overruns;
+
+  /// Average and maximum time in microseconds since the previous snapshot
+  /// which audio packets spent waiting for the audio thread, being converted
+  /// on it and waiting for the player thread afterwards.
+  uint32_t audio_queue_wait_us;
+  uint32_t audio_queue_wait_max_us;
+  uint32_t audio_convert_us;
+  uint32_t audio_convert_max_us;
+  uint32_t audio_handoff_us;
+  uint32_t audio_handoff_max_us;
+};
+
+#endif  // PIPELINE_STATS_H_
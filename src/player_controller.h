@@ -10,13 +10,83 @@
 #ifndef NATIVE_PLAYER_INC_PLAYER_PLAYER_CONROLLER_H_
 #define NATIVE_PLAYER_INC_PLAYER_PLAYER_CONROLLER_H_
 
+#include <map>
+#include <string>
 #include <vector>
 
 #include "common.h"
 #include "nacl_player/media_common.h"
 
 /// @file
-/// @brief This file defines the <code>PlayerController</code> class.
+/// @brief This file defines the <code>PlayerController</code> class and
+/// the <code>PlayerOptions</code> structure.
+
+/// @struct PlayerOptions
+/// @brief Playback options given by the application in a
+/// <code>kLoadMedia</code> message.
+/// @see Communication::MessageToPlayer::kLoadMedia
+struct PlayerOptions {
+  PlayerOptions()
+      : audio_level_cb_frequency(0),
+        transport("tcp"),
+        fast_start(false),
+        persist_stream_info(false),
+        max_reconnect_attempts(10),
+        target_latency(0),
+        replay_realtime(true),
+        priority(0),
+        max_buffered_bytes(0) {}
+
+  /// A period of audio level notifications in seconds, 0 disables them.
+  double audio_level_cb_frequency;
+
+  /// A path of the CA certificate used to verify RTSPS servers.
+  std::string crt_path;
+
+  /// An RTSP transport: "udp", "tcp", "udp_multicast" or "auto", which tries
+  /// UDP first and falls back to TCP.
+  std::string transport;
+
+  /// If true, streams are configured from the SDP and in-band parameter
+  /// sets instead of probing the first packets.
+  bool fast_start;
+
+  /// If true, the stream info cache is stored in the persistent file system,
+  /// so it survives application restarts.
+  bool persist_stream_info;
+
+  /// How many times the stream is reopened after a network error before
+  /// playback is given up, 0 disables reconnecting.
+  int max_reconnect_attempts;
+
+  /// A live latency in seconds the player catches up to by dropping video,
+  /// 0 disables catching up.
+  double target_latency;
+
+  /// FFmpeg demuxer and RTSP options, e.g. "max_delay" or "buffer_size",
+  /// passed to <code>avformat_open_input()</code>. Only allow-listed names are
+  /// used.
+  std::map<std::string, std::string> ffmpeg_options;
+
+  /// A file the packets received from the camera are written to, so the
+  /// session can be replayed later, empty disables capturing.
+  std::string capture_path;
+
+  /// If true, a capture given as a "replay://<path>" URL is fed to the player
+  /// with the original packet timing, otherwise as fast as the player takes
+  /// it.
+  bool replay_realtime;
+
+  /// A scheduling priority of the player's work on the threads shared by all
+  /// players, a higher one goes first, e.g. for the focused camera.
+  int priority;
+
+  /// A limit of bytes the player holds back for both streams while NaCl
+  /// Player does not need data, 0 for the player's own. Not sent by the
+  /// application, <code>PlayerProvider</code> sets it from the resource
+  /// budget.
+  size_t max_buffered_bytes;
+};
 
 /// @class PlayerController
 /// @brief It is a definition of the player controlling interface.
@@ -62,6 +132,18 @@ class PlayerController {
   /// @param[in] view_rect A size and position of a player display area.
   virtual void SetViewRect(const Samsung::NaClPlayer::Rect& view_rect) = 0;
 
+  /// Sets a scheduling priority of the player's work on the threads shared
+  /// by all players. It is ignored by default.
+  ///
+  /// @param[in] priority A higher priority goes first.
+  virtual void SetPriority(int /*priority*/) {}
+
+  /// Informs the controller about a playback progress reported by the
+  /// player. It is ignored by default.
+  ///
+  /// @param[in] time Current playback time.
+  virtual void OnTimeUpdate(Samsung::NaClPlayer::TimeTicks /*time*/) {}
+
   /// Provides information about <code>PlayerController</code> state.
   /// @return A current state of the player.
   virtual PlayerState GetState() = 0;
@@ -16,6 +16,9 @@ void MediaPlayerListener::OnTimeUpdate(TimeTicks time) {
   if (auto message_sender = message_sender_.lock()) {
     message_sender->CurrentTimeUpdate(time);
   }
+  if (auto player_controller = player_controller_.lock()) {
+    player_controller->OnTimeUpdate(time);
+  }
 }
 
 void MediaPlayerListener::OnEnded() {
@@ -32,9 +32,13 @@ class MediaPlayerListener : public Samsung::NaClPlayer::MediaEventsListener {
   ///
   /// @param[in] message_sender An object which will be used to send messages
   ///   based on received subtitle events through the communication channel
+  /// @param[in] player_controller A handler to a controller, which will be
+  ///   informed about the playback progress.
   explicit MediaPlayerListener(
-      std::weak_ptr<Communication::MessageSender> message_sender)
-      : message_sender_(std::move(message_sender)) {}
+      std::weak_ptr<Communication::MessageSender> message_sender,
+      std::weak_ptr<PlayerController> player_controller = {})
+      : message_sender_(std::move(message_sender)),
+        player_controller_(std::move(player_controller)) {}
 
   /// An event handler method, called periodically during clip playback and
   /// indicates a playback progress. <code>MediaPlayerListener</code> passes
@@ -58,6 +62,7 @@ class MediaPlayerListener : public Samsung::NaClPlayer::MediaEventsListener {
 
  private:
   std::weak_ptr<Communication::MessageSender> message_sender_;
+  std::weak_ptr<PlayerController> player_controller_;
 };
 
 /// @class MediaBufferingListener
@@ -13,17 +13,59 @@
 
 using Samsung::NaClPlayer::Rect;
 
+namespace {
+
+/// Keeps the resources of a player reserved until the controller is gone.
+struct BudgetedPlayer {
+  // The reservation is declared first, so it outlives the controller.
+  std::unique_ptr<ResourceBudget::Reservation> reservation;
+  std::shared_ptr<RTSPPlayerController> controller;
+};
+
+}  // namespace
+
+PlayerProvider::PlayerProvider(const pp::InstanceHandle& instance,
+    std::shared_ptr<Communication::MessageSender> message_sender,
+    const ResourceBudget::Limits& limits)
+    : instance_(instance), message_sender_((std::move(message_sender))),
+      budget_(std::make_shared<ResourceBudget>(limits)),
+      stream_info_cache_(std::make_shared<StreamInfoCache>()),
+      worker_pool_(std::make_shared<WorkerPool>(instance, limits.io_workers,
+                                                limits.processing_workers)) {
+  std::shared_ptr<Communication::MessageSender> sender = message_sender_;
+  worker_pool_->SetStatsListener(
+      [sender](const std::vector<WorkerPool::WorkerStats>& stats) {
+        sender->SendWorkerStats(stats);
+      });
+}
+
 std::shared_ptr<PlayerController> PlayerProvider::CreatePlayer(
-                    PlayerType type, const Samsung::NaClPlayer::Rect view_rect,
-                    const std::string& url, const double& audio_level_cb_frequency,
-                    const std::string& crt_path) {
+                    PlayerType type, int32_t player_id,
+                    const Samsung::NaClPlayer::Rect view_rect,
+                    const std::string& url, const PlayerOptions& options) {
+  std::shared_ptr<Communication::MessageSender> sender =
+      message_sender_->ForPlayer(player_id);
   switch (type) {
     case kRTSP: {
-      std::shared_ptr<RTSPPlayerController> controller =
-          std::make_shared<RTSPPlayerController>(instance_, message_sender_);
-      controller->SetViewRect(view_rect);
-      controller->InitPlayer(url, audio_level_cb_frequency, crt_path);
-      return controller;
+      auto player = std::make_shared<BudgetedPlayer>();
+      player->reservation = ResourceBudget::Reserve(
+          budget_, RTSPPlayerController::GetDefaultBufferedBytes());
+      if (!player->reservation) {
+        Logger::Error("No resources left for player %d", player_id);
+        sender->PlayerRejected();
+        return nullptr;
+      }
+
+      PlayerOptions budgeted_options = options;
+      budgeted_options.max_buffered_bytes =
+          player->reservation->GetBufferedBytes();
+      player->controller = std::make_shared<RTSPPlayerController>(
+          instance_, sender, stream_info_cache_, worker_pool_);
+      player->controller->SetViewRect(view_rect);
+      player->controller->InitPlayer(url, budgeted_options);
+      // Releasing the returned pointer releases the reservation as well.
+      return std::shared_ptr<PlayerController>(player,
+                                               player->controller.get());
     }
     default:
       Logger::Error("Not known type of player %d", type);
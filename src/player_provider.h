@@ -17,6 +17,9 @@
 #include "common.h"
 #include "player_controller.h"
 #include "message_sender.h"
+#include "resource_budget.h"
+#include "stream_info_cache.h"
+#include "worker_pool.h"
 
 /// @file
 /// @brief This file defines <code>PlayerProvider</code> class.
@@ -29,6 +32,9 @@
 /// have a different initialization procedure. This class encapsulates it,
 /// provided player controller is already initialized and ready to play the
 /// content.
+///
+/// All players it creates share its <code>ResourceBudget</code>: each holds a
+/// decoder slot and a share of the buffered bytes as long as it exists.
 
 class PlayerProvider {
  public:
@@ -47,11 +53,12 @@ class PlayerProvider {
   /// @param[in] instance A handle to main plugin instance.
   /// @param[in] message_sender A class which will be used by the player to
   ///   post messages through the communication channel.
+  /// @param[in] limits Resources all players may use together.
   /// @see pp::Instance
   /// @see Communication::MessageSender
   explicit PlayerProvider(const pp::InstanceHandle& instance,
-      std::shared_ptr<Communication::MessageSender> message_sender)
-      : instance_(instance), message_sender_((std::move(message_sender))) {}
+      std::shared_ptr<Communication::MessageSender> message_sender,
+      const ResourceBudget::Limits& limits = ResourceBudget::Limits());
 
   /// Destroys a <code>PlayerProvider</code> object. Created
   /// <code>PlayerController</code> objects will not be destroyed.
@@ -62,27 +69,37 @@ class PlayerProvider {
   /// main method of this class.
   ///
   /// @param[in] type A type of the player controller which is needed.
+  /// @param[in] player_id An id of the player chosen by the application, its
+  ///   messages carry it.
   /// @param[in] url A URL address to a file which the player controller
   ///   should use for getting the content. This parameter could point to
   ///   different file types depending on the <code>type</code> parameter.
   ///   Check <code>PlayerType</code> for more information about supported
   ///   formats.
   /// @param[in] view_rect A position and size of the player window.
-  /// @param[in] subtitle A URL address to an external subtitles file. It is
-  ///   an optional parameter, if is not provided then external subtitles
-  ///   are not be available.
-  /// @param[in] encoding A code of subtitles formating. It is an optional
-  ///   parameter, if is not specified then UTF-8 is used.
-  /// @return A configured and initialized <code>PlayerController<code>.
+  /// @param[in] options Playback options given by the application.
+  /// @return A configured and initialized <code>PlayerController<code>, NULL
+  ///   if the resource budget is used up, which the application is told with
+  ///   <code>kPlayerRejected</code>.
   std::shared_ptr<PlayerController> CreatePlayer(PlayerType type,
+                                     int32_t player_id,
                                      const Samsung::NaClPlayer::Rect view_rect,
                                      const std::string& url,
-                                     const double& audio_level_cb_frequency,
-                                     const std::string& crt_path);
+                                     const PlayerOptions& options);
+
+  /// Returns the budget shared by the created players.
+  std::shared_ptr<const ResourceBudget> GetResourceBudget() const {
+    return budget_;
+  }
 
  private:
   pp::InstanceHandle instance_;
   std::shared_ptr<Communication::MessageSender> message_sender_;
+
+  // Shared by all created players, so they outlive them.
+  std::shared_ptr<ResourceBudget> budget_;
+  std::shared_ptr<StreamInfoCache> stream_info_cache_;
+  std::shared_ptr<WorkerPool> worker_pool_;
 };
 
 #endif  // NATIVE_PLAYER_INC_PLAYER_PLAYER_PROVIDER_H_
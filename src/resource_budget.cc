@@ -0,0 +1,71 @@
+#include "resource_budget.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "common.h"
+#include "worker_pool.h"
+
+using pp::AutoLock;
+
+/// Enough for a 3x3 grid, lower it for TVs which decode fewer streams.
+static const uint32_t kDefaultDecoderSlots = 9;
+static const size_t kDefaultBufferedBytes = 24 * 1024 * 1024;
+
+ResourceBudget::Limits::Limits()
+	: io_workers(WorkerPool::kDefaultIoWorkers),
+	  processing_workers(WorkerPool::kDefaultProcessingWorkers),
+	  buffered_bytes(kDefaultBufferedBytes),
+	  decoder_slots(kDefaultDecoderSlots) {}
+
+ResourceBudget::Reservation::Reservation(std::shared_ptr<ResourceBudget> budget,
+                                         size_t buffered_bytes)
+	: budget_(std::move(budget)), buffered_bytes_(buffered_bytes) {}
+
+ResourceBudget::Reservation::~Reservation() {
+	budget_->Release(buffered_bytes_);
+}
+
+ResourceBudget::ResourceBudget(const Limits& limits)
+	: limits_(limits), used_slots_(0), used_bytes_(0) {}
+
+std::unique_ptr<ResourceBudget::Reservation> ResourceBudget::Reserve(
+    const std::shared_ptr<ResourceBudget>& budget, size_t buffered_bytes) {
+	AutoLock critical_section(budget->lock_);
+	const Limits& limits = budget->limits_;
+	if (budget->used_slots_ >= limits.decoder_slots) {
+		LOG_ERROR("All %u decoder slots are taken", limits.decoder_slots);
+		return std::unique_ptr<Reservation>();
+	}
+
+	// Every other free slot keeps its minimum, which the budget always
+	// leaves, so the grant is never 0.
+	size_t floor = limits.buffered_bytes / limits.decoder_slots;
+	if (floor > kMinPlayerBufferedBytes)
+		floor = kMinPlayerBufferedBytes;
+	uint32_t other_free_slots = limits.decoder_slots - budget->used_slots_ - 1;
+	size_t available = limits.buffered_bytes - budget->used_bytes_ -
+	                   other_free_slots * floor;
+	size_t granted = std::min(buffered_bytes, available);
+
+	budget->used_slots_++;
+	budget->used_bytes_ += granted;
+	LOG_INFO("Reserved decoder slot %u of %u and %u buffered bytes",
+	         budget->used_slots_, limits.decoder_slots,
+	         static_cast<uint32_t>(granted));
+	return std::unique_ptr<Reservation>(new Reservation(budget, granted));
+}
+
+ResourceBudget::Usage ResourceBudget::GetUsage() const {
+	AutoLock critical_section(lock_);
+	Usage usage;
+	usage.decoder_slots = used_slots_;
+	usage.buffered_bytes = used_bytes_;
+	return usage;
+}
+
+void ResourceBudget::Release(size_t buffered_bytes) {
+	AutoLock critical_section(lock_);
+	used_slots_--;
+	used_bytes_ -= buffered_bytes;
+}
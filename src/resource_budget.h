@@ -0,0 +1,104 @@
+#ifndef RESOURCE_BUDGET_H_
+#define RESOURCE_BUDGET_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+
+#include "ppapi/utility/threading/lock.h"
+
+/// @file
+/// @brief This file defines the <code>ResourceBudget</code> class.
+
+/// @class ResourceBudget
+/// @brief Limits of what all players of the module may use together.
+///
+/// Threads are bounded by the shared <code>WorkerPool</code>, which starts
+/// with the workers taken from the limits. It only adds I/O workers while all
+/// of them are blocked, and each player blocks one at the most, so the
+/// decoder slots bound those too. Every player holds one decoder slot, since
+/// NaCl Player only decodes so many streams at once, and a share of the bytes
+/// the players hold back while NaCl Player does not need data. A player gets
+/// the bytes it asks for as long as every free slot keeps at least
+/// <code>kMinPlayerBufferedBytes</code>, so the last tiles of a grid still
+/// get a usable buffer.
+///
+/// This class is thread safe.
+class ResourceBudget {
+	public:
+		/// @struct Limits
+		/// Resources shared by all players.
+		struct Limits {
+			Limits();
+
+			/// Threads the worker pool starts with, see <code>WorkerPool</code>.
+			uint32_t io_workers;
+			uint32_t processing_workers;
+			/// Bytes all players may hold back together.
+			size_t buffered_bytes;
+			/// Players which may play at the same time.
+			uint32_t decoder_slots;
+		};
+
+		/// @struct Usage
+		/// Resources reserved by the players which exist now.
+		struct Usage {
+			uint32_t decoder_slots;
+			size_t buffered_bytes;
+		};
+
+		/// The smallest share of buffered bytes a player starts with, a few
+		/// seconds of a typical camera stream.
+		static const size_t kMinPlayerBufferedBytes = 1024 * 1024;
+
+		/// @class Reservation
+		/// @brief Resources held by one player, released on destruction.
+		class Reservation {
+			public:
+				~Reservation();
+
+				Reservation(const Reservation&) = delete;
+				Reservation& operator=(const Reservation&) = delete;
+
+				/// Returns the bytes the player may buffer.
+				size_t GetBufferedBytes() const { return buffered_bytes_; }
+
+			private:
+				friend class ResourceBudget;
+
+				Reservation(std::shared_ptr<ResourceBudget> budget, size_t buffered_bytes);
+
+				std::shared_ptr<ResourceBudget> budget_;
+				size_t buffered_bytes_;
+		};
+
+		explicit ResourceBudget(const Limits& limits);
+
+		ResourceBudget(const ResourceBudget&) = delete;
+		ResourceBudget& operator=(const ResourceBudget&) = delete;
+
+		/// Reserves a decoder slot and up to <code>buffered_bytes</code> for a
+		/// new player.
+		///
+		/// @param[in] budget The budget itself, reservations keep it alive.
+		/// @param[in] buffered_bytes Bytes the player would like to buffer.
+		/// @return NULL if all decoder slots are taken.
+		static std::unique_ptr<Reservation> Reserve(
+		    const std::shared_ptr<ResourceBudget>& budget, size_t buffered_bytes);
+
+		const Limits& GetLimits() const { return limits_; }
+
+		Usage GetUsage() const;
+
+	private:
+		void Release(size_t buffered_bytes);
+
+		const Limits limits_;
+
+		mutable pp::Lock lock_;
+		uint32_t used_slots_;
+		size_t used_bytes_;
+};
+
+#endif  // RESOURCE_BUDGET_H_
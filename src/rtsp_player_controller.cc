@@ -1,7 +1,10 @@
+#include <algorithm>
 #include <functional>
 #include <limits>
 #include <utility>
+#include <string.h>
 #include <sys/time.h>
+#include <unistd.h>
 
 #include "ppapi/cpp/var_dictionary.h"
 #include "ppapi/cpp/instance.h"
@@ -9,6 +12,9 @@
 #include "nacl_player/es_data_source.h"
 #include "nacl_player/elementary_stream_listener.h"
 #include "rtsp_player_controller.h"
+#include "audio_level_meter.h"
+#include "codec_config_parser.h"
+#include "g711.h"
 #include "transcode_utils.h"
 
 using Samsung::NaClPlayer::ErrorCodes;
@@ -25,13 +31,56 @@ using std::make_shared;
 using std::placeholders::_1;
 using std::shared_ptr;
 using std::unique_ptr;
-using pp::AutoLock;
 
 
 static const uint32_t kMicrosecondsPerSecond = 1000000;
 static const uint32_t kVideoStreamProbeSize = 32;
+static const uint32_t kFirstPacketTimeoutMs = 2000;
+// Limits of blocking network operations, so an unreachable camera can't
+// stall the shared workers.
+static const uint32_t kConnectTimeoutMs = 10000;
+static const uint32_t kProbeTimeoutMs = 10000;
+static const uint32_t kReadTimeoutMs = 5000;
+// Closing the input sends RTSP TEARDOWN, which is not worth waiting for long.
+static const uint32_t kCloseTimeoutMs = 500;
+// Reconnect attempts are spread by an exponential backoff with jitter, so
+// players of many cameras don't hammer a recovering network all at once.
+static const uint32_t kReconnectInitialDelayMs = 500;
+static const uint32_t kReconnectMaxDelayMs = 30000;
+static const char* kTransportUDP = "udp";
+static const char* kTransportTCP = "tcp";
+static const char* kTransportUDPMulticast = "udp_multicast";
+static const char* kTransportAuto = "auto";
+/// Prefixes the path of a capture file which is played instead of a camera.
+static const char* kReplayScheme = "replay://";
+
+// FFmpeg options the application may set, format context options first and
+// RTSP demuxer options next.
+static const char* kAllowedFfmpegOptions[] = {
+	"analyzeduration", "fflags", "fpsprobesize", "max_delay", "probesize",
+	"allowed_media_types", "buffer_size", "max_port", "min_port",
+	"reorder_queue_size", "rtsp_flags", "stimeout", "user_agent",
+};
+
+static bool IsAllowedFfmpegOption(const std::string& name) {
+	for (const char* allowed : kAllowedFfmpegOptions) {
+		if (name == allowed)
+			return true;
+	}
+	return false;
+}
+
+static const uint32_t kMaxDrainBatch = 32;
+// Parsing gives the I/O worker up after a slice, so cameras sharing it take
+// turns.
+static const uint32_t kMaxParseBatch = 32;
+static const uint64_t kParseSliceUs = 20000;
+static const int64_t kRingFullRetryMs = 1;
 static const TimeTicks kOneMicrosecond = 1.0 / kMicrosecondsPerSecond;
 static const AVRational kMicrosBase = {1, kMicrosecondsPerSecond};
+/// Passed through audio is decoded for metering only this long before each
+/// level report.
+static const TimeTicks kAudioMeterWindow = 0.1;
 
 static TimeTicks ToTimeTicks(int64_t time_ticks, AVRational time_base) {
 	int64_t us = av_rescale_q(time_ticks, time_base, kMicrosBase);
@@ -48,33 +97,19 @@ static inline uint64_t nowms() {
 	return tv2ms(&tv);
 }
 
-enum MediaType { kVideoType, kAudioType };
-static pp::Lock packets_lock_;
-static pp::Lock mute_lock_;
-
 class ESListener : public Samsung::NaClPlayer::ElementaryStreamListener {
 	public:
-		ESListener(RTSPPlayerController *controller, MediaType media_type) {
+		ESListener(RTSPPlayerController *controller, StreamType stream_type) {
 			controller_ = controller;
-			media_type_ = media_type;
+			stream_type_ = stream_type;
 		}
 
 		void OnNeedData(int32_t bytes_max) {
-			AutoLock critical_section(packets_lock_);
-			if (media_type_ == kVideoType) {
-				controller_->need_video_data_ = true;
-			} else if (media_type_ == kAudioType) {
-				controller_->need_audio_data_ = true;
-			}
+			controller_->OnNeedData(stream_type_, bytes_max);
 		}
 
 		void OnEnoughData() {
-			AutoLock critical_section(packets_lock_);
-			if (media_type_ == kVideoType) {
-				controller_->need_video_data_ = false;
-			} else if (media_type_ == kAudioType) {
-				controller_->need_audio_data_ = false;
-			}
+			controller_->OnEnoughData(stream_type_);
 		}
 
 		void OnSeekData(Samsung::NaClPlayer::TimeTicks new_position) {
@@ -82,7 +117,7 @@ class ESListener : public Samsung::NaClPlayer::ElementaryStreamListener {
 		}
 	private:
 		RTSPPlayerController* controller_;
-		MediaType media_type_;
+		StreamType stream_type_;
 };
 
 void av_log_callback(void *ptr, int level, const char *fmt, va_list vargs) {
@@ -93,14 +128,23 @@ void av_log_callback(void *ptr, int level, const char *fmt, va_list vargs) {
 	}
 }
 
-void RTSPPlayerController::InitPlayer(const std::string& url, const double& audio_level_cb_frequency,
-                                      const std::string& crt_path) {
+void RTSPPlayerController::InitPlayer(const std::string& url,
+                                      const PlayerOptions& options) {
 	LOG_INFO("Loading media from: '%s'", url.c_str());
 	CleanPlayer();
+	cancellation_token_.Reset();
+	is_parsing_finished_ = false;
+	timestamp_offset_ = 0;
+	rebase_timestamps_ = false;
+	rebase_on_key_frame_ = false;
+	video_timeline_.Reset();
+	audio_timeline_.Reset();
+	latency_controller_.Reset(options.target_latency);
+	reconnect_rng_.seed(static_cast<uint32_t>(nowms()));
 
 	player_ = make_shared<MediaPlayer>();
 	listeners_.player_listener =
-	    make_shared<MediaPlayerListener>(message_sender_);
+	    make_shared<MediaPlayerListener>(message_sender_, shared_from_this());
 	listeners_.buffering_listener =
 	    make_shared<MediaBufferingListener>(message_sender_, shared_from_this());
 
@@ -114,42 +158,88 @@ void RTSPPlayerController::InitPlayer(const std::string& url, const double& audi
 		          ret);
 	}
 
-	player_thread_ = MakeUnique<pp::SimpleThread>(instance_);
-	parser_thread_ = MakeUnique<pp::SimpleThread>(instance_);
-	player_thread_->Start();
+	// Both streams keep their share of the default limits. No strand runs
+	// yet, so the buffers can be changed here.
+	size_t video_max_bytes = kVideoBufferMaxBytes;
+	size_t audio_max_bytes = kAudioBufferMaxBytes;
+	if (options.max_buffered_bytes) {
+		uint64_t total = GetDefaultBufferedBytes();
+		uint64_t max_bytes = options.max_buffered_bytes;
+		video_max_bytes = kVideoBufferMaxBytes * max_bytes / total;
+		audio_max_bytes = kAudioBufferMaxBytes * max_bytes / total;
+	}
+	video_buffer_.SetMaxBytes(video_max_bytes);
+	audio_buffer_.SetMaxBytes(audio_max_bytes);
+
+	priority_ = options.priority;
+	io_strand_ = worker_pool_->CreateStrand(WorkerPool::kIo, priority_);
+	{
+		AutoLock critical_section(player_strand_lock_);
+		player_strand_ = worker_pool_->CreateStrand(WorkerPool::kProcessing, priority_);
+	}
+	audio_strand_ = worker_pool_->CreateStrand(WorkerPool::kProcessing, priority_);
 
 	// create media data source
 	auto es_data_source = std::make_shared<ESDataSource>();
 	data_source_ = es_data_source;
 
-	need_video_data_ = false;
-	need_audio_data_ = false;
-	audio_level_cb_frequency_ = audio_level_cb_frequency;
+	options_ = options;
+	url_ = url;
+	if (options_.transport != kTransportUDP && options_.transport != kTransportTCP &&
+	    options_.transport != kTransportUDPMulticast &&
+	    options_.transport != kTransportAuto) {
+		LOG_ERROR("Unknown transport '%s', using TCP", options_.transport.c_str());
+		options_.transport = kTransportTCP;
+	}
+	audio_level_cb_frequency_ = options.audio_level_cb_frequency;
 
-	player_thread_->message_loop().PostWork(cc_factory_.NewCallback(
-	        &RTSPPlayerController::InitializeStreams, url, crt_path));
+	io_strand_->PostWork(cc_factory_.NewCallback(
+	        &RTSPPlayerController::InitializeStreams, url));
 }
 
 void RTSPPlayerController::UpdateAudioConfig() {
 	AVStream* s = format_context_->streams[audio_stream_idx_];
-	if (s->codecpar->codec_id == AV_CODEC_ID_AAC) {
-		is_transcode=false;
-		audio_config_.codec_type = Samsung::NaClPlayer::AUDIOCODEC_TYPE_AAC;
-		audio_config_.codec_profile = ConvertAACAudioCodecProfile(s->codecpar->profile);// Method
-		audio_config_.channel_layout =  ConvertChannelLayout(s->codecpar->channel_layout, s->codecpar->channels); //Method
-		audio_config_.sample_format = ConvertSampleFormat((AVSampleFormat)s->codecpar->format);
-		audio_config_.bits_per_channel = s->codecpar->bits_per_raw_sample / s->codecpar->channels;
-		audio_config_.samples_per_second = s->codecpar->sample_rate ;
-	} else {
-		is_transcode=true;
-		audio_config_.codec_type = Samsung::NaClPlayer::AUDIOCODEC_TYPE_AAC;
-		audio_config_.codec_profile = Samsung::NaClPlayer::AUDIOCODEC_PROFILE_AAC_LOW;
-		audio_config_.channel_layout = Samsung::NaClPlayer::CHANNEL_LAYOUT_MONO;
-		audio_config_.sample_format = Samsung::NaClPlayer::SAMPLEFORMAT_PLANARF32;
-		audio_config_.bits_per_channel = 16; // bitrate divided by sample rate
-		audio_config_.samples_per_second = s->codecpar->sample_rate;
+	audio_output_mode_ = GetAudioOutputMode(s->codecpar);
+	audio_config_.extra_data.clear();
+	switch (audio_output_mode_) {
+		case kAudioPassthrough: {
+			AVCodecID codec_id = s->codecpar->codec_id;
+			audio_config_.codec_type = ConvertAudioCodec(codec_id);
+			audio_config_.codec_profile = codec_id == AV_CODEC_ID_AAC ?
+			                              ConvertAACAudioCodecProfile(s->codecpar->profile) :
+			                              Samsung::NaClPlayer::AUDIOCODEC_PROFILE_UNKNOWN;
+			audio_config_.channel_layout =  ConvertChannelLayout(s->codecpar->channel_layout, s->codecpar->channels); //Method
+			audio_config_.sample_format = ConvertSampleFormat((AVSampleFormat)s->codecpar->format);
+			// PCM codecs have a fixed sample size, compressed ones report 0.
+			int bits_per_sample = av_get_bits_per_sample(codec_id);
+			audio_config_.bits_per_channel = bits_per_sample ? bits_per_sample :
+			                                 s->codecpar->bits_per_raw_sample / s->codecpar->channels;
+			audio_config_.samples_per_second = s->codecpar->sample_rate ;
+			if (s->codecpar->extradata_size > 0)
+				audio_config_.extra_data.assign(s->codecpar->extradata,
+				                                s->codecpar->extradata + s->codecpar->extradata_size);
+			break;
+		}
+		case kAudioPcm:
+			audio_config_.codec_type = Samsung::NaClPlayer::AUDIOCODEC_TYPE_PCM;
+			audio_config_.codec_profile = Samsung::NaClPlayer::AUDIOCODEC_PROFILE_UNKNOWN;
+			audio_config_.channel_layout = ConvertChannelLayout(s->codecpar->channel_layout, s->codecpar->channels);
+			audio_config_.sample_format = Samsung::NaClPlayer::SAMPLEFORMAT_S16;
+			audio_config_.bits_per_channel = 16;
+			audio_config_.samples_per_second = s->codecpar->sample_rate;
+			break;
+		case kAudioTranscode:
+			audio_config_.codec_type = Samsung::NaClPlayer::AUDIOCODEC_TYPE_AAC;
+			audio_config_.codec_profile = Samsung::NaClPlayer::AUDIOCODEC_PROFILE_AAC_LOW;
+			audio_config_.channel_layout = Samsung::NaClPlayer::CHANNEL_LAYOUT_MONO;
+			audio_config_.sample_format = Samsung::NaClPlayer::SAMPLEFORMAT_PLANARF32;
+			audio_config_.bits_per_channel = 16; // bitrate divided by sample rate
+			audio_config_.samples_per_second = s->codecpar->sample_rate;
+			break;
 	}
 
+	LOG_INFO("audio output mode: %d (0 passthrough, 1 pcm, 2 transcode)",
+	         audio_output_mode_);
 	LOG_INFO("audio configuration - codec: %d, profile: %d, sample_format: %d,"
 	         " bits_per_channel: %d, channel_layout: %d, samples_per_second: %d, extras:%d",
 	         audio_config_.codec_type, audio_config_.codec_profile,
@@ -208,44 +298,319 @@ void RTSPPlayerController::UpdateVideoConfig() {
 	LOG_INFO("video configuration updated");
 }
 
-void RTSPPlayerController::InitializeStreams(int32_t, const std::string& url,
-        const std::string& crt_path) {
-	// init ffmpeg
-	format_context_ = avformat_alloc_context();
+bool RTSPPlayerController::ConfigureVideoStreamFromSDP(AVStream* s) {
+	AVCodecParameters* par = s->codecpar;
+	if (par->codec_id != AV_CODEC_ID_H264 && par->codec_id != AV_CODEC_ID_HEVC)
+		return false;
+
+	// sprop-parameter-sets (sprop-vps/sps/pps for H.265) end up in extradata.
+	VideoParameterSetInfo sps;
+	if (!FindAndParseSPS(par->extradata, par->extradata_size,
+	                     par->codec_id == AV_CODEC_ID_HEVC, &sps)) {
+		LOG_INFO("No usable SPS in the SDP");
+		return false;
+	}
 
-	av_log_set_level(AV_LOG_VERBOSE);
-	av_log_set_callback(av_log_callback);
+	if (sps.chroma_format_idc == 1 && sps.bit_depth == 8) {
+		par->format = AV_PIX_FMT_YUV420P;
+	} else if (sps.chroma_format_idc == 2 && sps.bit_depth == 8) {
+		par->format = AV_PIX_FMT_YUV422P;
+	} else {
+		LOG_INFO("Unsupported SPS chroma format %d, bit depth %d",
+		         sps.chroma_format_idc, sps.bit_depth);
+		return false;
+	}
 
-	// TODO: Is it safe to call this multiple times?
-	av_register_all();
-	avformat_network_init();
+	// The VUI timing is preferred, a=framerate from the SDP is a fallback.
+	if (sps.frame_rate_num > 0) {
+		av_reduce(&s->r_frame_rate.num, &s->r_frame_rate.den,
+		          sps.frame_rate_num, sps.frame_rate_den,
+		          std::numeric_limits<int>::max());
+	} else if (s->avg_frame_rate.num > 0 && s->avg_frame_rate.den > 0) {
+		s->r_frame_rate = s->avg_frame_rate;
+	} else {
+		LOG_INFO("No frame rate in the SPS nor in the SDP");
+		return false;
+	}
+
+	par->profile = sps.profile;
+	par->level = sps.level;
+	par->width = sps.width;
+	par->height = sps.height;
+	LOG_INFO("video from SDP - profile: %d, level: %d, size: %dx%d, fps: %d/%d",
+	         par->profile, par->level, par->width, par->height,
+	         s->r_frame_rate.num, s->r_frame_rate.den);
+	return true;
+}
+
+bool RTSPPlayerController::ConfigureAudioStreamFromSDP(AVStream* s) {
+	AVCodecParameters* par = s->codecpar;
+	if (par->codec_id == AV_CODEC_ID_AAC) {
+		AACConfigInfo aac;
+		if (!ParseAACAudioSpecificConfig(par->extradata, par->extradata_size, &aac)) {
+			LOG_INFO("No usable AAC config in the SDP");
+			return false;
+		}
+		// FF_PROFILE_AAC_* values are MPEG-4 audio object types minus one.
+		par->profile = aac.object_type - 1;
+		par->sample_rate = aac.sample_rate;
+		par->channels = aac.channels;
+	}
+
+	// Other codecs are described by rtpmap alone.
+	if (par->sample_rate <= 0 || par->channels <= 0)
+		return false;
+	if (!par->channel_layout)
+		par->channel_layout = av_get_default_channel_layout(par->channels);
+
+	// Probing reports the decoder output format, which the transcoder relies on.
+	AVCodec* decoder = avcodec_find_decoder(par->codec_id);
+	if (!decoder || !decoder->sample_fmts)
+		return false;
+	par->format = decoder->sample_fmts[0];
+
+	LOG_INFO("audio from SDP - codec: %d, profile: %d, sample_rate: %d, channels: %d",
+	         par->codec_id, par->profile, par->sample_rate, par->channels);
+	return true;
+}
+
+bool RTSPPlayerController::ConfigureStreamsFromSDP() {
+	for (unsigned i = 0; i < format_context_->nb_streams; ++i) {
+		AVStream* s = format_context_->streams[i];
+		bool configured = true;
+		switch (s->codecpar->codec_type) {
+			case AVMEDIA_TYPE_VIDEO:
+				configured = ConfigureVideoStreamFromSDP(s);
+				break;
+			case AVMEDIA_TYPE_AUDIO:
+				configured = ConfigureAudioStreamFromSDP(s);
+				break;
+			default:
+				break;
+		}
+		if (!configured)
+			return false;
+	}
+	return true;
+}
 
+void RTSPPlayerController::ValidateCachedStreamInfo(const AVPacket* pkt) {
+	const AVCodecParameters* par = format_context_->streams[video_stream_idx_]->codecpar;
+	if (par->codec_id != AV_CODEC_ID_H264 && par->codec_id != AV_CODEC_ID_HEVC)
+		return;
+
+	// Cameras which send parameter sets out of band only can't be checked.
+	VideoParameterSetInfo sps;
+	if (!FindAndParseSPS(pkt->data, pkt->size, par->codec_id == AV_CODEC_ID_HEVC, &sps))
+		return;
+
+	int profile = par->profile & ~(FF_PROFILE_H264_CONSTRAINED | FF_PROFILE_H264_INTRA);
+	if (sps.width == par->width && sps.height == par->height && sps.profile == profile)
+		return;
+
+	LOG_ERROR("Stream changed since it was cached - profile: %d -> %d, size: %dx%d -> %dx%d",
+	          profile, sps.profile, par->width, par->height, sps.width, sps.height);
+	stream_info_cache_->Invalidate(url_);
+	message_sender_->StreamConfigChanged();
+}
+
+int RTSPPlayerController::OpenInput(const std::string& url,
+                                    const std::string& transport) {
+	format_context_ = avformat_alloc_context();
 	format_context_->probesize = kVideoStreamProbeSize;
+	cancellation_token_.Install(format_context_);
 
-	LOG_INFO("avformat_open_input");
+	LOG_INFO("avformat_open_input, transport: %s", transport.c_str());
 
 	AVDictionary *opts = 0;
-	av_dict_set(&opts, "rtsp_transport", "tcp", 0);
+	av_dict_set(&opts, "rtsp_transport", transport.c_str(), 0);
 
 	if (strncmp(url.c_str(), "rtsps", strlen("rtsps")) == 0) {
 		LOG_DEBUG("RTSPS protocol.");
-		av_dict_set(&opts, "ca_file", ("/http/" + crt_path).c_str(), 0);
+		av_dict_set(&opts, "ca_file", ("/http/" + options_.crt_path).c_str(), 0);
 		av_dict_set(&opts, "tls_verify", "1", 0);
 	}
+
+	for (const auto& option : options_.ffmpeg_options) {
+		if (!IsAllowedFfmpegOption(option.first)) {
+			LOG_ERROR("FFmpeg option '%s' is not allowed", option.first.c_str());
+			continue;
+		}
+		LOG_INFO("FFmpeg option %s=%s", option.first.c_str(), option.second.c_str());
+		av_dict_set(&opts, option.first.c_str(), option.second.c_str(), 0);
+	}
+
+	// Options of the format context, e.g. probesize, are applied to
+	// format_context_ and the rest to the RTSP demuxer. Whatever is left was
+	// not recognized. format_context_ is freed and set to NULL on failure.
+	cancellation_token_.SetDeadline(kConnectTimeoutMs);
 	int ret = avformat_open_input(&format_context_, url.c_str(), NULL, &opts);
+	cancellation_token_.SetDeadline(0);
+	AVDictionaryEntry* unused = NULL;
+	while ((unused = av_dict_get(opts, "", unused, AV_DICT_IGNORE_SUFFIX)))
+		LOG_ERROR("FFmpeg option '%s' not recognized", unused->key);
 	av_dict_free(&opts);
 
 	if (ret < 0) {
-		LOG_ERROR("input not opened, result: %s", get_error_text(ret));
+		char error[AV_ERROR_MAX_STRING_SIZE];
+		LOG_ERROR("input not opened, result: %s", av_make_error_string(error, sizeof(error), ret));
 	} else {
+		transport_ = transport;
 		LOG_INFO("input successfully opened");
 	}
+	return ret;
+}
+
+int RTSPPlayerController::OpenReplay(const std::string& path) {
+	replay_reader_ = MakeUnique<CaptureReader>();
+	if (!replay_reader_->Open(path)) {
+		replay_reader_.reset();
+		return AVERROR(ENOENT);
+	}
+	LOG_DEBUG("Captured streams: %s", replay_reader_->GetStreamDescription().c_str());
 
-	ret = avformat_find_stream_info(format_context_, NULL);
+	int ret = replay_reader_->CreateFormatContext(&format_context_);
 	if (ret < 0) {
-		LOG_ERROR("Cannot find stream info: %s", get_error_text(ret));
+		char error[AV_ERROR_MAX_STRING_SIZE];
+		LOG_ERROR("Cannot set up captured streams: %s",
+		          av_make_error_string(error, sizeof(error), ret));
+		replay_reader_.reset();
+	}
+	return ret;
+}
+
+int RTSPPlayerController::ReadPacket(AVPacket* pkt) {
+	if (!replay_reader_) {
+		cancellation_token_.SetDeadline(kReadTimeoutMs);
+		int ret = av_read_frame(format_context_, pkt);
+		cancellation_token_.SetDeadline(0);
+		return ret;
+	}
+
+	int64_t arrival_us = 0;
+	int ret = replay_reader_->Read(pkt, &arrival_us);
+	if (ret < 0 || !options_.replay_realtime)
+		return ret;
+	uint64_t due_ms = replay_start_ms_ + arrival_us / 1000;
+	uint64_t now_ms = CancellationToken::NowMs();
+	if (due_ms > now_ms && !cancellation_token_.SleepFor(due_ms - now_ms)) {
+		av_packet_unref(pkt);
+		return AVERROR_EXIT;
+	}
+	return ret;
+}
+
+bool RTSPPlayerController::WaitForFirstPacket() {
+	av_init_packet(&pending_packet_);
+	pending_packet_.data = NULL;
+	pending_packet_.size = 0;
+
+	cancellation_token_.SetDeadline(kFirstPacketTimeoutMs);
+	int ret = av_read_frame(format_context_, &pending_packet_);
+	cancellation_token_.SetDeadline(0);
+
+	has_pending_packet_ = ret >= 0;
+	if (!has_pending_packet_) {
+		char error[AV_ERROR_MAX_STRING_SIZE];
+		LOG_INFO("No packet within %u ms: %s", kFirstPacketTimeoutMs,
+		         av_make_error_string(error, sizeof(error), ret));
+	}
+	return has_pending_packet_;
+}
+
+void RTSPPlayerController::InitializeStreams(int32_t, const std::string& url) {
+	if (options_.persist_stream_info)
+		stream_info_cache_->EnablePersistence();
+
+	// init ffmpeg
+	av_log_set_level(AV_LOG_VERBOSE);
+	av_log_set_callback(av_log_callback);
+
+	// TODO: Is it safe to call this multiple times?
+	av_register_all();
+	avformat_network_init();
+
+	bool is_replay = url.compare(0, strlen(kReplayScheme), kReplayScheme) == 0;
+	CachedStreamInfo cached_info;
+	bool is_cached = !is_replay && stream_info_cache_->Lookup(url, &cached_info);
+
+	// In the auto mode the transport which worked last time is used, otherwise
+	// UDP is tried first and interleaved TCP is a fallback if no RTP arrives.
+	std::string transport = options_.transport;
+	if (transport == kTransportAuto && is_cached && cached_info.transport != kTransportUDP)
+		transport = cached_info.transport;
+
+	int ret;
+	has_pending_packet_ = false;
+	if (is_replay) {
+		ret = OpenReplay(url.substr(strlen(kReplayScheme)));
+	} else if (transport == kTransportAuto) {
+		ret = OpenInput(url, kTransportUDP);
+		if (ret >= 0 && !WaitForFirstPacket()) {
+			cancellation_token_.SetDeadline(kCloseTimeoutMs);
+			avformat_close_input(&format_context_);
+			cancellation_token_.SetDeadline(0);
+		}
+		if (!format_context_ && !cancellation_token_.IsCancelled()) {
+			LOG_INFO("UDP doesn't work, falling back to TCP");
+			ret = OpenInput(url, kTransportTCP);
+		}
 	} else {
-		LOG_INFO("Got stream info: %d", format_context_->nb_streams);
+		ret = OpenInput(url, transport);
+	}
+
+	if (cancellation_token_.IsCancelled()) {
+		LOG_INFO("Stopped while opening the input");
+		return;
+	}
+	if (ret < 0) {
+		state_ = PlayerState::kError;
+		return;
+	}
+	if (!is_replay)
+		message_sender_->TransportSelected(transport_);
+
+	bool configured = false;
+	if (is_cached) {
+		configured = StreamInfoCache::Apply(cached_info, format_context_);
+		if (configured) {
+			LOG_INFO("Streams configured from the cache, probing skipped");
+		} else {
+			LOG_INFO("Cached stream info doesn't match the SDP, dropping it");
+			stream_info_cache_->Invalidate(url);
+		}
+	}
+	validate_stream_info_ = configured;
+	bool cache_stream_info = !configured;
+	if (is_replay) {
+		// A capture holds the parameters the streams had when it was started.
+		configured = true;
+		cache_stream_info = false;
+	}
+
+	if (!configured && options_.fast_start) {
+		configured = ConfigureStreamsFromSDP();
+		if (configured)
+			LOG_INFO("Streams configured from the SDP, probing skipped");
+		else
+			LOG_INFO("SDP is incomplete, falling back to probing");
+	}
+
+	if (!configured) {
+		cancellation_token_.SetDeadline(kProbeTimeoutMs);
+		ret = avformat_find_stream_info(format_context_, NULL);
+		cancellation_token_.SetDeadline(0);
+		if (cancellation_token_.IsCancelled()) {
+			LOG_INFO("Stopped while probing streams");
+			return;
+		}
+		if (ret < 0) {
+			char error[AV_ERROR_MAX_STRING_SIZE];
+			LOG_ERROR("Cannot find stream info: %s", av_make_error_string(error, sizeof(error), ret));
+			cache_stream_info = false;
+		} else {
+			LOG_INFO("Got stream info: %d", format_context_->nb_streams);
+		}
 	}
 
 	video_stream_idx_ = av_find_best_stream(format_context_, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
@@ -255,12 +620,21 @@ void RTSPPlayerController::InitializeStreams(int32_t, const std::string& url,
 		LOG_ERROR("No video or audio streams in source.");
 		return;
 	}
+	latency_controller_.SetHasAudio(audio_stream_idx_ >= 0);
+
+	if (cache_stream_info) {
+		StreamInfoCache::Capture(format_context_, transport_, &cached_info);
+		stream_info_cache_->Store(url, cached_info);
+	} else if (validate_stream_info_ && cached_info.transport != transport_) {
+		cached_info.transport = transport_;
+		stream_info_cache_->Store(url, cached_info);
+	}
 
 	if (video_stream_idx_ >= 0) {
 		LOG_INFO("video index: %d", video_stream_idx_);
 
 		// add ElementaryStreamListener
-		std::shared_ptr<ESListener> video_listener = std::make_shared<ESListener>(this, kVideoType);
+		std::shared_ptr<ESListener> video_listener = std::make_shared<ESListener>(this, StreamType::Video);
 		video_stream_ = std::make_shared<Samsung::NaClPlayer::VideoElementaryStream>();
 		int32_t err = data_source_->AddStream(*video_stream_, video_listener);
 		if (err == ErrorCodes::Success) {
@@ -285,7 +659,7 @@ void RTSPPlayerController::InitializeStreams(int32_t, const std::string& url,
 		LOG_INFO("audio index: %d", audio_stream_idx_);
 
 		// add ElementaryStreamListener
-		std::shared_ptr<ESListener> audio_listener = std::make_shared<ESListener>(this, kAudioType);
+		std::shared_ptr<ESListener> audio_listener = std::make_shared<ESListener>(this, StreamType::Audio);
 		audio_stream_ = std::make_shared<Samsung::NaClPlayer::AudioElementaryStream>();
 		int32_t err = data_source_->AddStream(*audio_stream_, audio_listener);
 		if (err == ErrorCodes::Success) {
@@ -302,17 +676,24 @@ void RTSPPlayerController::InitializeStreams(int32_t, const std::string& url,
 		audio_stream_->SetChannelLayout(audio_config_.channel_layout);
 		audio_stream_->SetBitsPerChannel(audio_config_.bits_per_channel);
 		audio_stream_->SetSamplesPerSecond(audio_config_.samples_per_second);
+		if (!audio_config_.extra_data.empty())
+			audio_stream_->SetCodecExtraData(audio_config_.extra_data.size(),
+			                                 &audio_config_.extra_data.front());
 		audio_stream_->InitializeDone();
 	}
 
 	FinishStreamConfiguration();
 
-	parser_thread_->Start();
-	parser_thread_->message_loop().PostWork(
+	if (is_parsing_finished_) {
+		LOG_INFO("Stopped before parsing started");
+		return;
+	}
+	io_strand_->PostWork(
 	    cc_factory_.NewCallback(&RTSPPlayerController::StartParsing));
 }
 
 void RTSPPlayerController::Play() {
+	if (!player_) return;
 	int32_t ret = player_->Play();
 	if (ret == ErrorCodes::Success) {
 		LOG_INFO("Play called successfully");
@@ -322,24 +703,162 @@ void RTSPPlayerController::Play() {
 }
 
 void RTSPPlayerController::Stop() {
-	int32_t ret = player_->Stop();
-	if (ret == ErrorCodes::Success) {
-		LOG_INFO("Stop called successfully");
-	} else {
-		LOG_ERROR("Stop call failed, code: %d", ret);
+	if (player_) {
+		int32_t ret = player_->Stop();
+		if (ret == ErrorCodes::Success) {
+			LOG_INFO("Stop called successfully");
+		} else {
+			LOG_ERROR("Stop call failed, code: %d", ret);
+		}
+	}
+	StopStreaming();
+}
+
+void RTSPPlayerController::StartReconnecting() {
+	// The current streams are what the elementary streams were configured
+	// with, the new session has to match them.
+	StreamInfoCache::Capture(format_context_, transport_, &reconnect_stream_info_);
+	reconnect_attempt_ = 0;
+	reconnect_delay_ms_ = kReconnectInitialDelayMs;
+	ScheduleReconnect();
+}
+
+void RTSPPlayerController::ScheduleReconnect() {
+	if (format_context_) {
+		cancellation_token_.SetDeadline(kCloseTimeoutMs);
+		avformat_close_input(&format_context_);
+		cancellation_token_.SetDeadline(0);
+	}
+
+	if (++reconnect_attempt_ > options_.max_reconnect_attempts) {
+		LOG_ERROR("Giving up reconnecting");
+		state_ = PlayerState::kError;
+		message_sender_->ReconnectFailed();
+		FinishParsing();
+		return;
+	}
+
+	// Half of the delay is fixed and half random.
+	std::uniform_int_distribution<uint32_t> jitter(0, reconnect_delay_ms_ / 2);
+	uint32_t wait_ms = reconnect_delay_ms_ / 2 + jitter(reconnect_rng_);
+	reconnect_delay_ms_ = std::min(reconnect_delay_ms_ * 2, kReconnectMaxDelayMs);
+
+	LOG_INFO("Reconnecting in %u ms, attempt %d of %d", wait_ms, reconnect_attempt_,
+	         options_.max_reconnect_attempts);
+	message_sender_->Reconnecting(reconnect_attempt_, wait_ms);
+	// The I/O worker serves other cameras in the meantime. Stopping drops the
+	// attempt.
+	io_strand_->PostWork(cc_factory_.NewCallback(&RTSPPlayerController::Reconnect),
+	                     wait_ms);
+}
+
+void RTSPPlayerController::Reconnect(int32_t) {
+	if (is_parsing_finished_) {
+		FinishParsing();
+		return;
+	}
+
+	if (OpenInput(url_, transport_) < 0) {
+		if (cancellation_token_.IsCancelled())
+			FinishParsing();
+		else
+			ScheduleReconnect();
+		return;
+	}
+
+	if (!StreamInfoCache::Apply(reconnect_stream_info_, format_context_)) {
+		LOG_ERROR("Streams changed while reconnecting");
+		stream_info_cache_->Invalidate(url_);
+		message_sender_->StreamConfigChanged();
+		FinishParsing();
+		return;
 	}
-	//is_parsing_finished_ = true;
+
+	// In-band parameter sets may still differ from the SDP ones.
+	validate_stream_info_ = video_stream_idx_ >= 0;
+	// Both streams continue from the first keyframe, audio before it would
+	// have nothing to play along with.
+	rebase_timestamps_ = true;
+	rebase_on_key_frame_ = video_stream_idx_ >= 0;
+	LOG_INFO("Reconnected, attempt %d", reconnect_attempt_);
+	message_sender_->Reconnected(reconnect_attempt_);
+	ParsePackets(0);
+}
+
+void RTSPPlayerController::StopStreaming() {
+	if (!io_strand_ && !player_strand_ && !audio_strand_ && !format_context_)
+		return;
+
+	uint64_t started = nowms();
+	LOG_INFO("Stopping streaming.");
+	// Blocking reads and the RTSP handshake poll the token, so the running
+	// callback returns within one network poll interval.
+	cancellation_token_.Cancel();
+	is_parsing_finished_ = true;
+
+	// The I/O strand goes first: once it is closed nothing posts to the audio
+	// strand, which in turn only posts to the player strand. Posting to a
+	// closed strand fails harmlessly. The lock is not held while closing,
+	// OnNeedData() may be waiting for it on a player strand callback.
+	if (io_strand_)
+		io_strand_->Close();
+	if (audio_strand_)
+		audio_strand_->Close();
+	if (player_strand_)
+		player_strand_->Close();
+	io_strand_.reset();
+	audio_strand_.reset();
+	{
+		AutoLock critical_section(player_strand_lock_);
+		player_strand_.reset();
+	}
+	// A pending reconnect attempt was dropped without closing the capture.
+	capture_writer_.Close();
+	replay_reader_.reset();
+	CloseAudioCodecs();
+
+	EsPktSlot slot;
+	while (packet_ring_.TryPop(&slot)) {}
+	while (audio_es_ring_.TryPop(&slot)) {}
+	AudioJob job;
+	while (audio_ring_.TryPop(&job))
+		av_packet_unref(&job.pkt);
+	drain_scheduled_ = false;
+	audio_drain_scheduled_ = false;
+	video_ring_overrun_ = false;
+	video_buffer_.Clear();
+	audio_buffer_.Clear();
+	// The next load starts without allowances, its streams ask for data anew.
+	end_of_stream_pending_ = false;
+	video_bytes_allowed_ = 0;
+	audio_bytes_allowed_ = 0;
+	need_video_data_ = false;
+	need_audio_data_ = false;
+	if (has_pending_packet_) {
+		av_packet_unref(&pending_packet_);
+		has_pending_packet_ = false;
+	}
+
+	if (format_context_) {
+		// Give the TEARDOWN a moment, a dead camera won't answer anyway.
+		cancellation_token_.Reset();
+		cancellation_token_.SetDeadline(kCloseTimeoutMs);
+		avformat_close_input(&format_context_);
+	}
+
+	uint32_t teardown_ms = static_cast<uint32_t>(nowms() - started);
+	LOG_INFO("Streaming stopped in %u ms.", teardown_ms);
+	message_sender_->TeardownCompleted(teardown_ms);
 }
 
 void RTSPPlayerController::CleanPlayer() {
 	LOG_INFO("Cleaning player.");
-	if (player_) return;
-	player_thread_.reset();
-	parser_thread_.reset();
+	StopStreaming();
 	data_source_.reset();
+	video_stream_.reset();
+	audio_stream_.reset();
+	player_.reset();
 	state_ = PlayerState::kUnitialized;
-	// TODO: Do we need to close the input first?
-	avformat_free_context(format_context_);
 	LOG_INFO("Finished closing.");
 }
 
@@ -360,6 +879,24 @@ PlayerController::PlayerState RTSPPlayerController::GetState() {
 	return state_;
 }
 
+size_t RTSPPlayerController::GetDefaultBufferedBytes() {
+	return kVideoBufferMaxBytes + kAudioBufferMaxBytes;
+}
+
+void RTSPPlayerController::SetPriority(int priority) {
+	priority_ = priority;
+	if (io_strand_)
+		io_strand_->SetPriority(priority);
+	if (player_strand_)
+		player_strand_->SetPriority(priority);
+	if (audio_strand_)
+		audio_strand_->SetPriority(priority);
+}
+
+void RTSPPlayerController::OnTimeUpdate(TimeTicks time) {
+	latency_controller_.OnTimeUpdate(time);
+}
+
 void RTSPPlayerController::FinishStreamConfiguration() {
 	LOG_INFO("All streams configured, attaching data source.");
 	// Audio and video stream should be initialized already.
@@ -383,16 +920,17 @@ void RTSPPlayerController::OnSetDisplayRect(int32_t ret) {
 }
 
 void RTSPPlayerController::Mute() {
-	AutoLock critical_section(mute_lock_);
-	if (is_mute_==true) {
+	// Only called on the main thread, the audio strand just reads the flag.
+	if (is_mute_) {
 		LOG_INFO("Mute flag is false - UnMuted");
-		is_mute_=false;
+		is_mute_ = false;
 	} else {
 		LOG_INFO("Mute flag is true - Muted");
-		is_mute_=true;
+		is_mute_ = true;
 	}
 }
 
+#ifndef STAV_HOST_BUILD
 void RTSPPlayerController::RTPCheckAndSendBackStats(RTPDemuxContext *s, uint64_t *stats_last_sent,
         int *bits_this_sec) {
 	// based on https://www.ffmpeg.org/doxygen/trunk/rtpdec_8c-source.html
@@ -413,85 +951,139 @@ void RTSPPlayerController::RTPCheckAndSendBackStats(RTPDemuxContext *s, uint64_t
 		*bits_this_sec = 0;
 	}
 }
+#endif
 
 void RTSPPlayerController::StartParsing(int32_t) {
-	AVCodecContext *in_codec_ctx = NULL, *out_codec_ctx = NULL;
-	SwrContext *resample_context = NULL;
-	AVAudioFifo *fifo = NULL;
-	AVStream* s = NULL;
-	int ret = 0, bits_this_sec = 0;
-	uint64_t stats_last_sent = 0;
-	RTSPState *state;
-	RTPDemuxContext *demux;
-
-	// Open the Audio Decoder Context
-	if (audio_stream_idx_ >= 0) {
-		s = format_context_->streams[audio_stream_idx_];
-		init_transcoder(s->codecpar, &in_codec_ctx, &out_codec_ctx, &resample_context,is_transcode);
-
-		// Initialize the FIFO buffer to store audio samples to be encoded
-		init_fifo(&fifo, out_codec_ctx);
-
-		// Audio Level update
-		prev_audio_ts_ = 0;
-		audio_level_ = 0;
-		is_mute_ = false;
+	// Audio is converted on the audio strand from now on.
+	if (audio_stream_idx_ >= 0)
+		OpenAudioCodecs();
+
+	if (replay_reader_) {
+		replay_start_ms_ = CancellationToken::NowMs();
+	} else if (!options_.capture_path.empty()) {
+		capture_writer_.Open(options_.capture_path, format_context_);
 	}
 
-	is_parsing_finished_ = false;
+	is_hevc_ = video_stream_idx_ >= 0 &&
+	           format_context_->streams[video_stream_idx_]->codecpar->codec_id ==
+	           AV_CODEC_ID_HEVC;
+	rtp_bits_this_sec_ = 0;
+	rtp_stats_last_sent_ = 0;
+	ParsePackets(0);
+}
+
+void RTSPPlayerController::ParsePackets(int32_t) {
+#ifndef STAV_HOST_BUILD
+	RTSPState *state;
+	RTPDemuxContext *demux;
+#endif
 
 	AVPacket pkt;
 	av_init_packet(&pkt);
 	pkt.data = NULL;
 	pkt.size = 0;
 
+	uint64_t slice_end_us = StageLatency::NowUs() + kParseSliceUs;
+	uint32_t parsed = 0;
 	while (!is_parsing_finished_) {
+		// Other cameras get the worker between slices. A slice overruns by one
+		// blocking read at the most.
+		if (parsed == kMaxParseBatch || StageLatency::NowUs() >= slice_end_us) {
+			io_strand_->PostWork(
+			    cc_factory_.NewCallback(&RTSPPlayerController::ParsePackets));
+			return;
+		}
+		++parsed;
+
 		unique_ptr<ElementaryStreamPacket> es_pkt;
 
 		Message packet_msg;
-		int32_t ret = av_read_frame(format_context_, &pkt);
-		state = (RTSPState*)format_context_->priv_data;
-		demux = (RTPDemuxContext*)state->rtsp_streams[pkt.stream_index]->transport_priv;
-		bits_this_sec += pkt.size;
-		RTPCheckAndSendBackStats(demux, &stats_last_sent, &bits_this_sec);
+		int32_t ret = 0;
+		if (has_pending_packet_) {
+			// The packet which confirmed the transport works.
+			av_packet_move_ref(&pkt, &pending_packet_);
+			has_pending_packet_ = false;
+		} else {
+			ret = ReadPacket(&pkt);
+		}
+		if (ret >= 0 && capture_writer_.IsOpen())
+			capture_writer_.Write(&pkt);
+		if (ret < 0 && ret != AVERROR_EOF) {
+			if (cancellation_token_.IsCancelled()) {
+				LOG_INFO("Parsing cancelled");
+				break;
+			}
+			char errbuff[1024];
+			int32_t strerror_ret = av_strerror(ret, errbuff, 1024);
+			LOG_INFO("av_read_frame error: %d [%s], av_strerror ret: %d", ret,
+			         errbuff, strerror_ret);
+			av_packet_unref(&pkt);
+			// A capture can't be reopened, a read error means it is unusable.
+			if (replay_reader_)
+				break;
+			StartReconnecting();
+			return;
+		}
+		if (ret == AVERROR_EOF) {
+			is_parsing_finished_ = true;
+			// Audio still being converted comes before the end of stream.
+			if (audio_stream_idx_ >= 0)
+				QueueAudioPacket(NULL, true);
+			else
+				QueueEsPacket(&packet_ring_, kEndOfStream, NULL);
+			break;
+		}
+#ifndef STAV_HOST_BUILD
+		// A replayed capture has no RTSP demuxer behind it.
+		if (!replay_reader_) {
+			state = (RTSPState*)format_context_->priv_data;
+			demux = (RTPDemuxContext*)state->rtsp_streams[pkt.stream_index]->transport_priv;
+			rtp_bits_this_sec_ += pkt.size;
+			RTPCheckAndSendBackStats(demux, &rtp_stats_last_sent_, &rtp_bits_this_sec_);
+		}
+#endif
 		if (pkt.stream_index == audio_stream_idx_) {
 			packet_msg = kAudioPkt;
 		} else if (pkt.stream_index == video_stream_idx_) {
 			packet_msg = kVideoPkt;
 		} else {
-			packet_msg = kError;
 			LOG_INFO("Error! Packet stream index (%d) not recognized!",
 			         pkt.stream_index);
+			av_packet_unref(&pkt);
 			continue;
 		}
-		if (ret < 0) {
-			if (ret == AVERROR_EOF) {
-				is_parsing_finished_ = true;
-				packet_msg = kEndOfStream;
-			} else {  // Not handled error.
-				char errbuff[1024];
-				int32_t strerror_ret = av_strerror(ret, errbuff, 1024);
-				LOG_INFO("av_read_frame error: %d [%s], av_strerror ret: %d", ret,
-				         errbuff, strerror_ret);
-				break;
-			}
+		bool is_key_frame = packet_msg == kVideoPkt && (pkt.flags & AV_PKT_FLAG_KEY);
+		if (rebase_on_key_frame_ && !is_key_frame) {
+			LOG_DEBUG("Waiting for a keyframe to continue from");
+		} else if (packet_msg == kVideoPkt ?
+		           latency_controller_.ShouldDropVideo(pkt.data, pkt.size,
+		                   is_key_frame, is_hevc_) :
+		           latency_controller_.ShouldDropAudio()) {
+			// Catching up with the live stream, the next packet kept closes the
+			// gap, so the player has less to play out. Skipping to a keyframe
+			// drops both streams for about the same time, single pictures are
+			// only dropped if there is no audio.
+			rebase_timestamps_ = true;
+		} else if (packet_msg == kVideoPkt && video_ring_overrun_ && !is_key_frame) {
+			LOG_DEBUG("Dropping the rest of the GOP after a ring overrun");
+		} else if (!RebaseTimestamps(&pkt)) {
+			LOG_DEBUG("Dropping a packet of stream %d from before the rebase",
+			          pkt.stream_index);
 		} else {
-			if (pkt.stream_index == audio_stream_idx_) {
-				if (is_transcode || is_mute_) {
-					es_pkt = MakeESPacketFromAVPacketTranscode(&pkt, fifo, in_codec_ctx, out_codec_ctx, resample_context,is_mute_);
-				} else {
-					es_pkt = MakeESPacketFromAVPacketDecode(&pkt, in_codec_ctx);
-				}
+			if (packet_msg == kAudioPkt) {
+				QueueAudioPacket(&pkt, false);
 			} else {
+				video_ring_overrun_ = false;
+				if (validate_stream_info_ && is_key_frame) {
+					validate_stream_info_ = false;
+					ValidateCachedStreamInfo(&pkt);
+				}
 				es_pkt = MakeESPacketFromAVPacket(&pkt);
 			}
 		}
 
-		if (es_pkt != NULL || packet_msg == kEndOfStream) {
-			auto es_pkt_callback = std::make_shared<EsPktCallbackData>(packet_msg, std::move(es_pkt));
-			player_thread_->message_loop().PostWork(cc_factory_.NewCallback(
-			        &RTSPPlayerController::EsPktCallback, es_pkt_callback));
-		}
+		if (es_pkt != NULL)
+			QueueEsPacket(&packet_ring_, packet_msg, std::move(es_pkt));
 
 		av_packet_unref(&pkt);
 		av_init_packet(&pkt);
@@ -499,251 +1091,633 @@ void RTSPPlayerController::StartParsing(int32_t) {
 		pkt.size = 0;
 	}
 
-	if (in_codec_ctx) {
-		LOG_INFO("Flushing decoder");
-		if (flush_decoder(in_codec_ctx) < 0)
-			LOG_ERROR("Could not flush decoder (error '%s')", get_error_text(ret));
-	}
-
-	if (out_codec_ctx) {
-		LOG_INFO("Flushing encoder");
-		if (flush_encoder(out_codec_ctx) < 0)
-			LOG_ERROR("Could not flush encoder (error '%s')", get_error_text(ret));
-	}
-
-	if (fifo)
-		av_audio_fifo_free(fifo);
+	FinishParsing();
+}
 
-	swr_free(&resample_context);
-	avcodec_free_context(&in_codec_ctx);
-	avcodec_free_context(&out_codec_ctx);
+void RTSPPlayerController::FinishParsing() {
+	capture_writer_.Close();
 	LOG_INFO("Finished parsing data. parser: %p", this);
 }
 
-/*
- * Decibel table for different sample format
- * =================================================================
- * |bits per sample | dB Max    | Base-ten Range                    |
- * =================================================================
- * |    8           | 48.16     | -128 to +127
- * |    16          | 96.33     | -32,768 to +32,767
- * |    32          | 192.66    | -2,147,483,648 to +2,147,483,647
- * ------------------------------------------------------------------
- */
-void RTSPPlayerController::calculateAudioLevel(AVFrame* input_frame, AVSampleFormat format, AVRational time_base) {
-	uint8_t *buff16 = *input_frame->extended_data;
-	int nb_samples = input_frame->nb_samples;
-	float sum = 0,decibel=0,sample;
+bool RTSPPlayerController::OpenAudioCodecs() {
+	AVStream* s = format_context_->streams[audio_stream_idx_];
+	audio_codecpar_ = avcodec_parameters_alloc();
+	if (!audio_codecpar_ || avcodec_parameters_copy(audio_codecpar_, s->codecpar) < 0) {
+		LOG_ERROR("Could not copy audio stream parameters");
+		avcodec_parameters_free(&audio_codecpar_);
+		return false;
+	}
+	audio_time_base_ = s->time_base;
 
-	if (audio_level_cb_frequency_ <= 0.0)  //user expects no audio-updates
-		return;
+	bool opened;
+	if (audio_output_mode_ == kAudioTranscode) {
+		// The transcoder keeps its codecs and buffers until parsing stops.
+		opened = audio_transcoder_.Init(audio_codecpar_, audio_time_base_) >= 0;
+	} else {
+		// No encoder is opened in the other modes.
+		AVCodecContext* encoder_ctx = NULL;
+		opened = init_transcoder(audio_codecpar_, &audio_decoder_ctx_, &encoder_ctx,
+		                         &audio_resample_ctx_, audio_output_mode_) >= 0;
+		avcodec_free_context(&encoder_ctx);
+	}
 
-	switch (format) {
-		case AV_SAMPLE_FMT_U8:
-		case AV_SAMPLE_FMT_U8P: { //8-bit sample
+	// Muted passed through audio gets its payload replaced by silence.
+	if (audio_output_mode_ == kAudioPassthrough)
+		silent_audio_.Init(audio_codecpar_);
+	else
+		silent_audio_.Reset();
+
+	// Audio Level update
+	prev_audio_ts_ = 0;
+	audio_level_ = 0;
+	audio_peak_ = 0;
+	audio_decoder_primed_ = false;
+	audio_timestamp_ = 0;
+	is_mute_ = false;
+	// Passed through audio plays without a decoder, it is only not metered.
+	return opened || audio_output_mode_ == kAudioPassthrough;
+}
 
-			for (int i = 0; i < nb_samples; i++) {
-				sample = (char)buff16[i];
-				sample = fabs(sample);
-				sum += sample;
-			}
-			break;
-		}
+void RTSPPlayerController::CloseAudioCodecs() {
+	audio_transcoder_.Reset();
+	silent_audio_.Reset();
+	swr_free(&audio_resample_ctx_);
+	avcodec_free_context(&audio_decoder_ctx_);
+	avcodec_parameters_free(&audio_codecpar_);
+}
 
-		case AV_SAMPLE_FMT_S16:
-		case AV_SAMPLE_FMT_S16P: { //16-bit sample
+std::unique_ptr<ElementaryStreamPacket> RTSPPlayerController::NextConvertedAudioPacket() {
+	if (audio_output_mode_ != kAudioTranscode || !audio_transcoder_.IsOpen())
+		return NULL;
+	AVPacket pkt;
+	init_packet(&pkt);
+	unique_ptr<ElementaryStreamPacket> es_pkt = EncodeTranscodedAudio(&pkt);
+	av_packet_unref(&pkt);
+	return es_pkt;
+}
 
-			for (int i = 0; i < nb_samples; i++) {
-				sample = (short)(((short)buff16[(i*2) + 1] << 8) | (short)buff16[i*2]);
-				sample = fabs(sample);
-				sum += sample;
-			}
+std::unique_ptr<ElementaryStreamPacket> RTSPPlayerController::ConvertAudioPacket(
+    AVPacket* pkt) {
+	if (!audio_codecpar_)
+		return NULL;
+	switch (audio_output_mode_) {
+		case kAudioPassthrough:
+			return MakeESPacketFromAVPacketDecode(pkt);
+		case kAudioPcm:
+			return MakeESPacketFromAVPacketPcm(pkt, is_mute_);
+		case kAudioTranscode:
+			if (audio_transcoder_.IsOpen())
+				return MakeESPacketFromAVPacketTranscode(pkt, is_mute_);
 			break;
-		}
+	}
+	return NULL;
+}
 
-		case AV_SAMPLE_FMT_FLTP: {
-			for (int i = 0; i < nb_samples; i++) {
-				sample = (float)(((int)buff16[(i*4) + 3] << 24) |((int)buff16[(i*4) + 2] << 16) | ((int)buff16[(i*4) + 1] << 8) | (int)buff16[i*4]);
-				sample = fabs(sample);
-				sum += sample;
-			}
-			break;
-		}
+void RTSPPlayerController::calculateAudioLevel(AVFrame* input_frame, AVSampleFormat format, AVRational time_base) {
+	if (audio_level_cb_frequency_ <= 0.0)  //user expects no audio-updates
+		return;
 
-		default:
-			sum = 0;
-			break;
-	}
+	AudioLevel level;
+	if (MeasureAudioLevel(input_frame, format, &level))
+		ReportAudioLevel(level, ToTimeTicks(input_frame->best_effort_timestamp, time_base));
+}
 
-	//rms = (float)sqrt(sum / (nb_samples));
-	if (sum > 0) {
-		decibel = 20 * log(sum / nb_samples) * 0.4343; // Multiplying by 0.4343 for base 10 conversion
-		audio_level_ = (audio_level_ + decibel) / 2.0; //Average Decibel.
+void RTSPPlayerController::ReportAudioLevel(const AudioLevel& level,
+        TimeTicks ts_now) {
+	// Levels are averaged with the previous one, peaks are the highest since
+	// the last report.
+	double decibel = AudioLevelToDecibels(level.rms);
+	if (decibel > 0) {
+		audio_level_ = (audio_level_ + decibel) / 2.0;
 	} else {
 		audio_level_ = 0;
 	}
+	audio_peak_ = std::max<float>(audio_peak_, AudioLevelToDecibels(level.peak));
 
-	TimeTicks ts_now = ToTimeTicks(input_frame->best_effort_timestamp, time_base);
 	if ((ts_now - prev_audio_ts_) > audio_level_cb_frequency_) {
 		prev_audio_ts_ = ts_now;
-		message_sender_->SetAudioLevel((double)audio_level_);
+		message_sender_->SetAudioLevel(audio_level_, audio_peak_);
+		audio_peak_ = 0;
 	}
-
 }
+
 std::unique_ptr<ElementaryStreamPacket> RTSPPlayerController::MakeESPacketFromAVPacketDecode(
-    AVPacket* input_packet, AVCodecContext* in_codec_ctx) {
-	int ret = 0;
-	int data_present = 0;
-	AVFrame *input_frame = NULL;
+    AVPacket* input_packet) {
+	if (IsG711Codec(audio_codecpar_->codec_id)) {
+		// Expanding G.711 costs a table lookup per sample, no decoder needed.
+		if (audio_level_cb_frequency_ > 0)
+			DecodeG711Packet(input_packet);
+		return is_mute_ ? MakeESPacketFromSilence(input_packet) :
+		       MakeESPacketFromAVPacket(input_packet);
+	}
 
-	init_input_frame(&input_frame);
-	ret = decode(in_codec_ctx, input_frame, &data_present, input_packet);
-	if (ret < 0) {
-		LOG_ERROR("Could not decode frame (error '%s')", get_error_text(ret));
+	// The packet is passed through, decoding it only meters the level. So
+	// only packets shortly before a level report are decoded, the first one
+	// of them fills the overlap of the decoder after the skipped ones.
+	bool decode_packet = false;
+	bool measure = false;
+	if (audio_level_cb_frequency_ > 0 && audio_decoder_ctx_) {
+		TimeTicks ts = input_packet->pts != AV_NOPTS_VALUE ?
+		               ToTimeTicks(input_packet->pts, audio_time_base_) : prev_audio_ts_;
+		// Timestamps start over after a reconnect.
+		if (ts < prev_audio_ts_)
+			prev_audio_ts_ = ts;
+		decode_packet = audio_level_cb_frequency_ <= kAudioMeterWindow ||
+		                ts - prev_audio_ts_ > audio_level_cb_frequency_ - kAudioMeterWindow;
+		measure = decode_packet && audio_decoder_primed_;
+	}
+	audio_decoder_primed_ = decode_packet;
+
+	if (decode_packet) {
+		int data_present = 0;
+		AVFrame *input_frame = NULL;
+		init_input_frame(&input_frame);
+		int ret = decode(audio_decoder_ctx_, input_frame, &data_present, input_packet);
+		if (ret < 0) {
+			char error[AV_ERROR_MAX_STRING_SIZE];
+			LOG_ERROR("Could not decode frame (error '%s')",
+			          av_make_error_string(error, sizeof(error), ret));
+		} else if (data_present && measure) {
+			calculateAudioLevel(input_frame, audio_decoder_ctx_->sample_fmt,
+			                    audio_time_base_);
+		}
 		av_frame_free(&input_frame);
-		return NULL;
 	}
-	if (data_present) {
-		calculateAudioLevel(input_frame, in_codec_ctx->sample_fmt, in_codec_ctx->time_base);
+	return is_mute_ ? MakeESPacketFromSilence(input_packet) :
+	       MakeESPacketFromAVPacket(input_packet);
+}
 
+std::unique_ptr<ElementaryStreamPacket> RTSPPlayerController::MakeESPacketFromSilence(
+    AVPacket* input_packet) {
+	size_t size = 0;
+	const uint8_t* silence = silent_audio_.GetPayload(input_packet->size, &size);
+	// Audio playing on beats starving the player of it.
+	if (!silence)
 		return MakeESPacketFromAVPacket(input_packet);
-
-	}
-	return NULL;
+	auto es_packet = audio_packet_pool_.AcquireCopy(silence, size);
+	SetESPacketTiming(es_packet.get(), input_packet);
+	return es_packet;
 }
 
-std::unique_ptr<ElementaryStreamPacket> RTSPPlayerController::MakeESPacketFromAVPacketTranscode(
-    AVPacket* input_packet, AVAudioFifo *fifo, AVCodecContext* in_codec_ctx,
-    AVCodecContext* out_codec_ctx, SwrContext* resample_context,bool is_mute_) {
-	int ret = 0;
-	const int output_frame_size = out_codec_ctx->frame_size;
-
-	//Transcode any non AAC audio stream
-	int data_present = 0;
-	if (av_audio_fifo_size(fifo) < output_frame_size) {
-		// decode
+std::unique_ptr<ElementaryStreamPacket> RTSPPlayerController::MakeESPacketFromAVPacketPcm(
+    AVPacket* input_packet, bool is_mute) {
+	int channels = audio_codecpar_->channels;
+	int samples = 0;
+	if (IsG711Codec(audio_codecpar_->codec_id)) {
+		// G.711 is expanded with tables, the decoder isn't used. Muted audio is
+		// still metered, only the appended samples are silent.
+		DecodeG711Packet(input_packet);
+		samples = input_packet->size / channels;
+		if (is_mute)
+			memset(pcm_samples_.data(), 0, pcm_samples_.size());
+	} else {
+		if (!audio_decoder_ctx_)
+			return NULL;
+
+		// PCM and ADPCM decoders make one frame of each packet without any
+		// delay, so the frame keeps the timing of the packet.
+		int data_present = 0;
 		AVFrame *input_frame = NULL;
-		uint8_t **converted_input_samples = NULL;
 		init_input_frame(&input_frame);
-
-		ret = decode(in_codec_ctx, input_frame, &data_present, input_packet);
-		if (ret < 0) {
-			LOG_ERROR("Could not decode frame (error '%s')", get_error_text(ret));
-			//av_packet_unref(&input_packet);
+		int ret = decode(audio_decoder_ctx_, input_frame, &data_present, input_packet);
+		if (ret < 0 || !data_present) {
+			if (ret < 0) {
+				char error[AV_ERROR_MAX_STRING_SIZE];
+				LOG_ERROR("Could not decode frame (error '%s')",
+				          av_make_error_string(error, sizeof(error), ret));
+			}
 			av_frame_free(&input_frame);
 			return NULL;
 		}
-		// If there is decoded data, convert and store it
-		if (data_present) {
-			calculateAudioLevel(input_frame, in_codec_ctx->sample_fmt, in_codec_ctx->time_base);
+		calculateAudioLevel(input_frame, audio_decoder_ctx_->sample_fmt, audio_time_base_);
+
+		channels = input_frame->channels;
+		samples = input_frame->nb_samples;
+		pcm_samples_.resize(static_cast<size_t>(samples) * channels * sizeof(int16_t));
+		uint8_t* pcm = pcm_samples_.data();
+		if (is_mute) {
+			memset(pcm, 0, pcm_samples_.size());
+		} else if (audio_resample_ctx_) {
+			ret = swr_convert(audio_resample_ctx_, &pcm, samples,
+			                  (const uint8_t**)input_frame->extended_data, samples);
+			if (ret < 0) {
+				char error[AV_ERROR_MAX_STRING_SIZE];
+				LOG_ERROR("Could not convert input samples (error '%s')",
+				          av_make_error_string(error, sizeof(error), ret));
+			}
+		} else {
+			memcpy(pcm, input_frame->extended_data[0], pcm_samples_.size());
+		}
+		av_frame_free(&input_frame);
+		if (ret < 0)
+			return NULL;
+	}
 
-			// Initialize the temporary storage for the converted input samples
-			ret = init_converted_samples(&converted_input_samples, out_codec_ctx,
-			                             input_frame->nb_samples);
-			/**
-			 * Convert the input samples to the desired output sample format.
-			 * This requires a temporary storage provided by converted_input_samples.
-			 */
+	// RTP packets carry no duration, it follows from the number of samples.
+	if (input_packet->duration <= 0) {
+		AVRational sample_time = {1, audio_codecpar_->sample_rate};
+		input_packet->duration = av_rescale_q(samples, sample_time, audio_time_base_);
+	}
+	auto es_packet = audio_packet_pool_.AcquireCopy(pcm_samples_.data(),
+	                 pcm_samples_.size());
+	SetESPacketTiming(es_packet.get(), input_packet);
+	return es_packet;
+}
 
-			AutoLock critical_section(mute_lock_);
-			ret = convert_samples((const AVFrame*) input_frame, converted_input_samples,
-			                      resample_context, in_codec_ctx->sample_fmt, is_mute_);
+void RTSPPlayerController::DecodeG711Packet(AVPacket* pkt) {
+	pcm_samples_.resize(pkt->size * sizeof(int16_t));
+	DecodeG711(audio_codecpar_->codec_id, pkt->data, pkt->size,
+	           reinterpret_cast<int16_t*>(pcm_samples_.data()));
 
-			// Add the converted input samples to the FIFO buffer for later processing
-			ret = add_samples_to_fifo(fifo, converted_input_samples, input_frame->nb_samples);
-		}
-		//No Scope for input_frame after pushing the samples to fifo
-		av_frame_free(&input_frame);
+	if (audio_level_cb_frequency_ <= 0.0)
+		return;
+	const uint8_t* plane = pcm_samples_.data();
+	AudioLevel level;
+	MeasureAudioLevel(&plane, 1, pkt->size, AV_SAMPLE_FMT_S16, &level);
+	TimeTicks ts = pkt->pts != AV_NOPTS_VALUE ? ToTimeTicks(pkt->pts, audio_time_base_) :
+	               prev_audio_ts_;
+	ReportAudioLevel(level, ts);
+}
+
+std::unique_ptr<ElementaryStreamPacket> RTSPPlayerController::MakeESPacketFromAVPacketTranscode(
+    AVPacket* input_packet, bool is_mute) {
+	// Every packet is decoded, the FIFO may then hold more than one frame.
+	// The first packet encoded is returned, NextConvertedAudioPacket() gives
+	// the others.
+	AVFrame* input_frame = NULL;
+	int ret = audio_transcoder_.Decode(input_packet, is_mute, &input_frame);
+	if (ret < 0) {
+		char error[AV_ERROR_MAX_STRING_SIZE];
+		LOG_ERROR("Could not transcode frame (error '%s')",
+		          av_make_error_string(error, sizeof(error), ret));
+	} else if (input_frame) {
+		calculateAudioLevel(input_frame, (AVSampleFormat)input_frame->format,
+		                    audio_time_base_);
 	}
 
-	if (av_audio_fifo_size(fifo) >= output_frame_size) {
-		// encode
-		// Temporary storage of the output samples of the frame written to the file
-		AVFrame *output_frame;
-		/**
-		 * Use the maximum number of possible samples per frame.
-		 * If there is less than the maximum possible frame size in the FIFO
-		 * buffer use this number. Otherwise, use the maximum possible frame size
-		 */
-		const int frame_size = FFMIN(av_audio_fifo_size(fifo), out_codec_ctx->frame_size);
-		// Initialize temporary storage for one output frame
-		ret = init_output_frame(&output_frame, out_codec_ctx, frame_size);
-
-		/**
-		 * Read as many samples from the FIFO buffer as required to fill the frame.
-		 * The samples are stored in the frame temporarily.
-		 */
-		if (av_audio_fifo_read(fifo, (void **)output_frame->data, frame_size) < frame_size) {
-			LOG_ERROR("Could not read data from FIFO");
-			av_frame_free(&output_frame);
-			return NULL;
-		}
-		// Encode one frame worth of audio samples
-		// Packet used for temporary storage
-		AVPacket *output_packet = input_packet;
-		av_packet_unref(output_packet);
-		ret = encode(out_codec_ctx, output_packet, &data_present, output_frame);
-		if (ret < 0) {
-			LOG_ERROR("Could not encode frame (error '%s')", get_error_text(ret));
-			av_packet_unref(output_packet);
-			av_frame_free(&output_frame);
-			return NULL;
-		}
-		if (data_present) {
-			av_frame_free(&output_frame);
-			return MakeESPacketFromAVPacket(output_packet);
-		}
+	// The input packet is done with, the encoded one takes its place.
+	av_packet_unref(input_packet);
+	return EncodeTranscodedAudio(input_packet);
+}
+
+std::unique_ptr<ElementaryStreamPacket> RTSPPlayerController::EncodeTranscodedAudio(
+    AVPacket* pkt) {
+	int ret = audio_transcoder_.Encode(pkt);
+	if (ret < 0) {
+		char error[AV_ERROR_MAX_STRING_SIZE];
+		LOG_ERROR("Could not encode frame (error '%s')",
+		          av_make_error_string(error, sizeof(error), ret));
+		av_packet_unref(pkt);
+		return NULL;
 	}
-	return NULL; //No packets
+	if (!ret)
+		return NULL;
+	pkt->stream_index = audio_stream_idx_;
+	return MakeESPacketFromAVPacketCopy(pkt);
 }
 
 std::unique_ptr<ElementaryStreamPacket> RTSPPlayerController::MakeESPacketFromAVPacket(
     AVPacket* pkt) {
-	auto es_packet = MakeUnique<ElementaryStreamPacket>(pkt->data, pkt->size);
+	if (!pkt->buf)
+		return MakeESPacketFromAVPacketCopy(pkt);
 
-	AVStream* s = format_context_->streams[pkt->stream_index];
+	ESPacketPool* pool = pkt->stream_index == video_stream_idx_ ?
+	                     &video_packet_pool_ : &audio_packet_pool_;
 
-	es_packet->SetPts(ToTimeTicks(pkt->pts, s->time_base) + timestamp_);
-	es_packet->SetDts(ToTimeTicks(pkt->dts, s->time_base) + timestamp_);
-	es_packet->SetDuration(ToTimeTicks(pkt->duration, s->time_base));
-	es_packet->SetKeyFrame(pkt->flags == 1);
+	// Take over the demuxer's reference to the payload instead of copying it.
+	// It is released when the packet goes back to the pool after AppendPacket().
+	auto es_packet = pool->AcquireRef(pkt->buf, pkt->data, pkt->size);
+	pkt->buf = NULL;
 
+	SetESPacketTiming(es_packet.get(), pkt);
+	return es_packet;
+}
+
+std::unique_ptr<ElementaryStreamPacket> RTSPPlayerController::MakeESPacketFromAVPacketCopy(
+    AVPacket* pkt) {
+	// Each pool is only acquired from on the strand making packets of its
+	// stream.
+	ESPacketPool* pool = pkt->stream_index == video_stream_idx_ ?
+	                     &video_packet_pool_ : &audio_packet_pool_;
+	auto es_packet = pool->AcquireCopy(pkt->data, pkt->size);
+	SetESPacketTiming(es_packet.get(), pkt);
 	return es_packet;
 }
 
-void RTSPPlayerController::EsPktCallback(int32_t, const std::shared_ptr<EsPktCallbackData>& data) {
-	Message msg = std::get<0>(*data);
-	unique_ptr<ElementaryStreamPacket> es_pkt = std::move(std::get<1>(*data));
+void RTSPPlayerController::SetESPacketTiming(ElementaryStreamPacket* es_packet,
+        AVPacket* pkt) {
+	// Audio is converted on the audio strand, with the offset it was demuxed
+	// with.
+	bool is_audio = pkt->stream_index == audio_stream_idx_;
+	AVRational time_base = is_audio ? audio_time_base_ :
+	                       format_context_->streams[pkt->stream_index]->time_base;
+	TimeTicks offset = is_audio ? audio_timestamp_ : timestamp_offset_;
+
+	es_packet->SetPts(ToTimeTicks(pkt->pts, time_base) + offset);
+	es_packet->SetDts(ToTimeTicks(pkt->dts, time_base) + offset);
+	es_packet->SetDuration(ToTimeTicks(pkt->duration, time_base));
+	es_packet->SetKeyFrame(pkt->flags == 1);
+}
+
+bool RTSPPlayerController::RebaseTimestamps(const AVPacket* pkt) {
+	if (pkt->dts == AV_NOPTS_VALUE)
+		return true;
+	AVStream* s = format_context_->streams[pkt->stream_index];
+	TimeTicks dts = ToTimeTicks(pkt->dts, s->time_base);
+	StreamTimeline* timeline = pkt->stream_index == audio_stream_idx_ ?
+	                           &audio_timeline_ : &video_timeline_;
+
+	// A new RTSP session starts its timestamps from scratch, and dropped
+	// packets leave a gap. Both streams continue right after the latest packet
+	// of either, with one offset, so audio and video stay in sync. The stream
+	// which was behind gets a gap instead.
+	if (rebase_timestamps_) {
+		timestamp_offset_ =
+			std::max(video_timeline_.last_packet_end, audio_timeline_.last_packet_end) +
+			kOneMicrosecond - dts;
+		rebase_timestamps_ = false;
+		rebase_on_key_frame_ = false;
+		video_timeline_.resuming = true;
+		audio_timeline_.resuming = true;
+		LOG_INFO("Timestamps rebased by %f s at stream %d", timestamp_offset_,
+		         pkt->stream_index);
+	}
+	// Packets of the other stream demuxed after the one the offset was
+	// computed from may still start earlier.
+	if (timeline->resuming) {
+		if (dts + timestamp_offset_ < timeline->last_packet_end)
+			return false;
+		timeline->resuming = false;
+	}
+	timeline->last_packet_end =
+		std::max(timeline->last_packet_end,
+		         dts + timestamp_offset_ + ToTimeTicks(pkt->duration, s->time_base));
+	return true;
+}
+
+void RTSPPlayerController::QueueEsPacket(EsPktRing* ring, Message msg,
+        unique_ptr<ElementaryStreamPacket> es_pkt) {
+	EsPktSlot slot(msg, std::move(es_pkt));
+	if (!ring->TryPush(std::move(slot))) {
+		// Media packets are dropped when the player strand can't keep up, but the
+		// end of stream has to get through. Waiting here would hold the worker,
+		// the strand pushing to the ring tries again later instead. Video
+		// pictures depend on the previous ones, so the rest of the GOP goes
+		// too.
+		if (msg == kVideoPkt) {
+			if (!video_ring_overrun_) {
+				video_ring_overrun_ = true;
+				++ring_dropped_gops_;
+			}
+			LOG_DEBUG("Packet ring full, dropping video until the next keyframe");
+			return;
+		}
+		if (msg != kEndOfStream || cancellation_token_.IsCancelled()) {
+			LOG_DEBUG("Packet ring full, dropping packet (msg: %d)", msg);
+			return;
+		}
+		WorkerPool::Strand* strand =
+			ring == &audio_es_ring_ ? audio_strand_.get() : io_strand_.get();
+		strand->PostWork(cc_factory_.NewCallback(
+		        &RTSPPlayerController::RetryEndOfStream, ring), kRingFullRetryMs);
+		return;
+	}
+
+	if (!drain_scheduled_.exchange(true)) {
+		player_strand_->PostWork(cc_factory_.NewCallback(
+		        &RTSPPlayerController::DrainEsPackets));
+	}
+}
+
+void RTSPPlayerController::RetryEndOfStream(int32_t, EsPktRing* ring) {
+	QueueEsPacket(ring, kEndOfStream, NULL);
+}
+
+bool RTSPPlayerController::PopEsPacket(EsPktSlot* slot) {
+	// Packets at the heads are merged by DTS. A video packet isn't held back
+	// for audio still being converted, the streams are buffered separately.
+	const EsPktSlot* video = packet_ring_.Peek();
+	const EsPktSlot* audio = audio_es_ring_.Peek();
+	if (audio && (!video || audio->GetDts() < video->GetDts())) {
+		audio_es_ring_.TryPop(slot);
+		audio_handoff_wait_.Add(StageLatency::NowUs() - slot->queued_us);
+		return true;
+	}
+	return packet_ring_.TryPop(slot);
+}
+
+void RTSPPlayerController::DrainEsPackets(int32_t) {
+	EsPktSlot slot;
+	uint32_t drained = 0;
+	while (drained < kMaxDrainBatch && PopEsPacket(&slot)) {
+		HandleEsPacket(slot.msg, std::move(slot.es_pkt));
+		++drained;
+	}
+
+	AppendBufferedPackets();
+
+	uint64_t now = nowms();
+	if (now >= pipeline_stats_last_sent_ + 1000) {
+		SendPipelineStats();
+		pipeline_stats_last_sent_ = now;
+	}
+
+	// Let other work queued on the player strand, and other players, run
+	// between batches.
+	if (drained < kMaxDrainBatch) {
+		drain_scheduled_.store(false);
+		// The parser may have pushed after the last TryPop() but before the flag
+		// was cleared, in which case it did not schedule a drain.
+		if ((packet_ring_.Empty() && audio_es_ring_.Empty()) ||
+		    drain_scheduled_.exchange(true))
+			return;
+	}
+	player_strand_->PostWork(cc_factory_.NewCallback(
+	        &RTSPPlayerController::DrainEsPackets));
+}
+
+void RTSPPlayerController::QueueAudioPacket(AVPacket* pkt, bool end_of_stream) {
+	AudioJob job;
+	job.end_of_stream = end_of_stream;
+	job.timestamp_offset = timestamp_offset_;
+	job.queued_us = StageLatency::NowUs();
+	if (pkt)
+		av_packet_move_ref(&job.pkt, pkt);
+	if (!audio_ring_.TryPush(std::move(job))) {
+		// A stalled audio strand costs audio, the video keeps coming. The end of
+		// stream has to get through, it is queued again later.
+		if (!end_of_stream || cancellation_token_.IsCancelled()) {
+			LOG_DEBUG("Audio ring full, dropping packet");
+			av_packet_unref(&job.pkt);
+			return;
+		}
+		io_strand_->PostWork(cc_factory_.NewCallback(
+		        &RTSPPlayerController::RetryAudioEndOfStream), kRingFullRetryMs);
+		return;
+	}
+
+	if (!audio_drain_scheduled_.exchange(true)) {
+		audio_strand_->PostWork(cc_factory_.NewCallback(
+		        &RTSPPlayerController::DrainAudioPackets));
+	}
+}
+
+void RTSPPlayerController::RetryAudioEndOfStream(int32_t) {
+	QueueAudioPacket(NULL, true);
+}
+
+void RTSPPlayerController::DrainAudioPackets(int32_t) {
+	AudioJob job;
+	uint32_t drained = 0;
+	while (drained < kMaxDrainBatch && audio_ring_.TryPop(&job)) {
+		++drained;
+		uint64_t started = StageLatency::NowUs();
+		audio_queue_wait_.Add(started - job.queued_us);
+		if (job.end_of_stream) {
+			QueueEsPacket(&audio_es_ring_, kEndOfStream, NULL);
+			continue;
+		}
+
+		audio_timestamp_ = job.timestamp_offset;
+		unique_ptr<ElementaryStreamPacket> es_pkt = ConvertAudioPacket(&job.pkt);
+		av_packet_unref(&job.pkt);
+		audio_convert_time_.Add(StageLatency::NowUs() - started);
+		while (es_pkt) {
+			QueueEsPacket(&audio_es_ring_, kAudioPkt, std::move(es_pkt));
+			es_pkt = NextConvertedAudioPacket();
+		}
+	}
+
+	if (drained < kMaxDrainBatch) {
+		audio_drain_scheduled_.store(false);
+		// Same race with the parser as in DrainEsPackets().
+		if (audio_ring_.Empty() || audio_drain_scheduled_.exchange(true))
+			return;
+	}
+	audio_strand_->PostWork(cc_factory_.NewCallback(
+	        &RTSPPlayerController::DrainAudioPackets));
+}
 
+void RTSPPlayerController::HandleEsPacket(Message msg,
+        unique_ptr<ElementaryStreamPacket> es_pkt) {
 	switch (msg) {
-		case Message::kEndOfStream: {
-			AutoLock critical_section(packets_lock_);
-			data_source_->SetEndOfStream();
+		case Message::kEndOfStream:
+			end_of_stream_pending_ = true;
 			break;
-		}
-		case Message::kAudioPkt: {
-			AutoLock critical_section(packets_lock_);
-			if (need_audio_data_) {
-				int32_t ret = ErrorCodes::Success;
-				ret = audio_stream_->AppendPacket(es_pkt->GetESPacket());
-				if (ret != ErrorCodes::Success) {
-					LOG_ERROR("Failed to append audio packet! Error code: %d", ret);
-				}
-			}
+		case Message::kAudioPkt:
+			audio_buffer_.Push(std::move(es_pkt));
 			break;
-		}
-		case Message::kVideoPkt: {
-			AutoLock critical_section(packets_lock_);
-			if (need_video_data_) {
-				int32_t ret = ErrorCodes::Success;
-				ret = video_stream_->AppendPacket(es_pkt->GetESPacket());
-				if (ret != ErrorCodes::Success) {
-					LOG_INFO("Failed to append video packet! Error code: %d", ret);
-				}
-			}
+		case Message::kVideoPkt:
+			video_buffer_.Push(std::move(es_pkt));
 			break;
-		}
 		default:
 			LOG_ERROR("Not supported message type received!");
 	}
 }
+
+void RTSPPlayerController::AppendBufferedPackets() {
+	if (video_stream_)
+		AppendFromBuffer(&video_buffer_, &video_packet_pool_, video_stream_.get(),
+		                 &need_video_data_, &video_bytes_allowed_);
+	if (audio_stream_)
+		AppendFromBuffer(&audio_buffer_, &audio_packet_pool_, audio_stream_.get(),
+		                 &need_audio_data_, &audio_bytes_allowed_);
+
+	if (end_of_stream_pending_ && video_buffer_.Empty() && audio_buffer_.Empty()) {
+		end_of_stream_pending_ = false;
+		data_source_->SetEndOfStream();
+	}
+}
+
+void RTSPPlayerController::AppendFromBuffer(ESPacketBuffer* buffer,
+        ESPacketPool* pool, Samsung::NaClPlayer::ElementaryStream* stream,
+        const std::atomic<bool>* need_data, int64_t* bytes_allowed) {
+	// A used up allowance waits for the next OnNeedData().
+	if (*bytes_allowed == 0)
+		return;
+	bool limited = *bytes_allowed != kUnlimitedBytes;
+	// OnEnoughData() takes effect from the next packet on.
+	while (need_data->load() && !buffer->Empty()) {
+		// NaCl Player copies the data, so the packet goes back to the pool and
+		// releases its payload right after AppendPacket().
+		unique_ptr<ElementaryStreamPacket> es_pkt = buffer->Pop();
+		int32_t ret = stream->AppendPacket(es_pkt->GetESPacket());
+		if (ret != ErrorCodes::Success) {
+			LOG_ERROR("Failed to append packet! Error code: %d", ret);
+		} else {
+			latency_controller_.OnPacketAppended(es_pkt->GetPts());
+		}
+		uint32_t size = es_pkt->GetDataSize();
+		pool->Release(std::move(es_pkt));
+
+		if (limited) {
+			*bytes_allowed -= size;
+			if (*bytes_allowed <= 0) {
+				*bytes_allowed = 0;
+				break;
+			}
+		}
+	}
+}
+
+void RTSPPlayerController::OnNeedData(StreamType type, int32_t bytes_max) {
+	if (type == StreamType::Video)
+		need_video_data_ = true;
+	else if (type == StreamType::Audio)
+		need_audio_data_ = true;
+
+	// Buffers and allowances are touched on the player strand only. NaCl
+	// Player may still report after StopStreaming() released the strand.
+	AutoLock critical_section(player_strand_lock_);
+	if (!player_strand_)
+		return;
+	player_strand_->PostWork(cc_factory_.NewCallback(
+	        &RTSPPlayerController::OnNeedDataOnPlayerStrand, type, bytes_max));
+}
+
+void RTSPPlayerController::OnEnoughData(StreamType type) {
+	if (type == StreamType::Video)
+		need_video_data_ = false;
+	else if (type == StreamType::Audio)
+		need_audio_data_ = false;
+}
+
+void RTSPPlayerController::OnNeedDataOnPlayerStrand(int32_t, StreamType type,
+        int32_t bytes_max) {
+	// A non-positive maximum means the player did not limit the amount of data.
+	int64_t allowed = kUnlimitedBytes;
+	if (bytes_max > 0)
+		allowed = bytes_max;
+	if (type == StreamType::Video)
+		video_bytes_allowed_ = allowed;
+	else if (type == StreamType::Audio)
+		audio_bytes_allowed_ = allowed;
+	AppendBufferedPackets();
+}
+
+void RTSPPlayerController::SendPipelineStats() {
+	PipelineStats stats;
+	stats.ring_occupancy = packet_ring_.Size();
+	stats.ring_high_watermark = packet_ring_.HighWatermark();
+	stats.ring_overruns = packet_ring_.Overruns();
+	stats.ring_dropped_gops = ring_dropped_gops_;
+	stats.video_buffered_bytes = video_buffer_.GetBufferedBytes();
+	stats.video_buffered_packets = video_buffer_.GetBufferedPackets();
+	stats.video_dropped_packets = video_buffer_.GetDroppedPackets();
+	stats.video_dropped_gops = video_buffer_.GetDroppedGops();
+	stats.audio_buffered_bytes = audio_buffer_.GetBufferedBytes();
+	stats.audio_buffered_packets = audio_buffer_.GetBufferedPackets();
+	stats.audio_dropped_packets = audio_buffer_.GetDroppedPackets();
+	stats.es_packets = video_packet_pool_.GetAcquired() +
+	                   audio_packet_pool_.GetAcquired();
+	stats.es_packet_allocations = video_packet_pool_.GetAllocations() +
+	                              audio_packet_pool_.GetAllocations();
+	stats.latency_ms = latency_controller_.GetLatency() * 1000;
+	stats.latency_dropped_frames = latency_controller_.GetDroppedFrames();
+	stats.audio_queue_occupancy = audio_ring_.Size();
+	stats.audio_queue_overruns = audio_ring_.Overruns();
+	audio_queue_wait_.Take(&stats.audio_queue_wait_us, &stats.audio_queue_wait_max_us);
+	audio_convert_time_.Take(&stats.audio_convert_us, &stats.audio_convert_max_us);
+	audio_handoff_wait_.Take(&stats.audio_handoff_us, &stats.audio_handoff_max_us);
+	message_sender_->SendPipelineStats(stats);
+}
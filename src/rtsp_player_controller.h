@@ -2,7 +2,10 @@
 #define RTSP_PLAYER_CONTROLLER_H_
 
 #include <array>
+#include <atomic>
+#include <limits>
 #include <memory>
+#include <random>
 #include <string>
 #include <vector>
 #include <list>
@@ -12,12 +15,24 @@
 #include "nacl_player/media_player.h"
 #include "ppapi/cpp/instance.h"
 #include "ppapi/utility/completion_callback_factory.h"
-#include "ppapi/utility/threading/simple_thread.h"
+#include "ppapi/utility/threading/lock.h"
 
+#include "audio_level_meter.h"
+#include "audio_transcoder.h"
+#include "capture_file.h"
 #include "common.h"
 #include "player_controller.h"
 #include "player_listeners.h"
 #include "message_sender.h"
+#include "es_packet_buffer.h"
+#include "es_packet_pool.h"
+#include "cancellation_token.h"
+#include "latency_controller.h"
+#include "packet_ring.h"
+#include "silent_audio.h"
+#include "stage_latency.h"
+#include "stream_info_cache.h"
+#include "worker_pool.h"
 
 #include "convert_codecs.h"
 
@@ -28,7 +43,11 @@ extern "C" {
 #include "libavcodec/avcodec.h"
 #include "libavutil/dict.h"
 #include "sys/socket.h"
+#ifndef STAV_HOST_BUILD
+// RTSP internals of FFmpeg for the RTP statistics, the system FFmpeg used by
+// the host build doesn't install them.
 #include "rtsp-hack.h"
+#endif
 }
 
 class RTSPPlayerController : public PlayerController,
@@ -45,19 +64,64 @@ class RTSPPlayerController : public PlayerController,
 		///   Player object.
 		/// @param[in] message_sender A <code>MessageSender</code> object pointer
 		///   which will be used to send messages through the communication channel.
+		/// @param[in] stream_info_cache A cache of stream parameters shared by
+		///   all players.
+		/// @param[in] worker_pool Threads shared by all players, the player
+		///   schedules its work onto them.
 		///
 		/// @see RTSPPlayerController::InitPlayer()
 		RTSPPlayerController(const pp::InstanceHandle& instance,
-		                     std::shared_ptr<Communication::MessageSender> message_sender)
+		                     std::shared_ptr<Communication::MessageSender> message_sender,
+		                     std::shared_ptr<StreamInfoCache> stream_info_cache,
+		                     std::shared_ptr<WorkerPool> worker_pool)
 			: PlayerController(),
 			  instance_(instance),
+			  worker_pool_(worker_pool),
+			  priority_(0),
 			  cc_factory_(this),
 			  message_sender_(message_sender),
-			  state_(PlayerState::kUnitialized) {}
+			  stream_info_cache_(stream_info_cache),
+			  validate_stream_info_(false),
+			  replay_start_ms_(0),
+			  has_pending_packet_(false),
+			  is_hevc_(false),
+			  rtp_bits_this_sec_(0),
+			  rtp_stats_last_sent_(0),
+			  reconnect_attempt_(0),
+			  reconnect_delay_ms_(0),
+			  drain_scheduled_(false),
+			  audio_drain_scheduled_(false),
+			  video_ring_overrun_(false),
+			  ring_dropped_gops_(0),
+			  video_packet_pool_(kVideoPayloadCapacity),
+			  audio_packet_pool_(kAudioPayloadCapacity),
+			  video_buffer_(kVideoBufferMaxBytes, true),
+			  audio_buffer_(kAudioBufferMaxBytes, false),
+			  need_video_data_(false),
+			  need_audio_data_(false),
+			  video_bytes_allowed_(0),
+			  audio_bytes_allowed_(0),
+			  end_of_stream_pending_(false),
+			  pipeline_stats_last_sent_(0),
+			  state_(PlayerState::kUnitialized),
+			  format_context_(NULL),
+			  timestamp_offset_(0),
+			  rebase_timestamps_(false),
+			  rebase_on_key_frame_(false),
+			  is_parsing_finished_(false),
+			  is_mute_(false),
+			  audio_output_mode_(kAudioTranscode),
+			  audio_codecpar_(NULL),
+			  audio_time_base_(av_make_q(1, 1)),
+			  audio_decoder_ctx_(NULL),
+			  audio_resample_ctx_(NULL),
+			  audio_timestamp_(0) {}
 
 		/// Destroys an <code>RTSPPlayerController</code> object. This also
 		/// destroys a <code>MediaPlayer</code> object and thus a player pipeline.
-		~RTSPPlayerController() override {};
+		/// Pending network operations are aborted, so it doesn't block on an
+		/// unreachable camera.
+		~RTSPPlayerController() override { CleanPlayer(); }
 
 		/// Initializes NaCl Player and prepares it to play a given content.
 		///
@@ -66,23 +130,104 @@ class RTSPPlayerController : public PlayerController,
 		///
 		/// @param[in] url An address of an RTSP feed to be prepared for a
 		///   playback in NaCl Player.
+		/// @param[in] options Playback options given by the application.
 		/// @see RTSPPlayerController::RTSPPlayerController()
-		void InitPlayer(const std::string& url, const double& audio_level_cb_frequency,
-		                const std::string& crt_path);
+		void InitPlayer(const std::string& url, const PlayerOptions& options);
 
 		// Overloaded methods defined by PlayerController, don't have to be commented
 		void Play() override;
 		void Stop() override;
 		void Mute() override;
 		void SetViewRect(const Samsung::NaClPlayer::Rect& view_rect) override;
+		void SetPriority(int priority) override;
 		PlayerState GetState() override;
-		bool need_video_data_;
-		bool need_audio_data_;
+		void OnTimeUpdate(Samsung::NaClPlayer::TimeTicks time) override;
+
+		/// Returns the bytes a player holds back for both streams unless
+		/// <code>PlayerOptions::max_buffered_bytes</code> limits them.
+		static size_t GetDefaultBufferedBytes();
+
+		/// Informs the controller that NaCl Player needs more packets of the
+		/// given stream. Buffered packets are appended until
+		/// <code>bytes_max</code> bytes have been appended or
+		/// <code>OnEnoughData()</code> is called.
+		///
+		/// @param[in] type A type of the stream which needs data.
+		/// @param[in] bytes_max A number of bytes the player accepts, a
+		///   non-positive value means no limit.
+		/// @see Samsung::NaClPlayer::ElementaryStreamListener::OnNeedData()
+		void OnNeedData(StreamType type, int32_t bytes_max);
+
+		/// Informs the controller that NaCl Player has enough packets of the
+		/// given stream. Incoming packets are buffered from now on.
+		/// @see Samsung::NaClPlayer::ElementaryStreamListener::OnEnoughData()
+		void OnEnoughData(StreamType type);
+
 	private:
+#ifdef STAV_HOST_BUILD
+		/// Drives the ES packet conversion directly, see host/pipeline_bench.cc.
+		friend class PipelineBench;
+#endif
+
 		/// @public
 		/// Marks end of configuration of all media streams.
 		void FinishStreamConfiguration();
-		void InitializeStreams(int32_t, const std::string& url, const std::string& crt_path);
+		/// Opens the input and configures the streams. Called on
+		/// <code>io_strand_</code>.
+		void InitializeStreams(int32_t, const std::string& url);
+
+		/// Opens <code>url</code> using the given RTSP transport.
+		/// @return A negative FFmpeg error code on failure, in which case
+		///   <code>format_context_</code> is NULL.
+		int OpenInput(const std::string& url, const std::string& transport);
+
+		/// Opens a capture file as the input instead of a camera.
+		/// @return A negative FFmpeg error code on failure, in which case
+		///   <code>format_context_</code> is NULL.
+		int OpenReplay(const std::string& path);
+
+		/// Reads the next packet from the camera or, when replaying, from the
+		/// capture file, waiting until it is due if the original timing is kept.
+		/// Called on <code>io_strand_</code>.
+		int ReadPacket(AVPacket* pkt);
+
+		/// Reads the first packet into <code>pending_packet_</code>, giving up
+		/// after a timeout.
+		/// @return True if a packet arrived in time.
+		bool WaitForFirstPacket();
+
+		/// Aborts pending network operations, closes <code>io_strand_</code>,
+		/// <code>audio_strand_</code> and <code>player_strand_</code> and closes
+		/// the input. Reports how long it took. Called on the thread handling
+		/// messages.
+		void StopStreaming();
+
+		/// Starts reopening the input after a network error. The elementary
+		/// streams are kept, so playback continues only if the camera sends the
+		/// same streams. Called on <code>io_strand_</code>.
+		void StartReconnecting();
+
+		/// Closes the input and posts the next <code>Reconnect()</code> after an
+		/// exponential backoff, or gives up after the last attempt. The worker
+		/// is free for other cameras in the meantime. Called on
+		/// <code>io_strand_</code>.
+		void ScheduleReconnect();
+
+		/// Makes one attempt to reopen the input, parsing continues if it
+		/// succeeds. Called on <code>io_strand_</code>.
+		void Reconnect(int32_t);
+
+		/// Fills codec parameters of all streams from the SDP and in-band
+		/// parameter sets, so probing can be skipped.
+		/// @return False if some stream lacks information only probing gives.
+		bool ConfigureStreamsFromSDP();
+		bool ConfigureVideoStreamFromSDP(AVStream* s);
+		bool ConfigureAudioStreamFromSDP(AVStream* s);
+
+		/// Compares the SPS of the first video key frame with the cached
+		/// configuration playback was started with and drops the cache entry if
+		/// they differ. Called on <code>io_strand_</code>.
+		void ValidateCachedStreamInfo(const AVPacket* pkt);
 
 		void OnSetDisplayRect(int32_t);
 
@@ -100,21 +245,159 @@ class RTSPPlayerController : public PlayerController,
 		void UpdateVideoConfig();
 		void UpdateAudioConfig();
 
+		/// Makes an ES packet which takes over the payload buffer of
+		/// <code>pkt</code> if it is reference counted, so no copy is made.
 		std::unique_ptr<ElementaryStreamPacket> MakeESPacketFromAVPacket(AVPacket* pkt);
+
+		/// Makes an ES packet with a copy of the <code>pkt</code> payload.
+		std::unique_ptr<ElementaryStreamPacket> MakeESPacketFromAVPacketCopy(AVPacket* pkt);
+		void SetESPacketTiming(ElementaryStreamPacket* es_packet, AVPacket* pkt);
+		/// Transcodes audio with <code>audio_transcoder_</code>, NULL if no
+		/// packet came out. <code>input_packet</code> is unreferenced.
 		std::unique_ptr<ElementaryStreamPacket> MakeESPacketFromAVPacketTranscode(
-		    AVPacket* input_packet, AVAudioFifo *fifo, AVCodecContext* in_codec_ctx,
-		    AVCodecContext* out_codec_ctx, SwrContext* resample_context,bool);
+		    AVPacket* input_packet, bool is_mute);
+		/// Encodes the next full frame of the transcoder into
+		/// <code>pkt</code> and makes an ES packet of it, NULL if none came out.
+		std::unique_ptr<ElementaryStreamPacket> EncodeTranscodedAudio(AVPacket* pkt);
+		/// Passes an audio packet through, decoding it to meter the level if a
+		/// level report is due soon. The payload is replaced by silence while
+		/// muted.
 		std::unique_ptr<ElementaryStreamPacket> MakeESPacketFromAVPacketDecode(
-		    AVPacket* input_packet, AVCodecContext* in_codec_ctx);
+		    AVPacket* input_packet);
+		/// Makes an ES packet of <code>silent_audio_</code> with the timing of
+		/// <code>input_packet</code>, or of <code>input_packet</code> itself if
+		/// there is no silence for it.
+		std::unique_ptr<ElementaryStreamPacket> MakeESPacketFromSilence(
+		    AVPacket* input_packet);
+		/// Decodes a packet into an ES packet of interleaved 16-bit samples,
+		/// silent ones if <code>is_mute</code> is set.
+		std::unique_ptr<ElementaryStreamPacket> MakeESPacketFromAVPacketPcm(
+		    AVPacket* input_packet, bool is_mute);
+		/// Converts an audio packet as <code>audio_output_mode_</code> says.
+		/// Called on <code>audio_strand_</code>.
+		std::unique_ptr<ElementaryStreamPacket> ConvertAudioPacket(AVPacket* pkt);
+		/// Returns the next packet a converted packet yielded besides the one
+		/// <code>ConvertAudioPacket()</code> returned, NULL once there are no
+		/// more. Only transcoding yields more than one.
+		std::unique_ptr<ElementaryStreamPacket> NextConvertedAudioPacket();
+
+		/// Opens the audio codecs the output mode needs and keeps the audio
+		/// stream parameters for <code>audio_strand_</code>, which can't use
+		/// <code>format_context_</code> while the parser reconnects.
+		/// @return False if audio can't be converted.
+		bool OpenAudioCodecs();
+		/// Frees what <code>OpenAudioCodecs()</code> set up, once
+		/// <code>audio_strand_</code> is closed.
+		void CloseAudioCodecs();
+
+		/// Prepares parsing and posts the first <code>ParsePackets()</code>.
+		/// Called on <code>io_strand_</code>.
 		void StartParsing(int32_t);
+		/// Demuxes packets for a time slice and posts itself again, so cameras
+		/// sharing the I/O workers take turns. Called on <code>io_strand_</code>.
+		void ParsePackets(int32_t);
+		/// Closes the capture once no more packets will be parsed.
+		void FinishParsing();
+		/// Meters a decoded audio frame and reports the level every
+		/// <code>audio_level_cb_frequency_</code> seconds.
 		void calculateAudioLevel(AVFrame *, AVSampleFormat, AVRational);
+		/// Averages a measured level into the reported one and reports it if
+		/// it is due at <code>ts_now</code>.
+		void ReportAudioLevel(const AudioLevel& level,
+		                      Samsung::NaClPlayer::TimeTicks ts_now);
+		/// Expands a G.711 packet into <code>pcm_samples_</code> and meters it.
+		void DecodeG711Packet(AVPacket* pkt);
 
-		typedef std::tuple<
-		Message, std::unique_ptr<ElementaryStreamPacket>> EsPktCallbackData;
+		/// A slot of the rings which carry packets from
+		/// <code>io_strand_</code> and <code>audio_strand_</code> to
+		/// <code>player_strand_</code>.
+		struct EsPktSlot {
+			EsPktSlot() : msg(kError), queued_us(0) {}
+			EsPktSlot(Message message, std::unique_ptr<ElementaryStreamPacket> packet)
+				: msg(message), es_pkt(std::move(packet)),
+				  queued_us(StageLatency::NowUs()) {}
+
+			/// The DTS the rings are merged by, the end of stream goes last.
+			Samsung::NaClPlayer::TimeTicks GetDts() const {
+				return es_pkt ? es_pkt->GetDts() :
+				       std::numeric_limits<Samsung::NaClPlayer::TimeTicks>::max();
+			}
+
+			Message msg;
+			std::unique_ptr<ElementaryStreamPacket> es_pkt;
+			uint64_t queued_us;
+		};
+
+		/// Where the timestamps of a stream have got to, for continuing after
+		/// a reconnect or packets dropped to catch up.
+		struct StreamTimeline {
+			StreamTimeline() : last_packet_end(0), resuming(false) {}
+
+			/// Clears the timeline for a new stream.
+			void Reset() { *this = StreamTimeline(); }
+
+			/// The end of the latest packet demuxed, in player time.
+			Samsung::NaClPlayer::TimeTicks last_packet_end;
+			/// Set by a rebase until a packet of the stream starts after
+			/// <code>last_packet_end</code>, earlier ones are dropped.
+			bool resuming;
+		};
+
+		/// A slot of the ring which carries demuxed audio packets from
+		/// <code>io_strand_</code> to <code>audio_strand_</code>. The slot is
+		/// copied, so the popped copy owns the packet's payload reference.
+		struct AudioJob {
+			AudioJob() : end_of_stream(false), timestamp_offset(0), queued_us(0) {
+				av_init_packet(&pkt);
+				pkt.data = NULL;
+				pkt.size = 0;
+			}
+
+			AVPacket pkt;
+			bool end_of_stream;
+			/// The value of <code>timestamp_offset_</code> when the packet was
+			/// demuxed.
+			Samsung::NaClPlayer::TimeTicks timestamp_offset;
+			uint64_t queued_us;
+		};
+
+		/// Number of ring slots, about 3 s of 30 fps video with 50 audio frames/s.
+		static const size_t kPacketRingSize = 256;
+
+		/// Number of audio packets the audio strand may fall behind by, about
+		/// 1 s of 20 ms packets. More are dropped, so video never waits.
+		static const size_t kAudioRingSize = 64;
+
+		typedef PacketRing<EsPktSlot, kPacketRingSize> EsPktRing;
+
+		/// Limits of packets held back while NaCl Player does not need data.
+		static const size_t kVideoBufferMaxBytes = 4 * 1024 * 1024;
+		static const size_t kAudioBufferMaxBytes = 256 * 1024;
+
+		/// Allowance of a stream NaCl Player did not limit, an allowance of 0
+		/// is used up.
+		static const int64_t kUnlimitedBytes = -1;
+
+		/// Payload bytes reserved in new pooled packets. Video payloads are
+		/// normally borrowed from the demuxer, transcoded audio is copied.
+		static const uint32_t kVideoPayloadCapacity = 0;
+		static const uint32_t kAudioPayloadCapacity = 2048;
 
 		pp::InstanceHandle instance_;
-		std::unique_ptr<pp::SimpleThread> player_thread_;
-		std::unique_ptr<pp::SimpleThread> parser_thread_;
+		std::shared_ptr<WorkerPool> worker_pool_;
+		/// Opens the input and demuxes it on the I/O workers.
+		std::unique_ptr<WorkerPool::Strand> io_strand_;
+		/// Hands packets over to NaCl Player on the processing workers.
+		std::unique_ptr<WorkerPool::Strand> player_strand_;
+		/// Converts audio on the processing workers, so decoding and encoding
+		/// never delay the demuxing of video.
+		std::unique_ptr<WorkerPool::Strand> audio_strand_;
+		/// The priority of all strands of the player, set on the thread
+		/// handling messages.
+		int priority_;
+		/// Guards the <code>player_strand_</code> pointer against
+		/// <code>OnNeedData()</code>, which runs on NaCl Player's thread.
+		pp::Lock player_strand_lock_;
 		pp::CompletionCallbackFactory<RTSPPlayerController> cc_factory_;
 
 		PlayerListeners listeners_;
@@ -125,12 +408,142 @@ class RTSPPlayerController : public PlayerController,
 		std::shared_ptr<Samsung::NaClPlayer::MediaPlayer> player_;
 
 		std::shared_ptr<Communication::MessageSender> message_sender_;
+		std::shared_ptr<StreamInfoCache> stream_info_cache_;
+
+		/// True if streams were configured from the cache and the first key
+		/// frame has not been checked yet.
+		bool validate_stream_info_;
+
+		/// Aborts blocking FFmpeg I/O of <code>format_context_</code>.
+		CancellationToken cancellation_token_;
+
+		/// Writes the packets read when <code>PlayerOptions::capture_path</code>
+		/// is set. Used on <code>io_strand_</code>.
+		CaptureWriter capture_writer_;
+
+		/// The input when a capture is replayed, NULL otherwise.
+		std::unique_ptr<CaptureReader> replay_reader_;
+		/// When replaying started, arrival times of packets are relative to it.
+		uint64_t replay_start_ms_;
+
+		/// A packet read while checking the transport, it is the first one
+		/// handed over to the player.
+		AVPacket pending_packet_;
+		bool has_pending_packet_;
+
+		/// State of parsing kept between <code>ParsePackets()</code> calls.
+		bool is_hevc_;
+		int rtp_bits_this_sec_;
+		uint64_t rtp_stats_last_sent_;
+
+		/// Streams the reopened input has to match, the number of the next
+		/// attempt and the backoff before it.
+		CachedStreamInfo reconnect_stream_info_;
+		int reconnect_attempt_;
+		uint32_t reconnect_delay_ms_;
+
+		/// Queues a packet for <code>player_strand_</code> and wakes it up if it
+		/// is not already draining the rings. Called on <code>io_strand_</code>
+		/// with <code>packet_ring_</code> and on <code>audio_strand_</code> with
+		/// <code>audio_es_ring_</code>.
+		void QueueEsPacket(EsPktRing* ring, Message msg,
+		                   std::unique_ptr<ElementaryStreamPacket> es_pkt);
+		/// Queues the end of stream which did not fit into <code>ring</code>,
+		/// on the strand that tried to queue it.
+		void RetryEndOfStream(int32_t, EsPktRing* ring);
 
-		void EsPktCallback(int32_t, const std::shared_ptr<EsPktCallbackData>& data);
+		/// Appends a batch of queued packets to the player, reschedules itself if
+		/// the rings still hold packets. Called on <code>player_strand_</code>.
+		void DrainEsPackets(int32_t);
+
+		/// Pops the packet with the lowest DTS of those at the head of
+		/// <code>packet_ring_</code> and <code>audio_es_ring_</code>.
+		bool PopEsPacket(EsPktSlot* slot);
+
+		/// Hands a demuxed audio packet, or the end of stream, over to
+		/// <code>audio_strand_</code>. The packet is dropped if the audio strand
+		/// is too far behind. Called on <code>io_strand_</code>.
+		void QueueAudioPacket(AVPacket* pkt, bool end_of_stream);
+		void RetryAudioEndOfStream(int32_t);
+
+		/// Converts a batch of queued audio packets, reschedules itself if the
+		/// ring still holds packets. Called on <code>audio_strand_</code>.
+		void DrainAudioPackets(int32_t);
+
+		/// Computes <code>timestamp_offset_</code> from the first packet kept
+		/// after a reconnect or dropped packets, so it continues right after the
+		/// latest packet of either stream, and tracks where each stream ends.
+		/// Called on <code>io_strand_</code>.
+		///
+		/// @return False if the packet starts before the end of its stream
+		///   after a rebase and has to be dropped.
+		bool RebaseTimestamps(const AVPacket* pkt);
+		void HandleEsPacket(Message msg, std::unique_ptr<ElementaryStreamPacket> es_pkt);
+
+		/// Appends buffered packets as long as NaCl Player wants them and sets
+		/// the end of stream once both buffers are empty. Has to be called on
+		/// <code>player_strand_</code>.
+		void AppendBufferedPackets();
+		void AppendFromBuffer(ESPacketBuffer* buffer, ESPacketPool* pool,
+		                      Samsung::NaClPlayer::ElementaryStream* stream,
+		                      const std::atomic<bool>* need_data,
+		                      int64_t* bytes_allowed);
+		/// Takes the allowance of <code>OnNeedData()</code> over on
+		/// <code>player_strand_</code> and appends what is buffered.
+		void OnNeedDataOnPlayerStrand(int32_t, StreamType type, int32_t bytes_max);
+		void SendPipelineStats();
+#ifndef STAV_HOST_BUILD
 		void RTPCheckAndSendBackStats(RTPDemuxContext *s, uint64_t *stats_last_sent,
 		                              int *bits_this_sec);
+#endif
+
+		/// Video from <code>io_strand_</code>.
+		EsPktRing packet_ring_;
+		/// Converted audio from <code>audio_strand_</code>.
+		EsPktRing audio_es_ring_;
+		PacketRing<AudioJob, kAudioRingSize> audio_ring_;
+
+		/// True while a <code>DrainEsPackets()</code> call is posted or running.
+		std::atomic<bool> drain_scheduled_;
+		/// True while a <code>DrainAudioPackets()</code> call is posted or running.
+		std::atomic<bool> audio_drain_scheduled_;
+		/// True from a video packet which didn't fit into
+		/// <code>packet_ring_</code> to the next keyframe, the pictures in
+		/// between can't be decoded. Used on <code>io_strand_</code>.
+		bool video_ring_overrun_;
+		/// GOPs cut short that way.
+		std::atomic<uint32_t> ring_dropped_gops_;
+
+		/// Time audio packets spend waiting for <code>audio_strand_</code>,
+		/// being converted on it and waiting for <code>player_strand_</code>.
+		StageLatency audio_queue_wait_;
+		StageLatency audio_convert_time_;
+		StageLatency audio_handoff_wait_;
+
+		ESPacketPool video_packet_pool_;
+		ESPacketPool audio_packet_pool_;
+
+		/// Accessed on <code>player_strand_</code> only.
+		ESPacketBuffer video_buffer_;
+		ESPacketBuffer audio_buffer_;
+
+		/// Set by the NaCl Player listeners, read on <code>player_strand_</code>.
+		std::atomic<bool> need_video_data_;
+		std::atomic<bool> need_audio_data_;
+		/// Accessed on <code>player_strand_</code> only. Nothing is appended
+		/// while an allowance is 0, <code>kUnlimitedBytes</code> means no limit.
+		int64_t video_bytes_allowed_;
+		int64_t audio_bytes_allowed_;
+
+		bool end_of_stream_pending_;
+		uint64_t pipeline_stats_last_sent_;
 
-		PlayerState state_;
+		PlayerOptions options_;
+		std::string url_;
+		std::string transport_;
+		/// Written on <code>io_strand_</code>, read on the thread handling
+		/// messages.
+		std::atomic<PlayerState> state_;
 		Samsung::NaClPlayer::Rect view_rect_;
 
 		AVFormatContext* format_context_;
@@ -138,13 +551,46 @@ class RTSPPlayerController : public PlayerController,
 		int audio_stream_idx_;
 		VideoConfig video_config_;
 		AudioConfig audio_config_;
-		Samsung::NaClPlayer::TimeTicks timestamp_;
-		bool is_parsing_finished_;
-		bool is_mute_;
+		/// An offset added to the timestamps of both streams, so they continue
+		/// where playback left off and stay in sync. It is computed again from
+		/// the next packet kept if <code>rebase_timestamps_</code> is set, which
+		/// has to be a video keyframe if <code>rebase_on_key_frame_</code> is set
+		/// too. Used on <code>io_strand_</code>.
+		Samsung::NaClPlayer::TimeTicks timestamp_offset_;
+		bool rebase_timestamps_;
+		bool rebase_on_key_frame_;
+		StreamTimeline video_timeline_;
+		StreamTimeline audio_timeline_;
+		std::minstd_rand reconnect_rng_;
+		LatencyController latency_controller_;
+		std::atomic<bool> is_parsing_finished_;
+		/// Set on the main thread, read on the audio strand for every audio
+		/// packet.
+		std::atomic<bool> is_mute_;
+		/// The RMS level and the peak in decibels, see
+		/// <code>AudioLevelToDecibels()</code>.
 		float audio_level_;
+		float audio_peak_;
+		/// True if the previous passed through audio packet was decoded.
+		bool audio_decoder_primed_;
 		double prev_audio_ts_;
 		double audio_level_cb_frequency_;
-		bool is_transcode;
+		/// Set by <code>UpdateAudioConfig()</code> from the audio codec.
+		AudioOutputMode audio_output_mode_;
+		/// Interleaved 16-bit samples of the latest frame in
+		/// <code>kAudioPcm</code> mode or of the latest G.711 packet.
+		std::vector<uint8_t> pcm_samples_;
+		SilentAudio silent_audio_;
+		/// Used on the audio strand in <code>kAudioTranscode</code> mode.
+		AudioTranscoder audio_transcoder_;
+		/// Set up by <code>OpenAudioCodecs()</code> and used on the audio
+		/// strand, so it doesn't touch <code>format_context_</code>.
+		AVCodecParameters* audio_codecpar_;
+		AVRational audio_time_base_;
+		AVCodecContext* audio_decoder_ctx_;
+		SwrContext* audio_resample_ctx_;
+		/// The timestamp offset of the audio packet being converted.
+		Samsung::NaClPlayer::TimeTicks audio_timestamp_;
 };
 
 #endif
@@ -0,0 +1,125 @@
+#include "silent_audio.h"
+
+extern "C" {
+#include "libavutil/channel_layout.h"
+#include "libavutil/samplefmt.h"
+}
+
+#include "codec_config_parser.h"
+#include "common.h"
+
+/// Encoders buffer a few frames before the first packet comes out.
+static const int kMaxPrimingFrames = 16;
+/// Samples per channel encoded for PCM codecs, more than an RTP packet holds.
+static const int kPcmSilenceSamples = 8192;
+/// The only AAC object type the FFmpeg encoder produces.
+static const int kAACObjectTypeLC = 2;
+
+bool SilentAudio::Init(const AVCodecParameters* codecpar) {
+	Reset();
+	int sample_rate = codecpar->sample_rate;
+	int channels = codecpar->channels;
+	int profile = FF_PROFILE_UNKNOWN;
+	if (codecpar->codec_id == AV_CODEC_ID_AAC) {
+		// codecpar describes the output of HE-AAC, a frame of silence only
+		// has the core in it. Implicitly signalled SBR needs the profile.
+		AACConfigInfo aac;
+		if (ParseAACAudioSpecificConfig(codecpar->extradata,
+		                                codecpar->extradata_size, &aac)) {
+			if (aac.core_object_type != kAACObjectTypeLC) {
+				LOG_INFO("No encoder for AAC object type %d, muted audio will "
+				         "play unmuted", aac.core_object_type);
+				return false;
+			}
+			sample_rate = aac.core_sample_rate;
+			channels = aac.core_channels;
+		}
+		if (codecpar->profile == FF_PROFILE_AAC_HE ||
+		    codecpar->profile == FF_PROFILE_AAC_HE_V2) {
+			if (sample_rate == codecpar->sample_rate)
+				sample_rate /= 2;
+			if (codecpar->profile == FF_PROFILE_AAC_HE_V2)
+				channels = 1;
+		}
+		profile = FF_PROFILE_AAC_LOW;
+	}
+
+	AVCodec* codec = avcodec_find_encoder(codecpar->codec_id);
+	if (!codec) {
+		LOG_INFO("No encoder for codec %d, muted audio will play unmuted",
+		         codecpar->codec_id);
+		return false;
+	}
+
+	AVCodecContext* codec_ctx = avcodec_alloc_context3(codec);
+	AVFrame* frame = av_frame_alloc();
+	AVPacket* pkt = av_packet_alloc();
+	if (!codec_ctx || !frame || !pkt) {
+		avcodec_free_context(&codec_ctx);
+		av_frame_free(&frame);
+		av_packet_free(&pkt);
+		return false;
+	}
+	// Only the codec, the profile, the rate and the channels have to match
+	// the stream, any other encoder settings give the same silence.
+	codec_ctx->profile = profile;
+	codec_ctx->sample_rate = sample_rate;
+	codec_ctx->channels = channels;
+	codec_ctx->channel_layout =
+	    codecpar->channel_layout && channels == codecpar->channels ?
+	    codecpar->channel_layout : av_get_default_channel_layout(channels);
+	codec_ctx->sample_fmt = codec->sample_fmts ? codec->sample_fmts[0] :
+	                        AV_SAMPLE_FMT_S16;
+	codec_ctx->time_base.num = 1;
+	codec_ctx->time_base.den = sample_rate;
+	codec_ctx->strict_std_compliance = FF_COMPLIANCE_EXPERIMENTAL;
+
+	int ret = avcodec_open2(codec_ctx, codec, NULL);
+	if (ret >= 0) {
+		is_pcm_ = codec_ctx->frame_size <= 0;
+		frame->nb_samples = is_pcm_ ? kPcmSilenceSamples : codec_ctx->frame_size;
+		frame->format = codec_ctx->sample_fmt;
+		frame->channels = codec_ctx->channels;
+		frame->channel_layout = codec_ctx->channel_layout;
+		frame->sample_rate = codec_ctx->sample_rate;
+		ret = av_frame_get_buffer(frame, 0);
+	}
+	if (ret >= 0) {
+		av_samples_set_silence(frame->extended_data, 0, frame->nb_samples,
+		                       frame->channels, codec_ctx->sample_fmt);
+		for (int i = 0; i < kMaxPrimingFrames && payload_.empty(); ++i) {
+			frame->pts = static_cast<int64_t>(i) * frame->nb_samples;
+			if ((ret = avcodec_send_frame(codec_ctx, frame)) < 0)
+				break;
+			if (avcodec_receive_packet(codec_ctx, pkt) == 0) {
+				payload_.assign(pkt->data, pkt->data + pkt->size);
+				av_packet_unref(pkt);
+			}
+		}
+	}
+
+	if (payload_.empty())
+		LOG_ERROR("Could not encode silence for codec %d (error %d), muted "
+		          "audio will play unmuted", codecpar->codec_id, ret);
+	else
+		LOG_INFO("Silence for codec %d encoded at %d Hz, %d channels, %u bytes",
+		         codecpar->codec_id, sample_rate, channels,
+		         static_cast<unsigned>(payload_.size()));
+	avcodec_free_context(&codec_ctx);
+	av_frame_free(&frame);
+	av_packet_free(&pkt);
+	return !payload_.empty();
+}
+
+void SilentAudio::Reset() {
+	payload_.clear();
+	is_pcm_ = false;
+}
+
+const uint8_t* SilentAudio::GetPayload(size_t packet_size, size_t* size) const {
+	if (payload_.empty() || (is_pcm_ && packet_size > payload_.size()))
+		return NULL;
+	// PCM silence repeats every sample, so any whole number of them is silent.
+	*size = is_pcm_ ? packet_size : payload_.size();
+	return payload_.data();
+}
@@ -0,0 +1,55 @@
+#ifndef SILENT_AUDIO_H_
+#define SILENT_AUDIO_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+extern "C" {
+#include "libavcodec/avcodec.h"
+}
+
+/// @file
+/// @brief This file defines the <code>SilentAudio</code> class.
+
+/// @class SilentAudio
+/// @brief Silence encoded with the codec of a passed through audio stream.
+///
+/// It is encoded once when the stream starts, so a muted stream only has the
+/// payload of its packets replaced and nothing is decoded or encoded. HE-AAC
+/// gets a silent AAC LC frame of its core, which the decoder extends with
+/// the SBR and parametric stereo it is configured for.
+class SilentAudio {
+	public:
+		SilentAudio() : is_pcm_(false) {}
+
+		SilentAudio(const SilentAudio&) = delete;
+		SilentAudio& operator=(const SilentAudio&) = delete;
+
+		/// Encodes silence with the codec, sample rate and channels of
+		/// <code>codecpar</code>, or of the AAC core its AudioSpecificConfig
+		/// describes.
+		///
+		/// @return False if FFmpeg can't encode the codec or the AAC core.
+		bool Init(const AVCodecParameters* codecpar);
+
+		/// Drops the encoded silence.
+		void Reset();
+
+		/// Returns the payload to replace a packet of <code>packet_size</code>
+		/// bytes with. Codecs with frames get one silent frame, PCM codecs get
+		/// as many silent samples as the packet holds.
+		///
+		/// @param[out] size A size of the returned payload.
+		/// @return NULL if there is no silence for the packet.
+		const uint8_t* GetPayload(size_t packet_size, size_t* size) const;
+
+	private:
+		std::vector<uint8_t> payload_;
+		/// True for codecs without frames, where any number of samples is a
+		/// valid packet.
+		bool is_pcm_;
+};
+
+#endif  // SILENT_AUDIO_H_
@@ -0,0 +1,56 @@
+#ifndef STAGE_LATENCY_H_
+#define STAGE_LATENCY_H_
+
+#include <stdint.h>
+#include <time.h>
+
+#include <atomic>
+
+/// @file
+/// @brief This file defines the <code>StageLatency</code> class.
+
+/// @class StageLatency
+/// @brief Time spent by packets in one stage of the pipeline.
+///
+/// One thread adds samples, another one takes the average and the maximum
+/// since it last took them, e.g. when pipeline statistics are sent. Both
+/// sides are lock-free.
+class StageLatency {
+	public:
+		StageLatency() : sum_us_(0), count_(0), max_us_(0) {}
+
+		StageLatency(const StageLatency&) = delete;
+		StageLatency& operator=(const StageLatency&) = delete;
+
+		/// Adds the time a packet spent in the stage.
+		void Add(uint64_t us) {
+			sum_us_.fetch_add(us, std::memory_order_relaxed);
+			count_.fetch_add(1, std::memory_order_relaxed);
+			uint64_t max = max_us_.load(std::memory_order_relaxed);
+			while (us > max &&
+			       !max_us_.compare_exchange_weak(max, us, std::memory_order_relaxed)) {}
+		}
+
+		/// Returns the average and the maximum in microseconds since the
+		/// previous call and starts over. Both are 0 if nothing was added.
+		void Take(uint32_t* average_us, uint32_t* max_us) {
+			uint64_t sum = sum_us_.exchange(0, std::memory_order_relaxed);
+			uint64_t count = count_.exchange(0, std::memory_order_relaxed);
+			*average_us = count ? static_cast<uint32_t>(sum / count) : 0;
+			*max_us = static_cast<uint32_t>(max_us_.exchange(0, std::memory_order_relaxed));
+		}
+
+		/// Returns a monotonic time in microseconds.
+		static uint64_t NowUs() {
+			struct timespec ts;
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			return static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+		}
+
+	private:
+		std::atomic<uint64_t> sum_us_;
+		std::atomic<uint64_t> count_;
+		std::atomic<uint64_t> max_us_;
+};
+
+#endif  // STAGE_LATENCY_H_
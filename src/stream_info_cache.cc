@@ -0,0 +1,237 @@
+#include "stream_info_cache.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/mount.h>
+
+#include <fstream>
+#include <sstream>
+
+#include "common.h"
+
+using pp::AutoLock;
+
+static const char* kPersistentMountPoint = "/persistent";
+static const char* kPersistentMountData = "type=PERSISTENT,expected_size=1048576";
+static const char* kCacheFilePath = "/persistent/stream_info_cache";
+
+static std::string ToHex(const std::vector<uint8_t>& data) {
+	static const char kDigits[] = "0123456789abcdef";
+	std::string hex;
+	hex.reserve(data.size() * 2);
+	for (uint8_t byte : data) {
+		hex.push_back(kDigits[byte >> 4]);
+		hex.push_back(kDigits[byte & 0x0F]);
+	}
+	return hex;
+}
+
+static bool FromHex(const std::string& hex, std::vector<uint8_t>* data) {
+	if (hex.size() % 2)
+		return false;
+	data->clear();
+	data->reserve(hex.size() / 2);
+	for (size_t i = 0; i < hex.size(); i += 2) {
+		unsigned int byte;
+		if (sscanf(hex.c_str() + i, "%2x", &byte) != 1)
+			return false;
+		data->push_back(static_cast<uint8_t>(byte));
+	}
+	return true;
+}
+
+StreamInfoCache::StreamInfoCache() : persistent_(false) {}
+
+void StreamInfoCache::EnablePersistence() {
+	AutoLock critical_section(lock_);
+	if (persistent_)
+		return;
+
+	LOG_INFO("mounting html5fs @ %s", kPersistentMountPoint);
+	if (mount("", kPersistentMountPoint, "html5fs", 0, kPersistentMountData) != 0) {
+		LOG_ERROR("Failed to mount html5fs, stream info won't be persisted");
+		return;
+	}
+	persistent_ = true;
+	Load();
+}
+
+bool StreamInfoCache::Lookup(const std::string& url, CachedStreamInfo* info) {
+	AutoLock critical_section(lock_);
+	auto it = entries_.find(MakeKey(url));
+	if (it == entries_.end())
+		return false;
+	*info = it->second;
+	return true;
+}
+
+void StreamInfoCache::Store(const std::string& url,
+                            const CachedStreamInfo& info) {
+	AutoLock critical_section(lock_);
+	entries_[MakeKey(url)] = info;
+	if (persistent_)
+		Save();
+}
+
+void StreamInfoCache::Invalidate(const std::string& url) {
+	AutoLock critical_section(lock_);
+	if (entries_.erase(MakeKey(url)) && persistent_)
+		Save();
+}
+
+std::string StreamInfoCache::MakeKey(const std::string& url) {
+	size_t authority = url.find("://");
+	if (authority == std::string::npos)
+		return url;
+	authority += strlen("://");
+
+	size_t path = url.find('/', authority);
+	size_t at = url.rfind('@', path);
+	if (at == std::string::npos || at < authority)
+		return url;
+	return url.substr(0, authority) + url.substr(at + 1);
+}
+
+void StreamInfoCache::Capture(AVFormatContext* format_context,
+                              const std::string& transport,
+                              CachedStreamInfo* info) {
+	info->transport = transport;
+	info->streams.clear();
+	for (unsigned i = 0; i < format_context->nb_streams; ++i) {
+		const AVStream* s = format_context->streams[i];
+		const AVCodecParameters* par = s->codecpar;
+		CachedStreamParameters params;
+		params.codec_type = par->codec_type;
+		params.codec_id = par->codec_id;
+		params.codec_tag = par->codec_tag;
+		params.profile = par->profile;
+		params.level = par->level;
+		params.format = par->format;
+		params.width = par->width;
+		params.height = par->height;
+		params.sample_rate = par->sample_rate;
+		params.channels = par->channels;
+		params.channel_layout = par->channel_layout;
+		params.bits_per_raw_sample = par->bits_per_raw_sample;
+		params.frame_rate_num = s->r_frame_rate.num;
+		params.frame_rate_den = s->r_frame_rate.den;
+		if (par->extradata_size > 0)
+			params.extradata.assign(par->extradata,
+			                        par->extradata + par->extradata_size);
+		info->streams.push_back(params);
+	}
+}
+
+bool StreamInfoCache::Apply(const CachedStreamInfo& info,
+                            AVFormatContext* format_context) {
+	if (info.streams.size() != format_context->nb_streams)
+		return false;
+
+	for (unsigned i = 0; i < format_context->nb_streams; ++i) {
+		const AVCodecParameters* par = format_context->streams[i]->codecpar;
+		const CachedStreamParameters& params = info.streams[i];
+		if (params.codec_type != par->codec_type || params.codec_id != par->codec_id)
+			return false;
+
+		// Parameter sets announced in the SDP are up to date, so they have to
+		// agree with the cached ones.
+		if (par->extradata_size > 0 && !params.extradata.empty() &&
+		    (params.extradata.size() != static_cast<size_t>(par->extradata_size) ||
+		     memcmp(&params.extradata.front(), par->extradata, par->extradata_size))) {
+			LOG_INFO("Stream %u parameter sets differ from the cached ones", i);
+			return false;
+		}
+	}
+
+	for (unsigned i = 0; i < format_context->nb_streams; ++i) {
+		AVStream* s = format_context->streams[i];
+		AVCodecParameters* par = s->codecpar;
+		const CachedStreamParameters& params = info.streams[i];
+		par->codec_tag = params.codec_tag;
+		par->profile = params.profile;
+		par->level = params.level;
+		par->format = params.format;
+		par->width = params.width;
+		par->height = params.height;
+		par->sample_rate = params.sample_rate;
+		par->channels = params.channels;
+		par->channel_layout = params.channel_layout;
+		par->bits_per_raw_sample = params.bits_per_raw_sample;
+		s->r_frame_rate.num = params.frame_rate_num;
+		s->r_frame_rate.den = params.frame_rate_den;
+
+		if (par->extradata_size == 0 && !params.extradata.empty()) {
+			par->extradata = static_cast<uint8_t*>(av_mallocz(
+			    params.extradata.size() + AV_INPUT_BUFFER_PADDING_SIZE));
+			if (!par->extradata)
+				return false;
+			memcpy(par->extradata, &params.extradata.front(), params.extradata.size());
+			par->extradata_size = params.extradata.size();
+		}
+	}
+	return true;
+}
+
+// The file holds one "entry <key> <transport> <stream count>" line per camera
+// followed by one "stream ..." line per stream.
+void StreamInfoCache::Load() {
+	std::ifstream file(kCacheFilePath);
+	if (!file) {
+		LOG_INFO("No persisted stream info");
+		return;
+	}
+
+	std::string line;
+	while (std::getline(file, line)) {
+		std::istringstream entry_line(line);
+		std::string tag, key;
+		size_t count = 0;
+		CachedStreamInfo info;
+		if (!(entry_line >> tag >> key >> info.transport >> count) || tag != "entry")
+			continue;
+
+		bool valid = true;
+		for (size_t i = 0; i < count && valid; ++i) {
+			CachedStreamParameters params;
+			std::string extradata;
+			valid = static_cast<bool>(std::getline(file, line));
+			std::istringstream stream_line(line);
+			valid = valid &&
+			        (stream_line >> tag >> params.codec_type >> params.codec_id >>
+			         params.codec_tag >> params.profile >> params.level >>
+			         params.format >> params.width >> params.height >>
+			         params.sample_rate >> params.channels >>
+			         params.channel_layout >> params.bits_per_raw_sample >>
+			         params.frame_rate_num >> params.frame_rate_den) &&
+			        tag == "stream";
+			if (valid && stream_line >> extradata && extradata != "-")
+				valid = FromHex(extradata, &params.extradata);
+			info.streams.push_back(params);
+		}
+		if (valid)
+			entries_[key] = info;
+	}
+	LOG_INFO("Loaded stream info of %u cameras",
+	         static_cast<unsigned>(entries_.size()));
+}
+
+void StreamInfoCache::Save() {
+	std::ofstream file(kCacheFilePath, std::ios::trunc);
+	for (const auto& entry : entries_) {
+		const CachedStreamInfo& info = entry.second;
+		file << "entry " << entry.first << ' ' << info.transport << ' '
+		     << info.streams.size() << '\n';
+		for (const CachedStreamParameters& params : info.streams) {
+			file << "stream " << params.codec_type << ' ' << params.codec_id << ' '
+			     << params.codec_tag << ' ' << params.profile << ' ' << params.level
+			     << ' ' << params.format << ' ' << params.width << ' '
+			     << params.height << ' ' << params.sample_rate << ' '
+			     << params.channels << ' ' << params.channel_layout << ' '
+			     << params.bits_per_raw_sample << ' ' << params.frame_rate_num << ' '
+			     << params.frame_rate_den << ' '
+			     << (params.extradata.empty() ? "-" : ToHex(params.extradata)) << '\n';
+		}
+	}
+	if (!file)
+		LOG_ERROR("Failed to save stream info to %s", kCacheFilePath);
+}
@@ -0,0 +1,120 @@
+#ifndef STREAM_INFO_CACHE_H_
+#define STREAM_INFO_CACHE_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "ppapi/utility/threading/lock.h"
+
+extern "C" {
+#include "libavformat/avformat.h"
+}
+
+/// @file
+/// @brief This file defines the <code>StreamInfoCache</code> class.
+
+/// @struct CachedStreamParameters
+/// @brief Codec parameters of a single stream, as they were found by probing
+/// or read from the SDP.
+struct CachedStreamParameters {
+	CachedStreamParameters()
+		: codec_type(AVMEDIA_TYPE_UNKNOWN), codec_id(AV_CODEC_ID_NONE),
+		  codec_tag(0), profile(0), level(0), format(-1), width(0), height(0),
+		  sample_rate(0), channels(0), channel_layout(0), bits_per_raw_sample(0),
+		  frame_rate_num(0), frame_rate_den(0) {}
+
+	int codec_type;
+	int codec_id;
+	uint32_t codec_tag;
+	int profile;
+	int level;
+	int format;
+	int width;
+	int height;
+	int sample_rate;
+	int channels;
+	uint64_t channel_layout;
+	int bits_per_raw_sample;
+
+	/// The frame rate observed for video streams.
+	int frame_rate_num;
+	int frame_rate_den;
+	std::vector<uint8_t> extradata;
+};
+
+/// @struct CachedStreamInfo
+/// @brief Everything needed to configure playback of a camera without
+/// probing it.
+struct CachedStreamInfo {
+	/// The RTSP transport which worked for this camera.
+	std::string transport;
+
+	/// Parameters of all streams in the SDP order.
+	std::vector<CachedStreamParameters> streams;
+};
+
+/// @class StreamInfoCache
+/// @brief A cache of stream parameters of cameras, so they don't have to be
+/// probed on every connection.
+///
+/// Entries are keyed by the camera URL stripped of credentials. They are kept
+/// in memory and, once <code>EnablePersistence()</code> is called, in a file on
+/// a persistent html5fs mount as well.
+///
+/// This class is thread safe.
+class StreamInfoCache {
+	public:
+		StreamInfoCache();
+
+		StreamInfoCache(const StreamInfoCache&) = delete;
+		StreamInfoCache& operator=(const StreamInfoCache&) = delete;
+
+		/// Mounts the persistent file system and loads entries stored by
+		/// previous sessions. Subsequent calls do nothing.
+		///
+		/// @note Has to be called on a background thread, html5fs can't be
+		///   mounted on the main thread.
+		void EnablePersistence();
+
+		/// Looks up an entry of a camera.
+		///
+		/// @param[in] url A camera URL, it may contain credentials.
+		/// @param[out] info The cached entry.
+		/// @return True if an entry was found.
+		bool Lookup(const std::string& url, CachedStreamInfo* info);
+
+		/// Adds or replaces an entry of a camera.
+		void Store(const std::string& url, const CachedStreamInfo& info);
+
+		/// Removes an entry of a camera, e.g. when it no longer matches the
+		/// stream.
+		void Invalidate(const std::string& url);
+
+		/// Returns <code>url</code> without the user name and password.
+		static std::string MakeKey(const std::string& url);
+
+		/// Reads parameters of all streams of an opened input.
+		static void Capture(AVFormatContext* format_context,
+		                    const std::string& transport, CachedStreamInfo* info);
+
+		/// Fills codec parameters of an opened input from a cached entry. Nothing
+		/// is changed if the entry does not match the streams described by the
+		/// SDP.
+		///
+		/// @return True if the entry was applied.
+		static bool Apply(const CachedStreamInfo& info,
+		                  AVFormatContext* format_context);
+
+	private:
+		void Load();
+		void Save();
+
+		pp::Lock lock_;
+		std::map<std::string, CachedStreamInfo> entries_;
+		bool persistent_;
+};
+
+#endif  // STREAM_INFO_CACHE_H_
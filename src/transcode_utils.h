@@ -6,6 +6,7 @@
 
 #include <stdio.h>
 #include "common.h"
+#include "convert_codecs.h"
 
 extern "C" {
 #include "libavformat/avformat.h"
@@ -23,19 +24,8 @@ extern "C" {
 }
 
 
-/**
- * Convert an error code into a text message.
- * @param error Error code to be converted
- * @return Corresponding error text (not thread-safe)
- */
-static const char *get_error_text(const int error) {
-	static char error_buffer[255];
-	av_strerror(error, error_buffer, sizeof(error_buffer));
-	return error_buffer;
-}
-
 /** Initialize one data packet for reading or writing. */
-static void init_packet(AVPacket *packet) {
+static inline void init_packet(AVPacket *packet) {
 	av_init_packet(packet);
 	/** Set the packet data and size so that it is recognized as being empty. */
 	packet->data = NULL;
@@ -43,7 +33,7 @@ static void init_packet(AVPacket *packet) {
 }
 
 /** Initialize one audio frame for reading from the input file */
-static int init_input_frame(AVFrame **frame) {
+static inline int init_input_frame(AVFrame **frame) {
 	if (!(*frame = av_frame_alloc())) {
 		LOG_ERROR("Could not allocate input frame");
 		return AVERROR(ENOMEM);
@@ -56,9 +46,9 @@ static int init_input_frame(AVFrame **frame) {
  * If the input and output sample formats differ, a conversion is required
  * libswresample takes care of this, but requires initialization.
  */
-static int init_resampler(AVCodecContext *input_codec_context,
-                          AVCodecContext *output_codec_context,
-                          SwrContext **resample_context) {
+static inline int init_resampler(AVCodecContext *input_codec_context,
+                                 AVCodecContext *output_codec_context,
+                                 SwrContext **resample_context) {
 	int error;
 
 	/**
@@ -96,155 +86,7 @@ static int init_resampler(AVCodecContext *input_codec_context,
 	return 0;
 }
 
-/** Initialize a FIFO buffer for the audio samples to be encoded. */
-static int init_fifo(AVAudioFifo **fifo, AVCodecContext *output_codec_context) {
-	/** Create the FIFO buffer based on the specified output sample format. */
-	if (!(*fifo = av_audio_fifo_alloc(output_codec_context->sample_fmt,
-	                                  output_codec_context->channels, 1))) {
-		LOG_ERROR("Could not allocate FIFO");
-		return AVERROR(ENOMEM);
-	}
-	return 0;
-}
-
-/**
- * Initialize a temporary storage for the specified number of audio samples.
- * The conversion requires temporary storage due to the different format.
- * The number of audio samples to be allocated is specified in frame_size.
- */
-static int init_converted_samples(uint8_t ***converted_input_samples,
-                                  AVCodecContext *output_codec_context,
-                                  int frame_size) {
-	int error;
-
-	/**
-	 * Allocate as many pointers as there are audio channels.
-	 * Each pointer will later point to the audio samples of the corresponding
-	 * channels (although it may be NULL for interleaved formats).
-	 */
-	if (!(*converted_input_samples = (uint8_t **)calloc(output_codec_context->channels,
-	                                 sizeof(**converted_input_samples)))) {
-		LOG_ERROR("Could not allocate converted input sample pointers");
-		return AVERROR(ENOMEM);
-	}
-
-	/**
-	 * Allocate memory for the samples of all channels in one consecutive
-	 * block for convenience.
-	 */
-	if ((error = av_samples_alloc(*converted_input_samples, NULL,
-	                              output_codec_context->channels,
-	                              frame_size,
-	                              output_codec_context->sample_fmt, 0)) < 0) {
-		LOG_ERROR("Could not allocate converted input samples (error '%s')",
-		          get_error_text(error));
-		av_freep(&(*converted_input_samples)[0]);
-		free(*converted_input_samples);
-		return error;
-	}
-	return 0;
-}
-
-/**
- * Convert the input audio samples into the output sample format.
- * The conversion happens on a per-frame basis, the size of which is specified
- * by frame_size.
- */
-static int convert_samples(const AVFrame *input_frame, uint8_t **converted_data,
-                           SwrContext *resample_context, AVSampleFormat avformat, bool isMute) {
-	int error;
-
-	const uint8_t **input_data = (const uint8_t **)input_frame->extended_data;
-	const int frame_size = (const int)input_frame->nb_samples;
-	if (isMute==true) {
-		if ((error = av_samples_set_silence(converted_data, 0,
-		                                    input_frame->nb_samples, input_frame->channels,
-		                                    avformat)) < 0) {
-			LOG_ERROR("Set silence frame failed",
-			          get_error_text(error));
-		}
-	} else {
-		/** Convert the samples using the resampler. */
-		if ((error = swr_convert(resample_context,
-		                         converted_data, frame_size,
-		                         input_data    , frame_size)) < 0) {
-			LOG_ERROR("Could not convert input samples (error '%s')",
-			          get_error_text(error));
-			return error;
-		}
-	}
-
-	return 0;
-}
-
-/** Add converted input audio samples to the FIFO buffer for later processing. */
-static int add_samples_to_fifo(AVAudioFifo *fifo, uint8_t **converted_input_samples,
-                               const int frame_size) {
-	int error;
-
-	/**
-	 * Make the FIFO as large as it needs to be to hold both,
-	 * the old and the new samples.
-	 */
-	if ((error = av_audio_fifo_realloc(fifo, av_audio_fifo_size(fifo) + frame_size)) < 0) {
-		LOG_ERROR("Could not reallocate FIFO");
-		return error;
-	}
-
-	/** Store the new samples in the FIFO buffer. */
-	if (av_audio_fifo_write(fifo, (void **)converted_input_samples,
-	                        frame_size) < frame_size) {
-		LOG_ERROR("Could not write data to FIFO");
-		return AVERROR_EXIT;
-	}
-	av_freep(&(converted_input_samples)[0]);
-	free(converted_input_samples);
-	return 0;
-}
-
-/**
- * Initialize one input frame for writing to the output file.
- * The frame will be exactly frame_size samples large.
- */
-static int init_output_frame(AVFrame **frame, AVCodecContext *output_codec_context,
-                             int frame_size) {
-	int error;
-
-	/** Create a new frame to store the audio samples. */
-	if (!(*frame = av_frame_alloc())) {
-		LOG_ERROR("Could not allocate output frame");
-		return AVERROR_EXIT;
-	}
-
-	/**
-	 * Set the frame's parameters, especially its size and format.
-	 * av_frame_get_buffer needs this to allocate memory for the
-	 * audio samples of the frame.
-	 * Default channel layouts based on the number of channels
-	 * are assumed for simplicity.
-	 */
-
-	(*frame)->nb_samples     = frame_size;
-	(*frame)->channels       = output_codec_context->channels;
-	(*frame)->channel_layout = av_get_default_channel_layout((*frame)->channels);
-	(*frame)->format         = output_codec_context->sample_fmt;
-	(*frame)->sample_rate    = output_codec_context->sample_rate;
-
-	/**
-	 * Allocate the samples of the created frame. This call will make
-	 * sure that the audio frame can hold as many samples as specified.
-	 */
-	if ((error = av_frame_get_buffer(*frame, 0)) < 0) {
-		LOG_ERROR("Could not allocate output frame samples (error '%s')",
-		          get_error_text(error));
-		av_frame_free(frame);
-		return error;
-	}
-
-	return 0;
-}
-
-static int flush_encoder(AVCodecContext *avctx) {
+static inline int flush_encoder(AVCodecContext *avctx) {
 	int ret;
 	AVPacket pkt;
 	init_packet(&pkt);
@@ -269,7 +111,7 @@ static int flush_encoder(AVCodecContext *avctx) {
 	return 0;
 }
 
-static int flush_decoder(AVCodecContext *avctx) {
+static inline int flush_decoder(AVCodecContext *avctx) {
 	int ret;
 	AVFrame *input_frame;
 	init_input_frame(&input_frame);
@@ -295,7 +137,7 @@ static int flush_decoder(AVCodecContext *avctx) {
 }
 
 // https://blogs.gentoo.org/lu_zero/tag/api/
-int encode(AVCodecContext *avctx, AVPacket *pkt, int *got_packet, AVFrame *frame) {
+static inline int encode(AVCodecContext *avctx, AVPacket *pkt, int *got_packet, AVFrame *frame) {
 	int ret;
 
 	*got_packet = 0;
@@ -316,7 +158,7 @@ int encode(AVCodecContext *avctx, AVPacket *pkt, int *got_packet, AVFrame *frame
 	return ret;
 }
 
-int decode(AVCodecContext *avctx, AVFrame *frame, int *got_frame, AVPacket *pkt) {
+static inline int decode(AVCodecContext *avctx, AVFrame *frame, int *got_frame, AVPacket *pkt) {
 	int ret;
 
 	*got_frame = 0;
@@ -343,9 +185,10 @@ int decode(AVCodecContext *avctx, AVFrame *frame, int *got_frame, AVPacket *pkt)
 	return 0;
 }
 
-static int init_transcoder(AVCodecParameters *codecpar, AVCodecContext** in_ctx,
-                           AVCodecContext** out_ctx,
-                           SwrContext** resample_ctx,bool is_transcode_) {
+static inline int init_transcoder(const AVCodecParameters *codecpar, AVCodecContext** in_ctx,
+                                  AVCodecContext** out_ctx,
+                                  SwrContext** resample_ctx,
+                                  AudioOutputMode mode) {
 	int ret = 0;
 	AVCodecContext *in_codec_ctx, *out_codec_ctx;
 
@@ -378,35 +221,53 @@ static int init_transcoder(AVCodecParameters *codecpar, AVCodecContext** in_ctx,
 
 	ret = avcodec_open2(in_codec_ctx, in_codec, NULL);
 	if (ret < 0) {
-		LOG_ERROR("Failed to open decoder %s", get_error_text(ret));
+		char error[AV_ERROR_MAX_STRING_SIZE];
+		LOG_ERROR("Failed to open decoder %s", av_make_error_string(error, sizeof(error), ret));
 		return ret;
 	}
 
 	*in_ctx = in_codec_ctx;
 
+	if (mode == kAudioPcm) {
+		// Decoded samples only have to be interleaved 16-bit ones.
+		if (in_codec_ctx->sample_fmt == AV_SAMPLE_FMT_S16)
+			return 0;
+		int64_t layout = av_get_default_channel_layout(in_codec_ctx->channels);
+		*resample_ctx = swr_alloc_set_opts(NULL, layout, AV_SAMPLE_FMT_S16,
+		                                   in_codec_ctx->sample_rate, layout,
+		                                   in_codec_ctx->sample_fmt,
+		                                   in_codec_ctx->sample_rate, 0, NULL);
+		if (!*resample_ctx) {
+			LOG_ERROR("Could not allocate resample context");
+			return AVERROR(ENOMEM);
+		}
+		if ((ret = swr_init(*resample_ctx)) < 0) {
+			LOG_ERROR("Could not open resample context");
+			swr_free(resample_ctx);
+		}
+		return ret;
+	}
+
+	// Passed through audio is only decoded, to meter its level.
+	if (mode != kAudioTranscode)
+		return 0;
+
 	LOG_INFO("Setup encoder");
 	AVCodec *out_codec = avcodec_find_encoder(AV_CODEC_ID_AAC);
 	if (!out_codec) {
 		LOG_ERROR("No encoder found for AAC");
 		return -1;
 	}
-	if (is_transcode_) {
-		out_codec_ctx = avcodec_alloc_context3(out_codec);
-		out_codec_ctx->profile        = FF_PROFILE_AAC_LOW;
-		out_codec_ctx->channels       = 1;
-		out_codec_ctx->sample_rate    = in_codec_ctx->sample_rate ;
-		out_codec_ctx->channel_layout = av_get_default_channel_layout(out_codec_ctx->channels);
-		out_codec_ctx->sample_fmt     = out_codec->sample_fmts[0];
-		out_codec_ctx->bit_rate       = in_codec_ctx->bit_rate;
-	} else {
-		out_codec_ctx = avcodec_alloc_context3(out_codec);
-		out_codec_ctx->profile        = codecpar->profile;
-		out_codec_ctx->channels       = codecpar->channels;
-		out_codec_ctx->sample_rate    = codecpar->sample_rate ;
-		out_codec_ctx->channel_layout = codecpar->channel_layout;
-		out_codec_ctx->sample_fmt     = (AVSampleFormat)codecpar->format;
-		out_codec_ctx->bit_rate       = codecpar->bit_rate;
-	}
+	out_codec_ctx = avcodec_alloc_context3(out_codec);
+	out_codec_ctx->profile        = FF_PROFILE_AAC_LOW;
+	out_codec_ctx->channels       = 1;
+	out_codec_ctx->sample_rate    = in_codec_ctx->sample_rate ;
+	out_codec_ctx->channel_layout = av_get_default_channel_layout(out_codec_ctx->channels);
+	out_codec_ctx->sample_fmt     = out_codec->sample_fmts[0];
+	out_codec_ctx->bit_rate       = in_codec_ctx->bit_rate;
+	// Frames are timed in samples, the encoder accounts for its delay.
+	out_codec_ctx->time_base.num  = 1;
+	out_codec_ctx->time_base.den  = out_codec_ctx->sample_rate;
 	char out_layout_str[16];
 	av_get_channel_layout_string(out_layout_str, sizeof(out_layout_str), -1,
 	                             out_codec_ctx->channel_layout);
@@ -422,7 +283,9 @@ static int init_transcoder(AVCodecParameters *codecpar, AVCodecContext** in_ctx,
 
 	ret = avcodec_open2(out_codec_ctx, out_codec, NULL);
 	if (ret < 0) {
-		LOG_ERROR("Failed to open encoder %s", get_error_text(ret));
+		char error[AV_ERROR_MAX_STRING_SIZE];
+		LOG_ERROR("Failed to open encoder %s", av_make_error_string(error, sizeof(error), ret));
+		avcodec_free_context(&out_codec_ctx);
 		return ret;
 	}
 
@@ -0,0 +1,268 @@
+#include "worker_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+#include "common.h"
+#include "stage_latency.h"
+
+/// How often worker statistics are gathered.
+static const uint64_t kStatsPeriodUs = 1000000;
+
+WorkerPool::Strand::Strand(WorkerPool* pool, Group group, int priority)
+	: pool_(pool), group_(group), priority_(priority), closed_(false),
+	  queued_(false), running_(false), turn_(0) {}
+
+WorkerPool::Strand::~Strand() {
+	Close();
+}
+
+bool WorkerPool::Strand::PostWork(const pp::CompletionCallback& callback,
+                                  int64_t delay_ms) {
+	std::lock_guard<std::mutex> lock(pool_->mutex_);
+	if (closed_)
+		return false;
+	if (delay_ms > 0) {
+		DelayedWork delayed = {this, callback};
+		uint64_t due_us = StageLatency::NowUs() + delay_ms * 1000;
+		pool_->delayed_.insert(std::make_pair(due_us, delayed));
+		// Idle workers have to wait until the new callback is due at the most.
+		pool_->work_changed_.notify_all();
+		return true;
+	}
+	work_.push_back(callback);
+	if (!running_ && !queued_)
+		pool_->MakeReady(this);
+	return true;
+}
+
+void WorkerPool::Strand::SetPriority(int priority) {
+	std::lock_guard<std::mutex> lock(pool_->mutex_);
+	priority_ = priority;
+}
+
+void WorkerPool::Strand::Close() {
+	std::unique_lock<std::mutex> lock(pool_->mutex_);
+	closed_ = true;
+	work_.clear();
+	if (queued_) {
+		std::vector<Strand*>& ready = pool_->ready_;
+		ready.erase(std::find(ready.begin(), ready.end(), this));
+		queued_ = false;
+	}
+	for (auto it = pool_->delayed_.begin(); it != pool_->delayed_.end();) {
+		if (it->second.strand == this)
+			it = pool_->delayed_.erase(it);
+		else
+			++it;
+	}
+	while (running_)
+		pool_->strand_idle_.wait(lock);
+}
+
+WorkerPool::WorkerPool(const pp::InstanceHandle& instance, uint32_t io_workers,
+                       uint32_t processing_workers)
+	: instance_(instance),
+	  cc_factory_(this),
+	  next_turn_(0),
+	  shutting_down_(false),
+	  stats_period_start_us_(StageLatency::NowUs()) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	for (uint32_t i = 0; i < std::max(io_workers, 1u); ++i)
+		StartWorker(kIo, i);
+	for (uint32_t i = 0; i < std::max(processing_workers, 1u); ++i)
+		StartWorker(kProcessing, i);
+}
+
+WorkerPool::~WorkerPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		shutting_down_ = true;
+		work_changed_.notify_all();
+	}
+	// No workers are added once the pool shuts down.
+	for (auto& worker : workers_)
+		worker->thread.Join();
+}
+
+std::unique_ptr<WorkerPool::Strand> WorkerPool::CreateStrand(Group group,
+                                                             int priority) {
+	return std::unique_ptr<Strand>(new Strand(this, group, priority));
+}
+
+void WorkerPool::SetStatsListener(StatsListener listener) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	stats_listener_ = std::move(listener);
+}
+
+std::vector<WorkerPool::WorkerStats> WorkerPool::GetWorkerStats() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return stats_;
+}
+
+uint32_t WorkerPool::GetWorkerCount(Group group) const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	uint32_t count = 0;
+	for (const auto& worker : workers_) {
+		if (worker->group == group)
+			++count;
+	}
+	return count;
+}
+
+void WorkerPool::RunWorker(int32_t, size_t index) {
+	std::unique_lock<std::mutex> lock(mutex_);
+	Worker* worker = workers_[index].get();
+	while (!shutting_down_) {
+		uint64_t now_us = StageLatency::NowUs();
+		uint64_t next_due_us = FireDelayedWork(now_us);
+		if (UpdateStats(now_us) && stats_listener_ && !IsIdle()) {
+			std::vector<WorkerStats> stats = stats_;
+			StatsListener listener = stats_listener_;
+			lock.unlock();
+			listener(stats);
+			lock.lock();
+			continue;
+		}
+
+		Strand* strand = TakeReady(worker->group);
+		if (!strand) {
+			// Idle workers also wake up to close the statistics period.
+			uint64_t wake_us = stats_period_start_us_ + kStatsPeriodUs;
+			if (next_due_us)
+				wake_us = std::min(wake_us, next_due_us);
+			work_changed_.wait_for(lock, std::chrono::microseconds(
+			    wake_us > now_us ? wake_us - now_us : 0));
+			continue;
+		}
+
+		pp::CompletionCallback callback = strand->work_.front();
+		strand->work_.pop_front();
+		strand->running_ = true;
+		worker->running_since_us = now_us;
+		lock.unlock();
+
+		callback.Run(0);
+
+		uint64_t finished_us = StageLatency::NowUs();
+		lock.lock();
+		uint32_t task_us = static_cast<uint32_t>(finished_us - now_us);
+		worker->busy_us += finished_us - worker->running_since_us;
+		worker->running_since_us = 0;
+		worker->tasks++;
+		worker->max_task_us = std::max(worker->max_task_us, task_us);
+
+		strand->running_ = false;
+		// Other strands of the same priority get their turn first.
+		if (!strand->work_.empty() && !strand->closed_)
+			MakeReady(strand);
+		strand_idle_.notify_all();
+	}
+}
+
+void WorkerPool::MakeReady(Strand* strand) {
+	strand->queued_ = true;
+	strand->turn_ = next_turn_++;
+	ready_.push_back(strand);
+	if (strand->group_ == kIo)
+		GrowIoWorkers();
+	work_changed_.notify_all();
+}
+
+void WorkerPool::StartWorker(Group group, uint32_t index) {
+	size_t worker = workers_.size();
+	workers_.emplace_back(new Worker(instance_, group, index));
+	WorkerStats stats;
+	stats.group = group;
+	stats.index = index;
+	stats_.push_back(stats);
+	workers_[worker]->thread.Start();
+	workers_[worker]->thread.message_loop().PostWork(
+	    cc_factory_.NewCallback(&WorkerPool::RunWorker, worker));
+}
+
+void WorkerPool::GrowIoWorkers() {
+	if (shutting_down_)
+		return;
+	uint32_t workers = 0;
+	uint32_t idle_workers = 0;
+	for (const auto& worker : workers_) {
+		if (worker->group != kIo)
+			continue;
+		++workers;
+		if (!worker->running_since_us)
+			++idle_workers;
+	}
+	uint32_t ready_strands = 0;
+	for (const Strand* strand : ready_) {
+		if (strand->group_ == kIo)
+			++ready_strands;
+	}
+	if (ready_strands <= idle_workers)
+		return;
+	LOG_INFO("All %u I/O workers are busy, starting another one", workers);
+	StartWorker(kIo, workers);
+}
+
+WorkerPool::Strand* WorkerPool::TakeReady(Group group) {
+	auto next = ready_.end();
+	for (auto it = ready_.begin(); it != ready_.end(); ++it) {
+		if ((*it)->group_ != group)
+			continue;
+		if (next == ready_.end() || (*it)->priority_ > (*next)->priority_ ||
+		    ((*it)->priority_ == (*next)->priority_ && (*it)->turn_ < (*next)->turn_))
+			next = it;
+	}
+	if (next == ready_.end())
+		return NULL;
+	Strand* strand = *next;
+	ready_.erase(next);
+	strand->queued_ = false;
+	return strand;
+}
+
+uint64_t WorkerPool::FireDelayedWork(uint64_t now_us) {
+	while (!delayed_.empty() && delayed_.begin()->first <= now_us) {
+		DelayedWork delayed = delayed_.begin()->second;
+		delayed_.erase(delayed_.begin());
+		Strand* strand = delayed.strand;
+		strand->work_.push_back(delayed.callback);
+		if (!strand->running_ && !strand->queued_)
+			MakeReady(strand);
+	}
+	return delayed_.empty() ? 0 : delayed_.begin()->first;
+}
+
+bool WorkerPool::IsIdle() const {
+	for (const WorkerStats& stats : stats_) {
+		if (stats.tasks || stats.utilization)
+			return false;
+	}
+	return true;
+}
+
+bool WorkerPool::UpdateStats(uint64_t now_us) {
+	uint64_t period_us = now_us - stats_period_start_us_;
+	if (period_us < kStatsPeriodUs)
+		return false;
+
+	for (size_t i = 0; i < workers_.size(); ++i) {
+		Worker* worker = workers_[i].get();
+		// A callback still running counts up to now, the rest goes to the next
+		// period.
+		if (worker->running_since_us) {
+			worker->busy_us += now_us - worker->running_since_us;
+			worker->running_since_us = now_us;
+		}
+		stats_[i].utilization =
+		    static_cast<uint32_t>(std::min<uint64_t>(worker->busy_us * 100 / period_us, 100));
+		stats_[i].tasks = worker->tasks;
+		stats_[i].max_task_us = worker->max_task_us;
+		worker->busy_us = 0;
+		worker->tasks = 0;
+		worker->max_task_us = 0;
+	}
+	stats_period_start_us_ = now_us;
+	return true;
+}
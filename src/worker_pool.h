@@ -0,0 +1,232 @@
+#ifndef WORKER_POOL_H_
+#define WORKER_POOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "ppapi/cpp/completion_callback.h"
+#include "ppapi/cpp/instance_handle.h"
+#include "ppapi/utility/completion_callback_factory.h"
+#include "ppapi/utility/threading/simple_thread.h"
+
+/// @file
+/// @brief This file defines the <code>WorkerPool</code> class.
+
+/// @class WorkerPool
+/// @brief Threads all players schedule their work onto.
+///
+/// Work is posted to a <code>Strand</code> instead of a thread of its own.
+/// Callbacks of one strand run in the order they were posted and never
+/// concurrently, so a strand keeps the ordering a dedicated thread gave.
+/// Strands belong to one of two groups of workers: I/O workers, which may
+/// block in network reads, and processing workers, which convert and append
+/// packets and should not block. A free worker of a group takes the strand
+/// with the highest priority, strands of the same priority take turns after
+/// every callback, so long running work has to be split into callbacks which
+/// post the next one.
+///
+/// A read blocks its I/O worker until it times out, for seconds while a
+/// camera is unreachable, so the I/O group grows: when a strand becomes ready
+/// while every I/O worker is busy, another one is started. There are never
+/// more I/O workers than I/O strands running at once, and they are kept until
+/// the pool is destroyed. Processing workers are fixed.
+class WorkerPool {
+	public:
+		/// @enum Group
+		/// Groups of workers a strand can run on.
+		enum Group {
+			kIo,
+			kProcessing,
+		};
+
+		/// @struct WorkerStats
+		/// Utilization of one worker in the latest statistics period.
+		struct WorkerStats {
+			WorkerStats() : group(kIo), index(0), utilization(0), tasks(0), max_task_us(0) {}
+
+			Group group;
+			/// A number of the worker within its group.
+			uint32_t index;
+			/// A percentage of the period spent running callbacks. Time blocked in
+			/// network reads counts, so I/O workers are rarely idle.
+			uint32_t utilization;
+			/// Callbacks finished in the period and the longest of them.
+			uint32_t tasks;
+			uint32_t max_task_us;
+		};
+
+		/// Worker counts for a 4-core TV: reads mostly wait for the network, so
+		/// there are more I/O workers than processing ones. I/O workers start
+		/// with this many and grow while all of them are blocked.
+		static const uint32_t kDefaultIoWorkers = 4;
+		static const uint32_t kDefaultProcessingWorkers = 2;
+
+		/// Receives the statistics of all workers once per period, on the worker
+		/// which noticed the period has passed. Periods in which no work ran are
+		/// not reported.
+		typedef std::function<void(const std::vector<WorkerStats>&)> StatsListener;
+
+		/// @class Strand
+		/// @brief A serial queue of callbacks run by the workers of one group.
+		///
+		/// A strand has to be destroyed before the pool it was created by.
+		class Strand {
+			public:
+				/// Closes the strand.
+				~Strand();
+
+				Strand(const Strand&) = delete;
+				Strand& operator=(const Strand&) = delete;
+
+				/// Queues <code>callback</code> to be run with 0 after the callbacks
+				/// posted before it, or <code>delay_ms</code> from now.
+				///
+				/// @return False if the strand is closed, the callback is dropped.
+				bool PostWork(const pp::CompletionCallback& callback, int64_t delay_ms = 0);
+
+				/// Changes the priority, callbacks already queued are affected too.
+				void SetPriority(int priority);
+
+				/// Drops queued and delayed callbacks, rejects further ones and
+				/// waits for the running callback to return. It must not be called
+				/// from a callback of this strand, which would wait for itself.
+				void Close();
+
+			private:
+				friend class WorkerPool;
+
+				Strand(WorkerPool* pool, Group group, int priority);
+
+				WorkerPool* pool_;
+				Group group_;
+
+				// Guarded by the mutex of the pool.
+				int priority_;
+				std::deque<pp::CompletionCallback> work_;
+				bool closed_;
+				/// True while the strand waits in <code>ready_</code>.
+				bool queued_;
+				/// True while a worker runs a callback of the strand.
+				bool running_;
+				/// Orders ready strands of the same priority, lower goes first.
+				uint64_t turn_;
+		};
+
+		/// Starts the workers.
+		///
+		/// @param[in] instance A handle to the plugin instance.
+		/// @param[in] io_workers A number of I/O workers started at once, at
+		///   least 1. More are started while all of them are busy.
+		/// @param[in] processing_workers A number of processing workers, at
+		///   least 1.
+		WorkerPool(const pp::InstanceHandle& instance, uint32_t io_workers,
+		           uint32_t processing_workers);
+
+		/// Drops pending work and joins the workers.
+		~WorkerPool();
+
+		WorkerPool(const WorkerPool&) = delete;
+		WorkerPool& operator=(const WorkerPool&) = delete;
+
+		/// Creates a strand running on the workers of <code>group</code>.
+		///
+		/// @param[in] priority Strands with a higher priority run first, e.g.
+		///   the ones of the focused camera.
+		std::unique_ptr<Strand> CreateStrand(Group group, int priority);
+
+		/// Sets a listener of the periodic worker statistics.
+		void SetStatsListener(StatsListener listener);
+
+		/// Returns the statistics of the latest complete period.
+		std::vector<WorkerStats> GetWorkerStats();
+
+		/// Returns the number of workers of <code>group</code> started so far.
+		uint32_t GetWorkerCount(Group group) const;
+
+	private:
+		struct Worker {
+			Worker(const pp::InstanceHandle& instance, Group worker_group, uint32_t worker_index)
+				: thread(instance), group(worker_group), index(worker_index),
+				  running_since_us(0), busy_us(0), tasks(0), max_task_us(0) {}
+
+			pp::SimpleThread thread;
+			Group group;
+			uint32_t index;
+			/// When the running callback started, or the period if it started
+			/// earlier, 0 while idle.
+			uint64_t running_since_us;
+			/// Accumulated in the current period.
+			uint64_t busy_us;
+			uint32_t tasks;
+			uint32_t max_task_us;
+		};
+
+		/// A callback posted with a delay, moved to its strand once due.
+		struct DelayedWork {
+			Strand* strand;
+			pp::CompletionCallback callback;
+		};
+
+		/// Runs callbacks until the pool is destroyed. Posted once to each
+		/// worker's message loop.
+		void RunWorker(int32_t, size_t worker);
+
+		/// Queues the strand among the ready ones, the mutex has to be held.
+		void MakeReady(Strand* strand);
+
+		/// Starts a worker of <code>group</code>, the mutex has to be held.
+		void StartWorker(Group group, uint32_t index);
+
+		/// Starts another I/O worker if the ready I/O strands outnumber the idle
+		/// I/O workers. The mutex has to be held.
+		void GrowIoWorkers();
+
+		/// Takes the ready strand which goes next on <code>group</code>, NULL if
+		/// there is none. The mutex has to be held.
+		Strand* TakeReady(Group group);
+
+		/// Moves due delayed callbacks to their strands and returns when the
+		/// next one is due, 0 if there is none. The mutex has to be held.
+		uint64_t FireDelayedWork(uint64_t now_us);
+
+		/// Closes the statistics period if it is over. The mutex has to be
+		/// held.
+		/// @return True if <code>stats_</code> was updated.
+		bool UpdateStats(uint64_t now_us);
+
+		/// Returns true if no work ran in the latest period. The mutex has to
+		/// be held.
+		bool IsIdle() const;
+
+		pp::InstanceHandle instance_;
+		pp::CompletionCallbackFactory<WorkerPool> cc_factory_;
+
+		mutable std::mutex mutex_;
+		/// Guarded by the mutex, since I/O workers are added while the others
+		/// run. Workers are never removed, so pointers to them stay valid.
+		std::vector<std::unique_ptr<Worker> > workers_;
+		/// Signalled when work is ready, delayed work is posted or the pool
+		/// shuts down.
+		std::condition_variable work_changed_;
+		/// Signalled when a strand finishes a callback, for
+		/// <code>Strand::Close()</code>.
+		std::condition_variable strand_idle_;
+		std::vector<Strand*> ready_;
+		std::multimap<uint64_t, DelayedWork> delayed_;
+		uint64_t next_turn_;
+		bool shutting_down_;
+
+		uint64_t stats_period_start_us_;
+		std::vector<WorkerStats> stats_;
+		StatsListener stats_listener_;
+};
+
+#endif  // WORKER_POOL_H_